@@ -0,0 +1,122 @@
+#include "resource_utils.hpp"
+#include "sme/logger.hpp"
+#include "sme/model.hpp"
+#include "sme/simulate.hpp"
+#include "sme/version.hpp"
+#include <QElapsedTimer>
+#include <algorithm>
+#include <fmt/core.h>
+#include <string>
+#include <vector>
+
+using namespace sme;
+
+struct DuneParams {
+  double simulation_time{1e-2};
+  std::vector<const char *> models{
+      "single-compartment-diffusion-3d", "very-simple-model-3d",
+      "gray-scott-3d",                   "FitzhughNagumo3D",
+      "SelKov3D",                        "CalciumWavePropagation3D"};
+  std::vector<std::string> linear_solvers{"RestartedGMRes", "BiCGSTAB"};
+  std::vector<std::string> preconditioners{"",    "Jacobi", "SSOR",
+                                           "ILU", "AMG"};
+  std::size_t max_threads{0};
+};
+
+static void printHelpMessage() {
+  DuneParams params;
+  fmt::print("\nUsage:\n");
+  fmt::print("\n./dune [simulation_time=1e-2] [model=all] [max_threads=0]\n");
+  fmt::print("\nPossible values for model:\n");
+  for (const auto &model : params.models) {
+    fmt::print("  - {}\n", model);
+  }
+  fmt::print("  - all: all of the above\n");
+}
+
+static DuneParams parseArgs(int argc, char *argv[]) {
+  DuneParams params;
+  if (argc < 2) {
+    return params;
+  }
+  if (std::string a = argv[1]; (a == "-h") || (a == "--help")) {
+    printHelpMessage();
+    exit(0);
+  } else {
+    params.simulation_time = std::stod(argv[1]);
+  }
+  if (argc > 2) {
+    if (std::string arg = argv[2]; arg != "all") {
+      if (auto iter = std::find_if(
+              cbegin(params.models), cend(params.models),
+              [&arg](const std::string &s) { return s.starts_with(arg); });
+          iter != cend(params.models)) {
+        params.models = {*iter};
+      } else {
+        fmt::print("\nERROR: model '{}' not found\n", arg);
+        printHelpMessage();
+        exit(1);
+      }
+    }
+  }
+  if (argc > 3) {
+    params.max_threads = static_cast<std::size_t>(std::stoi(argv[3]));
+  }
+  fmt::print("\n# DUNE linear solver benchmark parameters:\n");
+  fmt::print("# simulation_time: {}\n", params.simulation_time);
+  fmt::print("# max_threads: {}\n", params.max_threads);
+  return params;
+}
+
+static void printDuneLinearSolvers(const DuneParams &params) {
+  // resources contain example models
+  Q_INIT_RESOURCE(resources);
+  // disable logging
+  spdlog::set_level(spdlog::level::off);
+
+  fmt::print("\n# {:28s}\t{:16s}\t{:14s}\t{:>8s}\t{:>12s}\n", "model",
+             "linear solver", "preconditioner", "steps", "ms/step");
+  for (const auto &modelName : params.models) {
+    for (const auto &linearSolver : params.linear_solvers) {
+      for (const auto &preconditioner : params.preconditioners) {
+        model::Model s;
+        s.importSBMLString(benchmarking::readResourceTextFile(
+            QString(":/models/%1.xml").arg(modelName)));
+        auto &settings{s.getSimulationSettings()};
+        settings.simulatorType = simulate::SimulatorType::DUNE;
+        settings.options.dune.linearSolver = linearSolver;
+        settings.options.dune.preconditioner = preconditioner;
+        settings.options.dune.maxThreads = params.max_threads;
+        fmt::print("  {:28s}\t{:16s}\t{:14s}", modelName, linearSolver,
+                   preconditioner.empty() ? "(default)" : preconditioner);
+        fflush(stdout);
+        simulate::Simulation sim(s);
+        QElapsedTimer time;
+        time.start();
+        std::size_t steps{0};
+        if (sim.errorMessage().empty()) {
+          steps = sim.doTimesteps(params.simulation_time);
+        }
+        auto elapsed{static_cast<double>(time.elapsed())};
+        if (!sim.errorMessage().empty() || steps == 0) {
+          auto msg{sim.errorMessage()};
+          if (msg.size() > 40) {
+            msg = msg.substr(0, 37) + "...";
+          }
+          fmt::print("\t{}\n", msg);
+          continue;
+        }
+        fmt::print("\t{:>8d}\t{:>12.3f}\n", steps,
+                   elapsed / static_cast<double>(steps));
+      }
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+  fmt::print("# Spatial Model Editor v{}\n",
+             common::SPATIAL_MODEL_EDITOR_VERSION);
+  fmt::print("# DUNE linear solver and preconditioner benchmark code\n");
+  auto params = parseArgs(argc, argv);
+  printDuneLinearSolvers(params);
+}
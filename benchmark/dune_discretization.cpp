@@ -0,0 +1,182 @@
+#include "resource_utils.hpp"
+#include "sme/logger.hpp"
+#include "sme/mesh2d.hpp"
+#include "sme/model.hpp"
+#include "sme/simulate.hpp"
+#include "sme/version.hpp"
+#include <QElapsedTimer>
+#include <algorithm>
+#include <cmath>
+#include <fmt/core.h>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace sme;
+
+struct DuneDiscretizationParams {
+  double simulation_time{1.0};
+  std::vector<const char *> models{"ABtoC", "single-compartment-diffusion",
+                                   "very-simple-model", "gray-scott",
+                                   "brusselator-model"};
+  std::vector<std::pair<simulate::DuneDiscretizationType, const char *>>
+      discretizations{{simulate::DuneDiscretizationType::FEM1, "FEM1"},
+                      {simulate::DuneDiscretizationType::FEM2, "FEM2"}};
+  // mesh refinement levels: each level divides the max triangle area by 4
+  std::size_t refinement_levels{3};
+};
+
+// concentrations of all species in all compartments at the final timepoint
+using Concentrations = std::vector<std::vector<double>>;
+
+static void printHelpMessage() {
+  DuneDiscretizationParams params;
+  fmt::print("\nUsage:\n");
+  fmt::print("\n./dune_discretization [simulation_time=1.0] [model=all] "
+             "[refinement_levels=3]\n");
+  fmt::print("\nPossible values for model:\n");
+  for (const auto &model : params.models) {
+    fmt::print("  - {}\n", model);
+  }
+  fmt::print("  - all: all of the above\n");
+}
+
+static DuneDiscretizationParams parseArgs(int argc, char *argv[]) {
+  DuneDiscretizationParams params;
+  if (argc < 2) {
+    return params;
+  }
+  if (std::string a = argv[1]; (a == "-h") || (a == "--help")) {
+    printHelpMessage();
+    exit(0);
+  } else {
+    params.simulation_time = std::stod(argv[1]);
+  }
+  if (argc > 2) {
+    if (std::string arg = argv[2]; arg != "all") {
+      if (auto iter = std::find_if(
+              cbegin(params.models), cend(params.models),
+              [&arg](const std::string &s) { return s.starts_with(arg); });
+          iter != cend(params.models)) {
+        params.models = {*iter};
+      } else {
+        fmt::print("\nERROR: model '{}' not found\n", arg);
+        printHelpMessage();
+        exit(1);
+      }
+    }
+  }
+  if (argc > 3) {
+    params.refinement_levels = static_cast<std::size_t>(std::stoi(argv[3]));
+  }
+  fmt::print("\n# DUNE discretization benchmark parameters:\n");
+  fmt::print("# simulation_time: {}\n", params.simulation_time);
+  fmt::print("# refinement_levels: {}\n", params.refinement_levels);
+  return params;
+}
+
+static void refineMesh(model::Model &s, std::size_t level) {
+  auto *mesh{s.getGeometry().getMesh2d()};
+  if (mesh == nullptr) {
+    return;
+  }
+  auto maxAreas{mesh->getCompartmentMaxTriangleArea()};
+  for (std::size_t i = 0; i < maxAreas.size(); ++i) {
+    auto area{maxAreas[i] >> (2 * level)};
+    mesh->setCompartmentMaxTriangleArea(i, std::max(area, std::size_t{1}));
+  }
+}
+
+static std::optional<Concentrations>
+runSimulation(const std::string &modelName, double simulationTime,
+              simulate::DuneDiscretizationType discretization,
+              std::size_t level, double &elapsedMs,
+              std::string &errorMessage) {
+  model::Model s;
+  s.importSBMLString(benchmarking::readResourceTextFile(
+      QString(":/models/%1.xml").arg(modelName.c_str())));
+  refineMesh(s, level);
+  auto &settings{s.getSimulationSettings()};
+  settings.simulatorType = simulate::SimulatorType::DUNE;
+  settings.options.dune.discretization = discretization;
+  simulate::Simulation sim(s);
+  QElapsedTimer time;
+  time.start();
+  if (sim.errorMessage().empty()) {
+    sim.doTimesteps(simulationTime);
+  }
+  elapsedMs = static_cast<double>(time.elapsed());
+  if (!sim.errorMessage().empty()) {
+    errorMessage = sim.errorMessage();
+    return {};
+  }
+  Concentrations concs;
+  auto timeIndex{sim.getTimePoints().size() - 1};
+  for (std::size_t ic = 0; ic < sim.getCompartmentIds().size(); ++ic) {
+    for (std::size_t is = 0; is < sim.getSpeciesIds(ic).size(); ++is) {
+      concs.push_back(sim.getConc(timeIndex, ic, is));
+    }
+  }
+  return concs;
+}
+
+static double relativeL2Error(const Concentrations &concs,
+                              const Concentrations &reference) {
+  double diff{0};
+  double norm{0};
+  for (std::size_t i = 0; i < reference.size(); ++i) {
+    for (std::size_t j = 0; j < reference[i].size(); ++j) {
+      diff += std::pow(concs[i][j] - reference[i][j], 2);
+      norm += std::pow(reference[i][j], 2);
+    }
+  }
+  return norm > 0 ? std::sqrt(diff / norm) : std::sqrt(diff);
+}
+
+static void printDuneDiscretizations(const DuneDiscretizationParams &params) {
+  // resources contain example models
+  Q_INIT_RESOURCE(resources);
+  // disable logging
+  spdlog::set_level(spdlog::level::off);
+
+  fmt::print("\n# {:28s}\t{:8s}\t{:>6s}\t{:>12s}\t{:>12s}\n", "model",
+             "method", "level", "ms", "rel L2 error");
+  for (const std::string &modelName : params.models) {
+    // reference solution: FEM2 on a mesh one level finer than the finest
+    double elapsed{0};
+    std::string msg;
+    auto reference{runSimulation(modelName, params.simulation_time,
+                                 simulate::DuneDiscretizationType::FEM2,
+                                 params.refinement_levels, elapsed, msg)};
+    if (!reference.has_value()) {
+      fmt::print("  {:28s}\treference failed: {}\n", modelName, msg);
+      continue;
+    }
+    for (const auto &[discretization, name] : params.discretizations) {
+      for (std::size_t level = 0; level < params.refinement_levels; ++level) {
+        fmt::print("  {:28s}\t{:8s}\t{:>6d}", modelName, name, level);
+        fflush(stdout);
+        auto concs{runSimulation(modelName, params.simulation_time,
+                                 discretization, level, elapsed, msg)};
+        if (!concs.has_value()) {
+          if (msg.size() > 40) {
+            msg = msg.substr(0, 37) + "...";
+          }
+          fmt::print("\t{}\n", msg);
+          continue;
+        }
+        fmt::print("\t{:>12.0f}\t{:>12.4e}\n", elapsed,
+                   relativeL2Error(concs.value(), reference.value()));
+      }
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+  fmt::print("# Spatial Model Editor v{}\n",
+             common::SPATIAL_MODEL_EDITOR_VERSION);
+  fmt::print("# DUNE discretization convergence vs cost benchmark code\n");
+  auto params = parseArgs(argc, argv);
+  printDuneDiscretizations(params);
+}
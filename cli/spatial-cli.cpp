@@ -11,6 +11,10 @@ int main(int argc, char *argv[]) {
   } catch (const CLI::ParseError &e) {
     return app.exit(e);
   }
+  if (params.command == "fit-worker") {
+    return sme::cli::runFitWorker();
+  }
+  params.program = argv[0];
   if (params.outputFile.empty()) {
     params.outputFile = params.inputFile;
   }
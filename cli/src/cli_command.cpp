@@ -3,9 +3,14 @@
 #include "sme/model.hpp"
 #include "sme/optimize.hpp"
 #include "sme/simulate.hpp"
+#include "sme/simulate_checkpoint.hpp"
+#include "sme/simulate_data_journal.hpp"
 #include <QFile>
 #include <fmt/core.h>
 #include <fmt/ranges.h>
+#include <iostream>
+#include <memory>
+#include <optional>
 
 namespace sme::cli {
 
@@ -19,6 +24,11 @@ static void applySimulationOptionOverrides(model::Model &model,
   if (params.simType.has_value()) {
     settings.simulatorType = params.simType.value();
   }
+  if (params.sim.memoryBudgetMegabytes.has_value()) {
+    constexpr std::size_t bytesPerMegabyte{1024 * 1024};
+    settings.memoryBudgetBytes =
+        params.sim.memoryBudgetMegabytes.value() * bytesPerMegabyte;
+  }
   auto &opt{settings.options};
   if (params.maxThreads.has_value()) {
     opt.dune.maxThreads = params.maxThreads.value();
@@ -27,6 +37,9 @@ static void applySimulationOptionOverrides(model::Model &model,
       opt.pixel.enableMultiThreading = (params.maxThreads.value() != 1);
     }
   }
+  if (params.sim.duneDiscretization.has_value()) {
+    opt.dune.discretization = params.sim.duneDiscretization.value();
+  }
   if (params.sim.duneIntegrator.has_value()) {
     opt.dune.integrator = params.sim.duneIntegrator.value();
   }
@@ -57,9 +70,15 @@ static void applySimulationOptionOverrides(model::Model &model,
   if (params.sim.duneLinearSolver.has_value()) {
     opt.dune.linearSolver = params.sim.duneLinearSolver.value();
   }
+  if (params.sim.dunePreconditioner.has_value()) {
+    opt.dune.preconditioner = params.sim.dunePreconditioner.value();
+  }
   if (params.sim.duneMaxThreads.has_value()) {
     opt.dune.maxThreads = params.sim.duneMaxThreads.value();
   }
+  if (params.sim.duneAdaptiveMesh.has_value()) {
+    opt.dune.adaptiveMesh = params.sim.duneAdaptiveMesh.value();
+  }
   if (params.sim.pixelIntegrator.has_value()) {
     opt.pixel.integrator = params.sim.pixelIntegrator.value();
   }
@@ -155,6 +174,33 @@ bool runCommand(const Params &params) {
       }
     }
     printSimulationTimes(times);
+    const auto &journalFile{params.sim.resultsJournalFile};
+    std::optional<simulate::SimulationDataJournalContents> journalContents{};
+    if (!journalFile.empty() && params.sim.continueExistingSimulation) {
+      journalContents = simulate::readSimulationDataJournal(journalFile);
+      if (journalContents.has_value() &&
+          journalContents->requestedTimes != times) {
+        fmt::print("\n# Ignoring results journal '{}' from a simulation "
+                   "with different simulation times\n",
+                   journalFile);
+        journalContents.reset();
+      }
+    }
+    auto remainingTimes{times};
+    if (journalContents.has_value()) {
+      const auto nCompleted{journalContents->nCompletedTimesteps()};
+      fmt::print("\n# Resuming from results journal '{}' with {} completed "
+                 "timesteps\n",
+                 journalFile, nCompleted);
+      auto [completedTimes, notCompletedTimes] =
+          simulate::splitSimulationTimes(times, nCompleted);
+      auto &settingsTimes{s.getSimulationSettings().times};
+      settingsTimes = journalContents->previousTimes;
+      settingsTimes.insert(settingsTimes.end(), completedTimes.cbegin(),
+                           completedTimes.cend());
+      s.getSimulationData() = std::move(journalContents->data);
+      remainingTimes = std::move(notCompletedTimes);
+    }
     simulate::Simulation sim(s);
     if (const auto &e = sim.errorMessage(); !e.empty()) {
       fmt::print("\n\nError in simulation setup: {}\n\n", e);
@@ -163,10 +209,82 @@ bool runCommand(const Params &params) {
 
     printSimulationInfo(s);
 
+    std::unique_ptr<simulate::SimulationDataJournal> journal{};
+    if (!journalFile.empty()) {
+      if (journalContents.has_value()) {
+        journal = std::make_unique<simulate::SimulationDataJournal>(
+            journalFile, journalContents.value(),
+            params.sim.resultsJournalSyncInterval);
+      } else {
+        const auto &data{s.getSimulationData()};
+        // existing times are discarded if there is only an initial timepoint
+        const auto previousTimes{
+            data.size() > 1
+                ? s.getSimulationSettings().times
+                : std::vector<std::pair<std::size_t, double>>{}};
+        journal = std::make_unique<simulate::SimulationDataJournal>(
+            journalFile, data, previousTimes, times,
+            params.sim.resultsJournalSyncInterval);
+      }
+      if (!journal->isValid()) {
+        fmt::print("\n\nError: failed to write results journal '{}'\n\n",
+                   journalFile);
+        return false;
+      }
+    }
+    const auto &checkpointFile{params.sim.solverCheckpointFile};
+    if (!checkpointFile.empty() && params.sim.continueExistingSimulation) {
+      if (auto checkpoint{simulate::importSolverCheckpoint(checkpointFile)};
+          checkpoint.has_value()) {
+        if (sim.applySolverCheckpoint(checkpoint.value())) {
+          fmt::print("\n# Resuming solver from checkpoint '{}' with timestep "
+                     "{}\n",
+                     checkpointFile, checkpoint->timestep);
+        } else {
+          fmt::print("\n# Ignoring solver checkpoint '{}' from time {}\n",
+                     checkpointFile, checkpoint->time);
+        }
+      }
+    }
+    // a journal that fails to be written is only valid up to the previous
+    // timepoint, so it is closed and no longer used
+    bool journalFailed{false};
+    bool writeCheckpoints{!checkpointFile.empty()};
+    if (journal != nullptr || writeCheckpoints) {
+      sim.setTimepointCallback([&journal, &journalFailed, &writeCheckpoints,
+                                &journalFile, &s, &sim,
+                                &checkpointFile](std::size_t timeIndex) {
+        if (journal != nullptr &&
+            !journal->append(s.getSimulationData(), timeIndex)) {
+          fmt::print("
+# Error: failed to write timepoint {} to results "
+                     "journal '{}': no further timepoints will be "
+                     "journalled\n",
+                     timeIndex, journalFile);
+          journal.reset();
+          journalFailed = true;
+        }
+        if (writeCheckpoints) {
+          if (auto checkpoint{sim.getSolverCheckpoint()};
+              checkpoint.has_value() &&
+              !simulate::exportSolverCheckpoint(checkpointFile,
+                                                checkpoint.value())) {
+            fmt::print("
+# Error: failed to write solver checkpoint '{}' at "
+                       "timepoint {}: no further checkpoints will be "
+                       "written\n",
+                       checkpointFile, timeIndex);
+            writeCheckpoints = false;
+          }
+        }
+      });
+    }
+
     const auto timeoutMilliseconds = params.sim.timeoutSeconds < 0.0
                                          ? -1.0
                                          : 1000.0 * params.sim.timeoutSeconds;
-    sim.doMultipleTimesteps(times, timeoutMilliseconds);
+    sim.doMultipleTimesteps(remainingTimes, timeoutMilliseconds);
+    journal.reset();
     if (const auto &e = sim.errorMessage();
         !e.empty() &&
         (params.sim.throwOnTimeout || !simulationStoppedOrTimedOut(e))) {
@@ -175,28 +293,79 @@ bool runCommand(const Params &params) {
     } else if (const auto &e = sim.errorMessage();
                !e.empty() && !params.sim.throwOnTimeout) {
       fmt::print("\n# Simulation exited early: {}\n", e);
+    } else if (!journalFile.empty()) {
+      if (!s.exportSMEFile(params.outputFile)) {
+        if (journalFailed) {
+          fmt::print("\n\nError: failed to write output file '{}'\n\n",
+                     params.outputFile);
+        } else {
+          fmt::print("\n\nError: failed to write output file '{}': the "
+                     "results are still in the results journal '{}'\n\n",
+                     params.outputFile, journalFile);
+        }
+        return false;
+      }
+      // all results are in the output file: journal no longer needed
+      QFile::remove(journalFile.c_str());
+      return true;
     }
   } else if (params.command == "fit") {
     s.getOptimizeOptions().optAlgorithm.optAlgorithmType = params.fit.algorithm;
     s.getOptimizeOptions().optAlgorithm.population =
         params.fit.populationPerThread;
     s.getOptimizeOptions().optAlgorithm.islands = params.fit.nThreads;
-    simulate::Optimization optimization(s);
-    fmt::print("# {:19}\t{:19}\n", "Fitness",
+    s.getOptimizeOptions().optAlgorithm.earlyTerminationFactor =
+        params.fit.earlyTerminationFactor;
+    s.getOptimizeOptions().optAlgorithm.coarseningFactor =
+        params.fit.coarseningFactor;
+    s.getOptimizeOptions().optAlgorithm.adjointGradient =
+        params.fit.adjointGradient;
+    simulate::OptWorkerOptions workerOptions{params.fit.nWorkers,
+                                             params.program,
+                                             {"fit-worker"},
+                                             params.fit.workerTimeout * 1000};
+    simulate::Optimization optimization(s, workerOptions);
+    if (!params.fit.fitnessCacheFile.empty() &&
+        !optimization.setFitnessCacheFile(params.fit.fitnessCacheFile)) {
+      fmt::print("\n\nError during optimization: {}\n\n",
+                 optimization.getErrorMessage());
+      return false;
+    }
+    // fitness values are only comparable at the same coarsening factor
+    const bool printFactor{params.fit.coarseningFactor > 1};
+    fmt::print("# {:19}\t{}{:19}\n", "Fitness",
+               printFactor ? "Coarsening\t" : "",
                fmt::join(optimization.getParamNames(), "\t"));
-    optimization.evolve(params.fit.nIterations,
-                        [](double fitness, const std::vector<double> &pars) {
-                          fmt::print("{:.13e}\t{:.13e}\n", fitness,
-                                     fmt::join(pars, "\t"));
-                        });
+    optimization.evolve(
+        params.fit.nIterations,
+        [&optimization, printFactor](double fitness,
+                                     const std::vector<double> &pars) {
+          if (printFactor) {
+            fmt::print("{:.13e}\t{}\t{:.13e}\n", fitness,
+                       optimization.getCoarseningFactors().back(),
+                       fmt::join(pars, "\t"));
+          } else {
+            fmt::print("{:.13e}\t{:.13e}\n", fitness, fmt::join(pars, "\t"));
+          }
+        });
     if (const auto &e = optimization.getErrorMessage(); !e.empty()) {
       fmt::print("\n\nError during optimization: {}\n\n", e);
       return false;
     }
     optimization.applyParametersToModel(&s);
   }
-  s.exportSMEFile(params.outputFile);
+  if (!s.exportSMEFile(params.outputFile)) {
+    fmt::print("\n\nError: failed to write output file '{}'\n\n",
+               params.outputFile);
+    return false;
+  }
   return true;
 }
 
+int runFitWorker() {
+  // stdout is used to communicate with the parent process
+  spdlog::set_level(spdlog::level::off);
+  return simulate::runOptimizationWorker(std::cin, std::cout);
+}
+
 } // namespace sme::cli
@@ -6,4 +6,6 @@ namespace sme::cli {
 
 bool runCommand(const Params &params);
 
+int runFitWorker();
+
 } // namespace sme::cli
@@ -1,6 +1,8 @@
 #include "catch_wrapper.hpp"
 #include "cli_command.hpp"
 #include "sme/model.hpp"
+#include "sme/simulate_checkpoint.hpp"
+#include "sme/simulate_data_journal.hpp"
 #include <QFile>
 #include <optional>
 
@@ -107,6 +109,101 @@ TEST_CASE("CLI Simulate", "[cli][simulate]") {
     REQUIRE(m6.getSimulationData().timePoints.size() == 7);
     REQUIRE(m6.getSimulationData().timePoints[6] == dbl_approx(0.60));
   }
+  SECTION("Results journal, pixel sim") {
+    const char *tmpInputFile{"tmpcli5.xml"};
+    const char *tmpOutputFile{"tmpcli5.sme"};
+    const char *tmpJournalFile{"tmpcli5.journal"};
+    QFile::remove(tmpInputFile);
+    QFile::remove(tmpOutputFile);
+    QFile::remove(tmpJournalFile);
+    QFile::copy(":/models/ABtoC.xml", tmpInputFile);
+    cli::Params params;
+    params.command = "simulate";
+    params.inputFile = tmpInputFile;
+    params.sim.simulationTimes = "0.2";
+    params.sim.imageIntervals = "0.1";
+    params.sim.resultsJournalFile = tmpJournalFile;
+    params.outputFile = tmpOutputFile;
+    params.simType = simulate::SimulatorType::Pixel;
+    cli::printParams(params);
+    REQUIRE(cli::runCommand(params));
+    // journal is removed after successful completion
+    REQUIRE(!QFile::exists(tmpJournalFile));
+    model::Model m;
+    m.importFile(tmpOutputFile);
+    const auto &data{m.getSimulationData()};
+    REQUIRE(data.timePoints.size() == 3);
+    // journal from an interrupted run with one of two timesteps completed
+    model::Model mInitial;
+    mInitial.importFile(tmpOutputFile);
+    mInitial.getSimulationData().pop_back();
+    mInitial.getSimulationData().pop_back();
+    {
+      simulate::SimulationDataJournal journal(
+          tmpJournalFile, mInitial.getSimulationData(), {}, {{2, 0.1}});
+      REQUIRE(journal.isValid());
+      REQUIRE(journal.append(data, 1));
+    }
+    // running the same command again resumes from the journal
+    REQUIRE(cli::runCommand(params));
+    REQUIRE(!QFile::exists(tmpJournalFile));
+    model::Model m2;
+    m2.importFile(tmpOutputFile);
+    const auto &data2{m2.getSimulationData()};
+    REQUIRE(data2.timePoints.size() == 3);
+    REQUIRE(data2.timePoints[1] == dbl_approx(0.1));
+    REQUIRE(data2.timePoints[2] == dbl_approx(0.2));
+    REQUIRE(data2.concentration[1] == data.concentration[1]);
+    // output file can't be written: journal is kept
+    params.sim.continueExistingSimulation = false;
+    params.outputFile = "tmpcli5_missing_dir/tmpcli5.sme";
+    REQUIRE(!cli::runCommand(params));
+    REQUIRE(QFile::exists(tmpJournalFile));
+    auto contents{simulate::readSimulationDataJournal(tmpJournalFile)};
+    REQUIRE(contents.has_value());
+    REQUIRE(contents->data.timePoints.size() == 3);
+  }
+  SECTION("Solver checkpoint, pixel sim") {
+    const char *tmpInputFile{"tmpcli6.xml"};
+    const char *tmpOutputFile{"tmpcli6.sme"};
+    const char *tmpCheckpointFile{"tmpcli6.checkpoint"};
+    QFile::remove(tmpInputFile);
+    QFile::remove(tmpOutputFile);
+    QFile::remove(tmpCheckpointFile);
+    QFile::copy(":/models/ABtoC.xml", tmpInputFile);
+    cli::Params params;
+    params.command = "simulate";
+    params.inputFile = tmpInputFile;
+    params.sim.simulationTimes = "0.2";
+    params.sim.imageIntervals = "0.1";
+    params.sim.solverCheckpointFile = tmpCheckpointFile;
+    params.outputFile = tmpOutputFile;
+    params.simType = simulate::SimulatorType::Pixel;
+    cli::printParams(params);
+    REQUIRE(cli::runCommand(params));
+    // checkpoint of the last timepoint is kept for later continuation
+    auto checkpoint{simulate::importSolverCheckpoint(tmpCheckpointFile)};
+    REQUIRE(checkpoint.has_value());
+    REQUIRE(checkpoint->simulatorType == simulate::SimulatorType::Pixel);
+    REQUIRE(checkpoint->time == dbl_approx(0.2));
+    REQUIRE(checkpoint->timestep > 0.0);
+    // continue the simulation from the output file & checkpoint
+    params.inputFile = tmpOutputFile;
+    params.sim.simulationTimes = "0.1";
+    params.sim.imageIntervals = "0.1";
+    REQUIRE(cli::runCommand(params));
+    model::Model m;
+    m.importFile(tmpOutputFile);
+    REQUIRE(m.getSimulationData().timePoints.size() == 4);
+    checkpoint = simulate::importSolverCheckpoint(tmpCheckpointFile);
+    REQUIRE(checkpoint.has_value());
+    REQUIRE(checkpoint->time == dbl_approx(0.3));
+    // checkpoint can't be written: simulation still completes
+    params.sim.solverCheckpointFile = "tmpcli6_missing_dir/tmpcli6.checkpoint";
+    REQUIRE(cli::runCommand(params));
+    m.importFile(tmpOutputFile);
+    REQUIRE(m.getSimulationData().timePoints.size() == 5);
+  }
   SECTION("Invalid partial simulation times") {
     const char *tmpInputFile{"tmpcli4.xml"};
     const char *tmpOutputFile{"tmpcli4.sme"};
@@ -139,4 +236,29 @@ TEST_CASE("CLI Simulate", "[cli][simulate]") {
     cli::printParams(params);
     cli::runCommand(params);
   }
+  SECTION("Parameter fitting with worker processes") {
+    const char *tmpInputFile{"tmpcli4.xml"};
+    const char *tmpOutputFile{"tmpcli4.sme"};
+    QFile::remove(tmpInputFile);
+    QFile::remove(tmpOutputFile);
+    QFile::copy(":/models/gray-scott.xml", tmpInputFile);
+    cli::Params params;
+    params.command = "fit";
+    params.inputFile = tmpInputFile;
+    params.outputFile = tmpOutputFile;
+    params.fit.algorithm = simulate::OptAlgorithmType::PSO;
+    params.fit.populationPerThread = 2;
+    params.fit.nIterations = 2;
+    params.fit.nThreads = 2;
+    params.fit.nWorkers = 2;
+    params.maxThreads = 1;
+    params.simType = simulate::SimulatorType::Pixel;
+    // the simulations are done by the CLI executable as "fit-worker"
+    params.program = SME_CLI_PROGRAM;
+    cli::printParams(params);
+    REQUIRE(cli::runCommand(params));
+    model::Model m;
+    m.importFile(tmpOutputFile);
+    REQUIRE(m.getIsValid());
+  }
 }
@@ -32,6 +32,23 @@ static auto makeDuneLinearSolverMap() {
       {"superlu", "SuperLU"}};
 }
 
+static auto makeDunePreconditionerMap() {
+  return std::map<std::string, std::string, std::less<>>{
+      {"default", ""},
+      {"jacobi", "Jacobi"},
+      {"gaussseidel", "GaussSeidel"},
+      {"sor", "SOR"},
+      {"ssor", "SSOR"},
+      {"ilu", "ILU"},
+      {"amg", "AMG"}};
+}
+
+static auto makeDuneDiscretizationMap() {
+  return std::map<std::string, simulate::DuneDiscretizationType, std::less<>>{
+      {"fem1", simulate::DuneDiscretizationType::FEM1},
+      {"fem2", simulate::DuneDiscretizationType::FEM2}};
+}
+
 static auto makePixelIntegratorMap() {
   return std::map<std::string, simulate::PixelIntegratorType, std::less<>>{
       {"rk101", simulate::PixelIntegratorType::RK101},
@@ -44,6 +61,9 @@ static void addParams(CLI::App &app, Params &params) {
   app.require_subcommand(1, 1);
   auto *sim_app = app.add_subcommand("simulate", "Run a spatial simulation");
   auto *fit_app = app.add_subcommand("fit", "Run parameter fitting");
+  // internal: started by fit to evaluate parameters in a separate process
+  app.add_subcommand("fit-worker", "Parameter fitting worker process")
+      ->group("");
   // common options
   for (auto *sub_app : {sim_app, fit_app}) {
     sub_app
@@ -62,6 +82,11 @@ static void addParams(CLI::App &app, Params &params) {
                      "(0 means unlimited). This sets both DUNE and Pixel "
                      "thread limits.")
         ->check(CLI::NonNegativeNumber);
+    sub_app
+        ->add_option("--dune-discretization", params.sim.duneDiscretization,
+                     "DUNE discretization: fem1 or fem2")
+        ->transform(CLI::CheckedTransformer(makeDuneDiscretizationMap(),
+                                            CLI::ignore_case));
     sub_app
         ->add_option("--dune-integrator", params.sim.duneIntegrator,
                      "DUNE integrator: expliciteuler, impliciteuler, heun, "
@@ -95,8 +120,16 @@ static void addParams(CLI::App &app, Params &params) {
                      "umfpack, or superlu")
         ->transform(CLI::CheckedTransformer(makeDuneLinearSolverMap(),
                                             CLI::ignore_case));
+    sub_app
+        ->add_option("--dune-preconditioner", params.sim.dunePreconditioner,
+                     "DUNE linear solver preconditioner: default, jacobi, "
+                     "gaussseidel, sor, ssor, ilu, or amg")
+        ->transform(CLI::CheckedTransformer(makeDunePreconditionerMap(),
+                                            CLI::ignore_case));
     sub_app->add_option("--dune-max-threads", params.sim.duneMaxThreads,
                         "DUNE max CPU threads (0 means unlimited)");
+    sub_app->add_option("--dune-adaptive-mesh", params.sim.duneAdaptiveMesh,
+                        "Enable DUNE adaptive mesh refinement (true/false)");
     sub_app
         ->add_option("--pixel-integrator", params.sim.pixelIntegrator,
                      "Pixel integrator: rk101, rk212, rk323, or rk435")
@@ -152,6 +185,30 @@ static void addParams(CLI::App &app, Params &params) {
                    "Whether to continue existing simulation results from the "
                    "input model (true/false)")
       ->capture_default_str();
+  sim_app
+      ->add_option("--memory-budget-mb", params.sim.memoryBudgetMegabytes,
+                   "Maximum memory in MB for simulation results: older "
+                   "timepoints are spilled to a temporary file if exceeded "
+                   "(0 means unlimited)")
+      ->check(CLI::NonNegativeNumber);
+  sim_app->add_option(
+      "--results-journal", params.sim.resultsJournalFile,
+      "Append-only file to which each new timepoint is written as soon as it "
+      "is simulated. If the simulation is interrupted, running the same "
+      "command again resumes from this file. It is removed once the "
+      "simulation completes.");
+  sim_app
+      ->add_option("--results-journal-sync-interval",
+                   params.sim.resultsJournalSyncInterval,
+                   "Number of timepoints between syncing the results journal "
+                   "to disk (0 means only at the end)")
+      ->capture_default_str();
+  sim_app->add_option(
+      "--solver-checkpoint", params.sim.solverCheckpointFile,
+      "File to which the solver state is written after each timepoint. When "
+      "continuing an existing simulation, the solver resumes from this file "
+      "if it matches the last timepoint, instead of restarting with a small "
+      "timestep.");
   // fitting options
   using enum sme::simulate::OptAlgorithmType;
   fit_app
@@ -172,7 +229,9 @@ static void addParams(CLI::App &app, Params &params) {
               {"NMS", NMS},
               {"sbplx", sbplx},
               {"AL", AL},
-              {"PRAXIS", PRAXIS}},
+              {"PRAXIS", PRAXIS},
+              {"Surrogate", Surrogate},
+              {"LBFGS", LBFGS}},
           CLI::ignore_case))
       ->capture_default_str();
   fit_app
@@ -190,6 +249,41 @@ static void addParams(CLI::App &app, Params &params) {
                    "The number of optimization threads")
       ->capture_default_str()
       ->check(CLI::PositiveNumber);
+  fit_app
+      ->add_option(
+          "--early-termination-factor", params.fit.earlyTerminationFactor,
+          "Stop evaluating parameters once their partial cost exceeds this "
+          "factor times the best cost so far (0: disabled)")
+      ->capture_default_str()
+      ->check(CLI::NonNegativeNumber);
+  fit_app
+      ->add_option("--coarsening-factor", params.fit.coarseningFactor,
+                   "Downsample the geometry by this factor for early "
+                   "iterations, halving it as the fitness stops improving "
+                   "(not supported by LBFGS)")
+      ->capture_default_str()
+      ->check(CLI::PositiveNumber);
+  fit_app->add_flag("--adjoint-gradient", params.fit.adjointGradient,
+                    "Calculate the gradient for gradient-based algorithms "
+                    "using the adjoint method instead of forward "
+                    "sensitivities (requires the rk101 pixel integrator)");
+  fit_app
+      ->add_option("-w,--n-workers", params.fit.nWorkers,
+                   "The number of worker processes used to simulate the "
+                   "model (0: simulate in the optimization threads)")
+      ->capture_default_str()
+      ->check(CLI::NonNegativeNumber);
+  fit_app
+      ->add_option("--worker-timeout", params.fit.workerTimeout,
+                   "The time in seconds to wait for a worker process to "
+                   "simulate the model, before restarting it")
+      ->capture_default_str()
+      ->check(CLI::Range(1, 2000000));
+  fit_app->add_option(
+      "--fitness-cache", params.fit.fitnessCacheFile,
+      "File in which the fitness of each simulated set of parameters is "
+      "stored. Fitness values already in this file from a previous fit of "
+      "the same model are reused instead of simulating the model again.");
 }
 
 static void addCallbacks(CLI::App &app) {
@@ -253,6 +347,17 @@ void printParams(const Params &params) {
     fmt::print("#   - Population per optimization thread: {}\n",
                params.fit.populationPerThread);
     fmt::print("#   - Number of iterations: {}\n", params.fit.nIterations);
+    fmt::print("#   - Early termination factor: {}\n",
+               params.fit.earlyTerminationFactor);
+    fmt::print("#   - Geometry coarsening factor: {}\n",
+               params.fit.coarseningFactor);
+    fmt::print("#   - Adjoint gradient: {}\n", params.fit.adjointGradient);
+    fmt::print("#   - Number of worker processes: {}\n", params.fit.nWorkers);
+    fmt::print("#   - Worker timeout: {} s\n", params.fit.workerTimeout);
+    fmt::print("#   - Fitness cache file: {}\n",
+               params.fit.fitnessCacheFile.empty()
+                   ? "(none)"
+                   : params.fit.fitnessCacheFile);
   }
   if (params.command == "simulate") {
     fmt::print("#   - Simulation Length(s): {}\n",
@@ -266,6 +371,19 @@ void printParams(const Params &params) {
                boolToString(params.sim.throwOnTimeout));
     fmt::print("#   - Continue existing simulation: {}\n",
                boolToString(params.sim.continueExistingSimulation));
+    fmt::print("#   - Memory budget (MB): {}\n",
+               params.sim.memoryBudgetMegabytes.has_value()
+                   ? fmt::format("{}", params.sim.memoryBudgetMegabytes.value())
+                   : "(from model)");
+    if (!params.sim.resultsJournalFile.empty()) {
+      fmt::print("#   - Results journal: {}\n", params.sim.resultsJournalFile);
+      fmt::print("#   - Results journal sync interval: {}\n",
+                 params.sim.resultsJournalSyncInterval);
+    }
+    if (!params.sim.solverCheckpointFile.empty()) {
+      fmt::print("#   - Solver checkpoint: {}\n",
+                 params.sim.solverCheckpointFile);
+    }
   }
 }
 
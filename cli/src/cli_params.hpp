@@ -14,6 +14,11 @@ struct SimParams {
   double timeoutSeconds{-1.0};
   bool throwOnTimeout{true};
   bool continueExistingSimulation{true};
+  std::optional<std::size_t> memoryBudgetMegabytes{};
+  std::string resultsJournalFile{};
+  std::size_t resultsJournalSyncInterval{1};
+  std::string solverCheckpointFile{};
+  std::optional<simulate::DuneDiscretizationType> duneDiscretization{};
   std::optional<std::string> duneIntegrator{};
   std::optional<double> duneInitialTimestep{};
   std::optional<double> duneMinTimestep{};
@@ -24,7 +29,9 @@ struct SimParams {
   std::optional<double> duneNewtonRelativeError{};
   std::optional<double> duneNewtonAbsoluteError{};
   std::optional<std::string> duneLinearSolver{};
+  std::optional<std::string> dunePreconditioner{};
   std::optional<std::size_t> duneMaxThreads{};
+  std::optional<bool> duneAdaptiveMesh{};
   std::optional<simulate::PixelIntegratorType> pixelIntegrator{};
   std::optional<double> pixelMaxRelativeError{};
   std::optional<double> pixelMaxAbsoluteError{};
@@ -40,6 +47,12 @@ struct FitParams {
   std::size_t populationPerThread{20};
   std::size_t nThreads{1};
   simulate::OptAlgorithmType algorithm{simulate::OptAlgorithmType::PSO};
+  double earlyTerminationFactor{0.0};
+  std::size_t coarseningFactor{1};
+  bool adjointGradient{false};
+  std::size_t nWorkers{0};
+  int workerTimeout{600};
+  std::string fitnessCacheFile{};
 };
 
 struct Params {
@@ -50,6 +63,8 @@ struct Params {
   std::optional<simulate::SimulatorType> simType{};
   std::string outputFile{};
   std::optional<std::size_t> maxThreads{};
+  // the path to this executable, used to start worker processes
+  std::string program{};
 };
 
 Params setupCLI(CLI::App &app);
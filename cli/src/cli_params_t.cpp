@@ -22,15 +22,32 @@ TEST_CASE("CLI Params", "[cli][params]") {
     REQUIRE_NOTHROW(a.parse(fmt::format("fit x.sme -a{}", i)));
     REQUIRE(params.fit.algorithm == simulate::optAlgorithmTypes[i]);
   }
+  REQUIRE(params.fit.adjointGradient == false);
+  REQUIRE_NOTHROW(a.parse("fit x.sme -a15 --adjoint-gradient"));
+  REQUIRE(params.fit.adjointGradient == true);
+  REQUIRE(params.fit.nWorkers == 0);
+  REQUIRE_NOTHROW(a.parse("fit x.sme --n-workers 3"));
+  REQUIRE(params.fit.nWorkers == 3);
+  REQUIRE(params.fit.workerTimeout == 600);
+  REQUIRE_NOTHROW(a.parse("fit x.sme --worker-timeout 30"));
+  REQUIRE(params.fit.workerTimeout == 30);
+  REQUIRE_THROWS(a.parse("fit x.sme --worker-timeout 0"));
+  REQUIRE_NOTHROW(a.parse("fit x.sme --fitness-cache cache.txt"));
+  REQUIRE(params.fit.fitnessCacheFile == "cache.txt");
+  REQUIRE_NOTHROW(a.parse("fit-worker"));
+  REQUIRE(a.get_subcommands().at(0)->get_name() == "fit-worker");
 
   CLI::App b;
   auto simParams = cli::setupCLI(b);
   REQUIRE_NOTHROW(b.parse(
       "simulate x.sme 1 0.1 --simulator pixel --max-threads 3 "
       "--dune-integrator heun --dune-linear-solver superlu "
+      "--dune-preconditioner ILU --dune-adaptive-mesh true "
+      "--dune-discretization fem2 "
       "--pixel-integrator rk323 --pixel-enable-multithreading true "
       "--pixel-opt-level 2 --timeout-seconds 10 --throw-on-timeout false "
-      "--continue-existing-simulation false"));
+      "--continue-existing-simulation false --memory-budget-mb 64 "
+      "--solver-checkpoint chk.bin"));
   REQUIRE(simParams.simType.has_value());
   REQUIRE(simParams.simType.value() == simulate::SimulatorType::Pixel);
   REQUIRE(simParams.maxThreads.has_value());
@@ -39,6 +56,13 @@ TEST_CASE("CLI Params", "[cli][params]") {
   REQUIRE(simParams.sim.duneIntegrator.value() == "Heun");
   REQUIRE(simParams.sim.duneLinearSolver.has_value());
   REQUIRE(simParams.sim.duneLinearSolver.value() == "SuperLU");
+  REQUIRE(simParams.sim.dunePreconditioner.has_value());
+  REQUIRE(simParams.sim.dunePreconditioner.value() == "ILU");
+  REQUIRE(simParams.sim.duneAdaptiveMesh.has_value());
+  REQUIRE(simParams.sim.duneAdaptiveMesh.value() == true);
+  REQUIRE(simParams.sim.duneDiscretization.has_value());
+  REQUIRE(simParams.sim.duneDiscretization.value() ==
+          simulate::DuneDiscretizationType::FEM2);
   REQUIRE(simParams.sim.pixelIntegrator.has_value());
   REQUIRE(simParams.sim.pixelIntegrator.value() ==
           simulate::PixelIntegratorType::RK323);
@@ -49,6 +73,9 @@ TEST_CASE("CLI Params", "[cli][params]") {
   REQUIRE(simParams.sim.timeoutSeconds == dbl_approx(10));
   REQUIRE(simParams.sim.throwOnTimeout == false);
   REQUIRE(simParams.sim.continueExistingSimulation == false);
+  REQUIRE(simParams.sim.memoryBudgetMegabytes.has_value());
+  REQUIRE(simParams.sim.memoryBudgetMegabytes.value() == 64);
+  REQUIRE(simParams.sim.solverCheckpointFile == "chk.bin");
 
   CLI::App c;
   auto simParamsNoTimes = cli::setupCLI(c);
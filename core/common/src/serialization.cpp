@@ -105,8 +105,19 @@ bool exportSmeFile(const std::string &filename,
   if (!fs) {
     return false;
   }
-  cereal::BinaryOutputArchive ar{fs};
-  ar(contents);
+  try {
+    cereal::BinaryOutputArchive ar{fs};
+    ar(contents);
+  } catch (const std::exception &e) {
+    SPDLOG_WARN("Failed to export file '{}'. {}", filename, e.what());
+    return false;
+  }
+  // e.g. no space left on the device
+  fs.close();
+  if (!fs) {
+    SPDLOG_WARN("Failed to write file '{}'", filename);
+    return false;
+  }
   return true;
 }
 
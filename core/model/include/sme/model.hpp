@@ -24,6 +24,7 @@
 #include "sme/serialization.hpp"
 #include "sme/simulate.hpp"
 #include "sme/simulate_options.hpp"
+#include "sme/simulator_cache.hpp"
 #include <QColor>
 #include <QImage>
 #include <QStringList>
@@ -74,6 +75,7 @@ private:
   std::unique_ptr<ModelUnits> modelUnits;
   std::unique_ptr<ModelMath> modelMath;
   std::unique_ptr<ModelFeatures> modelFeatures;
+  std::unique_ptr<simulate::SimulatorCache> simulatorCache;
 
   void initModelData(bool emptySpatialModel = false);
   void setHasUnsavedChanges(bool unsavedChanges);
@@ -200,6 +202,12 @@ public:
    * @brief Immutable simulation results storage.
    */
   [[nodiscard]] const simulate::SimulationData &getSimulationData() const;
+  /**
+   * @brief Data reused between simulations of this model.
+   *
+   * Cleared when a new model is loaded, and released with the model.
+   */
+  [[nodiscard]] simulate::SimulatorCache &getSimulatorCache() const;
   /**
    * @brief Mutable simulation settings.
    */
@@ -281,8 +289,9 @@ public:
   /**
    * @brief Export SME project file.
    * @param filename Output SME filename.
+   * @returns ``true`` if the file was written successfully.
    */
-  void exportSMEFile(const std::string &filename);
+  bool exportSMEFile(const std::string &filename);
   /**
    * @brief Serialize current SBML XML.
    * @returns SBML XML as text.
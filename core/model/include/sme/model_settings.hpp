@@ -142,6 +142,13 @@ struct SimulationSettings {
    * @brief Selected simulator backend.
    */
   sme::simulate::SimulatorType simulatorType{};
+  /**
+   * @brief Memory budget for stored simulation results in bytes.
+   *
+   * If exceeded, older timepoints are spilled to a temporary file. ``0``
+   * means unlimited.
+   */
+  std::size_t memoryBudgetBytes{0};
 
   template <class Archive>
   void serialize(Archive &ar, std::uint32_t const version) {
@@ -149,6 +156,9 @@ struct SimulationSettings {
       ar(times, options, simulatorType);
     } else if (version == 1) {
       ar(CEREAL_NVP(times), CEREAL_NVP(options), CEREAL_NVP(simulatorType));
+    } else if (version == 2) {
+      ar(CEREAL_NVP(times), CEREAL_NVP(options), CEREAL_NVP(simulatorType),
+         CEREAL_NVP(memoryBudgetBytes));
     }
   }
 };
@@ -254,5 +264,5 @@ struct Settings {
 
 CEREAL_CLASS_VERSION(sme::model::MeshParameters, 2);
 CEREAL_CLASS_VERSION(sme::model::DisplayOptions, 2);
-CEREAL_CLASS_VERSION(sme::model::SimulationSettings, 1);
+CEREAL_CLASS_VERSION(sme::model::SimulationSettings, 2);
 CEREAL_CLASS_VERSION(sme::model::Settings, 6);
@@ -208,7 +208,7 @@ void Model::importFile(const std::string &filename) {
   setHasUnsavedChanges(false);
 }
 
-void Model::exportSMEFile(const std::string &filename) {
+bool Model::exportSMEFile(const std::string &filename) {
   currentFilename = filename.c_str();
   if (auto len{currentFilename.lastIndexOf(".")}; len > 0) {
     currentFilename.truncate(len);
@@ -217,8 +217,10 @@ void Model::exportSMEFile(const std::string &filename) {
   smeFileContents->xmlModel = getXml().toStdString();
   if (!common::exportSmeFile(filename, *smeFileContents)) {
     SPDLOG_WARN("Failed to save file '{}'", filename);
+    return false;
   }
   setHasUnsavedChanges(false);
+  return true;
 }
 
 void Model::updateSBMLDoc() {
@@ -300,6 +302,10 @@ const simulate::SimulationData &Model::getSimulationData() const {
   return *smeFileContents->simulationData;
 }
 
+simulate::SimulatorCache &Model::getSimulatorCache() const {
+  return *simulatorCache;
+}
+
 SimulationSettings &Model::getSimulationSettings() {
   return settings->simulationSettings;
 }
@@ -351,6 +357,7 @@ void Model::clear() {
   smeFileContents->simulationData =
       std::make_unique<simulate::SimulationData>();
   settings = std::make_unique<Settings>();
+  simulatorCache = std::make_unique<simulate::SimulatorCache>();
 }
 
 SpeciesGeometry Model::getSpeciesGeometry(const QString &speciesID) const {
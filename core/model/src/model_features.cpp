@@ -283,7 +283,8 @@ static void extractSpeciesConc(std::vector<double> &concs,
                                std::size_t compartmentIndex,
                                std::size_t speciesIndex, std::size_t nVoxels,
                                std::size_t nSpecies) {
-  const auto &compConc = data.concentration[timeIndex][compartmentIndex];
+  const auto conc{data.getConcentration(timeIndex)};
+  const auto &compConc{(*conc)[compartmentIndex]};
   std::size_t stride = nSpecies + data.concPadding[timeIndex];
   concs.resize(nVoxels);
   for (std::size_t ix = 0; ix < nVoxels; ++ix) {
@@ -327,6 +328,8 @@ void ModelFeatures::reEvaluateAllTimepoints() {
   // re-evaluate for each stored timepoint
   for (std::size_t t = 0; t < simulationData->timePoints.size(); ++t) {
     evaluateAtTimepoint(t);
+    // release any timepoint that was paged back in from disk
+    simulationData->enforceMemoryBudget();
   }
 }
 
@@ -10,7 +10,9 @@
 #include <QSizeF>
 #include <QString>
 #include <map>
+#include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace sme {
@@ -49,6 +51,16 @@ public:
    * @returns INI file text.
    */
   [[nodiscard]] QString getIniFile() const;
+  /**
+   * @brief Generated DUNE ini file as key/value pairs.
+   *
+   * Keys include their section, e.g. ``model.time_step_operator.type``.
+   * Used to build the DUNE parameter tree without parsing the INI text.
+   *
+   * @returns INI key/value pairs.
+   */
+  [[nodiscard]] const std::vector<std::pair<std::string, std::string>> &
+  getIniEntries() const;
 
   /**
    * @brief 2D mesh used for conversion (nullable).
@@ -102,6 +114,7 @@ public:
 
 private:
   QString iniFile;
+  std::vector<std::pair<std::string, std::string>> iniEntries;
   const mesh::Mesh2d *mesh;
   const mesh::Mesh3d *mesh3d;
   std::unordered_map<std::string, std::vector<double>> concentrations;
@@ -3,6 +3,7 @@
 #include "sme/model.hpp"
 #include "sme/optimize_options.hpp"
 #include "sme/simulate.hpp"
+#include <iosfwd>
 #include <memory>
 #include <mutex>
 #include <oneapi/tbb/concurrent_queue.h>
@@ -39,8 +40,41 @@ struct OptConstData {
   common::Volume imageSize{};
   std::vector<double> maxTargetValues{};
   std::vector<FeatureOptCost> featureOptCosts{};
+  // the number of values of each OptParam, which is the number of voxels for
+  // a spatially varying diffusion constant, and 1 otherwise
+  std::vector<std::size_t> optParamSizes{};
 };
 
+/**
+ * @brief A reduced resolution version of the optimization problem
+ */
+struct OptCoarseLevel {
+  // the factor by which the geometry image is downsampled in x and y
+  std::size_t factor{1};
+  std::unique_ptr<OptConstData> optConstData{nullptr};
+  std::unique_ptr<ThreadsafeModelQueue> modelQueue{nullptr};
+  // the index of this level's model in the worker processes
+  std::size_t workerModelIndex{0};
+};
+
+/**
+ * @brief Options for evaluating the optimization cost in worker processes
+ */
+struct OptWorkerOptions {
+  // the number of worker processes, 0 to evaluate in this process
+  std::size_t count{0};
+  // the program to start for each worker, which should call
+  // runOptimizationWorker() with its standard input and output
+  std::string program{};
+  std::vector<std::string> arguments{};
+  // the maximum time to wait for a reply from a worker, in milliseconds. A
+  // worker that doesn't reply in time is restarted
+  int timeoutMs{600000};
+};
+
+class OptWorkerPool;
+class OptFitnessCache;
+
 /**
  * @brief Optimize model parameters
  *
@@ -63,21 +97,34 @@ private:
   std::atomic<std::size_t> nIterations{0};
   std::vector<double> bestFitness;
   std::vector<std::vector<double>> bestParams;
+  std::vector<std::size_t> bestCoarseningFactors;
   mutable std::mutex resultsMutex;
   mutable std::mutex bestResultsMutex;
   BestResults bestResults{};
   std::unique_ptr<ThreadsafeModelQueue> modelQueue{nullptr};
+  std::unique_ptr<OptWorkerPool> workerPool{nullptr};
+  std::unique_ptr<OptFitnessCache> fitnessCache{nullptr};
+  std::vector<OptCoarseLevel> coarseLevels{};
+  std::atomic<std::size_t> coarseLevelIndex{0};
+  mutable std::mutex coarseFitnessMutex;
+  double bestCoarseFitness{std::numeric_limits<double>::max()};
+  double previousCoarseFitness{std::numeric_limits<double>::max()};
   std::string errorMessage{};
 
   std::size_t finalizeEvolve(const std::string &newErrorMessage = {});
+  void updateFidelity();
 
 public:
   /**
    * @brief Constructs an Optimization object from the supplied model
    *
    * @param[in] model the model to optimize
+   * @param[in] workerOptions optional worker processes used to evaluate the
+   * cost
    */
-  explicit Optimization(sme::model::Model &model);
+  explicit Optimization(sme::model::Model &model,
+                        const OptWorkerOptions &workerOptions = {});
+  ~Optimization();
   /**
    * @brief Do n iterations of parameter optimization
    */
@@ -101,6 +148,14 @@ public:
    * @brief The best fitness from each iteration
    */
   [[nodiscard]] std::vector<double> getFitness() const;
+  /**
+   * @brief The coarsening factor used to evaluate the best fitness from each
+   * iteration
+   *
+   * Fitness values evaluated with different coarsening factors are not
+   * comparable.
+   */
+  [[nodiscard]] std::vector<std::size_t> getCoarseningFactors() const;
   /**
    * @brief Try to set a new set of best results for each target
    *
@@ -109,6 +164,49 @@ public:
    */
   bool setBestResults(double fitness,
                       std::vector<std::vector<double>> &&results);
+  /**
+   * @brief The fitness of the current best results
+   */
+  [[nodiscard]] double getBestResultsFitness() const;
+  /**
+   * @brief The current reduced resolution level
+   *
+   * Returns ``nullptr`` if the optimization is using full resolution.
+   */
+  [[nodiscard]] const OptCoarseLevel *getCoarseLevel() const;
+  /**
+   * @brief The factor by which the geometry is currently downsampled
+   */
+  [[nodiscard]] std::size_t getCoarseningFactor() const;
+  /**
+   * @brief Try to set a new best fitness for the current coarse level
+   *
+   * @returns ``true`` if `fitness` is lower than the current best
+   */
+  bool setBestCoarseFitness(double fitness);
+  /**
+   * @brief The best fitness for the current coarse level
+   */
+  [[nodiscard]] double getBestCoarseFitness() const;
+  /**
+   * @brief The worker processes used to evaluate the cost
+   *
+   * Returns ``nullptr`` if the cost is evaluated in this process.
+   */
+  [[nodiscard]] OptWorkerPool *getWorkerPool() const;
+  /**
+   * @brief The cache of evaluated fitness values
+   */
+  [[nodiscard]] OptFitnessCache *getFitnessCache() const;
+  /**
+   * @brief Also store evaluated fitness values in a file
+   *
+   * Fitness values already in the file from a previous optimization of the
+   * same model are reused instead of simulating the model again.
+   *
+   * @returns ``false`` if the file can't be used
+   */
+  bool setFitnessCacheFile(const std::string &filename);
 
   /**
    * @brief Get the values for a target obtained with the best currently
@@ -179,4 +277,14 @@ public:
   const std::string &getErrorMessage() const;
 };
 
+/**
+ * @brief Run an optimization worker process
+ *
+ * Reads the models and then parameters to evaluate from ``in``, and writes
+ * the resulting costs to ``out``, until ``in`` is closed or contains "quit".
+ *
+ * @returns the exit code for the worker process
+ */
+int runOptimizationWorker(std::istream &in, std::ostream &out);
+
 } // namespace sme::simulate
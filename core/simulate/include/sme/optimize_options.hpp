@@ -162,18 +162,23 @@ enum class OptAlgorithmType {
   NMS,
   sbplx,
   AL,
-  PRAXIS
+  PRAXIS,
+  Surrogate,
+  LBFGS
 };
 
 /**
  * @brief An array of all algorithm types for iterating over
  */
-inline constexpr std::array<OptAlgorithmType, 14> optAlgorithmTypes{
-    OptAlgorithmType::PSO,    OptAlgorithmType::GPSO,  OptAlgorithmType::DE,
-    OptAlgorithmType::iDE,    OptAlgorithmType::jDE,   OptAlgorithmType::pDE,
-    OptAlgorithmType::ABC,    OptAlgorithmType::gaco,  OptAlgorithmType::COBYLA,
-    OptAlgorithmType::BOBYQA, OptAlgorithmType::NMS,   OptAlgorithmType::sbplx,
-    OptAlgorithmType::AL,     OptAlgorithmType::PRAXIS};
+inline constexpr std::array<OptAlgorithmType, 16> optAlgorithmTypes{
+    OptAlgorithmType::PSO,       OptAlgorithmType::GPSO,
+    OptAlgorithmType::DE,        OptAlgorithmType::iDE,
+    OptAlgorithmType::jDE,       OptAlgorithmType::pDE,
+    OptAlgorithmType::ABC,       OptAlgorithmType::gaco,
+    OptAlgorithmType::COBYLA,    OptAlgorithmType::BOBYQA,
+    OptAlgorithmType::NMS,       OptAlgorithmType::sbplx,
+    OptAlgorithmType::AL,        OptAlgorithmType::PRAXIS,
+    OptAlgorithmType::Surrogate, OptAlgorithmType::LBFGS};
 
 std::string toString(sme::simulate::OptAlgorithmType optAlgorithmType);
 
@@ -193,12 +198,42 @@ struct OptAlgorithm {
    * @brief The population size in each island
    */
   std::size_t population{2};
+  /**
+   * @brief Stop fitness evaluations that cannot beat the best fitness
+   *
+   * If non-zero, the cost is accumulated after each simulation time, and the
+   * evaluation is stopped as soon as it exceeds this factor times the best
+   * fitness found so far. Must be zero (disabled) or at least one.
+   */
+  double earlyTerminationFactor{0.0};
+  /**
+   * @brief Downsampling factor of the geometry for early generations
+   *
+   * If greater than one, early generations are evaluated using the geometry
+   * image downsampled by this factor in x and y. The factor is halved each
+   * time the best fitness stops improving, until full resolution is reached.
+   */
+  std::size_t coarseningFactor{1};
+  /**
+   * @brief Calculate gradients using the adjoint method
+   *
+   * Only used by gradient-based algorithms. If true, the gradient is
+   * calculated by simulating the adjoint equations backwards in time, which
+   * costs about the same regardless of the number of parameters. Otherwise
+   * forward sensitivities are used, which require one extra copy of each
+   * species for each parameter.
+   */
+  bool adjointGradient{false};
 
   template <class Archive>
   void serialize(Archive &ar, std::uint32_t const version) {
     if (version == 0) {
       ar(CEREAL_NVP(optAlgorithmType), CEREAL_NVP(islands),
          CEREAL_NVP(population));
+    } else if (version == 1) {
+      ar(CEREAL_NVP(optAlgorithmType), CEREAL_NVP(islands),
+         CEREAL_NVP(population), CEREAL_NVP(earlyTerminationFactor),
+         CEREAL_NVP(coarseningFactor), CEREAL_NVP(adjointGradient));
     }
   }
 };
@@ -233,4 +268,4 @@ struct OptimizeOptions {
 CEREAL_CLASS_VERSION(sme::simulate::OptimizeOptions, 0);
 CEREAL_CLASS_VERSION(sme::simulate::OptCost, 1);
 CEREAL_CLASS_VERSION(sme::simulate::OptParam, 0);
-CEREAL_CLASS_VERSION(sme::simulate::OptAlgorithm, 0);
+CEREAL_CLASS_VERSION(sme::simulate::OptAlgorithm, 1);
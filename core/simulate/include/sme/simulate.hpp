@@ -4,6 +4,7 @@
 
 #include "sme/image_stack.hpp"
 #include "sme/model_settings.hpp"
+#include "sme/simulate_checkpoint.hpp"
 #include "sme/simulate_data.hpp"
 #include "sme/simulate_options.hpp"
 #include <QImage>
@@ -15,6 +16,7 @@
 #include <limits>
 #include <map>
 #include <memory>
+#include <optional>
 #include <queue>
 #include <shared_mutex>
 #include <string>
@@ -33,6 +35,7 @@ class Compartment;
 namespace simulate {
 
 class BaseSim;
+class ConcImagePyramid;
 
 /**
  * @brief Time-point event containing affected variable ids.
@@ -48,6 +51,7 @@ struct SimEvent {
 class Simulation {
 private:
   std::unique_ptr<BaseSim> simulator;
+  std::unique_ptr<ConcImagePyramid> concImagePyramid;
   std::vector<const geometry::Compartment *> compartments;
   std::vector<std::string> compartmentIds;
   std::map<std::string, double, std::less<>> eventSubstitutions{};
@@ -65,6 +69,7 @@ private:
   std::atomic<bool> stopRequested{false};
   std::atomic<std::size_t> nCompletedTimesteps{0};
   std::queue<SimEvent> simEvents;
+  std::function<void(std::size_t)> timepointCallback{};
   void initModel();
   void initEvents();
   void initSimulator();
@@ -102,6 +107,48 @@ public:
       const std::vector<std::pair<std::size_t, double>> &timesteps,
       double timeout_ms = -1.0,
       const std::function<bool()> &stopRunningCallback = {});
+  /**
+   * @brief Set callback invoked after each new timepoint is stored.
+   *
+   * The callback is called from the thread running the simulation, with the
+   * time index of the new timepoint.
+   * @param callback Callback function, or empty to disable.
+   */
+  void setTimepointCallback(std::function<void(std::size_t)> callback);
+  /**
+   * @brief Set the number of downsampled image levels to precompute.
+   *
+   * Level ``k`` averages the concentrations over ``2^k x 2^k x 2^k``
+   * voxels, and is computed for each new timepoint as it is stored. These
+   * are used by getConcImage() when a display size is given. If a memory
+   * budget is set, a quarter of it is reserved for these levels.
+   * @param nLevels Number of levels, or 0 to disable.
+   */
+  void setConcImagePyramidLevels(std::size_t nLevels);
+  /**
+   * @brief Enable the downsampled image levels needed for a display size.
+   *
+   * Equivalent to setConcImagePyramidLevels() with the coarsest level that
+   * still has at least one voxel per display pixel.
+   */
+  void setConcImageDisplaySize(const QSize &displaySize);
+  /**
+   * @brief Solver state at the latest timepoint.
+   *
+   * Should not be called while the simulation is running.
+   * @returns Solver checkpoint, or ``std::nullopt`` if not supported by the
+   * simulator.
+   */
+  [[nodiscard]] std::optional<SolverCheckpoint> getSolverCheckpoint() const;
+  /**
+   * @brief Restore solver state from a checkpoint of the latest timepoint.
+   *
+   * The checkpoint is only applied if it was created by the same type of
+   * simulator at the time of the latest timepoint.
+   * @param checkpoint Solver checkpoint.
+   * @returns ``true`` if the checkpoint was applied.
+   */
+  bool applySolverCheckpoint(const SolverCheckpoint &checkpoint);
   /**
    * @brief Solver error message.
    * @returns Error message string.
@@ -204,13 +251,17 @@ public:
    * @param speciesToDraw Per-compartment species indices to draw.
    * @param normaliseOverAllTimepoints Normalize using all timepoints.
    * @param normaliseOverAllSpecies Normalize using all species.
+   * @param displaySize Size the image will be displayed at. If given, and
+   * downsampled levels are enabled, the coarsest level with at least one
+   * voxel per display pixel is used. Empty for full resolution.
    * @returns Concentration image stack.
    */
   [[nodiscard]] common::ImageStack
   getConcImage(std::size_t timeIndex,
                const std::vector<std::vector<std::size_t>> &speciesToDraw = {},
                bool normaliseOverAllTimepoints = false,
-               bool normaliseOverAllSpecies = false) const;
+               bool normaliseOverAllSpecies = false,
+               const QSize &displaySize = {}) const;
   /**
    * @brief Species names for Python API.
    * @param compartmentIndex Compartment index.
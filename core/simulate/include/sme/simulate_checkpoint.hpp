@@ -0,0 +1,71 @@
+// Solver checkpoint for restarting a simulation
+
+#pragma once
+
+#include "sme/simulate_options.hpp"
+#include <cereal/cereal.hpp>
+#include <cereal/types/vector.hpp>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace sme::simulate {
+
+/**
+ * @brief Solver state at a timepoint, used to restart a simulation.
+ *
+ * Contains the integrator state that is not part of the stored simulation
+ * results, so that a restarted solver can resume with the same timestep
+ * instead of repeating the initial ramp-up from a small timestep.
+ */
+struct SolverCheckpoint {
+  /**
+   * @brief Simulator that created the checkpoint.
+   */
+  SimulatorType simulatorType{SimulatorType::Pixel};
+  /**
+   * @brief Simulation time of the checkpoint.
+   */
+  double time{0.0};
+  /**
+   * @brief Next timestep the integrator would have taken.
+   */
+  double timestep{0.0};
+  /**
+   * @brief Full solver state for each compartment, empty if not stored.
+   *
+   * For DUNE this is the finite element solution at the mesh nodes.
+   */
+  std::vector<std::vector<double>> state{};
+
+  template <class Archive>
+  void serialize(Archive &ar, std::uint32_t const version) {
+    if (version == 0) {
+      ar(CEREAL_NVP(simulatorType), CEREAL_NVP(time), CEREAL_NVP(timestep),
+         CEREAL_NVP(state));
+    }
+  }
+};
+
+/**
+ * @brief Write a solver checkpoint to disk.
+ *
+ * The file is replaced atomically, so an existing checkpoint is never left
+ * partially overwritten.
+ *
+ * @returns ``true`` on success.
+ */
+bool exportSolverCheckpoint(const std::string &filename,
+                            const SolverCheckpoint &checkpoint);
+
+/**
+ * @brief Read a solver checkpoint from disk.
+ *
+ * @returns Checkpoint, or ``std::nullopt`` if the file is missing or invalid.
+ */
+[[nodiscard]] std::optional<SolverCheckpoint>
+importSolverCheckpoint(const std::string &filename);
+
+} // namespace sme::simulate
+
+CEREAL_CLASS_VERSION(sme::simulate::SolverCheckpoint, 0);
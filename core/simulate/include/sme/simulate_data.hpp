@@ -6,16 +6,56 @@
 #include "sme/simulate_options.hpp"
 #include <cereal/cereal.hpp>
 #include <cereal/types/string.hpp>
+#include <cereal/types/vector.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
 namespace sme::simulate {
 
+class SimulationDataSpillFile;
+class SimulationDataBlockFile;
+
 /**
  * @brief Stored simulation outputs across timepoints.
+ *
+ * If a memory budget is set, concentrations of older timepoints can be
+ * spilled to a temporary file: their entries in ``concentration`` are then
+ * empty, and ``getConcentration`` should be used to access them.
  */
 class SimulationData {
+  std::size_t memoryBudgetBytes{0};
+  std::size_t reservedMemoryBytes{0};
+  std::unique_ptr<SimulationDataSpillFile> spillFile;
+  [[nodiscard]] std::vector<std::vector<double>>
+  readSpilledConcentration(std::size_t timeIndex) const;
+  // written in native byte order: a reader with a different byte order sees
+  // a different value, the concentration blocks themselves are little-endian
+  static constexpr std::uint32_t concentrationByteOrderMarker{0x01020304};
+  [[nodiscard]] static std::size_t concentrationBlocksPerBatch();
+  [[nodiscard]] std::shared_ptr<SimulationDataBlockFile>
+  encodeConcentrationBlocks() const;
+  [[nodiscard]] static const std::vector<std::uint64_t> &
+  getConcentrationBlockOffsets(const SimulationDataBlockFile &blockFile);
+  [[nodiscard]] static std::string
+  readConcentrationBlocks(SimulationDataBlockFile &blockFile,
+                          std::size_t begin, std::size_t end);
+  static void
+  checkConcentrationBlockOffsets(const std::vector<std::uint64_t> &offsets);
+  void decodeConcentrationBlocks(const std::string &bytes,
+                                 const std::vector<std::uint64_t> &offsets,
+                                 std::size_t begin, std::size_t end);
+  [[nodiscard]] std::size_t getResidentMemoryBytes() const;
+  [[nodiscard]] std::size_t getAvailableMemoryBudgetBytes() const;
+
 public:
+  SimulationData();
+  ~SimulationData();
+  SimulationData(SimulationData &&) noexcept;
+  SimulationData &operator=(SimulationData &&) noexcept;
   /**
    * @brief Simulated time values.
    */
@@ -54,7 +94,8 @@ public:
    */
   [[nodiscard]] std::size_t size() const;
   /**
-   * @brief Estimated memory usage of currently stored data.
+   * @brief Estimated memory usage of currently stored data, including any
+   * paged-in timepoints.
    */
   [[nodiscard]] std::size_t getEstimatedMemoryBytes() const;
   /**
@@ -70,19 +111,116 @@ public:
    * @brief Remove last stored timepoint.
    */
   void pop_back();
+  /**
+   * @brief Concentrations for a timepoint: ``compartment ->
+   * flattened(voxel,species)``.
+   *
+   * Spilled timepoints are paged back into memory, where the least recently
+   * used ones are released to stay within the memory budget. The returned
+   * pointer keeps the concentrations alive until it is destroyed.
+   */
+  [[nodiscard]] std::shared_ptr<const std::vector<std::vector<double>>>
+  getConcentration(std::size_t timeIndex) const;
+  /**
+   * @brief Returns ``true`` if timepoint concentrations are stored on disk.
+   */
+  [[nodiscard]] bool isSpilled(std::size_t timeIndex) const;
+  /**
+   * @brief Number of timepoints with concentrations stored on disk.
+   */
+  [[nodiscard]] std::size_t nSpilled() const;
+  /**
+   * @brief Memory budget in bytes, ``0`` means unlimited.
+   */
+  [[nodiscard]] std::size_t getMemoryBudgetBytes() const;
+  /**
+   * @brief Set memory budget in bytes, ``0`` means unlimited.
+   */
+  void setMemoryBudgetBytes(std::size_t bytes);
+  /**
+   * @brief Memory within the budget used by data derived from these results.
+   *
+   * For example downsampled images: these bytes are subtracted from the
+   * memory budget available for the concentrations.
+   */
+  void setReservedMemoryBytes(std::size_t bytes);
+  /**
+   * @brief Spill oldest timepoints to disk until within the memory budget.
+   *
+   * Room is left for one paged-in timepoint. Also releases any paged-in
+   * timepoints. The last timepoint is always kept in memory. Requires
+   * exclusive access to this object.
+   *
+   * @returns ``false`` if writing to the spill file failed.
+   */
+  bool enforceMemoryBudget();
+
+  /**
+   * @brief Serialize.
+   *
+   * From version 2 the concentrations are stored as a byte order marker, an
+   * index of byte offsets of each timepoint's block, then the blocks.
+   * Each block is an independently zlib-compressed, little-endian
+   * ``[nCompartments][n_0][n_0 doubles]...`` array, so any timepoint can be
+   * located and decoded on its own.
+   */
+  template <class Archive>
+  void save(Archive &ar, std::uint32_t const version) const {
+    if (version == 2) {
+      ar(timePoints);
+      ar(concentrationByteOrderMarker);
+      // blocks are encoded in parallel one batch at a time and staged to a
+      // temporary file, so that the index can be written before them
+      const auto blockFile{encodeConcentrationBlocks()};
+      const auto &offsets{getConcentrationBlockOffsets(*blockFile)};
+      ar(offsets);
+      const std::size_t n{offsets.size() - 1};
+      for (std::size_t begin = 0; begin < n;
+           begin += concentrationBlocksPerBatch()) {
+        const std::size_t end{
+            std::min(n, begin + concentrationBlocksPerBatch())};
+        const auto bytes{readConcentrationBlocks(*blockFile, begin, end)};
+        ar(cereal::binary_data(bytes.data(), bytes.size()));
+      }
+      ar(avgMinMax, concentrationMax, concPadding, xmlModel, featureResults);
+    }
+  }
 
   template <class Archive>
-  void serialize(Archive &ar, std::uint32_t const version) {
+  void load(Archive &ar, std::uint32_t const version) {
+    clear();
     if (version == 0) {
       ar(timePoints, concentration, avgMinMax, concentrationMax, concPadding,
          xmlModel);
     } else if (version == 1) {
       ar(timePoints, concentration, avgMinMax, concentrationMax, concPadding,
          xmlModel, featureResults);
+    } else if (version == 2) {
+      ar(timePoints);
+      std::uint32_t byteOrderMarker{0};
+      ar(byteOrderMarker);
+      if (byteOrderMarker != concentrationByteOrderMarker) {
+        throw std::runtime_error(
+            "Simulation data was saved with a different byte order");
+      }
+      std::vector<std::uint64_t> offsets;
+      ar(offsets);
+      checkConcentrationBlockOffsets(offsets);
+      const std::size_t n{offsets.size() - 1};
+      std::string bytes;
+      while (concentration.size() < n) {
+        const std::size_t begin{concentration.size()};
+        const std::size_t end{
+            std::min(n, begin + concentrationBlocksPerBatch())};
+        bytes.resize(offsets[end] - offsets[begin]);
+        ar(cereal::binary_data(bytes.data(), bytes.size()));
+        decodeConcentrationBlocks(bytes, offsets, begin, end);
+      }
+      ar(avgMinMax, concentrationMax, concPadding, xmlModel, featureResults);
     }
   }
 };
 
 } // namespace sme::simulate
 
-CEREAL_CLASS_VERSION(sme::simulate::SimulationData, 1);
+CEREAL_CLASS_VERSION(sme::simulate::SimulationData, 2);
@@ -0,0 +1,130 @@
+// Append-only journal of simulation results
+
+#pragma once
+
+#include "sme/simulate_data.hpp"
+#include <QFile>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace sme::simulate {
+
+/**
+ * @brief Contents of a simulation results journal.
+ */
+struct SimulationDataJournalContents {
+  /**
+   * @brief Simulation times stored in the model before the journaled run.
+   */
+  std::vector<std::pair<std::size_t, double>> previousTimes{};
+  /**
+   * @brief Simulation times requested for the journaled run.
+   */
+  std::vector<std::pair<std::size_t, double>> requestedTimes{};
+  /**
+   * @brief Number of timepoints that existed before the journaled run.
+   */
+  std::size_t nInitialTimepoints{0};
+  /**
+   * @brief All journaled timepoints.
+   */
+  SimulationData data{};
+  /**
+   * @brief Size in bytes of the valid part of the journal file.
+   */
+  qint64 validBytes{0};
+  /**
+   * @brief Number of timesteps of the requested run that were completed.
+   */
+  [[nodiscard]] std::size_t nCompletedTimesteps() const;
+};
+
+/**
+ * @brief Read a simulation results journal.
+ *
+ * Any incomplete or corrupted records at the end of the file, e.g. from a
+ * crash during a write, are ignored.
+ *
+ * @returns Journal contents, or ``std::nullopt`` if the file is missing or
+ * not a valid journal.
+ */
+[[nodiscard]] std::optional<SimulationDataJournalContents>
+readSimulationDataJournal(const std::string &filename);
+
+/**
+ * @brief Split simulation times into completed and remaining timesteps.
+ *
+ * @returns ``(completed, remaining)`` times after ``nCompleted`` timesteps.
+ */
+[[nodiscard]] std::pair<std::vector<std::pair<std::size_t, double>>,
+                        std::vector<std::pair<std::size_t, double>>>
+splitSimulationTimes(const std::vector<std::pair<std::size_t, double>> &times,
+                     std::size_t nCompleted);
+
+/**
+ * @brief Append-only file of simulation results, written one timepoint at a
+ * time.
+ *
+ * Each timepoint is written to the OS as soon as it is appended, so it
+ * survives the process being killed. The file is additionally synced to disk
+ * every ``syncInterval`` timepoints, so it also survives e.g. a node failure.
+ * The cost of writing a timepoint is independent of the number of
+ * timepoints already in the journal.
+ */
+class SimulationDataJournal {
+private:
+  QFile file;
+  std::size_t syncInterval;
+  std::size_t nUnsynced{0};
+  bool valid{false};
+  bool writeRecord(const std::string &payload);
+
+public:
+  /**
+   * @brief Create a new journal containing all timepoints of ``data``.
+   * @param filename Journal file, overwritten if it exists.
+   * @param data Existing simulation data.
+   * @param previousTimes Simulation times of the existing data.
+   * @param requestedTimes Simulation times requested for this run.
+   * @param syncInterval Timepoints between syncs to disk, ``0`` for never.
+   */
+  SimulationDataJournal(
+      const std::string &filename, const SimulationData &data,
+      const std::vector<std::pair<std::size_t, double>> &previousTimes,
+      const std::vector<std::pair<std::size_t, double>> &requestedTimes,
+      std::size_t syncInterval = 1);
+  /**
+   * @brief Re-open an existing journal to append further timepoints.
+   * @param filename Journal file.
+   * @param contents Contents previously read from this journal.
+   * @param syncInterval Timepoints between syncs to disk, ``0`` for never.
+   */
+  SimulationDataJournal(const std::string &filename,
+                        const SimulationDataJournalContents &contents,
+                        std::size_t syncInterval = 1);
+  /**
+   * @brief Destructor, syncs the journal to disk.
+   */
+  ~SimulationDataJournal();
+  SimulationDataJournal(const SimulationDataJournal &) = delete;
+  SimulationDataJournal &operator=(const SimulationDataJournal &) = delete;
+  /**
+   * @brief Returns ``true`` if the journal file is open for writing.
+   */
+  [[nodiscard]] bool isValid() const;
+  /**
+   * @brief Append a timepoint from ``data`` to the journal.
+   * @returns ``true`` on success.
+   */
+  bool append(const SimulationData &data, std::size_t timeIndex);
+  /**
+   * @brief Flush and sync the journal to disk.
+   * @returns ``true`` on success.
+   */
+  bool sync();
+};
+
+} // namespace sme::simulate
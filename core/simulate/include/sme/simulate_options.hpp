@@ -28,8 +28,11 @@ enum class SimulatorType { DUNE, Pixel };
 
 /**
  * @brief DUNE spatial discretization type.
+ *
+ *   - FEM1: 1st order (linear) finite elements
+ *   - FEM2: 2nd order (quadratic) finite elements
  */
-enum class DuneDiscretizationType { FEM1 };
+enum class DuneDiscretizationType { FEM1, FEM2 };
 
 /**
  * @brief DUNE solver options.
@@ -79,10 +82,36 @@ struct DuneOptions {
    * @brief Linear solver name.
    */
   std::string linearSolver{"RestartedGMRes"};
+  /**
+   * @brief Linear solver preconditioner name (empty means solver default).
+   */
+  std::string preconditioner{};
   /**
    * @brief Max thread count (0 means automatic/default).
    */
   std::size_t maxThreads{0};
+  /**
+   * @brief Adaptively refine and coarsen the mesh during the simulation.
+   */
+  bool adaptiveMesh{false};
+  /**
+   * @brief Maximum number of times an element of the mesh can be refined.
+   */
+  std::size_t adaptiveMaxLevel{2};
+  /**
+   * @brief Refine elements where a species varies by more than this fraction
+   * of its range.
+   */
+  double adaptiveRefineTol{0.1};
+  /**
+   * @brief Coarsen elements where all species vary by less than this fraction
+   * of their range.
+   */
+  double adaptiveCoarsenTol{0.01};
+  /**
+   * @brief Number of timesteps between mesh adaptations.
+   */
+  std::size_t adaptiveInterval{10};
 
   template <class Archive>
   void serialize(Archive &ar, std::uint32_t const version) {
@@ -103,6 +132,15 @@ struct DuneOptions {
          CEREAL_NVP(decrease), CEREAL_NVP(writeVTKfiles),
          CEREAL_NVP(newtonRelErr), CEREAL_NVP(newtonAbsErr),
          CEREAL_NVP(linearSolver), CEREAL_NVP(maxThreads));
+    } else if (version == 3) {
+      ar(CEREAL_NVP(discretization), CEREAL_NVP(integrator), CEREAL_NVP(dt),
+         CEREAL_NVP(minDt), CEREAL_NVP(maxDt), CEREAL_NVP(increase),
+         CEREAL_NVP(decrease), CEREAL_NVP(writeVTKfiles),
+         CEREAL_NVP(newtonRelErr), CEREAL_NVP(newtonAbsErr),
+         CEREAL_NVP(linearSolver), CEREAL_NVP(maxThreads),
+         CEREAL_NVP(preconditioner), CEREAL_NVP(adaptiveMesh),
+         CEREAL_NVP(adaptiveMaxLevel), CEREAL_NVP(adaptiveRefineTol),
+         CEREAL_NVP(adaptiveCoarsenTol), CEREAL_NVP(adaptiveInterval));
     }
   }
 };
@@ -252,7 +290,7 @@ struct AvgMinMax {
 } // namespace sme::simulate
 
 CEREAL_CLASS_VERSION(sme::simulate::Options, 0);
-CEREAL_CLASS_VERSION(sme::simulate::DuneOptions, 2);
+CEREAL_CLASS_VERSION(sme::simulate::DuneOptions, 3);
 CEREAL_CLASS_VERSION(sme::simulate::PixelIntegratorError, 0);
 CEREAL_CLASS_VERSION(sme::simulate::PixelOptions, 1);
 CEREAL_CLASS_VERSION(sme::simulate::AvgMinMax, 0);
@@ -1,12 +1,81 @@
+#pragma once
+
 #include "sme/image_stack.hpp"
 #include "sme/model.hpp"
+#include "sme/simulate_checkpoint.hpp"
 #include "sme/simulate_options.hpp"
 #include <cstddef>
+#include <functional>
+#include <limits>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
 
 namespace sme::simulate {
 class BaseSim;
+struct ConcentrationChange;
 enum class SteadyStateConvergenceMode { absolute, relative };
 
+/**
+ * @brief Steady state solver type.
+ *
+ *   - timestepping: run the simulator until the concentrations stop changing
+ *   - newton_krylov: solve dc/dt = 0 directly using a Jacobian-free
+ *     Newton-Krylov method with pseudo-transient continuation, using the
+ *     Pixel discretization
+ */
+enum class SteadyStateSolverType { timestepping, newton_krylov };
+
+/**
+ * @brief Options for a steady state continuation in a model parameter.
+ */
+struct SteadyStateContinuationOptions {
+  /**
+   * @brief Id of the constant model parameter to vary.
+   */
+  std::string parameterId{};
+  /**
+   * @brief First parameter value.
+   */
+  double start{0.0};
+  /**
+   * @brief Last parameter value.
+   */
+  double end{1.0};
+  /**
+   * @brief Initial step in the parameter value.
+   */
+  double initialStep{0.1};
+  /**
+   * @brief The continuation stops if the step is reduced below this value.
+   */
+  double minStep{1e-6};
+  /**
+   * @brief Maximum step in the parameter value.
+   */
+  double maxStep{std::numeric_limits<double>::max()};
+};
+
+/**
+ * @brief A steady state found by a continuation.
+ */
+struct SteadyStateContinuationPoint {
+  /**
+   * @brief The parameter value.
+   */
+  double parameterValue{0.0};
+  /**
+   * @brief The convergence criterion at the steady state.
+   */
+  double error{0.0};
+  /**
+   * @brief The cost of finding the steady state: the simulation time for
+   * time stepping, or the number of Newton iterations.
+   */
+  double steps{0.0};
+};
+
 class SteadyStateSimulation final {
 
   // data members for simulation
@@ -20,6 +89,9 @@ class SteadyStateSimulation final {
   double m_timeout_ms;
   SteadyStateConvergenceMode m_stop_mode;
   double m_dt; // timestep to check for convergence, not solver timestep
+  SteadyStateSolverType m_solver_type;
+  // parameter values that replace those in the model
+  std::map<std::string, double, std::less<>> m_substitutions = {};
   mutable std::mutex m_concentration_mutex = std::mutex();
 
   // data members for plotting
@@ -36,13 +108,18 @@ class SteadyStateSimulation final {
   // helper functions for solvers
   void initModel();
   void initSimulator();
+  void restartSimulator(const std::optional<SolverCheckpoint> &initialState);
 
   // .. and for running them
   void runDune(double time);
   void runPixel(double time);
+  void runNewtonKrylov();
   [[nodiscard]] double
-  computeStoppingCriterion(const std::vector<double> &c_old,
-                           const std::vector<double> &c_new) const;
+  computeStoppingCriterion(const ConcentrationChange &change) const;
+  double updateStoppingCriterion();
+  [[nodiscard]] double
+  computeResidualCriterion(const std::vector<double> &residual,
+                           const std::vector<double> &c) const;
 
   // helper functions for data
   [[nodiscard]] std::vector<std::vector<double>>
@@ -67,12 +144,15 @@ public:
    * @param timeout_ms Number of milliseconds the simulation is allowed to run
    * before stopping
    * @param dt Timestep to check for convergence (not solver timestep, this is
-   * set independently by the solver itself (!))
+   * set independently by the solver itself (!)). For the Newton-Krylov solver
+   * this is the initial pseudo-timestep.
+   * @param solver_type The steady state solver to use
    */
-  SteadyStateSimulation(sme::model::Model &model, double tolerance,
-                        std::size_t steps_to_convergence,
-                        SteadyStateConvergenceMode convergence_mode,
-                        double timeout_ms, double dt);
+  SteadyStateSimulation(
+      sme::model::Model &model, double tolerance,
+      std::size_t steps_to_convergence,
+      SteadyStateConvergenceMode convergence_mode, double timeout_ms, double dt,
+      SteadyStateSolverType solver_type = SteadyStateSolverType::timestepping);
   ~SteadyStateSimulation();
 
   // getters
@@ -98,6 +178,13 @@ public:
    */
   [[nodiscard]] SteadyStateConvergenceMode getConvergenceMode() const;
 
+  /**
+   * @brief Get the steady state solver type
+   *
+   * @return SteadyStateSolverType
+   */
+  [[nodiscard]] SteadyStateSolverType getSolverType() const;
+
   /**
    * @brief Get the number of steps below tolerance required to consider the
    * simulation converged
@@ -207,6 +294,19 @@ public:
       const std::vector<std::vector<std::size_t>> &speciesToDraw,
       bool normaliseOverAllSpecies);
 
+  /**
+   * @brief Get the concentrations of each species in a compartment
+   *
+   * The concentrations of each species are returned as a flat array over all
+   * voxels of the image, in the same order as ``Simulation::getPyConcs``,
+   * with zero concentration outside the compartment.
+   *
+   * @param compartmentIndex the index of the compartment
+   * @return std::vector<std::vector<double>>
+   */
+  [[nodiscard]] std::vector<std::vector<double>>
+  getPyConcs(std::size_t compartmentIndex);
+
   // setters
 
   /**
@@ -216,6 +316,15 @@ public:
    */
   void setConvergenceMode(SteadyStateConvergenceMode mode);
 
+  /**
+   * @brief Set the steady state solver type
+   *
+   * If this changes the solver type, the simulation is reset.
+   *
+   * @param solver_type SteadyStateSolverType: timestepping or newton_krylov
+   */
+  void setSolverType(SteadyStateSolverType solver_type);
+
   /**
    * @brief Set the tolerance used to determine convergence
    *
@@ -254,6 +363,32 @@ public:
    */
   void run();
 
+  /**
+   * @brief Find the steady states for a range of values of a model parameter
+   *
+   * Each steady state is used as the initial state for the next parameter
+   * value. The step in the parameter value grows while steady states are
+   * found without needing many more steps than the previous one, and is
+   * halved if the solver does not converge. The parameter values are
+   * substituted in the simulator, the model itself is not modified, and any
+   * existing substitutions are restored afterwards.
+   *
+   * A new simulator is constructed for each parameter value, since the
+   * parameter values are compiled into the simulator as constants, and its
+   * state is set to the previous steady state. If the state cannot be set,
+   * for example for a DUNE simulation with an adaptive mesh, a warning is
+   * logged and the steady state is found from the initial concentrations.
+   *
+   * @param options The parameter and range of values
+   * @param onSteadyState Called after each steady state is found, when the
+   * concentrations of the simulation are the steady state concentrations
+   * @return The steady states that were found
+   */
+  std::vector<SteadyStateContinuationPoint>
+  runContinuation(const SteadyStateContinuationOptions &options,
+                  const std::function<void(const SteadyStateContinuationPoint
+                                               &)> &onSteadyState = {});
+
   /**
    * @brief Request the simulation to stop
    *
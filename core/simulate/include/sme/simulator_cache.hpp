@@ -0,0 +1,36 @@
+// Simulator data reused between simulations of a model
+//  - owned by the model, released when the model is cleared or destroyed
+
+#pragma once
+
+#include <memory>
+
+namespace sme::simulate {
+
+struct DuneSimCache;
+
+/**
+ * @brief Data that can be reused by subsequent simulations of a model.
+ *
+ * For example the DUNE grid and the mapping between its elements and the
+ * geometry voxels, which only depend on the mesh and the geometry.
+ */
+class SimulatorCache {
+  std::unique_ptr<DuneSimCache> duneSimCache;
+
+public:
+  SimulatorCache();
+  ~SimulatorCache();
+  SimulatorCache(const SimulatorCache &) = delete;
+  SimulatorCache &operator=(const SimulatorCache &) = delete;
+  /**
+   * @brief Cache used by the DUNE simulator.
+   */
+  [[nodiscard]] DuneSimCache &getDuneSimCache();
+  /**
+   * @brief Discard all cached data.
+   */
+  void clear();
+};
+
+} // namespace sme::simulate
@@ -3,12 +3,28 @@
 #pragma once
 
 #include "sme/image_stack.hpp"
+#include "sme/simulate_checkpoint.hpp"
 #include <QImage>
+#include <optional>
 #include <string>
 #include <vector>
 
 namespace sme::simulate {
 
+/**
+ * @brief Sums of squares used to monitor convergence to a steady state.
+ */
+struct ConcentrationChange {
+  /**
+   * @brief Sum of squares of the change in concentrations.
+   */
+  double sumSquaredChange{0.0};
+  /**
+   * @brief Sum of squares of the concentrations.
+   */
+  double sumSquaredConcentration{0.0};
+};
+
 /**
  * @brief Abstract interface implemented by simulation backends.
  */
@@ -52,6 +68,31 @@ public:
    * @brief Request/clear stop flag.
    */
   virtual void setStopRequested(bool stoprequested) = 0;
+  /**
+   * @brief Current solver state, or ``std::nullopt`` if not supported.
+   */
+  [[nodiscard]] virtual std::optional<SolverCheckpoint> getCheckpoint() const {
+    return {};
+  }
+  /**
+   * @brief Change in concentrations since the previous call, or
+   * ``std::nullopt`` if not supported.
+   *
+   * Only species concentrations are included, not the padding. The current
+   * concentrations become the reference for the next call. The reference is
+   * allocated by the first call, which reports no change.
+   */
+  [[nodiscard]] virtual std::optional<ConcentrationChange>
+  updateConcentrationChange() {
+    return {};
+  }
+  /**
+   * @brief Restore solver state, returns ``false`` if not applied.
+   */
+  virtual bool
+  setCheckpoint([[maybe_unused]] const SolverCheckpoint &checkpoint) {
+    return false;
+  }
 };
 
 } // namespace sme::simulate
@@ -0,0 +1,262 @@
+#include "conc_image_pyramid.hpp"
+#include "sme/geometry.hpp"
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <utility>
+
+namespace sme::simulate {
+
+namespace {
+
+template <typename T>
+[[nodiscard]] std::size_t vectorBytes(const std::vector<T> &v) {
+  return v.capacity() * sizeof(T);
+}
+
+} // namespace
+
+ConcImagePyramid::ConcImagePyramid(
+    const common::Volume &imageSize, const common::VolumeF &voxelSize,
+    const std::vector<const geometry::Compartment *> &compartments,
+    std::vector<std::size_t> compartmentNSpecies, std::size_t nLevels)
+    : fullSize{imageSize}, nSpecies{std::move(compartmentNSpecies)} {
+  const auto depth{imageSize.depth()};
+  for (std::size_t k = 1; k <= nLevels; ++k) {
+    const int f{1 << k};
+    const auto fz{static_cast<std::size_t>(f)};
+    // stop once a level would be smaller than a single voxel
+    if (f > std::max(imageSize.width(), imageSize.height()) && fz > depth) {
+      break;
+    }
+    auto &level{levels.emplace_back()};
+    level.volume = common::Volume((imageSize.width() + f - 1) / f,
+                                  (imageSize.height() + f - 1) / f,
+                                  (depth + fz - 1) / fz);
+    level.voxelSize =
+        common::VolumeF(voxelSize.width() * f, voxelSize.height() * f,
+                        voxelSize.depth() * static_cast<double>(
+                                                std::min(fz, depth)));
+    constexpr auto none{std::numeric_limits<std::size_t>::max()};
+    std::vector<std::size_t> cellIndex(level.volume.nVoxels(), none);
+    for (const auto *compartment : compartments) {
+      auto &cc{level.compartments.emplace_back()};
+      const auto &voxels{compartment->getVoxels()};
+      cc.voxelCells.reserve(voxels.size());
+      for (const auto &voxel : voxels) {
+        const common::Voxel cell{voxel.p.x() / f, voxel.p.y() / f,
+                                 voxel.z / fz};
+        auto &index{cellIndex[common::voxelArrayIndex(level.volume, cell)]};
+        if (index == none) {
+          index = cc.cells.size();
+          cc.cells.push_back(cell);
+          cc.counts.push_back(0.0);
+        }
+        cc.counts[index] += 1.0;
+        cc.voxelCells.push_back(index);
+      }
+      cc.weights.reserve(cc.cells.size());
+      for (std::size_t i = 0; i < cc.cells.size(); ++i) {
+        const auto &cell{cc.cells[i]};
+        // cells on the image boundary may be smaller than f x f x f voxels
+        const int w{std::min(f, imageSize.width() - cell.p.x() * f)};
+        const int h{std::min(f, imageSize.height() - cell.p.y() * f)};
+        const auto d{std::min(fz, depth - cell.z * fz)};
+        cc.weights.push_back(cc.counts[i] / static_cast<double>(w * h) /
+                             static_cast<double>(d));
+        cellIndex[common::voxelArrayIndex(level.volume, cell)] = none;
+      }
+      levelsBytes += vectorBytes(cc.cells) + vectorBytes(cc.weights) +
+                     vectorBytes(cc.counts) + vectorBytes(cc.voxelCells);
+    }
+  }
+}
+
+std::size_t ConcImagePyramid::nLevels() const { return levels.size(); }
+
+std::size_t ConcImagePyramid::getLevel(const common::Volume &imageSize,
+                                       const QSize &displaySize,
+                                       std::size_t maxLevel) {
+  if (displaySize.isEmpty() || imageSize.nVoxels() == 0) {
+    return 0;
+  }
+  // the displayed image is scaled to fit, preserving its aspect ratio
+  const double w{static_cast<double>(imageSize.width())};
+  const double h{static_cast<double>(imageSize.height())};
+  const double scale{std::min(displaySize.width() / w,
+                              displaySize.height() / h)};
+  std::size_t level{0};
+  while (level < maxLevel &&
+         scale * static_cast<double>(1 << (level + 1)) <= 1.0) {
+    ++level;
+  }
+  return level;
+}
+
+std::size_t ConcImagePyramid::getLevel(const QSize &displaySize) const {
+  return getLevel(fullSize, displaySize, levels.size());
+}
+
+void ConcImagePyramid::setMaxMemoryBytes(std::size_t bytes) {
+  std::scoped_lock lock{mutex};
+  maxConcsBytes = bytes;
+}
+
+std::size_t ConcImagePyramid::getReservedMemoryBytes() const {
+  return levelsBytes + maxConcsBytes;
+}
+
+std::size_t ConcImagePyramid::getMemoryBytes() {
+  std::scoped_lock lock{mutex};
+  return levelsBytes + concsBytes;
+}
+
+ConcImagePyramid::LevelConcs
+ConcImagePyramid::compute(std::size_t timeIndex,
+                          const SimulationData &data) const {
+  LevelConcs levelConcs;
+  levelConcs.reserve(levels.size());
+  const auto timeConc{data.getConcentration(timeIndex)};
+  for (const auto &level : levels) {
+    auto &compConcs{levelConcs.emplace_back()};
+    compConcs.reserve(level.compartments.size());
+    for (std::size_t ic = 0; ic < level.compartments.size(); ++ic) {
+      const auto &cc{level.compartments[ic]};
+      const auto ns{nSpecies[ic]};
+      const std::size_t stride{ns + data.concPadding[timeIndex]};
+      const auto &conc{(*timeConc)[ic]};
+      auto &avg{compConcs.emplace_back(cc.cells.size() * ns, 0.0)};
+      for (std::size_t ix = 0; ix < cc.voxelCells.size(); ++ix) {
+        const auto cell{cc.voxelCells[ix]};
+        for (std::size_t is = 0; is < ns; ++is) {
+          avg[cell * ns + is] += conc[ix * stride + is];
+        }
+      }
+      for (std::size_t i = 0; i < cc.cells.size(); ++i) {
+        for (std::size_t is = 0; is < ns; ++is) {
+          avg[i * ns + is] /= cc.counts[i];
+        }
+      }
+    }
+  }
+  return levelConcs;
+}
+
+void ConcImagePyramid::store(std::size_t timeIndex, LevelConcs &&levelConcs) {
+  if (timepoints.size() <= timeIndex) {
+    timepoints.resize(timeIndex + 1);
+  }
+  auto &tp{timepoints[timeIndex]};
+  concsBytes -= tp.bytes;
+  tp.concs = std::move(levelConcs);
+  tp.bytes = 0;
+  for (const auto &compConcs : tp.concs) {
+    for (const auto &avg : compConcs) {
+      tp.bytes += vectorBytes(avg);
+    }
+  }
+  tp.lastUsed = ++useCount;
+  concsBytes += tp.bytes;
+  if (maxConcsBytes == 0) {
+    return;
+  }
+  // discard least recently used timepoints, apart from this one
+  while (concsBytes > maxConcsBytes) {
+    TimepointConcs *lru{nullptr};
+    for (std::size_t i = 0; i < timepoints.size(); ++i) {
+      auto &t{timepoints[i]};
+      if (i != timeIndex && !t.concs.empty() &&
+          (lru == nullptr || t.lastUsed < lru->lastUsed)) {
+        lru = &t;
+      }
+    }
+    if (lru == nullptr) {
+      break;
+    }
+    concsBytes -= lru->bytes;
+    lru->concs = {};
+    lru->bytes = 0;
+  }
+}
+
+void ConcImagePyramid::update(std::size_t timeIndex,
+                              const SimulationData &data) {
+  auto levelConcs{compute(timeIndex, data)};
+  std::scoped_lock lock{mutex};
+  for (std::size_t i = timeIndex; i < timepoints.size(); ++i) {
+    concsBytes -= timepoints[i].bytes;
+  }
+  timepoints.resize(timeIndex);
+  store(timeIndex, std::move(levelConcs));
+}
+
+void ConcImagePyramid::clear() {
+  std::scoped_lock lock{mutex};
+  timepoints.clear();
+  concsBytes = 0;
+}
+
+common::ImageStack ConcImagePyramid::getImage(
+    std::size_t level, std::size_t timeIndex, const SimulationData &data,
+    const std::vector<std::vector<std::size_t>> &speciesToDraw,
+    const std::vector<std::vector<double>> &maxConcs,
+    const std::vector<std::vector<QRgb>> &colors) {
+  std::unique_lock lock{mutex};
+  if (timepoints.size() <= timeIndex || timepoints[timeIndex].concs.empty()) {
+    lock.unlock();
+    auto levelConcs{compute(timeIndex, data)};
+    lock.lock();
+    store(timeIndex, std::move(levelConcs));
+  } else {
+    timepoints[timeIndex].lastUsed = ++useCount;
+  }
+  const auto &lvl{levels[level - 1]};
+  const auto &levelConcs{timepoints[timeIndex].concs[level - 1]};
+  // sum of the colors of each compartment weighted by its coverage
+  std::vector<std::array<double, 3>> rgb(lvl.volume.nVoxels(), {0, 0, 0});
+  std::vector<bool> covered(lvl.volume.nVoxels(), false);
+  for (std::size_t ic = 0; ic < lvl.compartments.size(); ++ic) {
+    const auto &cc{lvl.compartments[ic]};
+    const auto ns{nSpecies[ic]};
+    const auto &avg{levelConcs[ic]};
+    for (std::size_t i = 0; i < cc.cells.size(); ++i) {
+      int r = 0;
+      int g = 0;
+      int b = 0;
+      for (std::size_t is : speciesToDraw[ic]) {
+        double c = avg[i * ns + is] / maxConcs[ic][is];
+        const auto &col = colors[ic][is];
+        r += static_cast<int>(qRed(col) * c);
+        g += static_cast<int>(qGreen(col) * c);
+        b += static_cast<int>(qBlue(col) * c);
+      }
+      const auto index{common::voxelArrayIndex(lvl.volume, cc.cells[i])};
+      const double w{cc.weights[i]};
+      rgb[index][0] += w * std::min(r, 255);
+      rgb[index][1] += w * std::min(g, 255);
+      rgb[index][2] += w * std::min(b, 255);
+      covered[index] = true;
+    }
+  }
+  common::ImageStack imgs(lvl.volume, QImage::Format_ARGB32_Premultiplied);
+  imgs.setVoxelSize(lvl.voxelSize);
+  imgs.fill(0);
+  std::size_t index{0};
+  for (std::size_t z = 0; z < lvl.volume.depth(); ++z) {
+    for (int y = 0; y < lvl.volume.height(); ++y) {
+      for (int x = 0; x < lvl.volume.width(); ++x) {
+        if (covered[index]) {
+          const auto &[r, g, b] = rgb[index];
+          imgs[z].setPixel(x, y,
+                           qRgb(std::min(static_cast<int>(r), 255),
+                                std::min(static_cast<int>(g), 255),
+                                std::min(static_cast<int>(b), 255)));
+        }
+        ++index;
+      }
+    }
+  }
+  return imgs;
+}
+
+} // namespace sme::simulate
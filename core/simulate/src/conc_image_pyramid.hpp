@@ -0,0 +1,150 @@
+// Downsampled concentrations for fast rendering of simulation images
+
+#pragma once
+
+#include "sme/image_stack.hpp"
+#include "sme/simulate_data.hpp"
+#include "sme/voxel.hpp"
+#include <QRgb>
+#include <QSize>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace sme {
+
+namespace geometry {
+class Compartment;
+}
+
+namespace simulate {
+
+/**
+ * @brief Multi-resolution pyramid of simulation concentrations.
+ *
+ * Level ``k`` averages the concentrations over blocks of ``2^k x 2^k x 2^k``
+ * voxels, so that an image for a small display can be rendered without
+ * iterating over every voxel of a large geometry. Level 0 is the full
+ * resolution image, which is not stored here.
+ *
+ * Downsampled concentrations are a cache: if a maximum memory size is set,
+ * the least recently used timepoints are discarded and recomputed on demand.
+ */
+class ConcImagePyramid {
+  struct CompartmentCells {
+    // coarse voxels that contain at least one voxel of the compartment
+    std::vector<common::Voxel> cells;
+    // fraction of each coarse voxel covered by the compartment
+    std::vector<double> weights;
+    // number of compartment voxels in each coarse voxel
+    std::vector<double> counts;
+    // coarse voxel index for each compartment voxel
+    std::vector<std::size_t> voxelCells;
+  };
+  struct Level {
+    common::Volume volume;
+    common::VolumeF voxelSize;
+    std::vector<CompartmentCells> compartments;
+  };
+  // level->compartment->concentrations[cell * nSpecies + species]
+  using LevelConcs = std::vector<std::vector<std::vector<double>>>;
+  struct TimepointConcs {
+    LevelConcs concs;
+    std::size_t bytes{0};
+    std::uint64_t lastUsed{0};
+  };
+  common::Volume fullSize;
+  std::vector<Level> levels;
+  std::vector<std::size_t> nSpecies;
+  std::size_t levelsBytes{0};
+  std::vector<TimepointConcs> timepoints;
+  std::size_t concsBytes{0};
+  std::size_t maxConcsBytes{0};
+  std::uint64_t useCount{0};
+  std::mutex mutex;
+  [[nodiscard]] LevelConcs compute(std::size_t timeIndex,
+                                   const SimulationData &data) const;
+  void store(std::size_t timeIndex, LevelConcs &&levelConcs);
+
+public:
+  /**
+   * @brief Construct the pyramid geometry.
+   * @param imageSize Full resolution image volume.
+   * @param voxelSize Full resolution voxel size.
+   * @param compartments Compartments to include.
+   * @param compartmentNSpecies Number of species in each compartment.
+   * @param nLevels Maximum number of downsampled levels.
+   */
+  ConcImagePyramid(
+      const common::Volume &imageSize, const common::VolumeF &voxelSize,
+      const std::vector<const geometry::Compartment *> &compartments,
+      std::vector<std::size_t> compartmentNSpecies, std::size_t nLevels);
+  /**
+   * @brief Number of downsampled levels.
+   */
+  [[nodiscard]] std::size_t nLevels() const;
+  /**
+   * @brief Coarsest level that still has at least one voxel per display pixel.
+   * @param imageSize Full resolution image volume.
+   * @param displaySize Size of the display, empty for full resolution.
+   * @param maxLevel Maximum level to return.
+   * @returns Level, or 0 if the full resolution image should be used.
+   */
+  [[nodiscard]] static std::size_t getLevel(const common::Volume &imageSize,
+                                            const QSize &displaySize,
+                                            std::size_t maxLevel);
+  /**
+   * @brief Coarsest level of this pyramid for a display.
+   */
+  [[nodiscard]] std::size_t getLevel(const QSize &displaySize) const;
+  /**
+   * @brief Maximum memory used by downsampled concentrations, ``0`` means
+   * unlimited.
+   */
+  void setMaxMemoryBytes(std::size_t bytes);
+  /**
+   * @brief Memory reserved by this pyramid: its geometry plus the maximum
+   * memory used by downsampled concentrations.
+   */
+  [[nodiscard]] std::size_t getReservedMemoryBytes() const;
+  /**
+   * @brief Current memory used by this pyramid.
+   */
+  [[nodiscard]] std::size_t getMemoryBytes();
+  /**
+   * @brief Compute the downsampled concentrations for a timepoint.
+   *
+   * Replaces any existing values for this timepoint, and discards any
+   * later timepoints. Requires shared access to ``data``, the values are
+   * computed without blocking readers of this pyramid.
+   */
+  void update(std::size_t timeIndex, const SimulationData &data);
+  /**
+   * @brief Discard all downsampled concentrations.
+   */
+  void clear();
+  /**
+   * @brief Render a downsampled concentration image stack.
+   *
+   * Concentrations for the timepoint are computed first if not already
+   * available.
+   *
+   * @param level Level to render, must be between 1 and ``nLevels()``.
+   * @param timeIndex Time index.
+   * @param data Simulation data.
+   * @param speciesToDraw Per-compartment species indices to draw.
+   * @param maxConcs Per-compartment species normalisation.
+   * @param colors Per-compartment species colors.
+   * @returns Concentration image stack.
+   */
+  [[nodiscard]] common::ImageStack
+  getImage(std::size_t level, std::size_t timeIndex, const SimulationData &data,
+           const std::vector<std::vector<std::size_t>> &speciesToDraw,
+           const std::vector<std::vector<double>> &maxConcs,
+           const std::vector<std::vector<QRgb>> &colors);
+};
+
+} // namespace simulate
+
+} // namespace sme
@@ -62,9 +62,19 @@ static void addGrid(IniFile &ini, int dimension, const QString &filenameGrid) {
   ini.addValue("dimension", dimension);
 }
 
-static void addModel(IniFile &ini) {
+static int getOrder(simulate::DuneDiscretizationType discretization) {
+  switch (discretization) {
+  case simulate::DuneDiscretizationType::FEM2:
+    return 2;
+  default:
+    return 1;
+  }
+}
+
+static void addModel(IniFile &ini,
+                     simulate::DuneDiscretizationType discretization) {
   ini.addSection("model");
-  ini.addValue("order", 1);
+  ini.addValue("order", getOrder(discretization));
   ini.addValue("parser_type", "SymEngineSBML");
 }
 
@@ -83,6 +93,11 @@ static void addTimeStepping(IniFile &ini,
   ini.addValue("time_step_max", duneOptions.maxDt, doublePrecision);
   ini.addSection("model", "time_step_operator", "linear_solver");
   ini.addValue("type", duneOptions.linearSolver.c_str());
+  if (!duneOptions.preconditioner.empty()) {
+    ini.addSection("model", "time_step_operator", "linear_solver",
+                   "preconditioner");
+    ini.addValue("type", duneOptions.preconditioner.c_str());
+  }
   ini.addSection("model", "time_step_operator", "nonlinear_solver");
   ini.addValue("type", duneOptions.integrator.c_str());
   ini.addValue("convergence_condition.relative_tolerance",
@@ -440,7 +455,8 @@ DuneConverter::DuneConverter(
   IniFile iniCommon;
   int dimension = mesh3d != nullptr ? 3 : 2;
   addGrid(iniCommon, dimension, filenameGrid);
-  addModel(iniCommon);
+  addModel(iniCommon,
+           model.getSimulationSettings().options.dune.discretization);
   addTimeStepping(iniCommon, model.getSimulationSettings().options.dune,
                   doublePrecision);
   addWriter(iniCommon);
@@ -495,6 +511,7 @@ DuneConverter::DuneConverter(
   }
 
   iniFile = iniCommon.getText();
+  iniEntries = iniCommon.getEntries();
 
   if (forExternalUse) {
     // export ini files
@@ -524,6 +541,11 @@ DuneConverter::DuneConverter(
 
 QString DuneConverter::getIniFile() const { return iniFile; }
 
+const std::vector<std::pair<std::string, std::string>> &
+DuneConverter::getIniEntries() const {
+  return iniEntries;
+}
+
 const mesh::Mesh2d *DuneConverter::getMesh() const { return mesh; }
 
 const mesh::Mesh3d *DuneConverter::getMesh3d() const { return mesh3d; }
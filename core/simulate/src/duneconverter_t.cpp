@@ -3,6 +3,7 @@
 #include "model_test_utils.hpp"
 #include "sme/duneconverter.hpp"
 #include "sme/model.hpp"
+#include <utility>
 
 using namespace sme;
 using namespace sme::test;
@@ -72,6 +73,37 @@ TEST_CASE("DUNE: DuneConverter",
     REQUIRE(*line++ == "initial.expression = 0");
     REQUIRE(*line++ == "storage.expression = 2.5");
   }
+  SECTION("ABtoC model with linear solver preconditioner") {
+    auto s{getExampleModel(Mod::ABtoC)};
+    auto &options{s.getSimulationSettings().options.dune};
+    {
+      simulate::DuneConverter dc(s, {}, true, {}, 14);
+      REQUIRE(!dc.getIniFile().contains("preconditioner"));
+    }
+    options.preconditioner = "AMG";
+    simulate::DuneConverter dc(s, {}, true, {}, 14);
+    QStringList ini = dc.getIniFile().split("\n");
+    auto line = find_line(
+        "[model.time_step_operator.linear_solver.preconditioner]", ini);
+    REQUIRE(*line++ ==
+            "[model.time_step_operator.linear_solver.preconditioner]");
+    REQUIRE(*line++ == "type = AMG");
+  }
+  SECTION("ABtoC model with each discretization") {
+    auto s{getExampleModel(Mod::ABtoC)};
+    auto &options{s.getSimulationSettings().options.dune};
+    for (auto [discretization, order] :
+         {std::pair{simulate::DuneDiscretizationType::FEM1, "order = 1"},
+          std::pair{simulate::DuneDiscretizationType::FEM2, "order = 2"}}) {
+      CAPTURE(order);
+      options.discretization = discretization;
+      simulate::DuneConverter dc(s, {}, true, {}, 14);
+      QStringList ini = dc.getIniFile().split("\n");
+      auto line = find_line("[model]", ini);
+      REQUIRE(*line++ == "[model]");
+      REQUIRE(*line++ == order);
+    }
+  }
   SECTION("ABtoC model with off-diagonal cross-diffusion") {
     auto s{getExampleModel(Mod::ABtoC)};
     s.getSpecies().setCrossDiffusionConstant("C", "A", "2");
@@ -11,9 +11,14 @@
 #include "sme/voxel.hpp"
 #include <QPoint>
 #include <algorithm>
+#include <array>
+#include <cmath>
 #include <cstddef>
 #include <dune/functions/gridfunctions/gridviewfunction.hh>
+#include <limits>
+#include <map>
 #include <memory>
+#include <span>
 #include <vector>
 
 namespace Dune {
@@ -24,6 +29,9 @@ namespace sme::simulate {
 
 /**
  * @brief Analytic grid function sampling concentration from voxel arrays.
+ *
+ * The concentration array is not copied, and must outlive this function and
+ * any copies of it.
  */
 template <typename Domain> class SmeGridFunction {
 public:
@@ -33,7 +41,7 @@ public:
   SmeGridFunction(const common::VoxelF &physicalOrigin,
                   const common::VolumeF &voxelVolume,
                   const common::Volume &imageVolume,
-                  const std::vector<double> &concentration)
+                  std::span<const double> concentration)
       : origin{physicalOrigin}, voxel{voxelVolume}, vol{imageVolume},
         c(concentration) {
     SPDLOG_TRACE("  - {}x{}x{} voxels", vol.width(), vol.height(), vol.depth());
@@ -71,11 +79,96 @@ private:
   common::VoxelF origin;
   common::VolumeF voxel;
   common::Volume vol;
-  std::vector<double> c;
+  std::span<const double> c;
+};
+
+/**
+ * @brief Analytic grid function returning the value at the nearest vertex.
+ *
+ * Used to interpolate P1 vertex values onto a grid that contains these
+ * vertices, but with different vertex indices, e.g. after the grid has been
+ * adapted.
+ */
+template <typename Domain> class VertexValueFunction {
+public:
+  /**
+   * @brief Construct from vertex positions and values.
+   * @param positions Vertex positions.
+   * @param values Value at each vertex.
+   * @param cellWidth Width of the cells used to look up nearby vertices.
+   */
+  VertexValueFunction(const std::vector<Domain> &positions,
+                      const std::vector<double> &values, double cellWidth)
+      : data{std::make_shared<Data>()} {
+    data->width = cellWidth > 0 ? cellWidth : 1.0;
+    data->positions = positions;
+    data->values = values;
+    for (std::size_t i = 0; i < positions.size(); ++i) {
+      data->cells[toCell(positions[i])].push_back(i);
+    }
+  }
+  /**
+   * @brief Evaluate value of nearest vertex to global coordinate.
+   */
+  double operator()(const Domain &globalPos) const {
+    auto cell{toCell(globalPos)};
+    double minDist{std::numeric_limits<double>::max()};
+    double value{0.0};
+    auto checkVertex = [&](std::size_t iVertex) {
+      auto d{(data->positions[iVertex] - globalPos).two_norm2()};
+      if (d < minDist) {
+        minDist = d;
+        value = data->values[iVertex];
+      }
+    };
+    // check this cell and all neighbouring cells
+    constexpr std::size_t nNeighbours{Domain::size() == 3 ? 27 : 9};
+    for (std::size_t n = 0; n < nNeighbours; ++n) {
+      auto neighbour{cell};
+      auto m{n};
+      for (std::size_t j = 0; j < Domain::size(); ++j) {
+        neighbour[j] += static_cast<long>(m % 3) - 1;
+        m /= 3;
+      }
+      if (auto iter{data->cells.find(neighbour)}; iter != data->cells.end()) {
+        for (auto iVertex : iter->second) {
+          checkVertex(iVertex);
+        }
+      }
+    }
+    if (minDist == std::numeric_limits<double>::max()) {
+      // no nearby vertex: fall back to checking all vertices
+      for (std::size_t i = 0; i < data->positions.size(); ++i) {
+        checkVertex(i);
+      }
+    }
+    return value;
+  }
+
+private:
+  using Cell = std::array<long, 3>;
+  struct Data {
+    double width{1.0};
+    std::vector<Domain> positions;
+    std::vector<double> values;
+    std::map<Cell, std::vector<std::size_t>> cells;
+  };
+  // shared between copies, as grid functions are copied by value
+  std::shared_ptr<Data> data;
+  [[nodiscard]] Cell toCell(const Domain &x) const {
+    Cell cell{0, 0, 0};
+    for (std::size_t j = 0; j < Domain::size(); ++j) {
+      cell[j] = static_cast<long>(std::floor(x[j] / data->width));
+    }
+    return cell;
+  }
 };
 
 /**
  * @brief Build DUNE grid functions for each simulated species.
+ *
+ * The functions refer to the concentration arrays of ``dc``, so must not
+ * outlive it.
  */
 template <typename Grid, typename GridFunction>
 std::unordered_map<std::string, GridFunction>
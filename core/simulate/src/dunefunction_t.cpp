@@ -336,3 +336,29 @@ TEST_CASE("DUNE: function 3d - small cell volumes",
     }
   }
 }
+
+TEST_CASE("DUNE: vertex value function",
+          "[core/simulate/dunefunction][core/"
+          "simulate][core][dunefunction][dune]") {
+  using Domain = Dune::FieldVector<double, 2>;
+  std::vector<Domain> positions{{0.0, 0.0}, {1.0, 0.0}, {0.0, 1.0},
+                                {0.5, 0.5}, {10.0, 10.0}};
+  std::vector<double> values{1.0, 2.0, 3.0, 4.0, 5.0};
+  simulate::VertexValueFunction<Domain> f(positions, values, 0.5);
+  // vertex positions, including small rounding differences
+  for (std::size_t i = 0; i < positions.size(); ++i) {
+    REQUIRE(f(positions[i]) == dbl_approx(values[i]));
+    auto p{positions[i]};
+    p[0] += 1e-12;
+    p[1] -= 1e-12;
+    REQUIRE(f(p) == dbl_approx(values[i]));
+  }
+  // points near a vertex, including points in a different cell
+  REQUIRE(f(Domain{0.49, 0.51}) == dbl_approx(4.0));
+  REQUIRE(f(Domain{-0.01, 0.98}) == dbl_approx(3.0));
+  // point with no vertices in neighbouring cells
+  REQUIRE(f(Domain{8.0, 8.0}) == dbl_approx(5.0));
+  // copies share the same data
+  auto g{f};
+  REQUIRE(g(Domain{1.0, 0.0}) == dbl_approx(2.0));
+}
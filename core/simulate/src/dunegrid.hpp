@@ -13,8 +13,11 @@
 #include <dune/grid/common/gridfactory.hh>
 #include <dune/grid/multidomaingrid/multidomaingrid.hh>
 #include <memory>
+#include <mutex>
 #include <unordered_set>
+#include <tuple>
 #include <utility>
+#include <variant>
 #include <vector>
 
 namespace sme::simulate {
@@ -153,6 +156,31 @@ void assignElements(Grid &grid, const std::vector<std::size_t> &numElements) {
   grid->postUpdateSubDomains();
 }
 
+/**
+ * @brief Mesh vertices and per-compartment elements that define a grid.
+ */
+struct DuneGridKey {
+  std::vector<double> vertices;
+  std::vector<std::vector<std::size_t>> elements;
+  bool operator==(const DuneGridKey &) const = default;
+};
+
+/**
+ * @brief Construct the grid key for a 2D/3D mesh.
+ */
+template <typename MeshType>
+DuneGridKey makeDuneGridKey(const MeshType &mesh) {
+  DuneGridKey key{mesh.getVerticesAsFlatArray(), {}};
+  for (const auto &elements : getElementIndices(mesh)) {
+    auto &indices{key.elements.emplace_back()};
+    indices.reserve(elements.size() * (MeshType::dim + 1));
+    for (const auto &element : elements) {
+      indices.insert(indices.end(), element.cbegin(), element.cend());
+    }
+  }
+  return key;
+}
+
 } // namespace detail
 
 /**
@@ -167,4 +195,88 @@ auto makeDuneGrid(const MeshType &mesh) {
   return std::make_pair(grid, hostGrid);
 }
 
+/**
+ * @brief Cache of the most recently constructed multi-domain DUNE grid.
+ *
+ * The grid only depends on the mesh vertices and the elements in each
+ * compartment, so it can be reused by subsequent simulations where only
+ * parameters or initial conditions have changed. The cached grid is only
+ * returned if it is not still in use elsewhere, otherwise a new grid is
+ * constructed.
+ *
+ * Data derived from the cached grid, of type ``Data``, can also be stored
+ * here. It is discarded whenever the cached grid is replaced.
+ */
+template <class HostGrid, class MDGTraits, class Data = std::monostate>
+class DuneGridCache {
+public:
+  using Grid = Dune::mdgrid::MultiDomainGrid<HostGrid, MDGTraits>;
+  /**
+   * @brief Get a grid for the mesh, constructing it if necessary.
+   */
+  template <class MeshType>
+  std::pair<std::shared_ptr<Grid>, std::shared_ptr<HostGrid>>
+  get(const MeshType &mesh) {
+    auto key{detail::makeDuneGridKey(mesh)};
+    std::scoped_lock lock(mutex);
+    if (grid != nullptr && key == cachedKey) {
+      if (grid.use_count() == 1 && hostGrid.use_count() == 1) {
+        ++hits;
+        return {grid, hostGrid};
+      }
+      // cached grid is still being used by another simulation
+      return makeDuneGrid<HostGrid, MDGTraits>(mesh);
+    }
+    data.reset();
+    std::tie(grid, hostGrid) = makeDuneGrid<HostGrid, MDGTraits>(mesh);
+    cachedKey = std::move(key);
+    return {grid, hostGrid};
+  }
+  /**
+   * @brief Get the data stored for a grid.
+   * @returns The data, or ``nullptr`` if ``g`` is not the cached grid or no
+   * data has been stored for it.
+   */
+  std::shared_ptr<const Data> getData(const std::shared_ptr<Grid> &g) {
+    std::scoped_lock lock(mutex);
+    if (g == nullptr || g != grid) {
+      return nullptr;
+    }
+    return data;
+  }
+  /**
+   * @brief Store data for a grid, ignored if ``g`` is not the cached grid.
+   */
+  void setData(const std::shared_ptr<Grid> &g,
+               std::shared_ptr<const Data> gridData) {
+    std::scoped_lock lock(mutex);
+    if (g != nullptr && g == grid) {
+      data = std::move(gridData);
+    }
+  }
+  /**
+   * @brief Number of times a cached grid has been reused.
+   */
+  [[nodiscard]] std::size_t nHits() const { return hits; }
+  /**
+   * @brief Discard the cached grid and its data.
+   */
+  void clear() {
+    std::scoped_lock lock(mutex);
+    data.reset();
+    grid.reset();
+    hostGrid.reset();
+    cachedKey = {};
+  }
+
+private:
+  std::mutex mutex;
+  detail::DuneGridKey cachedKey;
+  // grid holds a reference to hostGrid, so must be destroyed first
+  std::shared_ptr<HostGrid> hostGrid;
+  std::shared_ptr<Grid> grid;
+  std::shared_ptr<const Data> data;
+  std::size_t hits{0};
+};
+
 } // namespace sme::simulate
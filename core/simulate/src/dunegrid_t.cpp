@@ -281,4 +281,52 @@ TEST_CASE("DUNE grid",
       }
     }
   }
+  SECTION("grid cache") {
+    auto m{getExampleModel(Mod::VerySimpleModel)};
+    const auto *mesh{m.getGeometry().getMesh2d()};
+    REQUIRE(mesh != nullptr);
+    simulate::DuneGridCache<HostGrid2d, MDGTraits2d, int> cache;
+    auto [grid, hostGrid] = cache.get(*mesh);
+    REQUIRE(grid != nullptr);
+    REQUIRE(hostGrid != nullptr);
+    REQUIRE(cache.nHits() == 0);
+    const auto *cachedGrid{grid.get()};
+    // grid still in use: a new grid is constructed
+    auto [grid2, hostGrid2] = cache.get(*mesh);
+    REQUIRE(grid2.get() != cachedGrid);
+    REQUIRE(cache.nHits() == 0);
+    REQUIRE(grid2->leafGridView().size(0) == grid->leafGridView().size(0));
+    grid.reset();
+    hostGrid.reset();
+    // grid no longer in use: cached grid is reused
+    auto [grid3, hostGrid3] = cache.get(*mesh);
+    REQUIRE(grid3.get() == cachedGrid);
+    REQUIRE(cache.nHits() == 1);
+    REQUIRE(grid3->maxSubDomainIndex() == grid2->maxSubDomainIndex());
+    // data is only stored for the cached grid
+    cache.setData(grid2, std::make_shared<const int>(1));
+    REQUIRE(cache.getData(grid2) == nullptr);
+    cache.setData(grid3, std::make_shared<const int>(2));
+    REQUIRE(cache.getData(grid2) == nullptr);
+    REQUIRE(*cache.getData(grid3) == 2);
+    grid3.reset();
+    hostGrid3.reset();
+    // different mesh: cached grid and data are replaced
+    auto m2{getExampleModel(Mod::ABtoC)};
+    auto [grid4, hostGrid4] = cache.get(*m2.getGeometry().getMesh2d());
+    REQUIRE(cache.nHits() == 1);
+    grid4.reset();
+    hostGrid4.reset();
+    auto [grid5, hostGrid5] = cache.get(*m2.getGeometry().getMesh2d());
+    REQUIRE(cache.nHits() == 2);
+    REQUIRE(cache.getData(grid5) == nullptr);
+    cache.setData(grid5, std::make_shared<const int>(3));
+    REQUIRE(*cache.getData(grid5) == 3);
+    cache.clear();
+    REQUIRE(cache.getData(grid5) == nullptr);
+    grid5.reset();
+    hostGrid5.reset();
+    auto [grid6, hostGrid6] = cache.get(*mesh);
+    REQUIRE(cache.nHits() == 2);
+  }
 }
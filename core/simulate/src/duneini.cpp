@@ -5,11 +5,17 @@ namespace sme::simulate {
 
 const QString &IniFile::getText() const { return text; }
 
+const std::vector<std::pair<std::string, std::string>> &
+IniFile::getEntries() const {
+  return entries;
+}
+
 void IniFile::addSection(const QString &str) {
   if (!text.isEmpty()) {
     text.append("\n");
   }
   text.append(QString("[%1]\n").arg(str));
+  section = str;
 }
 
 void IniFile::addSection(const QString &str1, const QString &str2) {
@@ -41,6 +47,8 @@ void IniFile::addSection(const QString &str1, const QString &str2,
 
 void IniFile::addValue(const QString &var, const QString &value) {
   text.append(QString("%1 = %2\n").arg(var, value));
+  auto key{section.isEmpty() ? var : QString("%1.%2").arg(section, var)};
+  entries.emplace_back(key.toStdString(), value.trimmed().toStdString());
 }
 
 void IniFile::addValue(const QString &var, int value) {
@@ -51,6 +59,10 @@ void IniFile::addValue(const QString &var, double value, int precision) {
   addValue(var, common::dblToQStr(value, precision));
 }
 
-void IniFile::clear() { text.clear(); }
+void IniFile::clear() {
+  text.clear();
+  section.clear();
+  entries.clear();
+}
 
 } // namespace sme::simulate
@@ -4,6 +4,9 @@
 #pragma once
 
 #include <QString>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace sme {
 
@@ -15,12 +18,22 @@ namespace simulate {
 class IniFile {
 private:
   QString text;
+  QString section;
+  std::vector<std::pair<std::string, std::string>> entries;
 
 public:
   /**
    * @brief Get generated INI text.
    */
   [[nodiscard]] const QString &getText() const;
+  /**
+   * @brief Get key/value pairs, with keys prefixed by their section.
+   *
+   * Equivalent to the INI text, but can be used to construct a parameter
+   * tree without parsing the text.
+   */
+  [[nodiscard]] const std::vector<std::pair<std::string, std::string>> &
+  getEntries() const;
   /**
    * @brief Add one-level section.
    */
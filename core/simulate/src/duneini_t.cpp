@@ -42,4 +42,31 @@ TEST_CASE("DUNE: ini files",
     correct = "[a.b.c]\n";
     REQUIRE(ini.getText() == correct);
   }
+  SECTION("IniFile entries") {
+    simulate::IniFile ini;
+    REQUIRE(ini.getEntries().empty());
+    ini.addValue("top", "level");
+    ini.addSection("t1");
+    ini.addValue("x", "a");
+    ini.addValue("y", 3);
+    ini.addSection("t1", "t2");
+    ini.addValue("z", 3.14159, 10);
+    ini.addValue("sub.w", " (x + y) ");
+    const auto &entries{ini.getEntries()};
+    REQUIRE(entries.size() == 5);
+    REQUIRE(entries[0].first == "top");
+    REQUIRE(entries[0].second == "level");
+    REQUIRE(entries[1].first == "t1.x");
+    REQUIRE(entries[1].second == "a");
+    REQUIRE(entries[2].first == "t1.y");
+    REQUIRE(entries[2].second == "3");
+    REQUIRE(entries[3].first == "t1.t2.z");
+    REQUIRE(entries[3].second == "3.14159");
+    REQUIRE(entries[4].first == "t1.t2.sub.w");
+    REQUIRE(entries[4].second == "(x + y)");
+    ini.clear();
+    REQUIRE(ini.getEntries().empty());
+    ini.addValue("x", "a");
+    REQUIRE(ini.getEntries().back().first == "x");
+  }
 }
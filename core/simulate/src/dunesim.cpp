@@ -27,19 +27,13 @@ DuneSim::DuneSim(
         options.maxThreads == 0
             ? static_cast<std::size_t>(oneapi::tbb::info::default_concurrency())
             : options.maxThreads;
-    if (options.discretization != DuneDiscretizationType::FEM1) {
-      // for now we only support 1st order FEM
-      // in future could add:
-      //  - 0th order a.k.a. FVM for independent compartment models
-      //  - 2nd order FEM for both types of models
-      SPDLOG_ERROR("Invalid integrator type requested");
-      throw std::runtime_error("Invalid integrator type requested");
-    }
     if (dc.getIniFile().isEmpty()) {
       currentErrorMessage = "Nothing to simulate";
       SPDLOG_WARN("{}", currentErrorMessage);
       return;
     }
+    oneapi::tbb::global_control control(
+        oneapi::tbb::global_control::max_allowed_parallelism, numMaxThreads);
     if (dc.getMesh() != nullptr) {
       pDuneImpl2d =
           std::make_unique<DuneImpl<2>>(dc, options, sbmlDoc, compartmentIds);
@@ -51,6 +45,8 @@ DuneSim::DuneSim(
       SPDLOG_ERROR("{}", currentErrorMessage);
       return;
     }
+    // reference concentrations are only copied if convergence is monitored
+    concReference.resize(compartmentIds.size());
   } catch (const Dune::Exception &e) {
     currentErrorMessage = e.what();
     SPDLOG_ERROR("{}", currentErrorMessage);
@@ -72,27 +68,37 @@ std::size_t DuneSim::run(double time, double timeout_ms,
       oneapi::tbb::global_control::max_allowed_parallelism, numMaxThreads);
   QElapsedTimer timer;
   timer.start();
+  currentErrorMessage.clear();
+  // checked after each internal step of the adaptive stepper
+  auto stopCallback = [this, &timer, timeout_ms, &stopRunningCallback]() {
+    if (stopRequested.load()) {
+      SPDLOG_DEBUG("Simulation stopped early");
+      currentErrorMessage = "Simulation stopped early";
+    } else if (stopRunningCallback && stopRunningCallback()) {
+      SPDLOG_DEBUG("Simulation cancelled: requesting stop");
+      currentErrorMessage = "Simulation cancelled";
+    } else if (timeout_ms >= 0.0 &&
+               static_cast<double>(timer.elapsed()) >= timeout_ms) {
+      SPDLOG_DEBUG("Simulation timeout: requesting stop");
+      currentErrorMessage = "Simulation timeout";
+    } else {
+      return false;
+    }
+    return true;
+  };
+  std::size_t steps{0};
   try {
     if (pDuneImpl2d != nullptr) {
-      pDuneImpl2d->run(time);
+      steps = pDuneImpl2d->run(time, stopCallback);
     } else {
-      pDuneImpl3d->run(time);
+      steps = pDuneImpl3d->run(time, stopCallback);
     }
-    currentErrorMessage.clear();
   } catch (const Dune::Exception &e) {
     currentErrorMessage = e.what();
     SPDLOG_ERROR("{}", currentErrorMessage);
     return 0;
   }
-  if (stopRunningCallback && stopRunningCallback()) {
-    SPDLOG_DEBUG("Simulation cancelled: requesting stop");
-    currentErrorMessage = "Simulation cancelled";
-  }
-  if (timeout_ms >= 0.0 && static_cast<double>(timer.elapsed()) >= timeout_ms) {
-    SPDLOG_DEBUG("Simulation timeout: requesting stop");
-    currentErrorMessage = "Simulation timeout";
-  }
-  return 1;
+  return steps;
 }
 
 const std::vector<double> &
@@ -106,6 +112,90 @@ DuneSim::getConcentrations(std::size_t compartmentIndex) const {
 
 std::size_t DuneSim::getConcentrationPadding() const { return 0; }
 
+std::optional<ConcentrationChange> DuneSim::updateConcentrationChange() {
+  ConcentrationChange change{};
+  for (std::size_t i = 0; i < concReference.size(); ++i) {
+    const auto &c{getConcentrations(i)};
+    auto &cRef{concReference[i]};
+    if (cRef.size() != c.size()) {
+      cRef = c;
+    }
+    for (std::size_t j = 0; j < c.size(); ++j) {
+      const double dc{c[j] - cRef[j]};
+      change.sumSquaredChange += dc * dc;
+      change.sumSquaredConcentration += c[j] * c[j];
+      cRef[j] = c[j];
+    }
+  }
+  return change;
+}
+
+std::optional<SolverCheckpoint> DuneSim::getCheckpoint() const {
+  if (pDuneImpl2d == nullptr && pDuneImpl3d == nullptr) {
+    return {};
+  }
+  SolverCheckpoint checkpoint{};
+  checkpoint.simulatorType = SimulatorType::DUNE;
+  if (pDuneImpl2d != nullptr) {
+    checkpoint.timestep = pDuneImpl2d->getTimestep();
+    // an adapted mesh can't be recreated when restarting
+    if (!pDuneImpl2d->getAdaptiveMesh()) {
+      checkpoint.state = pDuneImpl2d->getNodeValues();
+    }
+  } else {
+    checkpoint.timestep = pDuneImpl3d->getTimestep();
+    if (!pDuneImpl3d->getAdaptiveMesh()) {
+      checkpoint.state = pDuneImpl3d->getNodeValues();
+    }
+  }
+  return checkpoint;
+}
+
+std::size_t DuneSim::getNumberOfMeshElements() const {
+  if (pDuneImpl2d != nullptr) {
+    return pDuneImpl2d->getNumberOfElements();
+  }
+  if (pDuneImpl3d != nullptr) {
+    return pDuneImpl3d->getNumberOfElements();
+  }
+  return 0;
+}
+
+bool DuneSim::setCheckpoint(const SolverCheckpoint &checkpoint) {
+  if ((pDuneImpl2d == nullptr && pDuneImpl3d == nullptr) ||
+      checkpoint.simulatorType != SimulatorType::DUNE ||
+      checkpoint.timestep <= 0.0) {
+    SPDLOG_WARN("Solver checkpoint does not match this simulation");
+    return false;
+  }
+  if (!checkpoint.state.empty()) {
+    common::ScopedCLocale scopedCLocale;
+    bool valid{false};
+    try {
+      valid = pDuneImpl2d != nullptr
+                  ? pDuneImpl2d->setNodeValues(checkpoint.state)
+                  : pDuneImpl3d->setNodeValues(checkpoint.state);
+    } catch (const Dune::Exception &e) {
+      SPDLOG_ERROR("{}", e.what());
+    }
+    if (!valid) {
+      SPDLOG_WARN("Solver checkpoint does not match this mesh");
+      return false;
+    }
+  } else {
+    SPDLOG_WARN("Solver checkpoint has no DUNE state: continuing from the "
+                "stored concentrations");
+  }
+  if (pDuneImpl2d != nullptr) {
+    pDuneImpl2d->setTimestep(checkpoint.timestep);
+  } else {
+    pDuneImpl3d->setTimestep(checkpoint.timestep);
+  }
+  SPDLOG_INFO("Restored solver checkpoint with next timestep {}",
+              checkpoint.timestep);
+  return true;
+}
+
 const std::string &DuneSim::errorMessage() const { return currentErrorMessage; }
 
 void DuneSim::setCurrentErrormessage(const std::string &msg) {
@@ -116,13 +206,8 @@ const common::ImageStack &DuneSim::errorImages() const {
   return currentErrorImages;
 }
 
-void DuneSim::setStopRequested([[maybe_unused]] bool stop) {
-  SPDLOG_DEBUG("Not implemented - ignoring request");
-}
+void DuneSim::setStopRequested(bool stop) { stopRequested.store(stop); }
 
-bool DuneSim::getStopRequested() const {
-  SPDLOG_DEBUG("Not implemented - ignoring request");
-  return false;
-}
+bool DuneSim::getStopRequested() const { return stopRequested.load(); }
 
 } // namespace sme::simulate
@@ -9,10 +9,12 @@
 #include <QPointF>
 #include <QSize>
 #include <array>
+#include <atomic>
 #include <cstddef>
 #include <limits>
 #include <map>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
@@ -43,6 +45,9 @@ private:
   std::string currentErrorMessage{};
   common::ImageStack currentErrorImages{};
   std::size_t numMaxThreads{0};
+  std::atomic<bool> stopRequested{false};
+  // concentrations at the previous convergence check for each compartment
+  std::vector<std::vector<double>> concReference{};
 
 public:
   /**
@@ -71,6 +76,28 @@ public:
    * @brief Concentration array padding.
    */
   [[nodiscard]] std::size_t getConcentrationPadding() const override;
+  /**
+   * @brief Change in concentrations since the previous call.
+   */
+  [[nodiscard]] std::optional<ConcentrationChange>
+  updateConcentrationChange() override;
+  /**
+   * @brief Current adaptive stepper timestep and finite element solution.
+   *
+   * The solution is stored as its values at the Lagrange nodes of the mesh,
+   * unless the adaptive mesh is enabled.
+   */
+  [[nodiscard]] std::optional<SolverCheckpoint> getCheckpoint() const override;
+  /**
+   * @brief Restore adaptive stepper timestep and finite element solution.
+   */
+  bool setCheckpoint(const SolverCheckpoint &checkpoint) override;
+  /**
+   * @brief Number of elements in the current mesh.
+   *
+   * Changes during the simulation if the adaptive mesh is enabled.
+   */
+  [[nodiscard]] std::size_t getNumberOfMeshElements() const;
   /**
    * @brief Current error message.
    */
@@ -19,8 +19,17 @@
 #include <dune/copasi/model/functor_factory_parser.hh>
 #include <dune/grid/common/mcmgmapper.hh>
 #include <dune/grid/common/rangegenerators.hh>
+#include <algorithm>
+#include <array>
 #include <fmt/core.h>
+#include <functional>
+#include <limits>
 #include <memory>
+#include <oneapi/tbb/blocked_range.h>
+#include <oneapi/tbb/parallel_for.h>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace sme::simulate {
 
@@ -31,6 +40,109 @@ template <int DuneDimensions>
 using VoxelLocalPair =
     std::pair<std::size_t, Dune::FieldVector<double, DuneDimensions>>;
 
+/**
+ * @brief Pair of mesh vertex index and element-local coordinate.
+ */
+template <int DuneDimensions>
+using VertexLocalPair =
+    std::pair<std::size_t, Dune::FieldVector<double, DuneDimensions>>;
+
+/**
+ * @brief Sparse linear interpolation from mesh vertex values to voxels.
+ *
+ * Each row is a compartment voxel, given by the weighted sum of the values at
+ * the ``DuneDimensions + 1`` vertices of the simplex element containing it.
+ */
+template <int DuneDimensions> struct VertexInterpolation {
+  /**
+   * @brief Number of mesh vertices in the compartment.
+   */
+  std::size_t nVertices{0};
+  /**
+   * @brief Vertices to evaluate in each element, each vertex appears once.
+   */
+  std::vector<std::vector<VertexLocalPair<DuneDimensions>>> elementVertices;
+  /**
+   * @brief Compartment voxel index for each row.
+   */
+  std::vector<std::size_t> voxels;
+  /**
+   * @brief Vertex indices for each row.
+   */
+  std::vector<std::size_t> vertexIndices;
+  /**
+   * @brief Interpolation weights for each row.
+   */
+  std::vector<double> weights;
+};
+
+/**
+ * @brief Mapping between the elements and the voxels of a compartment.
+ */
+template <int DuneDimensions> struct DuneVoxelMap {
+  /**
+   * @brief Vertex values -> voxel concentrations.
+   */
+  VertexInterpolation<DuneDimensions> interpolation;
+  /**
+   * @brief Voxels in each element, if not using vertex interpolation.
+   */
+  std::vector<std::vector<VoxelLocalPair<DuneDimensions>>> elementVoxels;
+  /**
+   * @brief Index of nearest valid voxel for any voxels outside the mesh.
+   */
+  std::vector<std::pair<std::size_t, std::size_t>> missingVoxels;
+};
+
+/**
+ * @brief Voxel maps of the simulated compartments of a grid.
+ *
+ * Along with the grid, the maps depend on the voxel geometry and the
+ * discretization, which are stored to check if the maps can be reused.
+ */
+template <int DuneDimensions> struct DuneVoxelMaps {
+  bool vertexInterpolation{true};
+  std::array<double, 6> voxelGeometry{};
+  std::vector<std::size_t> compartmentIndices;
+  std::vector<std::vector<common::Voxel>> compartmentVoxels;
+  std::vector<std::shared_ptr<const DuneVoxelMap<DuneDimensions>>> maps;
+};
+
+/**
+ * @brief Grid cache used by the DUNE simulator.
+ */
+template <int DuneDimensions>
+using DuneImplGridCache =
+    DuneGridCache<Dune::UGGrid<DuneDimensions>,
+                  Dune::mdgrid::FewSubDomainsTraits<DuneDimensions, 64>,
+                  DuneVoxelMaps<DuneDimensions>>;
+
+/**
+ * @brief Grids and voxel maps reused by the DUNE simulations of a model.
+ */
+struct DuneSimCache {
+  DuneImplGridCache<2> grid2d;
+  DuneImplGridCache<3> grid3d;
+  /**
+   * @brief Grid cache for a spatial dimension.
+   */
+  template <int DuneDimensions>
+  DuneImplGridCache<DuneDimensions> &getGridCache() {
+    if constexpr (DuneDimensions == 2) {
+      return grid2d;
+    } else {
+      return grid3d;
+    }
+  }
+  /**
+   * @brief Discard all cached grids and voxel maps.
+   */
+  void clear() {
+    grid2d.clear();
+    grid3d.clear();
+  }
+};
+
 /**
  * @brief Voxel pair used for bounding boxes.
  */
@@ -76,28 +188,48 @@ getBoundingBox(const std::vector<std::array<double, DuneDimensions>> &vertices,
 }
 
 /**
- * @brief Find nearest valid neighboring voxel index.
+ * @brief Find the nearest valid voxel for each invalid voxel.
+ *
+ * Uses a single breadth-first search over the compartment voxels starting
+ * from all valid voxels, so each invalid voxel is reached from its nearest
+ * valid voxel in terms of the number of neighbour steps.
+ *
+ * @returns Pairs of invalid voxel index and nearest valid voxel index.
  */
-static inline std::size_t getIxValidNeighbour(std::size_t ix,
-                                              const std::vector<bool> &ixValid,
-                                              const geometry::Compartment *g) {
-  std::vector<std::size_t> queue{ix};
-  std::size_t queueIndex = 0;
-  // return nearest neighbour if valid, otherwise add to queue
-  for (std::size_t iter = 0; iter < 10 * ixValid.size(); ++iter) {
+static inline std::vector<std::pair<std::size_t, std::size_t>>
+getNearestValidVoxels(const std::vector<bool> &ixValid,
+                      const geometry::Compartment *g) {
+  constexpr auto none{std::numeric_limits<std::size_t>::max()};
+  std::vector<std::size_t> nearest(ixValid.size(), none);
+  std::vector<std::size_t> queue;
+  queue.reserve(ixValid.size());
+  for (std::size_t ix = 0; ix < ixValid.size(); ++ix) {
+    if (ixValid[ix]) {
+      nearest[ix] = ix;
+      queue.push_back(ix);
+    }
+  }
+  for (std::size_t queueIndex = 0; queueIndex < queue.size(); ++queueIndex) {
     std::size_t i = queue[queueIndex];
     for (auto iy : {g->up_x(i), g->dn_x(i), g->up_y(i), g->dn_y(i), g->up_z(i),
                     g->dn_z(i)}) {
-      if (ixValid[iy]) {
-        return iy;
-      } else {
+      if (nearest[iy] == none) {
+        nearest[iy] = nearest[i];
         queue.push_back(iy);
       }
     }
-    ++queueIndex;
   }
-  SPDLOG_WARN("Failed to find valid neighbour of pixel {}", ix);
-  return 0;
+  std::vector<std::pair<std::size_t, std::size_t>> missing;
+  for (std::size_t ix = 0; ix < ixValid.size(); ++ix) {
+    if (!ixValid[ix]) {
+      if (nearest[ix] == none) {
+        SPDLOG_WARN("Failed to find valid neighbour of pixel {}", ix);
+        nearest[ix] = 0;
+      }
+      missing.push_back({ix, nearest[ix]});
+    }
+  }
+  return missing;
 }
 
 /**
@@ -125,14 +257,47 @@ public:
       // for release GUI builds disable DUNE logging
       spdlog::set_level(spdlog::level::off);
     }
-    std::stringstream ssIni(dc.getIniFile().toStdString());
-    Dune::ParameterTreeParser::readINITree(ssIni, config);
-    if constexpr (DuneDimensions == 2) {
-      std::tie(grid, hostGrid) =
-          makeDuneGrid<HostGrid, MDGTraits>(*dc.getMesh());
+    // build parameter tree directly instead of parsing the ini text
+    for (const auto &[key, value] : dc.getIniEntries()) {
+      config[key] = value;
+    }
+    discretization = options.discretization;
+    vertexInterpolation = discretization == DuneDiscretizationType::FEM1;
+    adaptiveMesh = options.adaptiveMesh;
+    if (adaptiveMesh && !dc.getDiffusionConstantArrays().empty()) {
+      // cell data is defined on the initial grid elements
+      SPDLOG_WARN("Adaptive mesh not supported with spatially varying "
+                  "diffusion constants: using a static mesh");
+      adaptiveMesh = false;
+    }
+    if (adaptiveMesh && !vertexInterpolation) {
+      // solution transfer assumes linear elements
+      SPDLOG_WARN("Adaptive mesh only supported for FEM1 discretization: "
+                  "using a static mesh");
+      adaptiveMesh = false;
+    }
+    adaptiveMaxLevel = static_cast<int>(options.adaptiveMaxLevel);
+    adaptiveRefineTol = options.adaptiveRefineTol;
+    adaptiveCoarsenTol = options.adaptiveCoarsenTol;
+    adaptiveInterval = std::max(options.adaptiveInterval, std::size_t{1});
+    // grid and voxel maps are owned by the model, and reused by subsequent
+    // simulations of the same geometry
+    auto &gridCache{sbmlDoc.getSimulatorCache()
+                        .getDuneSimCache()
+                        .getGridCache<DuneDimensions>()};
+    if (adaptiveMesh) {
+      // an adapted grid cannot be shared with other simulations
+      if constexpr (DuneDimensions == 2) {
+        std::tie(grid, hostGrid) =
+            makeDuneGrid<HostGrid, MDGTraits>(*dc.getMesh());
+      } else {
+        std::tie(grid, hostGrid) =
+            makeDuneGrid<HostGrid, MDGTraits>(*dc.getMesh3d());
+      }
+    } else if constexpr (DuneDimensions == 2) {
+      std::tie(grid, hostGrid) = gridCache.get(*dc.getMesh());
     } else {
-      std::tie(grid, hostGrid) =
-          makeDuneGrid<HostGrid, MDGTraits>(*dc.getMesh3d());
+      std::tie(grid, hostGrid) = gridCache.get(*dc.getMesh3d());
     }
     if (options.writeVTKfiles) {
       vtkFilename = "vtk";
@@ -166,7 +331,7 @@ public:
           sbmlDoc.getCompartments().getCompartment(compartmentId.c_str()));
     }
     initDuneSimCompartments(sbmlDoc.getCompartments().getCompartments());
-    updateVoxels();
+    updateVoxels(adaptiveMesh ? nullptr : &gridCache);
     updateSpeciesConcentrations();
   }
 
@@ -177,14 +342,52 @@ public:
 
   /**
    * @brief Run simulation to ``time`` ahead and refresh concentrations.
+   *
+   * ``stopCallback`` is called after each internal adaptive step. If it
+   * returns ``true`` the simulation stops at the current time, which is
+   * then earlier than the requested time.
+   *
+   * If the adaptive mesh is enabled, the grid is adapted every
+   * ``adaptiveInterval`` internal steps.
+   *
+   * @returns Number of internal steps taken.
    */
-  void run(double time) {
-    stepper->evolve(*step_operator, *state, *state, dt, t0 + time).or_throw();
+  std::size_t run(double time, const std::function<bool()> &stopCallback) {
+    struct StopRequested {};
+    struct AdaptRequested {};
+    const double tEnd{t0 + time};
+    std::size_t steps{0};
+    bool finished{false};
+    while (!finished) {
+      try {
+        stepper
+            ->evolve(*step_operator, *state, *state, dt, tEnd,
+                     [this, &steps, &stopCallback](const auto &) {
+                       ++steps;
+                       if (stopCallback && stopCallback()) {
+                         throw StopRequested{};
+                       }
+                       if (adaptiveMesh &&
+                           ++stepsSinceAdapt >= adaptiveInterval) {
+                         throw AdaptRequested{};
+                       }
+                     })
+            .or_throw();
+        t0 = tEnd;
+        finished = true;
+      } catch (const StopRequested &) {
+        SPDLOG_DEBUG("Stopped at t={} after {} steps", state->time, steps);
+        t0 = state->time;
+        finished = true;
+      } catch (const AdaptRequested &) {
+        adaptGrid();
+      }
+    }
     if (!vtkFilename.empty()) {
       model->write_vtk(*state, vtkFilename, true);
     }
-    t0 += time;
     updateSpeciesConcentrations();
+    return steps;
   }
 
   /**
@@ -195,6 +398,108 @@ public:
     return duneCompartments[compartmentIndex].concentration;
   }
 
+  /**
+   * @brief Next timestep of the adaptive stepper.
+   */
+  [[nodiscard]] double getTimestep() const { return dt; }
+
+  /**
+   * @brief Set next timestep of the adaptive stepper.
+   */
+  void setTimestep(double timestep) { dt = timestep; }
+
+  /**
+   * @brief Whether the mesh can change during the simulation.
+   */
+  [[nodiscard]] bool getAdaptiveMesh() const { return adaptiveMesh; }
+
+  /**
+   * @brief Number of elements in the current mesh.
+   */
+  [[nodiscard]] std::size_t getNumberOfElements() const {
+    return static_cast<std::size_t>(grid->leafGridView().size(0));
+  }
+
+  /**
+   * @brief Solution values at the Lagrange nodes of each compartment.
+   *
+   * For each compartment, the values of each species at each node, where the
+   * nodes are the vertices, and for FEM2 also the edge midpoints. These
+   * determine the finite element solution exactly.
+   */
+  [[nodiscard]] std::vector<std::vector<double>> getNodeValues() const {
+    std::vector<std::vector<double>> nodeValues;
+    nodeValues.reserve(duneCompartments.size());
+    for (const auto &comp : duneCompartments) {
+      auto &values{nodeValues.emplace_back()};
+      for (const auto &speciesName : comp.speciesNames) {
+        if (speciesName.empty()) {
+          continue;
+        }
+        auto gridFunc = model->make_compartment_function(state, speciesName);
+        auto localGridFunc = localFunction(gridFunc);
+        forEachNode(comp, [&localGridFunc, &values](const auto &e,
+                                                    const auto &localPoint) {
+          localGridFunc.bind(e);
+          values.push_back(localGridFunc(localPoint));
+        });
+      }
+    }
+    return nodeValues;
+  }
+
+  /**
+   * @brief Set the solution from values at the Lagrange nodes.
+   *
+   * The inverse of getNodeValues, returns ``false`` if the number of values
+   * doesn't match the current mesh.
+   */
+  bool setNodeValues(const std::vector<std::vector<double>> &nodeValues) {
+    if (nodeValues.size() != duneCompartments.size()) {
+      return false;
+    }
+    std::unordered_map<std::string, typename Model::GridFunction> functions;
+    for (std::size_t iComp = 0; iComp < duneCompartments.size(); ++iComp) {
+      const auto &comp{duneCompartments[iComp]};
+      const auto &gridview{
+          grid->subDomain(static_cast<unsigned int>(comp.index))
+              .leafGridView()};
+      using Domain = typename SubGridView::template Codim<
+          0>::Geometry::GlobalCoordinate;
+      std::vector<Domain> positions;
+      double minEdge{std::numeric_limits<double>::max()};
+      forEachNode(comp, [&positions, &minEdge](const auto &e,
+                                               const auto &localPoint) {
+        const auto &geo{e.geometry()};
+        minEdge = std::min(minEdge, (geo.corner(1) - geo.corner(0)).two_norm());
+        positions.push_back(geo.global(localPoint));
+      });
+      const auto &values{nodeValues[iComp]};
+      if (values.size() != positions.size() * comp.nSpecies) {
+        return false;
+      }
+      // nodes of 2nd order elements are half an edge apart
+      const double cellWidth{0.25 * minEdge};
+      auto first{values.cbegin()};
+      for (const auto &speciesName : comp.speciesNames) {
+        if (speciesName.empty()) {
+          continue;
+        }
+        std::vector<double> speciesValues(
+            first, first + static_cast<std::ptrdiff_t>(positions.size()));
+        first += static_cast<std::ptrdiff_t>(positions.size());
+        functions[fmt::format("{}.{}", comp.name, speciesName)] =
+            Dune::Functions::makeAnalyticGridViewFunction(
+                VertexValueFunction<Domain>(positions, speciesValues,
+                                            cellWidth),
+                gridview);
+      }
+    }
+    model->interpolate(*state, functions);
+    updateSpeciesConcentrations();
+    return true;
+  }
+
 private:
   struct DuneSimCompartment {
     std::string name;
@@ -203,10 +508,8 @@ private:
     std::vector<std::string> speciesNames;
     geometry::VoxelIndexer voxelIndexer;
     const geometry::Compartment *geometry;
-    // voxel+dune local coords for each triangle
-    std::vector<std::vector<VoxelLocalPair<DuneDimensions>>> voxels;
-    // index of nearest valid voxel for any missing pixels
-    std::vector<std::pair<std::size_t, std::size_t>> missingVoxels;
+    // mapping between elements and voxels, may be shared with other sims
+    std::shared_ptr<const DuneVoxelMap<DuneDimensions>> voxelMap;
     std::vector<double> concentration;
   };
 
@@ -237,6 +540,15 @@ private:
   double volOverL3;
   double t0{0.0};
   double dt{1e-3};
+  DuneDiscretizationType discretization{DuneDiscretizationType::FEM1};
+  // linear interpolation from vertex values is only exact for FEM1
+  bool vertexInterpolation{true};
+  bool adaptiveMesh{false};
+  int adaptiveMaxLevel{0};
+  double adaptiveRefineTol{0.0};
+  double adaptiveCoarsenTol{0.0};
+  std::size_t adaptiveInterval{1};
+  std::size_t stepsSinceAdapt{0};
   std::string vtkFilename{};
   std::vector<DuneSimCompartment> duneCompartments;
 
@@ -246,36 +558,41 @@ private:
       const auto &gridview{
           grid->subDomain(static_cast<unsigned int>(comp.index))
               .leafGridView()};
+      const auto &interp{comp.voxelMap->interpolation};
+      std::vector<double> vertexValues(interp.nVertices, 0.0);
       std::size_t iSpecies{0};
       for (const auto &speciesName : comp.speciesNames) {
         if (!speciesName.empty()) {
           SPDLOG_TRACE("    - species[{}] '{}'", iSpecies, speciesName);
           auto gridFunc = model->make_compartment_function(state, speciesName);
           auto localGridFunc = localFunction(gridFunc);
+          if (!vertexInterpolation) {
+            evaluateAtVoxels(gridview, localGridFunc, comp, iSpecies);
+            ++iSpecies;
+            continue;
+          }
+          // evaluate DUNE grid function once at each mesh vertex
           std::size_t iElement{0};
           for (const auto e : elements(gridview)) {
-            SPDLOG_TRACE("element {} ({})", iElement,
-                         common::decltypeStr<decltype(e)>());
-            localGridFunc.bind(e);
-            for (const auto &[ix, localPoint] : comp.voxels[iElement]) {
-              // evaluate DUNE grid function at this voxel location
-              // and convert result from Amount / Length^3 to Amount / Volume
-              double result = localGridFunc(localPoint) * volOverL3;
-              SPDLOG_TRACE("  - voxel ({}) -> local ({}) -> conc {}", ix,
-                           localPoint, result);
-              // replace negative values with zero
-              comp.concentration[ix * comp.nSpecies + iSpecies] =
-                  result < 0 ? 0 : result;
+            if (const auto &vertices{interp.elementVertices[iElement]};
+                !vertices.empty()) {
+              localGridFunc.bind(e);
+              for (const auto &[iv, localPoint] : vertices) {
+                vertexValues[iv] = localGridFunc(localPoint);
+              }
             }
             ++iElement;
           }
+          interpolateToVoxels(interp, vertexValues, comp.concentration,
+                              comp.nSpecies, iSpecies);
           ++iSpecies;
         }
       }
     }
     for (auto &comp : duneCompartments) {
       // fill in missing pixels with neighbouring value
-      for (const auto &[ixMissing, ixNeighbour] : comp.missingVoxels) {
+      for (const auto &[ixMissing, ixNeighbour] :
+           comp.voxelMap->missingVoxels) {
         for (std::size_t iSpecies = 0; iSpecies < comp.nSpecies; ++iSpecies) {
           comp.concentration[ixMissing * comp.nSpecies + iSpecies] =
               comp.concentration[ixNeighbour * comp.nSpecies + iSpecies];
@@ -284,6 +601,81 @@ private:
     }
   }
 
+  /**
+   * @brief Call ``f(element, localPoint)`` once for each Lagrange node.
+   *
+   * The nodes are visited in the same order for the same mesh.
+   */
+  template <typename F>
+  void forEachNode(const DuneSimCompartment &comp, F &&f) const {
+    const auto &subGrid{grid->subDomain(static_cast<unsigned int>(comp.index))};
+    const auto &idSet{subGrid.localIdSet()};
+    // vertices, and edge midpoints for 2nd order elements
+    std::vector<int> codims{DuneDimensions};
+    if (discretization == DuneDiscretizationType::FEM2) {
+      codims.push_back(DuneDimensions - 1);
+    }
+    std::vector<std::unordered_set<IdType>> visited(codims.size());
+    for (const auto &e : elements(subGrid.leafGridView())) {
+      auto ref = Dune::referenceElement(e.geometry());
+      for (std::size_t k = 0; k < codims.size(); ++k) {
+        for (int i = 0; i < ref.size(codims[k]); ++i) {
+          if (visited[k].insert(idSet.subId(e, i, codims[k])).second) {
+            f(e, ref.position(i, codims[k]));
+          }
+        }
+      }
+    }
+  }
+
+  template <typename LocalGridFunction>
+  void evaluateAtVoxels(const SubGridView &gridview,
+                        LocalGridFunction &localGridFunc,
+                        DuneSimCompartment &comp, std::size_t iSpecies) const {
+    // evaluate DUNE grid function at each voxel in each element
+    std::size_t iElement{0};
+    for (const auto e : elements(gridview)) {
+      if (const auto &voxels{comp.voxelMap->elementVoxels[iElement]};
+          !voxels.empty()) {
+        localGridFunc.bind(e);
+        for (const auto &[ix, localPoint] : voxels) {
+          // convert result from Amount / Length^3 to Amount / Volume
+          double result{localGridFunc(localPoint) * volOverL3};
+          // replace negative values with zero
+          comp.concentration[ix * comp.nSpecies + iSpecies] =
+              result < 0 ? 0 : result;
+        }
+      }
+      ++iElement;
+    }
+  }
+
+  void interpolateToVoxels(const VertexInterpolation<DuneDimensions> &interp,
+                           const std::vector<double> &vertexValues,
+                           std::vector<double> &concentration,
+                           std::size_t nSpecies, std::size_t iSpecies) const {
+    constexpr std::size_t nCorners{DuneDimensions + 1};
+    constexpr std::size_t grainSize{1024};
+    oneapi::tbb::parallel_for(
+        oneapi::tbb::blocked_range<std::size_t>(0, interp.voxels.size(),
+                                                grainSize),
+        [&](const oneapi::tbb::blocked_range<std::size_t> &r) {
+          for (std::size_t row = r.begin(); row != r.end(); ++row) {
+            double result{0.0};
+            for (std::size_t k = row * nCorners; k < (row + 1) * nCorners;
+                 ++k) {
+              result +=
+                  interp.weights[k] * vertexValues[interp.vertexIndices[k]];
+            }
+            // convert result from Amount / Length^3 to Amount / Volume
+            result *= volOverL3;
+            // replace negative values with zero
+            concentration[interp.voxels[row] * nSpecies + iSpecies] =
+                result < 0 ? 0 : result;
+          }
+        });
+  }
+
   void initDuneSimCompartments(
       const std::vector<std::unique_ptr<geometry::Compartment>> &comps) {
     duneCompartments.clear();
@@ -312,84 +704,182 @@ private:
              compartmentSpeciesNames,
              geometry::VoxelIndexer(imgVolume, comp->getVoxels()),
              comp.get(),
-             {},
-             {},
+             nullptr,
              std::vector<double>(nPixels * nSimulatedSpecies, 0.0)});
       }
       ++compIndex;
     }
   }
 
-  void updateVoxels() {
+  [[nodiscard]] std::array<double, 6> getVoxelGeometry() const {
+    return {pixelSize.width(),  pixelSize.height(), pixelSize.depth(),
+            pixelOrigin.p.x(), pixelOrigin.p.y(),  pixelOrigin.z};
+  }
+
+  [[nodiscard]] bool
+  canReuseVoxelMaps(const DuneVoxelMaps<DuneDimensions> &voxelMaps) const {
+    if (voxelMaps.vertexInterpolation != vertexInterpolation ||
+        voxelMaps.voxelGeometry != getVoxelGeometry() ||
+        voxelMaps.maps.size() != duneCompartments.size()) {
+      return false;
+    }
+    for (std::size_t i = 0; i < duneCompartments.size(); ++i) {
+      const auto &comp{duneCompartments[i]};
+      if (voxelMaps.compartmentIndices[i] != comp.index ||
+          voxelMaps.compartmentVoxels[i] != comp.geometry->getVoxels()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void updateVoxels(DuneImplGridCache<DuneDimensions> *gridCache = nullptr) {
+    if (gridCache != nullptr) {
+      if (auto voxelMaps{gridCache->getData(grid)};
+          voxelMaps != nullptr && canReuseVoxelMaps(*voxelMaps)) {
+        SPDLOG_DEBUG("Reusing cached voxel maps");
+        for (std::size_t i = 0; i < duneCompartments.size(); ++i) {
+          duneCompartments[i].voxelMap = voxelMaps->maps[i];
+        }
+        return;
+      }
+    }
+    auto voxelMaps{std::make_shared<DuneVoxelMaps<DuneDimensions>>()};
+    voxelMaps->vertexInterpolation = vertexInterpolation;
+    voxelMaps->voxelGeometry = getVoxelGeometry();
     for (auto &comp : duneCompartments) {
-      comp.voxels.clear();
-      comp.missingVoxels.clear();
+      auto voxelMap{std::make_shared<DuneVoxelMap<DuneDimensions>>()};
       SPDLOG_TRACE("compartment[{}]: {}", comp.index, comp.name);
       const auto &gridview{
           grid->subDomain(static_cast<unsigned int>(comp.index))
               .leafGridView()};
       const auto &qpi{comp.voxelIndexer};
-      std::vector<bool> ixAssigned(qpi.size(), false);
-      // get local coord for each pixel in each triangle
-      std::vector<std::array<double, DuneDimensions>> corners(DuneDimensions +
-                                                              1);
-      Dune::FieldVector<double, DuneDimensions> duneCoord;
+      std::vector<std::remove_cvref_t<Elem>> elems;
       for (const auto e : elements(gridview)) {
-        auto &voxelsInElement = comp.voxels.emplace_back();
-        const auto &geo = e.geometry();
-        auto ref = Dune::referenceElement(geo);
-        for (int i = 0; i < geo.corners(); ++i) {
-          for (std::size_t j = 0; j < DuneDimensions; ++j) {
-            corners[static_cast<std::size_t>(i)][j] = geo.corner(i)[j];
+        elems.push_back(e);
+      }
+      // find the voxels inside each element in parallel
+      std::vector<std::vector<VoxelLocalPair<DuneDimensions>>> elemVoxels(
+          elems.size());
+      oneapi::tbb::parallel_for(
+          oneapi::tbb::blocked_range<std::size_t>(0, elems.size()),
+          [&](const oneapi::tbb::blocked_range<std::size_t> &r) {
+            for (std::size_t iElement = r.begin(); iElement != r.end();
+                 ++iElement) {
+              elemVoxels[iElement] = getVoxelsInElement(elems[iElement], qpi);
+            }
+          });
+      // assemble interpolation operator, in element order
+      auto &interp{voxelMap->interpolation};
+      Dune::MultipleCodimMultipleGeomTypeMapper<SubGridView> vertexMapper(
+          gridview, Dune::mcmgVertexLayout());
+      interp.nVertices = vertexMapper.size();
+      interp.elementVertices.resize(elems.size());
+      if (!vertexInterpolation) {
+        voxelMap->elementVoxels.resize(elems.size());
+      }
+      std::vector<bool> vertexAssigned(interp.nVertices, false);
+      std::vector<bool> ixAssigned(qpi.size(), false);
+      std::array<std::size_t, DuneDimensions + 1> elementVertexIndices{};
+      for (std::size_t iElement = 0; iElement < elems.size(); ++iElement) {
+        const auto &e{elems[iElement]};
+        auto ref = Dune::referenceElement(e.geometry());
+        for (int i = 0; i < DuneDimensions + 1; ++i) {
+          // each vertex value is evaluated in the first element containing it
+          auto iv{static_cast<std::size_t>(
+              vertexMapper.subIndex(e, i, DuneDimensions))};
+          elementVertexIndices[static_cast<std::size_t>(i)] = iv;
+          if (!vertexAssigned[iv]) {
+            interp.elementVertices[iElement].push_back(
+                {iv, ref.position(i, DuneDimensions)});
+            vertexAssigned[iv] = true;
           }
         }
-        auto [pMin, pMax] = getBoundingBox(corners, pixelSize, pixelOrigin);
-        SPDLOG_TRACE("  - bounding box ({},{},{}) - ({},{},{})", pMin.p.x(),
-                     pMin.p.y(), pMin.z, pMax.p.x(), pMax.p.y(), pMax.z);
-        for (int x = pMin.p.x(); x < pMax.p.x() + 1; ++x) {
-          for (int y = pMin.p.y(); y < pMax.p.y() + 1; ++y) {
-            for (std::size_t z = pMin.z; z < pMax.z + 1; ++z) {
-              // global coordinate of center of voxel
-              duneCoord[0] =
-                  (static_cast<double>(x) + 0.5) * pixelSize.width() +
-                  pixelOrigin.p.x();
-              duneCoord[1] =
-                  (static_cast<double>(y) + 0.5) * pixelSize.height() +
-                  pixelOrigin.p.y();
-              if constexpr (DuneDimensions == 3) {
-                duneCoord[2] =
-                    (static_cast<double>(z) + 0.5) * pixelSize.depth() +
-                    pixelOrigin.z;
-              }
-              // as local coordinate for this element
-              auto localPoint = e.geometry().local(duneCoord);
-              // note: qpi/QImage has (0,0) in top-left corner:
-              common::Voxel vox{
-                  x, common::yIndex(y, geometryImageSize.height(), true), z};
-              if (auto ix{qpi.getIndex(vox)};
-                  ix.has_value() && ref.checkInside(localPoint)) {
-                voxelsInElement.push_back({*ix, localPoint});
-                ixAssigned[*ix] = true;
-              }
-            }
+        for (const auto &[ix, localPoint] : elemVoxels[iElement]) {
+          if (ixAssigned[ix]) {
+            continue;
+          }
+          ixAssigned[ix] = true;
+          if (!vertexInterpolation) {
+            voxelMap->elementVoxels[iElement].push_back({ix, localPoint});
+            continue;
+          }
+          // linear basis functions of the reference simplex
+          double w0{1.0};
+          for (std::size_t j = 0; j < DuneDimensions; ++j) {
+            w0 -= localPoint[j];
+          }
+          interp.voxels.push_back(ix);
+          interp.vertexIndices.push_back(elementVertexIndices[0]);
+          interp.weights.push_back(w0);
+          for (std::size_t j = 0; j < DuneDimensions; ++j) {
+            interp.vertexIndices.push_back(elementVertexIndices[j + 1]);
+            interp.weights.push_back(localPoint[j]);
           }
         }
-        SPDLOG_TRACE("    - found {} voxels", voxelsInElement.size());
+        SPDLOG_TRACE("element {}: found {} voxels", iElement,
+                     elemVoxels[iElement].size());
       }
       // Deal with voxels that fell outside of mesh (either in a membrane, or
       // where the mesh boundary differs a little from the pixel boundary).
       // For now we just set the value to the nearest voxel from the same
       // compartment which does lie inside an element of the mesh
-      for (std::size_t ix = 0; ix < ixAssigned.size(); ++ix) {
-        if (!ixAssigned[ix]) {
-          SPDLOG_DEBUG("voxel {} not in a triangle", ix);
-          // find a neighbouring valid pixel
-          auto ixNeighbour = getIxValidNeighbour(ix, ixAssigned, comp.geometry);
-          SPDLOG_DEBUG("  -> using concentration from voxel {}", ixNeighbour);
-          comp.missingVoxels.push_back({ix, ixNeighbour});
+      voxelMap->missingVoxels =
+          getNearestValidVoxels(ixAssigned, comp.geometry);
+      SPDLOG_DEBUG("{} voxels not in an element",
+                   voxelMap->missingVoxels.size());
+      comp.voxelMap = voxelMap;
+      voxelMaps->compartmentIndices.push_back(comp.index);
+      voxelMaps->compartmentVoxels.push_back(comp.geometry->getVoxels());
+      voxelMaps->maps.push_back(std::move(voxelMap));
+    }
+    if (gridCache != nullptr) {
+      gridCache->setData(grid, std::move(voxelMaps));
+    }
+  }
+
+  std::vector<VoxelLocalPair<DuneDimensions>>
+  getVoxelsInElement(const std::remove_cvref_t<Elem> &e,
+                     const geometry::VoxelIndexer &qpi) const {
+    std::vector<VoxelLocalPair<DuneDimensions>> voxels;
+    const auto &geo = e.geometry();
+    auto ref = Dune::referenceElement(geo);
+    std::vector<std::array<double, DuneDimensions>> corners(
+        static_cast<std::size_t>(geo.corners()));
+    for (int i = 0; i < geo.corners(); ++i) {
+      for (std::size_t j = 0; j < DuneDimensions; ++j) {
+        corners[static_cast<std::size_t>(i)][j] = geo.corner(i)[j];
+      }
+    }
+    // only voxels in the bounding box of the element can be inside it
+    auto [pMin, pMax] = getBoundingBox(corners, pixelSize, pixelOrigin);
+    Dune::FieldVector<double, DuneDimensions> duneCoord;
+    for (int x = pMin.p.x(); x < pMax.p.x() + 1; ++x) {
+      for (int y = pMin.p.y(); y < pMax.p.y() + 1; ++y) {
+        for (std::size_t z = pMin.z; z < pMax.z + 1; ++z) {
+          // global coordinate of center of voxel
+          duneCoord[0] = (static_cast<double>(x) + 0.5) * pixelSize.width() +
+                         pixelOrigin.p.x();
+          duneCoord[1] = (static_cast<double>(y) + 0.5) * pixelSize.height() +
+                         pixelOrigin.p.y();
+          if constexpr (DuneDimensions == 3) {
+            duneCoord[2] = (static_cast<double>(z) + 0.5) * pixelSize.depth() +
+                           pixelOrigin.z;
+          }
+          // note: qpi/QImage has (0,0) in top-left corner:
+          common::Voxel vox{
+              x, common::yIndex(y, geometryImageSize.height(), true), z};
+          if (auto ix{qpi.getIndex(vox)}; ix.has_value()) {
+            // as local coordinate for this element
+            auto localPoint = geo.local(duneCoord);
+            if (ref.checkInside(localPoint)) {
+              voxels.push_back({*ix, localPoint});
+            }
+          }
         }
       }
     }
+    return voxels;
   }
 
   std::shared_ptr<Dune::Copasi::CellData<GridView, double>>
@@ -397,6 +887,180 @@ private:
     return makeDiffusionCellDataForGridView(dc, grid->leafGridView());
   }
 
+  using IdType = typename SubGrid::Traits::LocalIdSet::IdType;
+  // species -> vertex id -> P1 vertex value
+  using VertexValues = std::vector<std::unordered_map<IdType, double>>;
+
+  /**
+   * @brief Refine elements near steep gradients and coarsen quiescent ones.
+   *
+   * The refinement indicator of an element is the largest variation of any
+   * species over its vertices, relative to the range of that species in the
+   * compartment. After adaptation the solution is interpolated onto the new
+   * grid, and the state, step operator and voxel interpolation are rebuilt.
+   */
+  void adaptGrid() {
+    constexpr int nCorners{DuneDimensions + 1};
+    stepsSinceAdapt = 0;
+    std::vector<VertexValues> oldValues;
+    for (const auto &comp : duneCompartments) {
+      const auto &subGrid{
+          grid->subDomain(static_cast<unsigned int>(comp.index))};
+      const auto &gridview{subGrid.leafGridView()};
+      const auto &idSet{subGrid.localIdSet()};
+      auto &values{oldValues.emplace_back()};
+      std::vector<double> ranges;
+      for (const auto &speciesName : comp.speciesNames) {
+        if (speciesName.empty()) {
+          continue;
+        }
+        auto gridFunc = model->make_compartment_function(state, speciesName);
+        auto localGridFunc = localFunction(gridFunc);
+        auto &v{values.emplace_back()};
+        double cMin{std::numeric_limits<double>::max()};
+        double cMax{std::numeric_limits<double>::lowest()};
+        for (const auto &e : elements(gridview)) {
+          auto ref = Dune::referenceElement(e.geometry());
+          localGridFunc.bind(e);
+          for (int i = 0; i < nCorners; ++i) {
+            if (auto [iter, inserted] =
+                    v.try_emplace(idSet.subId(e, i, DuneDimensions), 0.0);
+                inserted) {
+              iter->second = localGridFunc(ref.position(i, DuneDimensions));
+              cMin = std::min(cMin, iter->second);
+              cMax = std::max(cMax, iter->second);
+            }
+          }
+        }
+        ranges.push_back(cMax - cMin);
+      }
+      std::size_t nRefine{0};
+      std::size_t nCoarsen{0};
+      for (const auto &e : elements(gridview)) {
+        double indicator{0.0};
+        for (std::size_t iSpecies = 0; iSpecies < values.size(); ++iSpecies) {
+          if (ranges[iSpecies] <= 0.0) {
+            continue;
+          }
+          double vMin{std::numeric_limits<double>::max()};
+          double vMax{std::numeric_limits<double>::lowest()};
+          for (int i = 0; i < nCorners; ++i) {
+            auto value{
+                values[iSpecies].at(idSet.subId(e, i, DuneDimensions))};
+            vMin = std::min(vMin, value);
+            vMax = std::max(vMax, value);
+          }
+          indicator = std::max(indicator, (vMax - vMin) / ranges[iSpecies]);
+        }
+        if (indicator > adaptiveRefineTol && e.level() < adaptiveMaxLevel) {
+          grid->mark(1, grid->multiDomainEntity(e));
+          ++nRefine;
+        } else if (indicator < adaptiveCoarsenTol && e.level() > 0) {
+          grid->mark(-1, grid->multiDomainEntity(e));
+          ++nCoarsen;
+        }
+      }
+      SPDLOG_DEBUG("compartment {}: marked {} to refine, {} to coarsen",
+                   comp.name, nRefine, nCoarsen);
+    }
+    grid->preAdapt();
+    grid->adapt();
+    grid->postAdapt();
+    // transfer solution to the adapted grid
+    std::unordered_map<std::string, typename Model::GridFunction> functions;
+    for (std::size_t iComp = 0; iComp < duneCompartments.size(); ++iComp) {
+      const auto &comp{duneCompartments[iComp]};
+      const auto &subGrid{
+          grid->subDomain(static_cast<unsigned int>(comp.index))};
+      const auto &gridview{subGrid.leafGridView()};
+      const auto &idSet{subGrid.localIdSet()};
+      const auto &values{oldValues[iComp]};
+      using Domain = typename SubGridView::template Codim<
+          0>::Geometry::GlobalCoordinate;
+      std::vector<Domain> positions;
+      std::vector<std::vector<double>> newValues(values.size());
+      std::unordered_set<IdType> visited;
+      double minEdge{std::numeric_limits<double>::max()};
+      for (const auto &e : elements(gridview)) {
+        const auto &geo{e.geometry()};
+        minEdge = std::min(minEdge, (geo.corner(1) - geo.corner(0)).two_norm());
+        for (int i = 0; i < nCorners; ++i) {
+          if (!visited.insert(idSet.subId(e, i, DuneDimensions)).second) {
+            continue;
+          }
+          positions.push_back(geo.corner(i));
+          for (std::size_t iSpecies = 0; iSpecies < values.size();
+               ++iSpecies) {
+            newValues[iSpecies].push_back(getVertexValue(
+                values[iSpecies], idSet, e, i, positions.back()));
+          }
+        }
+      }
+      std::size_t iSpecies{0};
+      for (const auto &speciesName : comp.speciesNames) {
+        if (!speciesName.empty()) {
+          functions[fmt::format("{}.{}", comp.name, speciesName)] =
+              Dune::Functions::makeAnalyticGridViewFunction(
+                  VertexValueFunction<Domain>(positions, newValues[iSpecies],
+                                              0.5 * minEdge),
+                  gridview);
+          ++iSpecies;
+        }
+      }
+      SPDLOG_DEBUG("compartment {}: {} elements after adaptation", comp.name,
+                   gridview.size(0));
+    }
+    const double time{state->time};
+    state = model->make_state(grid, config.sub("model"));
+    model->interpolate(*state, functions);
+    state->time = time;
+    step_operator = model->make_step_operator(*state, config.sub("model"));
+    updateVoxels();
+  }
+
+  /**
+   * @brief Value of the pre-adaptation solution at a vertex of the new grid.
+   *
+   * Existing vertices keep their value, new vertices are linearly
+   * interpolated from the nearest ancestor element whose vertices all
+   * existed before the adaptation.
+   */
+  template <typename IdSet, typename Domain>
+  static double getVertexValue(const std::unordered_map<IdType, double> &old,
+                               const IdSet &idSet,
+                               const std::remove_cvref_t<Elem> &e, int corner,
+                               const Domain &position) {
+    constexpr int nCorners{DuneDimensions + 1};
+    if (auto iter{old.find(idSet.subId(e, corner, DuneDimensions))};
+        iter != old.end()) {
+      return iter->second;
+    }
+    std::array<double, nCorners> cornerValues{};
+    auto ancestor{e};
+    while (ancestor.hasFather()) {
+      ancestor = ancestor.father();
+      bool allFound{true};
+      for (int i = 0; i < nCorners && allFound; ++i) {
+        auto iter{old.find(idSet.subId(ancestor, i, DuneDimensions))};
+        allFound = iter != old.end();
+        if (allFound) {
+          cornerValues[static_cast<std::size_t>(i)] = iter->second;
+        }
+      }
+      if (allFound) {
+        // linear basis functions of the reference simplex
+        auto localPoint{ancestor.geometry().local(position)};
+        double result{cornerValues[0]};
+        for (std::size_t j = 0; j < DuneDimensions; ++j) {
+          result += localPoint[j] * (cornerValues[j + 1] - cornerValues[0]);
+        }
+        return result;
+      }
+    }
+    SPDLOG_WARN("No pre-adaptation value found for vertex");
+    return 0.0;
+  }
+
   void setInitial(const DuneConverter &dc) {
     SPDLOG_INFO("Initial condition functions:");
     auto initialConditionFunctions{
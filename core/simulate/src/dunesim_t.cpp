@@ -2,14 +2,20 @@
 #include "dune_headers.hpp"
 #include "dunegrid.hpp"
 #include "dunesim.hpp"
+#include "dunesim_impl.hpp"
 #include "model_test_utils.hpp"
+#include "sme/duneconverter.hpp"
 #include "sme/mesh2d.hpp"
 #include "sme/model.hpp"
 #include "sme/simulate_options.hpp"
 #include "sme/utils.hpp"
+#include <algorithm>
 #include <array>
+#include <cmath>
 #include <locale>
+#include <numeric>
 #include <optional>
+#include <sstream>
 
 using namespace sme;
 using namespace sme::test;
@@ -54,6 +60,20 @@ std::vector<double> getAllElementCoordinates(Grid *grid,
   return v;
 }
 
+void requireSameParameterTree(const Dune::ParameterTree &a,
+                              const Dune::ParameterTree &b) {
+  REQUIRE(a.getValueKeys() == b.getValueKeys());
+  for (const auto &key : a.getValueKeys()) {
+    CAPTURE(key);
+    REQUIRE(a[key] == b[key]);
+  }
+  REQUIRE(a.getSubKeys() == b.getSubKeys());
+  for (const auto &key : a.getSubKeys()) {
+    CAPTURE(key);
+    requireSameParameterTree(a.sub(key), b.sub(key));
+  }
+}
+
 std::array<std::vector<double>, 2>
 getSubdomainElementCoordinates(const mesh::Mesh2d &mesh) {
   auto duneGrid = simulate::makeDuneGrid<HostGrid2d, MDGTraits2d>(mesh);
@@ -184,9 +204,235 @@ TEST_CASE("DuneSim", "[core/simulate/dunesim][core/"
     std::vector<std::string> comps{"comp"};
     simulate::DuneSim duneSim(m, comps);
     REQUIRE(duneSim.errorMessage().empty());
-    duneSim.run(1, -1, []() { return true; });
+    // callback is checked after each internal step
+    REQUIRE(duneSim.run(1, -1, []() { return true; }) == 1);
     REQUIRE(duneSim.errorMessage() == "Simulation cancelled");
   }
+  SECTION("Stop request and timeout are checked during a run") {
+    auto m{getExampleModel(Mod::ABtoC)};
+    std::vector<std::string> comps{"comp"};
+    simulate::DuneSim duneSim(m, comps);
+    REQUIRE(duneSim.errorMessage().empty());
+    REQUIRE(duneSim.getStopRequested() == false);
+    duneSim.setStopRequested(true);
+    REQUIRE(duneSim.getStopRequested() == true);
+    REQUIRE(duneSim.run(1e3, -1, {}) == 1);
+    REQUIRE(duneSim.errorMessage() == "Simulation stopped early");
+    duneSim.setStopRequested(false);
+    REQUIRE(duneSim.run(1e3, 0, {}) == 1);
+    REQUIRE(duneSim.errorMessage() == "Simulation timeout");
+    // no stop condition: run to completion
+    REQUIRE(duneSim.run(1e-3, -1, {}) >= 1);
+    REQUIRE(duneSim.errorMessage().empty());
+  }
+  SECTION("Parameter tree from ini entries matches parsed ini text") {
+    for (auto exampleModel : {Mod::ABtoC, Mod::VerySimpleModel,
+                              Mod::LiverSimplified, Mod::VerySimpleModel3D}) {
+      CAPTURE(exampleModel);
+      auto m{getExampleModel(exampleModel)};
+      simulate::DuneConverter dc(m);
+      Dune::ParameterTree parsed;
+      std::stringstream ssIni(dc.getIniFile().toStdString());
+      Dune::ParameterTreeParser::readINITree(ssIni, parsed);
+      Dune::ParameterTree direct;
+      for (const auto &[key, value] : dc.getIniEntries()) {
+        direct[key] = value;
+      }
+      requireSameParameterTree(parsed, direct);
+    }
+  }
+  SECTION("Grid and voxel maps are reused from the model cache") {
+    auto m{getExampleModel(Mod::VerySimpleModel)};
+    std::vector<std::string> comps{"c1", "c2", "c3"};
+    auto &gridCache{m.getSimulatorCache().getDuneSimCache().grid2d};
+    std::vector<double> concs;
+    {
+      simulate::DuneSim sim(m, comps);
+      REQUIRE(sim.errorMessage().empty());
+      REQUIRE(gridCache.nHits() == 0);
+      sim.run(0.05, -1, {});
+      concs = sim.getConcentrations(1);
+    }
+    {
+      simulate::DuneSim sim(m, comps);
+      REQUIRE(sim.errorMessage().empty());
+      REQUIRE(gridCache.nHits() == 1);
+      sim.run(0.05, -1, {});
+      const auto &c{sim.getConcentrations(1)};
+      REQUIRE(c.size() == concs.size());
+      for (std::size_t i = 0; i < c.size(); ++i) {
+        REQUIRE(c[i] == dbl_approx(concs[i]));
+      }
+    }
+    // voxel maps are stored with the cached grid
+    {
+      auto [grid, hostGrid] = gridCache.get(*m.getGeometry().getMesh2d());
+      REQUIRE(gridCache.nHits() == 2);
+      auto voxelMaps{gridCache.getData(grid)};
+      REQUIRE(voxelMaps != nullptr);
+      REQUIRE(voxelMaps->maps.size() == comps.size());
+    }
+    // clearing the model releases the cached grid and voxel maps
+    m.clear();
+    auto &clearedGridCache{m.getSimulatorCache().getDuneSimCache().grid2d};
+    REQUIRE(clearedGridCache.nHits() == 0);
+    // each model has its own cache
+    auto m2{getExampleModel(Mod::VerySimpleModel)};
+    auto [grid, hostGrid] =
+        m2.getSimulatorCache().getDuneSimCache().grid2d.get(
+            *m2.getGeometry().getMesh2d());
+    REQUIRE(m2.getSimulatorCache().getDuneSimCache().grid2d.getData(grid) ==
+            nullptr);
+  }
+  SECTION("Discretizations") {
+    auto m{getExampleModel(Mod::VerySimpleModel)};
+    std::vector<std::string> comps{"c1", "c2", "c3"};
+    auto &options{m.getSimulationSettings().options.dune};
+    simulate::DuneSim fem1(m, comps);
+    REQUIRE(fem1.errorMessage().empty());
+    fem1.run(0.05, -1, {});
+    options.discretization = simulate::DuneDiscretizationType::FEM2;
+    simulate::DuneSim fem2(m, comps);
+    REQUIRE(fem2.errorMessage().empty());
+    fem2.run(0.05, -1, {});
+    REQUIRE(fem2.errorMessage().empty());
+    for (std::size_t iComp = 0; iComp < comps.size(); ++iComp) {
+      CAPTURE(iComp);
+      const auto &c{fem2.getConcentrations(iComp)};
+      const auto &cFem1{fem1.getConcentrations(iComp)};
+      REQUIRE(c.size() == cFem1.size());
+      // average concentrations agree with the FEM1 simulation
+      auto sum{std::accumulate(c.cbegin(), c.cend(), 0.0)};
+      auto sumFem1{std::accumulate(cFem1.cbegin(), cFem1.cend(), 0.0)};
+      REQUIRE(sum == Catch::Approx(sumFem1).epsilon(0.05).margin(1e-10));
+      REQUIRE(std::ranges::all_of(
+          c, [](double x) { return std::isfinite(x) && x >= 0.0; }));
+    }
+    // adaptive mesh is only supported for FEM1, otherwise ignored
+    options.discretization = simulate::DuneDiscretizationType::FEM2;
+    options.adaptiveMesh = true;
+    simulate::DuneSim fem2Adaptive(m, comps);
+    REQUIRE(fem2Adaptive.errorMessage().empty());
+  }
+  SECTION("Discretizations: diffusion from a point source") {
+    // gaussian initial concentrations spread out from the centre of the
+    // circle, see docs/tests/diffusion.rst for the analytic solution
+    auto m{getExampleModel(Mod::SingleCompartmentDiffusion)};
+    std::vector<std::string> comps{"circle"};
+    auto &options{m.getSimulationSettings().options.dune};
+    options.dt = 1.0;
+    options.maxDt = 1.0;
+    options.minDt = 0.5;
+    const auto *slow{m.getSpecies().getField("slow")};
+    const auto *fast{m.getSpecies().getField("fast")};
+    const auto *comp{slow->getCompartment()};
+    const std::vector<double> D{slow->getDiffusionConstant()[0],
+                                fast->getDiffusionConstant()[0]};
+    constexpr double sigma2{36.0};
+    constexpr double t{10.0};
+    for (auto discretization : {simulate::DuneDiscretizationType::FEM1,
+                                simulate::DuneDiscretizationType::FEM2}) {
+      CAPTURE(static_cast<int>(discretization));
+      options.discretization = discretization;
+      simulate::DuneSim duneSim(m, comps);
+      REQUIRE(duneSim.errorMessage().empty());
+      duneSim.run(t, -1, {});
+      REQUIRE(duneSim.errorMessage().empty());
+      const auto &c{duneSim.getConcentrations(0)};
+      REQUIRE(c.size() == comp->nVoxels() * D.size());
+      for (std::size_t is = 0; is < D.size(); ++is) {
+        CAPTURE(is);
+        const double t0{sigma2 / 4.0 / D[is]};
+        double cMax{0.0};
+        double avgRelErr{0.0};
+        std::size_t count{0};
+        for (std::size_t ix = 0; ix < comp->nVoxels(); ++ix) {
+          const auto &p{comp->getVoxel(ix).p};
+          const double conc{c[ix * D.size() + is]};
+          cMax = std::max(cMax, conc);
+          // squared distance from the centre of the initial distribution
+          const double r2{std::pow(p.x() - 47.5, 2) +
+                          std::pow(51.5 - p.y(), 2)};
+          // avoid boundary effects: analytic solution is in infinite volume
+          if (r2 < 16 * 16) {
+            const double analytic{(t0 / (t + t0)) *
+                                  std::exp(-r2 / (4.0 * D[is] * (t + t0)))};
+            avgRelErr += std::abs(conc - analytic) / analytic;
+            ++count;
+          }
+        }
+        avgRelErr /= static_cast<double>(count);
+        REQUIRE(avgRelErr < 0.1);
+        // the peak has decreased from its initial value of 1
+        REQUIRE(cMax == Catch::Approx(t0 / (t + t0)).epsilon(0.1));
+      }
+    }
+  }
+  SECTION("Linear solver with AMG preconditioner") {
+    auto m{getExampleModel(Mod::ABtoC)};
+    std::vector<std::string> comps{"comp"};
+    auto &options{m.getSimulationSettings().options.dune};
+    options.newtonRelErr = 1e-10;
+    options.newtonAbsErr = 1e-12;
+    simulate::DuneSim reference(m, comps);
+    REQUIRE(reference.errorMessage().empty());
+    reference.run(0.05, -1, {});
+    REQUIRE(reference.errorMessage().empty());
+    options.linearSolver = "BiCGSTAB";
+    options.preconditioner = "AMG";
+    simulate::DuneSim duneSim(m, comps);
+    REQUIRE(duneSim.errorMessage().empty());
+    duneSim.run(0.05, -1, {});
+    REQUIRE(duneSim.errorMessage().empty());
+    const auto &c{duneSim.getConcentrations(0)};
+    const auto &cReference{reference.getConcentrations(0)};
+    REQUIRE(c.size() == cReference.size());
+    for (std::size_t i = 0; i < c.size(); ++i) {
+      REQUIRE(c[i] == Catch::Approx(cReference[i]).epsilon(1e-6).margin(1e-10));
+    }
+    // an unknown preconditioner is reported as a simulation error
+    options.preconditioner = "NotAPreconditioner";
+    simulate::DuneSim invalid(m, comps);
+    if (invalid.errorMessage().empty()) {
+      invalid.run(0.05, -1, {});
+    }
+    REQUIRE(!invalid.errorMessage().empty());
+  }
+  SECTION("Adaptive mesh refinement") {
+    auto m{getExampleModel(Mod::VerySimpleModel)};
+    std::vector<std::string> comps{"c1", "c2", "c3"};
+    auto &options{m.getSimulationSettings().options.dune};
+    simulate::DuneSim staticMesh(m, comps);
+    REQUIRE(staticMesh.errorMessage().empty());
+    const auto nElements{staticMesh.getNumberOfMeshElements()};
+    REQUIRE(nElements > 0);
+    staticMesh.run(0.05, -1, {});
+    REQUIRE(staticMesh.getNumberOfMeshElements() == nElements);
+    options.adaptiveMesh = true;
+    options.adaptiveInterval = 1;
+    options.adaptiveMaxLevel = 1;
+    options.adaptiveRefineTol = 1e-6;
+    options.adaptiveCoarsenTol = 0.0;
+    simulate::DuneSim adaptiveMesh(m, comps);
+    REQUIRE(adaptiveMesh.errorMessage().empty());
+    REQUIRE(adaptiveMesh.getNumberOfMeshElements() == nElements);
+    REQUIRE(adaptiveMesh.run(0.05, -1, {}) > 1);
+    REQUIRE(adaptiveMesh.errorMessage().empty());
+    // elements with a concentration gradient are refined
+    REQUIRE(adaptiveMesh.getNumberOfMeshElements() > nElements);
+    for (std::size_t iComp = 0; iComp < comps.size(); ++iComp) {
+      CAPTURE(iComp);
+      const auto &c{adaptiveMesh.getConcentrations(iComp)};
+      const auto &cStatic{staticMesh.getConcentrations(iComp)};
+      REQUIRE(c.size() == cStatic.size());
+      // average concentrations agree with the static mesh simulation
+      auto sum{std::accumulate(c.cbegin(), c.cend(), 0.0)};
+      auto sumStatic{std::accumulate(cStatic.cbegin(), cStatic.cend(), 0.0)};
+      REQUIRE(sum == Catch::Approx(sumStatic).epsilon(0.05).margin(1e-10));
+      REQUIRE(std::ranges::all_of(
+          c, [](double x) { return std::isfinite(x) && x >= 0.0; }));
+    }
+  }
   SECTION("Species are mapped to the correct initial concentrations") {
     // https://github.com/spatial-model-editor/spatial-model-editor/issues/852
     // used inverse mapping of indices, which happened to be correct for test
@@ -0,0 +1,208 @@
+#include "newton_krylov.hpp"
+#include "sme/logger.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace sme::simulate {
+
+static double dot(const std::vector<double> &a, const std::vector<double> &b) {
+  double sum{0.0};
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+static double norm(const std::vector<double> &a) {
+  return std::sqrt(dot(a, a));
+}
+
+NewtonKrylovSolver::NewtonKrylovSolver(Function residualFunction,
+                                       std::vector<double> initialState,
+                                       const NewtonKrylovOptions &solverOptions)
+    : residual{std::move(residualFunction)}, options{solverOptions},
+      u{std::move(initialState)}, f(u.size(), 0.0), uPerturbed(u.size()),
+      fPerturbed(u.size()), tau{solverOptions.initialPseudoTimestep} {
+  evaluateResidual(u, f);
+  fNorm = norm(f);
+}
+
+void NewtonKrylovSolver::setPreconditioner(Function linearOp,
+                                           std::vector<double> linearOpDiag) {
+  linearOperator = std::move(linearOp);
+  diagonal = std::move(linearOpDiag);
+  lz.resize(u.size());
+}
+
+void NewtonKrylovSolver::evaluateResidual(const std::vector<double> &values,
+                                          std::vector<double> &result) {
+  residual(values, result);
+  ++nResidualEvaluations;
+}
+
+void NewtonKrylovSolver::applyOperator(const std::vector<double> &v,
+                                       std::vector<double> &result) {
+  // (I/tau - J) v, with J v from a finite difference of the residual
+  double vNorm{norm(v)};
+  if (vNorm == 0.0) {
+    std::ranges::fill(result, 0.0);
+    return;
+  }
+  double eps{std::sqrt(std::numeric_limits<double>::epsilon()) *
+             (1.0 + norm(u)) / vNorm};
+  for (std::size_t i = 0; i < u.size(); ++i) {
+    uPerturbed[i] = u[i] + eps * v[i];
+  }
+  evaluateResidual(uPerturbed, fPerturbed);
+  for (std::size_t i = 0; i < u.size(); ++i) {
+    result[i] = v[i] / tau - (fPerturbed[i] - f[i]) / eps;
+  }
+}
+
+void NewtonKrylovSolver::applyPreconditioner(const std::vector<double> &r,
+                                             std::vector<double> &z) {
+  if (!linearOperator) {
+    z = r;
+    return;
+  }
+  // Jacobi iterations for (I/tau - L) z = r
+  for (std::size_t i = 0; i < r.size(); ++i) {
+    z[i] = r[i] / (1.0 / tau - diagonal[i]);
+  }
+  for (std::size_t sweep = 0; sweep < options.preconditionerSweeps; ++sweep) {
+    linearOperator(z, lz);
+    for (std::size_t i = 0; i < r.size(); ++i) {
+      z[i] += (r[i] - z[i] / tau + lz[i]) / (1.0 / tau - diagonal[i]);
+    }
+  }
+}
+
+std::vector<double> NewtonKrylovSolver::solveLinearSystem() {
+  // right-preconditioned GMRES for (I/tau - J) du = F(u)
+  const std::size_t n{u.size()};
+  const std::size_t m{std::max(options.maxKrylovIterations, std::size_t{1})};
+  std::vector<double> du(n, 0.0);
+  if (fNorm == 0.0) {
+    return du;
+  }
+  std::vector<std::vector<double>> v;
+  std::vector<std::vector<double>> z;
+  v.reserve(m + 1);
+  z.reserve(m);
+  // upper Hessenberg matrix h(i, k) = h[k * (m + 1) + i]
+  std::vector<double> h((m + 1) * m, 0.0);
+  auto hij = [&h, m](std::size_t i, std::size_t k) -> double & {
+    return h[k * (m + 1) + i];
+  };
+  std::vector<double> cs(m, 0.0);
+  std::vector<double> sn(m, 0.0);
+  std::vector<double> g(m + 1, 0.0);
+  g[0] = fNorm;
+  auto &v0{v.emplace_back(f)};
+  for (auto &vi : v0) {
+    vi /= fNorm;
+  }
+  std::vector<double> w(n);
+  std::size_t nIter{0};
+  while (nIter < m) {
+    const std::size_t k{nIter};
+    applyPreconditioner(v[k], z.emplace_back(n));
+    applyOperator(z[k], w);
+    // modified Gram-Schmidt
+    for (std::size_t i = 0; i <= k; ++i) {
+      hij(i, k) = dot(w, v[i]);
+      for (std::size_t j = 0; j < n; ++j) {
+        w[j] -= hij(i, k) * v[i][j];
+      }
+    }
+    const double wNorm{norm(w)};
+    hij(k + 1, k) = wNorm;
+    // apply previous Givens rotations to the new column
+    for (std::size_t i = 0; i < k; ++i) {
+      double tmp{cs[i] * hij(i, k) + sn[i] * hij(i + 1, k)};
+      hij(i + 1, k) = -sn[i] * hij(i, k) + cs[i] * hij(i + 1, k);
+      hij(i, k) = tmp;
+    }
+    const double r{std::hypot(hij(k, k), hij(k + 1, k))};
+    if (r == 0.0) {
+      break;
+    }
+    cs[k] = hij(k, k) / r;
+    sn[k] = hij(k + 1, k) / r;
+    hij(k, k) = r;
+    hij(k + 1, k) = 0.0;
+    g[k + 1] = -sn[k] * g[k];
+    g[k] = cs[k] * g[k];
+    ++nIter;
+    if (std::abs(g[k + 1]) <= options.krylovTolerance * fNorm ||
+        wNorm == 0.0) {
+      break;
+    }
+    auto &vNext{v.emplace_back(w)};
+    for (auto &vi : vNext) {
+      vi /= wNorm;
+    }
+  }
+  SPDLOG_DEBUG("GMRES: {} iterations, relative residual {}", nIter,
+               std::abs(g[nIter]) / fNorm);
+  // solve the upper triangular system and form du = sum_i y_i z_i
+  std::vector<double> y(nIter, 0.0);
+  for (std::size_t ii = nIter; ii-- > 0;) {
+    double sum{g[ii]};
+    for (std::size_t j = ii + 1; j < nIter; ++j) {
+      sum -= hij(ii, j) * y[j];
+    }
+    y[ii] = sum / hij(ii, ii);
+  }
+  for (std::size_t i = 0; i < nIter; ++i) {
+    for (std::size_t j = 0; j < n; ++j) {
+      du[j] += y[i] * z[i][j];
+    }
+  }
+  return du;
+}
+
+double NewtonKrylovSolver::step() {
+  auto uNew{solveLinearSystem()};
+  for (std::size_t i = 0; i < u.size(); ++i) {
+    uNew[i] += u[i];
+    if (options.nonNegative && uNew[i] < 0.0) {
+      uNew[i] = 0.0;
+    }
+  }
+  std::vector<double> fNew(u.size(), 0.0);
+  evaluateResidual(uNew, fNew);
+  const double fNewNorm{norm(fNew)};
+  if (!std::isfinite(fNewNorm)) {
+    // reject step and retry with a smaller pseudo-timestep
+    tau *= 0.1;
+    SPDLOG_DEBUG("Rejected step: pseudo-timestep -> {}", tau);
+    return fNorm;
+  }
+  // switched evolution relaxation: grow tau as the residual decreases
+  tau = std::min(tau * fNorm / std::max(fNewNorm, 1e-300),
+                 options.maxPseudoTimestep);
+  u = std::move(uNew);
+  f = std::move(fNew);
+  fNorm = fNewNorm;
+  SPDLOG_DEBUG("|F| = {}, pseudo-timestep -> {}", fNorm, tau);
+  return fNorm;
+}
+
+const std::vector<double> &NewtonKrylovSolver::getState() const { return u; }
+
+const std::vector<double> &NewtonKrylovSolver::getResidual() const {
+  return f;
+}
+
+double NewtonKrylovSolver::getResidualNorm() const { return fNorm; }
+
+double NewtonKrylovSolver::getPseudoTimestep() const { return tau; }
+
+std::size_t NewtonKrylovSolver::getResidualEvaluations() const {
+  return nResidualEvaluations;
+}
+
+} // namespace sme::simulate
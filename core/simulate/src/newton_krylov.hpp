@@ -0,0 +1,131 @@
+// Jacobian-free Newton-Krylov steady state solver
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace sme::simulate {
+
+/**
+ * @brief Options for the Newton-Krylov steady state solver.
+ */
+struct NewtonKrylovOptions {
+  /**
+   * @brief Initial pseudo-timestep for pseudo-transient continuation.
+   */
+  double initialPseudoTimestep{1.0};
+  /**
+   * @brief Maximum pseudo-timestep: larger values approach a pure Newton step.
+   */
+  double maxPseudoTimestep{1e12};
+  /**
+   * @brief Maximum number of GMRES iterations for each Newton step.
+   */
+  std::size_t maxKrylovIterations{50};
+  /**
+   * @brief Relative tolerance for the GMRES linear solve.
+   */
+  double krylovTolerance{1e-3};
+  /**
+   * @brief Number of Jacobi sweeps used to apply the preconditioner.
+   */
+  std::size_t preconditionerSweeps{4};
+  /**
+   * @brief Clamp negative values of the state to zero after each step.
+   *
+   * For concentrations, which are only physical if non-negative.
+   */
+  bool nonNegative{false};
+};
+
+/**
+ * @brief Jacobian-free Newton-Krylov solver for ``F(u) = 0``.
+ *
+ * Each step solves ``(I/tau - J) du = F(u)`` using GMRES, where the
+ * Jacobian-vector products ``J v`` are approximated by finite differences of
+ * the residual ``F``. The pseudo-timestep ``tau`` is increased as the
+ * residual decreases (switched evolution relaxation), so the first steps
+ * follow the transient dynamics and later steps converge like Newton's
+ * method.
+ *
+ * The linear solve can optionally be preconditioned with a linear operator
+ * ``L`` that approximates the Jacobian, such as the diffusion operator: a few
+ * Jacobi sweeps of ``(I/tau - L) z = r`` are used to apply it.
+ */
+class NewtonKrylovSolver {
+public:
+  /**
+   * @brief Evaluate ``result = f(values)``.
+   */
+  using Function = std::function<void(const std::vector<double> &values,
+                                      std::vector<double> &result)>;
+  /**
+   * @brief Construct a solver.
+   * @param residual The residual function ``F``.
+   * @param initialState The initial guess ``u``.
+   * @param options Solver options.
+   */
+  NewtonKrylovSolver(Function residual, std::vector<double> initialState,
+                     const NewtonKrylovOptions &options = {});
+  /**
+   * @brief Precondition the linear solve with an approximate Jacobian.
+   * @param linearOperator Applies the linear operator ``L``.
+   * @param diagonal The diagonal of ``L``.
+   */
+  void setPreconditioner(Function linearOperator,
+                         std::vector<double> diagonal);
+  /**
+   * @brief Do one pseudo-transient Newton step.
+   *
+   * If the step fails to produce a finite residual it is rejected and the
+   * pseudo-timestep reduced. If ``nonNegative`` is set, negative values of
+   * the new state are set to zero before evaluating its residual.
+   *
+   * @returns The L2 norm of the residual after the step.
+   */
+  double step();
+  /**
+   * @brief The current state ``u``.
+   */
+  [[nodiscard]] const std::vector<double> &getState() const;
+  /**
+   * @brief The current residual ``F(u)``.
+   */
+  [[nodiscard]] const std::vector<double> &getResidual() const;
+  /**
+   * @brief The L2 norm of the current residual.
+   */
+  [[nodiscard]] double getResidualNorm() const;
+  /**
+   * @brief The current pseudo-timestep.
+   */
+  [[nodiscard]] double getPseudoTimestep() const;
+  /**
+   * @brief The total number of residual evaluations.
+   */
+  [[nodiscard]] std::size_t getResidualEvaluations() const;
+
+private:
+  Function residual;
+  Function linearOperator;
+  std::vector<double> diagonal;
+  NewtonKrylovOptions options;
+  std::vector<double> u;
+  std::vector<double> f;
+  std::vector<double> uPerturbed;
+  std::vector<double> fPerturbed;
+  std::vector<double> lz;
+  double fNorm{0.0};
+  double tau;
+  std::size_t nResidualEvaluations{0};
+  void evaluateResidual(const std::vector<double> &values,
+                        std::vector<double> &result);
+  void applyOperator(const std::vector<double> &v, std::vector<double> &result);
+  void applyPreconditioner(const std::vector<double> &r,
+                           std::vector<double> &z);
+  std::vector<double> solveLinearSystem();
+};
+
+} // namespace sme::simulate
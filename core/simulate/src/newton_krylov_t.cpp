@@ -0,0 +1,111 @@
+#include "catch_wrapper.hpp"
+#include "newton_krylov.hpp"
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+using namespace sme;
+
+TEST_CASE("Newton-Krylov steady state solver",
+          "[core/simulate/newton_krylov][core/simulate][core][newton_krylov]") {
+  SECTION("linear system") {
+    simulate::NewtonKrylovOptions options;
+    options.initialPseudoTimestep = 1e12;
+    simulate::NewtonKrylovSolver solver(
+        [](const std::vector<double> &u, std::vector<double> &f) {
+          f[0] = 1.0 - 2.0 * u[0] + u[1];
+          f[1] = 2.0 + u[0] - 3.0 * u[1];
+        },
+        {0.0, 0.0}, options);
+    REQUIRE(solver.getResidualNorm() == dbl_approx(std::sqrt(5.0)));
+    REQUIRE(solver.getResidualEvaluations() == 1);
+    // with a large pseudo-timestep a single step is a Newton step
+    solver.step();
+    REQUIRE(solver.getState()[0] == Catch::Approx(1.0).epsilon(1e-6));
+    REQUIRE(solver.getState()[1] == Catch::Approx(1.0).epsilon(1e-6));
+    REQUIRE(solver.getResidualNorm() < 1e-6);
+  }
+  SECTION("non-finite residual: step rejected") {
+    simulate::NewtonKrylovOptions options;
+    options.initialPseudoTimestep = 1e12;
+    // a full Newton step from u=3 gives u<0
+    simulate::NewtonKrylovSolver solver(
+        [](const std::vector<double> &u, std::vector<double> &f) {
+          f[0] = -std::log(u[0]);
+        },
+        {3.0}, options);
+    solver.step();
+    REQUIRE(solver.getState()[0] == dbl_approx(3.0));
+    REQUIRE(solver.getPseudoTimestep() == dbl_approx(1e11));
+    std::size_t nSteps{0};
+    while (solver.getResidualNorm() > 1e-12 && nSteps < 100) {
+      solver.step();
+      ++nSteps;
+    }
+    REQUIRE(nSteps < 100);
+    REQUIRE(solver.getState()[0] == Catch::Approx(1.0).epsilon(1e-10));
+  }
+  SECTION("non-negative state") {
+    simulate::NewtonKrylovOptions options;
+    options.initialPseudoTimestep = 1e12;
+    // root is at u=-1
+    auto residual = [](const std::vector<double> &u, std::vector<double> &f) {
+      f[0] = -1.0 - u[0];
+      f[1] = 1.0 - u[1];
+    };
+    simulate::NewtonKrylovSolver unclamped(residual, {0.5, 0.5}, options);
+    unclamped.step();
+    REQUIRE(unclamped.getState()[0] == Catch::Approx(-1.0).epsilon(1e-6));
+    options.nonNegative = true;
+    simulate::NewtonKrylovSolver solver(residual, {0.5, 0.5}, options);
+    for (int i = 0; i < 5; ++i) {
+      solver.step();
+      REQUIRE(solver.getState()[0] == dbl_approx(0.0));
+      REQUIRE(solver.getResidual()[0] == dbl_approx(-1.0));
+    }
+    // other values are not affected
+    REQUIRE(solver.getState()[1] == Catch::Approx(1.0).epsilon(1e-6));
+  }
+  SECTION("1d reaction-diffusion") {
+    constexpr std::size_t n{200};
+    constexpr double d{100.0};
+    auto diffusion = [](const std::vector<double> &u, std::vector<double> &f) {
+      for (std::size_t i = 0; i < n; ++i) {
+        double uLeft{i > 0 ? u[i - 1] : u[i]};
+        double uRight{i + 1 < n ? u[i + 1] : u[i]};
+        f[i] = d * (uLeft - 2.0 * u[i] + uRight);
+      }
+    };
+    auto residual = [&diffusion](const std::vector<double> &u,
+                                 std::vector<double> &f) {
+      diffusion(u, f);
+      for (std::size_t i = 0; i < n; ++i) {
+        double source{i < n / 10 ? 1.0 : 0.0};
+        f[i] += source - 0.1 * u[i] - 0.5 * u[i] * u[i];
+      }
+    };
+    std::vector<double> diagonal(n, -2.0 * d);
+    diagonal.front() = -d;
+    diagonal.back() = -d;
+    auto solve = [&](bool precondition) {
+      simulate::NewtonKrylovSolver solver(residual,
+                                          std::vector<double>(n, 0.0));
+      if (precondition) {
+        solver.setPreconditioner(diffusion, diagonal);
+      }
+      std::size_t nSteps{0};
+      while (solver.getResidualNorm() > 1e-9 && nSteps < 100) {
+        solver.step();
+        ++nSteps;
+      }
+      REQUIRE(nSteps < 100);
+      for (double u : solver.getState()) {
+        REQUIRE(u > 0.0);
+      }
+      return solver.getResidualEvaluations();
+    };
+    auto nEvalsUnpreconditioned{solve(false)};
+    auto nEvalsPreconditioned{solve(true)};
+    REQUIRE(nEvalsPreconditioned < nEvalsUnpreconditioned);
+  }
+}
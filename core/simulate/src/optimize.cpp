@@ -1,10 +1,16 @@
 #include "sme/optimize.hpp"
+#include "optimize_cache.hpp"
+#include "optimize_gradient.hpp"
 #include "optimize_impl.hpp"
+#include "optimize_surrogate.hpp"
+#include "optimize_workers.hpp"
 #include "sme/logger.hpp"
 #include "sme/model.hpp"
 #include "sme/utils.hpp"
+#include <QCryptographicHash>
 #include <fmt/core.h>
 #include <iostream>
+#include <oneapi/tbb/parallel_for.h>
 #include <pagmo/algorithms/bee_colony.hpp>
 #include <pagmo/algorithms/de.hpp>
 #include <pagmo/algorithms/de1220.hpp>
@@ -143,6 +149,139 @@ static FeatureOptCost resolveFeatureOptCost(const sme::model::Model &model,
   return featureOptCost;
 }
 
+std::string initOptConstData(OptConstData &optConstData,
+                             sme::model::Model &model) {
+  const auto &options{model.getOptimizeOptions()};
+  optConstData.imageSize = model.getGeometry().getImages().volume();
+  optConstData.xmlModel = model.getXml().toStdString();
+  optConstData.optimizeOptions = options;
+  optConstData.optTimesteps = getOptTimesteps(options);
+  optConstData.optParamSizes.clear();
+  for (const auto &optParam : options.optParams) {
+    optConstData.optParamSizes.push_back(getOptParamSize(model, optParam));
+  }
+  if (std::ranges::any_of(options.optCosts,
+                          [](const auto &c) { return c.weight < 0.0; })) {
+    // partial costs are only a lower bound if all weights are non-negative
+    SPDLOG_WARN("Negative cost weight: early termination disabled");
+    optConstData.optimizeOptions.optAlgorithm.earlyTerminationFactor = 0.0;
+  }
+  optConstData.featureOptCosts.resize(options.optCosts.size());
+  for (const auto &cost : options.optCosts) {
+    if (cost.targetValues.empty()) {
+      // empty vector is implicitly zero everywhere,
+      // use negative value here to allow rescaling of image to whatever the
+      // result is
+      optConstData.maxTargetValues.push_back(-1.0);
+    } else {
+      optConstData.maxTargetValues.push_back(
+          sme::common::max(cost.targetValues));
+    }
+  }
+  for (std::size_t i = 0; i < options.optCosts.size(); ++i) {
+    const auto &optCost = options.optCosts[i];
+    if (optCost.optCostType != OptCostType::Feature) {
+      continue;
+    }
+    optConstData.featureOptCosts[i] =
+        resolveFeatureOptCost(model, optCost, optConstData.imageSize);
+    if (!optConstData.featureOptCosts[i].valid) {
+      return optConstData.featureOptCosts[i].errorMessage;
+    }
+  }
+  return {};
+}
+
+static std::vector<double> resampleTarget(const std::vector<double> &values,
+                                          const common::Volume &size,
+                                          const common::Volume &newSize) {
+  // nearest neighbour, as used to downsample the geometry image
+  std::vector<double> resampled;
+  resampled.reserve(newSize.nVoxels());
+  auto sample = [](std::size_t i, std::size_t n, std::size_t newN) {
+    return std::min((2 * i + 1) * n / (2 * newN), n - 1);
+  };
+  for (std::size_t z = 0; z < newSize.depth(); ++z) {
+    for (int y = 0; y < newSize.height(); ++y) {
+      auto sy{sample(static_cast<std::size_t>(y),
+                     static_cast<std::size_t>(size.height()),
+                     static_cast<std::size_t>(newSize.height()))};
+      for (int x = 0; x < newSize.width(); ++x) {
+        auto sx{sample(static_cast<std::size_t>(x),
+                       static_cast<std::size_t>(size.width()),
+                       static_cast<std::size_t>(newSize.width()))};
+        resampled.push_back(values[sx + static_cast<std::size_t>(size.width()) *
+                                            (sy + static_cast<std::size_t>(
+                                                      size.height()) *
+                                                      z)]);
+      }
+    }
+  }
+  return resampled;
+}
+
+static std::unique_ptr<OptConstData>
+makeCoarseOptConstData(const OptConstData &optConstData, std::size_t factor) {
+  sme::model::Model model;
+  model.importSBMLString(optConstData.xmlModel);
+  // spatially varying species arrays can't be resampled
+  for (const auto &compartmentId : model.getCompartments().getIds()) {
+    for (const auto &id : model.getSpecies().getIds(compartmentId)) {
+      if (!model.getSpecies().getSampledFieldInitialAssignment(id).isEmpty() ||
+          !model.getSpecies().getField(id)->getIsUniformDiffusionConstant()) {
+        SPDLOG_WARN("Species '{}' has a spatially varying array: coarse "
+                    "geometry not supported",
+                    id.toStdString());
+        return nullptr;
+      }
+    }
+  }
+  auto &geometry{model.getGeometry()};
+  auto images{geometry.getImages()};
+  const auto size{images.volume()};
+  const int width{std::max(size.width() / static_cast<int>(factor), 1)};
+  const int height{std::max(size.height() / static_cast<int>(factor), 1)};
+  auto voxelSize{geometry.getVoxelSize()};
+  geometry.importGeometryFromImages(images.scaled(width, height), true);
+  geometry.setVoxelSize({voxelSize.width() * size.width() / width,
+                         voxelSize.height() * size.height() / height,
+                         voxelSize.depth()});
+  if (!geometry.getIsValid()) {
+    SPDLOG_WARN("Geometry is not valid when downsampled by a factor {}",
+                factor);
+    return nullptr;
+  }
+  const auto newSize{geometry.getImages().volume()};
+  for (auto &optCost : model.getOptimizeOptions().optCosts) {
+    if (!optCost.targetValues.empty()) {
+      optCost.targetValues =
+          resampleTarget(optCost.targetValues, size, newSize);
+    }
+  }
+  auto coarseOptConstData{std::make_unique<OptConstData>()};
+  if (auto error{initOptConstData(*coarseOptConstData, model)};
+      !error.empty()) {
+    SPDLOG_WARN("{}", error);
+    return nullptr;
+  }
+  return coarseOptConstData;
+}
+
+static std::string getFitnessCacheModelHash(const std::string &xmlModel) {
+  // the optimization algorithm options don't affect the fitness
+  sme::model::Model model;
+  model.importSBMLString(xmlModel);
+  model.getOptimizeOptions().optAlgorithm = {};
+  auto xml{model.getXml()};
+  // remove the comment with the version and time of creation
+  if (auto begin{xml.indexOf("<!-- Created by")}; begin >= 0) {
+    xml.remove(begin, xml.indexOf("-->", begin) + 3 - begin);
+  }
+  return QCryptographicHash::hash(xml.toUtf8(), QCryptographicHash::Sha256)
+      .toHex()
+      .toStdString();
+}
+
 static std::unique_ptr<pagmo::algorithm>
 getPagmoAlgorithm(sme::simulate::OptAlgorithmType optAlgorithmType) {
   // https://esa.github.io/pagmo2/docs/cpp/cpp_docs.html#implemented-algorithms
@@ -211,6 +350,16 @@ getPagmoAlgorithm(sme::simulate::OptAlgorithmType optAlgorithmType) {
     algo.set_maxeval(10);
     return std::make_unique<pagmo::algorithm>(std::move(algo));
   }
+  case Surrogate:
+    return std::make_unique<pagmo::algorithm>(
+        sme::simulate::SurrogateAlgorithm());
+  case LBFGS: {
+    // uses the gradient from the forward sensitivities of the simulation
+    auto algo = pagmo::nlopt("lbfgs");
+    algo.set_xtol_rel(0);
+    algo.set_maxeval(10);
+    return std::make_unique<pagmo::algorithm>(std::move(algo));
+  }
   default:
     SPDLOG_INFO("Unknown optimization algorithm: using PSO");
     return std::make_unique<pagmo::algorithm>(pagmo::pso());
@@ -229,13 +378,16 @@ std::size_t Optimization::finalizeEvolve(const std::string &newErrorMessage) {
   return nIterations;
 }
 
-Optimization::Optimization(sme::model::Model &model) {
+Optimization::Optimization(sme::model::Model &model,
+                           const OptWorkerOptions &workerOptions)
+    : fitnessCache{std::make_unique<OptFitnessCache>()} {
   const auto &options{model.getOptimizeOptions()};
 
   // nlopt algorithms can have population < 2, while the others do not.
   auto nloptAlgorithms = {OptAlgorithmType::COBYLA, OptAlgorithmType::BOBYQA,
                           OptAlgorithmType::NMS,    OptAlgorithmType::sbplx,
-                          OptAlgorithmType::AL,     OptAlgorithmType::PRAXIS};
+                          OptAlgorithmType::AL,     OptAlgorithmType::PRAXIS,
+                          OptAlgorithmType::LBFGS};
 
   if (options.optAlgorithm.population < 2 &&
       std::ranges::find(nloptAlgorithms,
@@ -244,41 +396,62 @@ Optimization::Optimization(sme::model::Model &model) {
     errorMessage = "Invalid optimization population size, can't be less than 2";
     return;
   }
-  optConstData = std::make_unique<sme::simulate::OptConstData>();
-  optConstData->imageSize = model.getGeometry().getImages().volume();
-  optConstData->xmlModel = model.getXml().toStdString();
-  optConstData->optimizeOptions = model.getOptimizeOptions();
-  optConstData->optTimesteps = getOptTimesteps(options);
-  optConstData->featureOptCosts.resize(
-      optConstData->optimizeOptions.optCosts.size());
-  for (const auto &cost : model.getOptimizeOptions().optCosts) {
-    if (cost.targetValues.empty()) {
-      // empty vector is implicitly zero everywhere,
-      // use negative value here to allow rescaling of image to whatever the
-      // result is
-      optConstData->maxTargetValues.push_back(-1.0);
-    } else {
-      optConstData->maxTargetValues.push_back(
-          sme::common::max(cost.targetValues));
+  if (double factor{options.optAlgorithm.earlyTerminationFactor};
+      factor != 0.0 && !(factor >= 1.0)) {
+    errorMessage = "Invalid early termination factor, must be zero or at "
+                   "least 1";
+    return;
+  }
+  if (options.optAlgorithm.coarseningFactor < 1) {
+    errorMessage = "Invalid coarsening factor, can't be less than 1";
+    return;
+  }
+  if (options.optAlgorithm.optAlgorithmType == OptAlgorithmType::LBFGS) {
+    errorMessage = checkCostGradientSupport(model, options);
+    if (!errorMessage.empty()) {
+      return;
     }
   }
-  for (std::size_t i = 0; i < optConstData->optimizeOptions.optCosts.size();
-       ++i) {
-    const auto &optCost = optConstData->optimizeOptions.optCosts[i];
-    if (optCost.optCostType != OptCostType::Feature) {
+  optConstData = std::make_unique<sme::simulate::OptConstData>();
+  errorMessage = initOptConstData(*optConstData, model);
+  if (!errorMessage.empty()) {
+    return;
+  }
+  // reduced resolution levels for multi-fidelity optimization
+  for (auto factor{options.optAlgorithm.coarseningFactor}; factor > 1;
+       factor /= 2) {
+    auto coarseOptConstData{makeCoarseOptConstData(*optConstData, factor)};
+    if (coarseOptConstData == nullptr) {
+      SPDLOG_WARN("Skipping factor {} coarser geometry", factor);
       continue;
     }
-    optConstData->featureOptCosts[i] =
-        resolveFeatureOptCost(model, optCost, optConstData->imageSize);
-    if (!optConstData->featureOptCosts[i].valid) {
-      errorMessage = optConstData->featureOptCosts[i].errorMessage;
-      return;
-    }
+    auto &coarseLevel{coarseLevels.emplace_back()};
+    coarseLevel.factor = factor;
+    coarseLevel.optConstData = std::move(coarseOptConstData);
+    coarseLevel.modelQueue =
+        std::make_unique<sme::simulate::ThreadsafeModelQueue>();
+    coarseLevel.workerModelIndex = coarseLevels.size();
   }
   modelQueue = std::make_unique<sme::simulate::ThreadsafeModelQueue>();
   algo = getPagmoAlgorithm(
       optConstData->optimizeOptions.optAlgorithm.optAlgorithmType);
-
+  if (workerOptions.count > 0) {
+    // the worker processes construct their own models
+    std::vector<std::string> xmlModels{optConstData->xmlModel};
+    for (const auto &coarseLevel : coarseLevels) {
+      xmlModels.push_back(coarseLevel.optConstData->xmlModel);
+    }
+    workerPool = std::make_unique<OptWorkerPool>(workerOptions, xmlModels);
+    errorMessage = workerPool->getErrorMessage();
+    return;
+  }
+  for (auto &coarseLevel : coarseLevels) {
+    for (std::size_t i = 0; i < options.optAlgorithm.islands; ++i) {
+      auto m{std::make_shared<sme::model::Model>()};
+      m->importSBMLString(coarseLevel.optConstData->xmlModel);
+      coarseLevel.modelQueue->push(std::move(m));
+    }
+  }
   // README: construct models in queue in serial for now to avoid libsbml thread
   // safety issues (see
   // https://github.com/spatial-model-editor/spatial-model-editor/issues/786)
@@ -292,6 +465,8 @@ Optimization::Optimization(sme::model::Model &model) {
   }
 }
 
+Optimization::~Optimization() = default;
+
 std::size_t Optimization::evolve(
     std::size_t n,
     const std::function<void(double, const std::vector<double> &)> &callback) {
@@ -313,26 +488,36 @@ std::size_t Optimization::evolve(
           optConstData->optimizeOptions.optAlgorithm.population);
     } catch (const std::invalid_argument &e) {
       return finalizeEvolve(e.what());
+    } catch (const std::runtime_error &e) {
+      return finalizeEvolve(e.what());
     }
     {
       std::scoped_lock lock{resultsMutex};
       appendBestFitnesssAndParams(*archi, bestFitness, bestParams);
+      bestCoarseningFactors.push_back(getCoarseningFactor());
+      previousCoarseFitness = bestFitness.back();
     }
   }
   SPDLOG_INFO("Starting {} {} evolve steps", n, algo->get_name());
   // ensure output vectors won't re-allocate during evolution
   bestFitness.reserve(bestFitness.size() + n);
   bestParams.reserve(bestParams.size() + n);
+  bestCoarseningFactors.reserve(bestCoarseningFactors.size() + n);
   for (std::size_t i = 0; i < n; ++i) {
     try {
       archi->evolve();
       archi->wait_check();
+      {
+        std::scoped_lock lock{resultsMutex};
+        appendBestFitnesssAndParams(*archi, bestFitness, bestParams);
+        bestCoarseningFactors.push_back(getCoarseningFactor());
+      }
+      updateFidelity();
     } catch (const std::invalid_argument &e) {
       return finalizeEvolve(e.what());
-    }
-    {
-      std::scoped_lock lock{resultsMutex};
-      appendBestFitnesssAndParams(*archi, bestFitness, bestParams);
+    } catch (const std::runtime_error &e) {
+      // a worker process failed
+      return finalizeEvolve(e.what());
     }
     if (callback) {
       double fitness{};
@@ -354,6 +539,50 @@ std::size_t Optimization::evolve(
   return finalizeEvolve();
 }
 
+void Optimization::updateFidelity() {
+  if (coarseLevelIndex.load() >= coarseLevels.size()) {
+    return;
+  }
+  // move to the next finer level once the best fitness stops improving
+  constexpr double minRelativeImprovement{1e-2};
+  double fitness{};
+  {
+    std::scoped_lock lock{resultsMutex};
+    fitness = bestFitness.back();
+  }
+  if (fitness < (1.0 - minRelativeImprovement) * previousCoarseFitness) {
+    previousCoarseFitness = fitness;
+    return;
+  }
+  ++coarseLevelIndex;
+  previousCoarseFitness = std::numeric_limits<double>::max();
+  {
+    std::scoped_lock lock{coarseFitnessMutex};
+    bestCoarseFitness = std::numeric_limits<double>::max();
+  }
+  SPDLOG_INFO("Increasing resolution: coarsening factor {}",
+              getCoarseningFactor());
+  // fitness values are not comparable between levels, so discard the points
+  // evaluated by the surrogate (shared by all the islands), and re-evaluate
+  // the populations at the new resolution
+  if (archi->size() > 0) {
+    auto algorithm{(*archi)[0].get_algorithm()};
+    if (auto *surrogate{algorithm.extract<SurrogateAlgorithm>()};
+        surrogate != nullptr) {
+      surrogate->clearArchive();
+    }
+  }
+  oneapi::tbb::parallel_for(std::size_t{0}, archi->size(), [this](auto i) {
+    auto &island{(*archi)[i]};
+    auto pop{island.get_population()};
+    pagmo::population newPop(pop.get_problem(), 0, pop.get_seed());
+    for (const auto &x : pop.get_x()) {
+      newPop.push_back(x);
+    }
+    island.set_population(newPop);
+  });
+}
+
 bool Optimization::applyParametersToModel(sme::model::Model *model) const {
   std::scoped_lock lock{resultsMutex};
   if (bestParams.empty()) {
@@ -383,9 +612,17 @@ double Optimization::getMaxValue(std::size_t index) {
 
 std::vector<std::string> Optimization::getParamNames() const {
   std::vector<std::string> names;
-  names.reserve(optConstData->optimizeOptions.optParams.size());
-  for (const auto &optParam : optConstData->optimizeOptions.optParams) {
-    names.push_back(optParam.name);
+  const auto &optParams{optConstData->optimizeOptions.optParams};
+  for (std::size_t i = 0; i < optParams.size(); ++i) {
+    const auto size{optConstData->optParamSizes[i]};
+    if (size == 1) {
+      names.push_back(optParams[i].name);
+      continue;
+    }
+    // one value for each voxel of a diffusion constant field
+    for (std::size_t ix = 0; ix < size; ++ix) {
+      names.push_back(fmt::format("{} [{}]", optParams[i].name, ix));
+    }
   }
   return names;
 }
@@ -395,6 +632,11 @@ std::vector<double> Optimization::getFitness() const {
   return bestFitness;
 }
 
+std::vector<std::size_t> Optimization::getCoarseningFactors() const {
+  std::scoped_lock lock{resultsMutex};
+  return bestCoarseningFactors;
+}
+
 common::ImageStack Optimization::getDifferenceImage(std::size_t index) {
 
   auto size = getImageSize();
@@ -429,6 +671,55 @@ bool Optimization::setBestResults(double fitness,
   return false;
 }
 
+double Optimization::getBestResultsFitness() const {
+  std::scoped_lock lock{bestResultsMutex};
+  return bestResults.fitness;
+}
+
+const OptCoarseLevel *Optimization::getCoarseLevel() const {
+  if (auto i{coarseLevelIndex.load()}; i < coarseLevels.size()) {
+    return &coarseLevels[i];
+  }
+  return nullptr;
+}
+
+std::size_t Optimization::getCoarseningFactor() const {
+  const auto *coarseLevel{getCoarseLevel()};
+  return coarseLevel == nullptr ? 1 : coarseLevel->factor;
+}
+
+bool Optimization::setBestCoarseFitness(double fitness) {
+  std::scoped_lock lock{coarseFitnessMutex};
+  if (fitness < bestCoarseFitness) {
+    bestCoarseFitness = fitness;
+    return true;
+  }
+  return false;
+}
+
+double Optimization::getBestCoarseFitness() const {
+  std::scoped_lock lock{coarseFitnessMutex};
+  return bestCoarseFitness;
+}
+
+OptWorkerPool *Optimization::getWorkerPool() const { return workerPool.get(); }
+
+OptFitnessCache *Optimization::getFitnessCache() const {
+  return fitnessCache.get();
+}
+
+bool Optimization::setFitnessCacheFile(const std::string &filename) {
+  if (optConstData == nullptr) {
+    return false;
+  }
+  if (auto modelHash{getFitnessCacheModelHash(optConstData->xmlModel)};
+      !fitnessCache->setFile(filename, modelHash)) {
+    errorMessage = fitnessCache->getErrorMessage();
+    return false;
+  }
+  return true;
+}
+
 common::ImageStack Optimization::getTargetImage(std::size_t index) const {
   return common::ImageStack(
       optConstData->imageSize,
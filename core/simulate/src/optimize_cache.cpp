@@ -0,0 +1,138 @@
+#include "optimize_cache.hpp"
+#include "sme/logger.hpp"
+#include <algorithm>
+#include <fmt/core.h>
+#include <mutex>
+
+namespace sme::simulate {
+
+// File format, one entry per line:
+//  - header: "sme-fitness-cache <significantDigits> <modelHash>"
+//  - entry: "<fitness> <factor> <p_1> ... <p_n>"
+
+OptFitnessCache::OptFitnessCache(int significantDigits)
+    : significantDigits{std::max(significantDigits, 1)} {}
+
+std::string OptFitnessCache::toKey(std::size_t factor,
+                                   const pagmo::vector_double &dv) const {
+  std::string key{fmt::format("{}", factor)};
+  for (double p : dv) {
+    // +0 and -0 are the same parameter value
+    key.append(fmt::format(" {:.{}e}", p == 0.0 ? 0.0 : p,
+                           significantDigits - 1));
+  }
+  return key;
+}
+
+bool OptFitnessCache::setFile(const std::string &filename,
+                              const std::string &modelHash) {
+  std::unique_lock lock{mutex};
+  if (file.isOpen()) {
+    file.close();
+  }
+  errorMessage.clear();
+  const QByteArray header{
+      fmt::format("sme-fitness-cache {} {}\n", significantDigits, modelHash)
+          .c_str()};
+  file.setFileName(filename.c_str());
+  if (file.exists()) {
+    if (!file.open(QIODevice::ReadOnly)) {
+      errorMessage = fmt::format("Failed to read fitness cache file '{}'",
+                                 filename);
+      return false;
+    }
+    if (file.readLine() != header) {
+      errorMessage = fmt::format(
+          "Fitness cache file '{}' was created for a different model",
+          filename);
+      file.close();
+      return false;
+    }
+    qint64 validBytes{file.pos()};
+    std::size_t nLoaded{0};
+    while (!file.atEnd()) {
+      auto line{file.readLine()};
+      if (!line.endsWith('\n')) {
+        // incomplete entry, e.g. from a crash during a write
+        break;
+      }
+      auto separator{line.indexOf(' ')};
+      if (separator <= 0) {
+        break;
+      }
+      bool valid{false};
+      double fitness{line.left(separator).toDouble(&valid)};
+      if (!valid) {
+        break;
+      }
+      values.insert_or_assign(line.mid(separator + 1).trimmed().toStdString(),
+                              fitness);
+      validBytes = file.pos();
+      ++nLoaded;
+    }
+    file.close();
+    if (validBytes < file.size()) {
+      SPDLOG_WARN("Ignoring invalid entries at end of fitness cache file");
+      file.resize(validBytes);
+    }
+    SPDLOG_INFO("Loaded {} fitness values from '{}'", nLoaded, filename);
+  }
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+    errorMessage =
+        fmt::format("Failed to write fitness cache file '{}'", filename);
+    return false;
+  }
+  if (file.size() == 0) {
+    file.write(header);
+    file.flush();
+  }
+  return true;
+}
+
+std::optional<double> OptFitnessCache::find(std::size_t factor,
+                                             const pagmo::vector_double &dv) {
+  auto key{toKey(factor, dv)};
+  std::shared_lock lock{mutex};
+  if (auto iter{values.find(key)}; iter != values.cend()) {
+    ++hits;
+    SPDLOG_DEBUG("Using cached fitness {} for '{}'", iter->second, key);
+    return iter->second;
+  }
+  return {};
+}
+
+std::optional<double>
+OptFitnessCache::peek(std::size_t factor,
+                      const pagmo::vector_double &dv) const {
+  auto key{toKey(factor, dv)};
+  std::shared_lock lock{mutex};
+  if (auto iter{values.find(key)}; iter != values.cend()) {
+    return iter->second;
+  }
+  return {};
+}
+
+void OptFitnessCache::insert(std::size_t factor,
+                             const pagmo::vector_double &dv, double fitness) {
+  auto key{toKey(factor, dv)};
+  std::unique_lock lock{mutex};
+  if (!values.insert_or_assign(key, fitness).second || !file.isOpen()) {
+    return;
+  }
+  file.write(fmt::format("{:.17g} {}\n", fitness, key).c_str());
+  // write each entry to the OS, so it survives the process being killed
+  file.flush();
+}
+
+std::size_t OptFitnessCache::size() const {
+  std::shared_lock lock{mutex};
+  return values.size();
+}
+
+std::size_t OptFitnessCache::getHits() const { return hits.load(); }
+
+const std::string &OptFitnessCache::getErrorMessage() const {
+  return errorMessage;
+}
+
+} // namespace sme::simulate
@@ -0,0 +1,86 @@
+// Optimization fitness cache
+//  - OptFitnessCache: thread-safe cache of evaluated fitness values
+
+#pragma once
+
+#include <QFile>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <pagmo/types.hpp>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+namespace sme::simulate {
+
+/**
+ * @brief Thread-safe cache of optimization fitness values
+ *
+ * The fitness values are stored for each coarsening factor, with the
+ * parameters rounded to a number of significant digits, so that parameters
+ * that are identical up to rounding errors share a fitness value. The values
+ * can optionally also be appended to a file, to be reused by a later
+ * optimization of the same model.
+ */
+class OptFitnessCache {
+public:
+  /**
+   * @brief Construct an empty cache
+   *
+   * @param[in] significantDigits the number of significant digits of each
+   * parameter that are compared
+   */
+  explicit OptFitnessCache(int significantDigits = 12);
+  /**
+   * @brief Load and append fitness values to a file
+   *
+   * If the file exists, it must have been created for the same
+   * ``modelHash``, and the fitness values it contains are added to the cache.
+   * Any incomplete value at the end of the file is ignored.
+   *
+   * @returns ``false`` if the file can't be used
+   */
+  bool setFile(const std::string &filename, const std::string &modelHash);
+  /**
+   * @brief The cached fitness for parameters ``dv`` at coarsening ``factor``
+   */
+  [[nodiscard]] std::optional<double> find(std::size_t factor,
+                                           const pagmo::vector_double &dv);
+  /**
+   * @brief The cached fitness, without counting it as a hit
+   *
+   * For internal lookups, whose value is not returned as a fitness.
+   */
+  [[nodiscard]] std::optional<double>
+  peek(std::size_t factor, const pagmo::vector_double &dv) const;
+  /**
+   * @brief Add the fitness for parameters ``dv`` at coarsening ``factor``
+   */
+  void insert(std::size_t factor, const pagmo::vector_double &dv,
+              double fitness);
+  /**
+   * @brief The number of cached fitness values
+   */
+  [[nodiscard]] std::size_t size() const;
+  /**
+   * @brief The number of calls to find() that returned a cached value
+   */
+  [[nodiscard]] std::size_t getHits() const;
+  /**
+   * @brief Returns a message if the file couldn't be used
+   */
+  [[nodiscard]] const std::string &getErrorMessage() const;
+
+private:
+  int significantDigits;
+  mutable std::shared_mutex mutex;
+  std::unordered_map<std::string, double> values{};
+  std::atomic<std::size_t> hits{0};
+  QFile file{};
+  std::string errorMessage{};
+  [[nodiscard]] std::string toKey(std::size_t factor,
+                                  const pagmo::vector_double &dv) const;
+};
+
+} // namespace sme::simulate
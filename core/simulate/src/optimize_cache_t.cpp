@@ -0,0 +1,129 @@
+#include "catch_wrapper.hpp"
+#include "model_test_utils.hpp"
+#include "optimize_cache.hpp"
+#include "sme/model.hpp"
+#include "sme/optimize.hpp"
+#include <QFile>
+
+using namespace sme;
+using namespace sme::test;
+
+TEST_CASE("Optimization fitness cache",
+          "[core/simulate/optimize_cache][core/simulate][core][optimize]") {
+  const char *filename{"tmp_fitness_cache.txt"};
+  QFile::remove(filename);
+  SECTION("in memory") {
+    simulate::OptFitnessCache cache(6);
+    REQUIRE(cache.size() == 0);
+    REQUIRE(!cache.find(1, {0.1, 2.0}).has_value());
+    cache.insert(1, {0.1, 2.0}, 3.5);
+    REQUIRE(cache.size() == 1);
+    REQUIRE(cache.find(1, {0.1, 2.0}).value() == dbl_approx(3.5));
+    // equal to 6 significant digits
+    REQUIRE(cache.find(1, {0.1 + 1e-12, 2.0 - 1e-12}).value() ==
+            dbl_approx(3.5));
+    REQUIRE(!cache.find(1, {0.1001, 2.0}).has_value());
+    // different coarsening factor
+    REQUIRE(!cache.find(2, {0.1, 2.0}).has_value());
+    cache.insert(2, {0.1, 2.0}, 1.5);
+    REQUIRE(cache.find(2, {0.1, 2.0}).value() == dbl_approx(1.5));
+    // +0 and -0 are the same
+    cache.insert(1, {0.0}, 7.0);
+    REQUIRE(cache.find(1, {-0.0}).value() == dbl_approx(7.0));
+    REQUIRE(cache.size() == 3);
+    REQUIRE(cache.getHits() == 4);
+    // peek is not counted as a hit
+    REQUIRE(cache.peek(1, {0.1, 2.0}).value() == dbl_approx(3.5));
+    REQUIRE(!cache.peek(1, {0.2, 2.0}).has_value());
+    REQUIRE(cache.getHits() == 4);
+  }
+  SECTION("file") {
+    {
+      simulate::OptFitnessCache cache;
+      REQUIRE(cache.setFile(filename, "abc"));
+      cache.insert(1, {0.1, 2.0}, 3.5);
+      cache.insert(4, {0.2, 2.0}, 1.25);
+    }
+    {
+      // values are loaded from the file
+      simulate::OptFitnessCache cache;
+      REQUIRE(cache.setFile(filename, "abc"));
+      REQUIRE(cache.size() == 2);
+      REQUIRE(cache.find(1, {0.1, 2.0}).value() == dbl_approx(3.5));
+      REQUIRE(cache.find(4, {0.2, 2.0}).value() == dbl_approx(1.25));
+      // new values are appended
+      cache.insert(1, {0.3, 2.0}, 9.0);
+    }
+    {
+      // incomplete value at end of file is ignored
+      QFile f(filename);
+      REQUIRE(f.open(QIODevice::WriteOnly | QIODevice::Append));
+      f.write("1.0 1 0.4");
+    }
+    {
+      simulate::OptFitnessCache cache;
+      REQUIRE(cache.setFile(filename, "abc"));
+      REQUIRE(cache.size() == 3);
+      REQUIRE(cache.find(1, {0.3, 2.0}).value() == dbl_approx(9.0));
+      cache.insert(1, {0.4, 2.0}, 0.5);
+    }
+    {
+      simulate::OptFitnessCache cache;
+      REQUIRE(cache.setFile(filename, "abc"));
+      REQUIRE(cache.size() == 4);
+      REQUIRE(cache.find(1, {0.4, 2.0}).value() == dbl_approx(0.5));
+    }
+    {
+      // file from a different model can't be used
+      simulate::OptFitnessCache cache;
+      REQUIRE(!cache.setFile(filename, "def"));
+      REQUIRE(!cache.getErrorMessage().empty());
+      REQUIRE(cache.size() == 0);
+    }
+  }
+  SECTION("optimization") {
+    auto model{getExampleModel(Mod::ABtoC)};
+    model.getSimulationSettings().simulatorType =
+        sme::simulate::SimulatorType::Pixel;
+    auto &optimizeOptions{model.getOptimizeOptions()};
+    optimizeOptions.optAlgorithm.islands = 1;
+    optimizeOptions.optAlgorithm.population = 3;
+    optimizeOptions.optParams.push_back(
+        {sme::simulate::OptParamType::ReactionParameter, "name", "k1", "r1",
+         0.02, 0.88});
+    optimizeOptions.optCosts.push_back(
+        {sme::simulate::OptCostType::Concentration,
+         simulate::OptCostDiffType::Absolute,
+         "name",
+         "C",
+         1.0,
+         0.23,
+         0,
+         2,
+         {}});
+    std::size_t nCached{0};
+    {
+      simulate::Optimization optimization(model);
+      REQUIRE(optimization.setFitnessCacheFile(filename));
+      optimization.evolve(2);
+      REQUIRE(optimization.getErrorMessage().empty());
+      nCached = optimization.getFitnessCache()->size();
+      REQUIRE(nCached >= 3);
+    }
+    // changing the algorithm options doesn't invalidate the file
+    optimizeOptions.optAlgorithm.population = 4;
+    {
+      simulate::Optimization optimization(model);
+      REQUIRE(optimization.setFitnessCacheFile(filename));
+      REQUIRE(optimization.getFitnessCache()->size() == nCached);
+    }
+    // changing the model does
+    model.getSpecies().setDiffusionConstant("A", 0.123);
+    {
+      simulate::Optimization optimization(model);
+      REQUIRE(!optimization.setFitnessCacheFile(filename));
+      REQUIRE(!optimization.getErrorMessage().empty());
+    }
+  }
+  QFile::remove(filename);
+}
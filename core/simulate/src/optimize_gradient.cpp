@@ -0,0 +1,1077 @@
+#include "optimize_gradient.hpp"
+#include "optimize_impl.hpp"
+#include "pixelsim.hpp"
+#include "sme/geometry.hpp"
+#include "sme/logger.hpp"
+#include "sme/simple_symbolic.hpp"
+#include "sme/symbolic.hpp"
+#include "sme/voxel.hpp"
+#include <QString>
+#include <QStringList>
+#include <algorithm>
+#include <cmath>
+#include <fmt/core.h>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace sme::simulate {
+
+namespace {
+
+// README: libsbml is not thread safe when constructing models (see
+// https://github.com/spatial-model-editor/spatial-model-editor/issues/786)
+std::mutex modelConstructionMutex;
+
+// the simulated species of a compartment, and their sensitivities
+struct SensitivityCompartment {
+  std::string id{};
+  const geometry::Compartment *compartment{nullptr};
+  // the simulated species, followed by the sensitivity species
+  std::vector<std::string> speciesIds{};
+  // the number of simulated species
+  std::size_t nSpecies{0};
+  // the index in speciesIds of the sensitivity of each species to each
+  // parameter, or {} if it is always zero
+  std::vector<std::vector<std::optional<std::size_t>>> sensitivityIndices{};
+};
+
+void copySpeciesProperties(model::ModelSpecies &species, const QString &id,
+                           const QString &newId) {
+  species.setIsSpatial(newId, species.getIsSpatial(id));
+  species.setStorage(newId, species.getStorage(id));
+  switch (species.getDiffusionConstantType(id)) {
+  case model::SpatialDataType::Analytic:
+    species.setAnalyticDiffusionConstant(
+        newId, species.getAnalyticDiffusionConstant(id));
+    break;
+  case model::SpatialDataType::Image:
+    species.setSampledFieldDiffusionConstant(
+        newId, species.getSampledFieldDiffusionConstant(id));
+    break;
+  default:
+    species.setDiffusionConstant(newId, species.getDiffusionConstant(id));
+  }
+}
+
+// the id of the parameter in the rate expression of a reaction, if it has one
+std::optional<std::string>
+getParameterSymbol(const OptParam &optParam, const QString &reactionId,
+                   const QStringList &localParameterIds) {
+  const auto id{QString::fromStdString(optParam.id)};
+  if (optParam.optParamType == OptParamType::ModelParameter &&
+      !localParameterIds.contains(id)) {
+    return optParam.id;
+  }
+  if (optParam.optParamType == OptParamType::ReactionParameter &&
+      optParam.parentId == reactionId.toStdString()) {
+    return optParam.id;
+  }
+  return {};
+}
+
+void addSensitivityReactions(
+    model::Model &model, const std::vector<OptParam> &optParams,
+    const model::ReactionLocation &location,
+    const std::vector<const SensitivityCompartment *> &compartments) {
+  auto &reactions{model.getReactions()};
+  for (const auto &reactionId : reactions.getIds(location.id)) {
+    const auto rate{model.inlineExpr(
+        reactions.getRateExpression(reactionId).toStdString())};
+    const auto localParameterIds{reactions.getParameterIds(reactionId)};
+    // local parameter ids are only valid in the original reaction, so their
+    // values are substituted into the sensitivity reactions
+    std::vector<std::pair<std::string, double>> localParameters;
+    for (const auto &localParameterId : localParameterIds) {
+      localParameters.emplace_back(
+          localParameterId.toStdString(),
+          reactions.getParameterValue(reactionId, localParameterId));
+    }
+    for (std::size_t iParam = 0; iParam < optParams.size(); ++iParam) {
+      // d(rate)/d(param) = sum_j d(rate)/d(c_j) s_j + partial d(rate)/d(param)
+      std::vector<std::string> variables;
+      std::vector<std::string> sensitivityIds;
+      for (const auto *compartment : compartments) {
+        for (std::size_t is = 0; is < compartment->nSpecies; ++is) {
+          if (const auto &index{compartment->sensitivityIndices[iParam][is]};
+              index.has_value()) {
+            variables.push_back(compartment->speciesIds[is]);
+            sensitivityIds.push_back(compartment->speciesIds[*index]);
+          }
+        }
+      }
+      auto paramSymbol{
+          getParameterSymbol(optParams[iParam], reactionId, localParameterIds)};
+      if (paramSymbol.has_value()) {
+        variables.push_back(*paramSymbol);
+      }
+      common::Symbolic sym(rate, variables, {}, {}, true);
+      if (!sym.isValid()) {
+        throw std::invalid_argument(sym.getErrorMessage());
+      }
+      std::string expr;
+      auto addTerm = [&expr, &reactionId](const std::string &derivative,
+                                          const std::string &factor) {
+        if (derivative == "0") {
+          return;
+        }
+        if (derivative.find("Derivative") != std::string::npos) {
+          throw std::invalid_argument(fmt::format(
+              "Optimization: can't differentiate rate of reaction '{}'",
+              reactionId.toStdString()));
+        }
+        expr.append(fmt::format(" + ({}){}", derivative, factor));
+      };
+      for (std::size_t i = 0; i < sensitivityIds.size(); ++i) {
+        addTerm(sym.diff(variables[i]), fmt::format("*{}", sensitivityIds[i]));
+      }
+      if (paramSymbol.has_value()) {
+        addTerm(sym.diff(*paramSymbol), "");
+      }
+      if (expr.empty()) {
+        continue;
+      }
+      common::Symbolic sensitivityRate(expr, {}, localParameters, {}, true);
+      if (!sensitivityRate.isValid()) {
+        throw std::invalid_argument(sensitivityRate.getErrorMessage());
+      }
+      reactions.add(QString("%1 sensitivity %2")
+                        .arg(reactions.getName(reactionId))
+                        .arg(iParam),
+                    location.id);
+      const auto sensitivityReactionId{reactions.getIds(location.id).back()};
+      for (std::size_t i = 0; i < sensitivityIds.size(); ++i) {
+        if (double stoich{reactions.getSpeciesStoichiometry(
+                reactionId, variables[i].c_str())};
+            stoich != 0.0) {
+          reactions.setSpeciesStoichiometry(
+              sensitivityReactionId, sensitivityIds[i].c_str(), stoich);
+        }
+      }
+      reactions.setRateExpression(sensitivityReactionId,
+                                  sensitivityRate.inlinedExpr().c_str());
+    }
+  }
+}
+
+std::vector<SensitivityCompartment>
+addSensitivities(model::Model &model, const std::vector<OptParam> &optParams) {
+  std::vector<SensitivityCompartment> compartments;
+  auto &species{model.getSpecies()};
+  // same compartment and species ordering as Simulation
+  for (const auto &compartmentId : model.getCompartments().getIds()) {
+    SensitivityCompartment compartment;
+    for (const auto &speciesId : species.getIds(compartmentId)) {
+      if (species.isSimulatedSpecies(speciesId)) {
+        compartment.speciesIds.push_back(speciesId.toStdString());
+      }
+    }
+    if (compartment.speciesIds.empty()) {
+      continue;
+    }
+    compartment.id = compartmentId.toStdString();
+    compartment.compartment =
+        model.getCompartments().getCompartment(compartmentId);
+    compartment.nSpecies = compartment.speciesIds.size();
+    compartment.sensitivityIndices.resize(optParams.size());
+    for (std::size_t iParam = 0; iParam < optParams.size(); ++iParam) {
+      auto &indices{compartment.sensitivityIndices[iParam]};
+      indices.resize(compartment.nSpecies);
+      for (std::size_t is = 0; is < compartment.nSpecies; ++is) {
+        const QString speciesId{compartment.speciesIds[is].c_str()};
+        if (!species.isReactive(speciesId)) {
+          continue;
+        }
+        species.add(QString("%1 sensitivity %2")
+                        .arg(species.getName(speciesId))
+                        .arg(iParam),
+                    compartmentId);
+        const auto sensitivityId{species.getIds(compartmentId).back()};
+        copySpeciesProperties(species, speciesId, sensitivityId);
+        indices[is] = compartment.speciesIds.size();
+        compartment.speciesIds.push_back(sensitivityId.toStdString());
+      }
+    }
+    compartments.push_back(std::move(compartment));
+  }
+  auto findCompartment =
+      [&compartments](
+          const std::string &compartmentId) -> const SensitivityCompartment * {
+    for (const auto &compartment : compartments) {
+      if (compartment.id == compartmentId) {
+        return &compartment;
+      }
+    }
+    return nullptr;
+  };
+  for (const auto &location : model.getReactions().getReactionLocations()) {
+    std::vector<const SensitivityCompartment *> locationCompartments;
+    if (location.type == model::ReactionLocation::Type::Compartment) {
+      locationCompartments.push_back(
+          findCompartment(location.id.toStdString()));
+    } else if (location.type == model::ReactionLocation::Type::Membrane) {
+      const auto *membrane{model.getMembranes().getMembrane(location.id)};
+      locationCompartments.push_back(
+          findCompartment(membrane->getCompartmentA()->getId()));
+      locationCompartments.push_back(
+          findCompartment(membrane->getCompartmentB()->getId()));
+    }
+    std::erase(locationCompartments, nullptr);
+    if (locationCompartments.empty()) {
+      continue;
+    }
+    addSensitivityReactions(model, optParams, location, locationCompartments);
+  }
+  return compartments;
+}
+
+// returns the concentration cost, and sets the concentration values of the
+// target and the derivative of the cost with respect to the concentration in
+// each voxel of the compartment
+double concentrationCostDerivative(const OptCost &optCost,
+                                   const geometry::Compartment *compartment,
+                                   const std::vector<double> &conc,
+                                   std::size_t stride,
+                                   const common::Volume &imageSize,
+                                   std::vector<double> &values,
+                                   std::vector<double> &dcost) {
+  values.assign(static_cast<std::size_t>(imageSize.nVoxels()), 0.0);
+  const auto nPixels{compartment->nVoxels()};
+  std::vector<std::size_t> arrayIndices(nPixels);
+  for (std::size_t ix = 0; ix < nPixels; ++ix) {
+    arrayIndices[ix] =
+        common::voxelArrayIndex(imageSize, compartment->getVoxel(ix), true);
+    values[arrayIndices[ix]] = conc[ix * stride + optCost.speciesIndex];
+  }
+  double cost{calculateFieldCost(optCost, values)};
+  dcost.resize(nPixels);
+  for (std::size_t ix = 0; ix < nPixels; ++ix) {
+    const auto i{arrayIndices[ix]};
+    if (optCost.targetValues.empty()) {
+      dcost[ix] = 2.0 * values[i];
+      continue;
+    }
+    dcost[ix] = 2.0 * (values[i] - optCost.targetValues[i]);
+    if (optCost.optCostDiffType == OptCostDiffType::Relative) {
+      double scale{std::abs(optCost.targetValues[i]) + optCost.epsilon};
+      dcost[ix] /= scale * scale;
+    }
+  }
+  return cost;
+}
+
+// returns the concentration cost, and sets the concentration values of the
+// target and the derivative of the cost with respect to each parameter
+double concentrationCostGradient(const OptCost &optCost,
+                                 const SensitivityCompartment &compartment,
+                                 const std::vector<double> &conc,
+                                 std::size_t stride,
+                                 const common::Volume &imageSize,
+                                 std::vector<double> &values,
+                                 pagmo::vector_double &gradient) {
+  std::vector<double> dcost;
+  double cost{concentrationCostDerivative(optCost, compartment.compartment,
+                                          conc, stride, imageSize, values,
+                                          dcost)};
+  for (std::size_t iParam = 0; iParam < gradient.size(); ++iParam) {
+    gradient[iParam] = 0.0;
+    const auto &index{
+        compartment.sensitivityIndices[iParam][optCost.speciesIndex]};
+    if (!index.has_value()) {
+      continue;
+    }
+    for (std::size_t ix = 0; ix < dcost.size(); ++ix) {
+      gradient[iParam] += dcost[ix] * conc[ix * stride + *index];
+    }
+  }
+  return cost;
+}
+
+std::optional<SimulatedCostGradient>
+simulateCostGradientSensitivities(const OptConstData &optConstData,
+                                  const pagmo::vector_double &dv,
+                                  const std::function<bool()> &isStopping) {
+  const auto &options{optConstData.optimizeOptions};
+  auto model{std::make_unique<sme::model::Model>()};
+  std::vector<SensitivityCompartment> compartments;
+  {
+    std::scoped_lock lock{modelConstructionMutex};
+    model->importSBMLString(optConstData.xmlModel);
+    applyParameters(dv, model.get());
+    if (auto error{checkCostGradientSupport(*model, options)};
+        !error.empty()) {
+      throw std::invalid_argument(error);
+    }
+    compartments = addSensitivities(*model, options.optParams);
+  }
+  std::vector<std::string> compartmentIds;
+  std::vector<std::vector<std::string>> compartmentSpeciesIds;
+  std::set<std::string, std::less<>> sensitivityIds;
+  for (const auto &compartment : compartments) {
+    compartmentIds.push_back(compartment.id);
+    compartmentSpeciesIds.push_back(compartment.speciesIds);
+    auto firstSensitivity{compartment.speciesIds.cbegin() +
+                          static_cast<std::ptrdiff_t>(compartment.nSpecies)};
+    sensitivityIds.insert(firstSensitivity, compartment.speciesIds.cend());
+  }
+  PixelSim sim(*model, compartmentIds, compartmentSpeciesIds, {},
+               sensitivityIds);
+  if (!sim.errorMessage().empty()) {
+    throw std::runtime_error(sim.errorMessage());
+  }
+  SimulatedCostGradient result{0.0, pagmo::vector_double(dv.size(), 0.0),
+                               std::vector<std::vector<double>>(
+                                   options.optCosts.size())};
+  pagmo::vector_double optCostGradient(dv.size(), 0.0);
+  for (const auto &optTimestep : optConstData.optTimesteps) {
+    sim.run(optTimestep.simulationTime, -1, isStopping);
+    if (isStopping()) {
+      return {};
+    }
+    if (!sim.errorMessage().empty()) {
+      throw std::runtime_error(sim.errorMessage());
+    }
+    // same weighting as calculateCosts()
+    double cost{0.0};
+    pagmo::vector_double gradient(dv.size(), 0.0);
+    for (auto optCostIndex : optTimestep.optCostIndices) {
+      const auto &optCost{options.optCosts[optCostIndex]};
+      const auto &compartment{compartments.at(optCost.compartmentIndex)};
+      const std::size_t stride{compartment.speciesIds.size() +
+                               sim.getConcentrationPadding()};
+      cost += concentrationCostGradient(
+          optCost, compartment, sim.getConcentrations(optCost.compartmentIndex),
+          stride, optConstData.imageSize, result.targets[optCostIndex],
+          optCostGradient);
+      cost *= optCost.weight;
+      for (std::size_t i = 0; i < gradient.size(); ++i) {
+        gradient[i] = (gradient[i] + optCostGradient[i]) * optCost.weight;
+      }
+    }
+    result.cost += cost;
+    for (std::size_t i = 0; i < gradient.size(); ++i) {
+      result.gradient[i] += gradient[i];
+    }
+  }
+  SPDLOG_DEBUG("Cost {} with gradient {}", result.cost,
+               common::vectorToString(result.gradient));
+  return result;
+}
+
+// the simulated species of a compartment, their adjoints, and the gradient of
+// the cost with respect to each parameter
+struct AdjointCompartment {
+  std::string id{};
+  const geometry::Compartment *compartment{nullptr};
+  // the simulated species, followed by their adjoints, followed by one
+  // gradient species for each parameter
+  std::vector<std::string> speciesIds{};
+  // the number of simulated species
+  std::size_t nSpecies{0};
+  // the storage of each simulated species
+  std::vector<double> storage{};
+  std::vector<std::size_t> nonSpatialSpeciesIndices{};
+  // the position of the compartment in the forward and adjoint simulation
+  // states
+  std::size_t offset{0};
+  std::size_t stride{0};
+  std::size_t adjointOffset{0};
+  std::size_t adjointStride{0};
+};
+
+// for each reaction in a location, adds reactions that calculate the discrete
+// adjoint J^T lambda, and the derivative of the cost with respect to each
+// parameter, where the adjoint species lambda_i / S_i multiplies each rate
+void addAdjointReactions(
+    model::Model &model, const std::vector<OptParam> &optParams,
+    const model::ReactionLocation &location,
+    const std::vector<const AdjointCompartment *> &compartments) {
+  auto &reactions{model.getReactions()};
+  const auto &species{model.getSpecies()};
+  std::vector<std::string> variables;
+  std::vector<std::string> adjointIds;
+  std::vector<double> storage;
+  for (const auto *compartment : compartments) {
+    for (std::size_t is = 0; is < compartment->nSpecies; ++is) {
+      variables.push_back(compartment->speciesIds[is]);
+      adjointIds.push_back(compartment->speciesIds[compartment->nSpecies + is]);
+      storage.push_back(compartment->storage[is]);
+    }
+  }
+  // the gradient species of the first compartment are used for the
+  // parameter derivatives
+  const auto *gradientCompartment{compartments.front()};
+  const auto gradientIndex{2 * gradientCompartment->nSpecies};
+  for (const auto &reactionId : reactions.getIds(location.id)) {
+    // sum_i M_i lambda_i / S_i for the species i changed by this reaction
+    std::string weight;
+    for (std::size_t i = 0; i < variables.size(); ++i) {
+      if (!species.isReactive(variables[i].c_str())) {
+        continue;
+      }
+      if (double stoich{reactions.getSpeciesStoichiometry(
+              reactionId, variables[i].c_str())};
+          stoich != 0.0) {
+        weight.append(
+            fmt::format(" + {}*{}", stoich / storage[i], adjointIds[i]));
+      }
+    }
+    if (weight.empty()) {
+      continue;
+    }
+    const auto rate{model.inlineExpr(
+        reactions.getRateExpression(reactionId).toStdString())};
+    const auto localParameterIds{reactions.getParameterIds(reactionId)};
+    std::vector<std::pair<std::string, double>> localParameters;
+    for (const auto &localParameterId : localParameterIds) {
+      localParameters.emplace_back(
+          localParameterId.toStdString(),
+          reactions.getParameterValue(reactionId, localParameterId));
+    }
+    auto symbols{variables};
+    std::vector<std::optional<std::string>> paramSymbols;
+    for (const auto &optParam : optParams) {
+      paramSymbols.push_back(
+          getParameterSymbol(optParam, reactionId, localParameterIds));
+      if (paramSymbols.back().has_value()) {
+        symbols.push_back(*paramSymbols.back());
+      }
+    }
+    common::Symbolic sym(rate, symbols, {}, {}, true);
+    if (!sym.isValid()) {
+      throw std::invalid_argument(sym.getErrorMessage());
+    }
+    const auto name{reactions.getName(reactionId)};
+    auto addReaction = [&](const std::string &derivative,
+                           const QString &adjointName,
+                           const std::string &productId, double factor) {
+      if (derivative == "0") {
+        return;
+      }
+      if (derivative.find("Derivative") != std::string::npos) {
+        throw std::invalid_argument(fmt::format(
+            "Optimization: can't differentiate rate of reaction '{}'",
+            reactionId.toStdString()));
+      }
+      common::Symbolic adjointRate(
+          fmt::format("{}*({})*({})", factor, weight, derivative), {},
+          localParameters, {}, true);
+      if (!adjointRate.isValid()) {
+        throw std::invalid_argument(adjointRate.getErrorMessage());
+      }
+      reactions.add(adjointName, location.id);
+      const auto adjointReactionId{reactions.getIds(location.id).back()};
+      reactions.setSpeciesStoichiometry(adjointReactionId, productId.c_str(),
+                                        1.0);
+      reactions.setRateExpression(adjointReactionId,
+                                  adjointRate.inlinedExpr().c_str());
+    };
+    // the sim divides the rate of species j by S_j, so multiply it by S_j
+    for (std::size_t i = 0; i < variables.size(); ++i) {
+      addReaction(sym.diff(variables[i]),
+                  QString("%1 adjoint %2").arg(name).arg(i), adjointIds[i],
+                  storage[i]);
+    }
+    for (std::size_t iParam = 0; iParam < optParams.size(); ++iParam) {
+      if (paramSymbols[iParam].has_value()) {
+        addReaction(
+            sym.diff(*paramSymbols[iParam]),
+            QString("%1 gradient %2").arg(name).arg(iParam),
+            gradientCompartment->speciesIds[gradientIndex + iParam], 1.0);
+      }
+    }
+  }
+}
+
+std::vector<AdjointCompartment>
+addAdjoints(model::Model &model, const std::vector<OptParam> &optParams) {
+  std::vector<AdjointCompartment> compartments;
+  auto &species{model.getSpecies()};
+  // same compartment and species ordering as Simulation
+  for (const auto &compartmentId : model.getCompartments().getIds()) {
+    AdjointCompartment compartment;
+    for (const auto &speciesId : species.getIds(compartmentId)) {
+      if (species.isSimulatedSpecies(speciesId)) {
+        compartment.speciesIds.push_back(speciesId.toStdString());
+      }
+    }
+    if (compartment.speciesIds.empty()) {
+      continue;
+    }
+    compartment.id = compartmentId.toStdString();
+    compartment.compartment =
+        model.getCompartments().getCompartment(compartmentId);
+    compartment.nSpecies = compartment.speciesIds.size();
+    for (std::size_t is = 0; is < compartment.nSpecies; ++is) {
+      const QString speciesId{compartment.speciesIds[is].c_str()};
+      compartment.storage.push_back(species.getStorage(speciesId));
+      species.add(QString("%1 adjoint").arg(species.getName(speciesId)),
+                  compartmentId);
+      const auto adjointId{species.getIds(compartmentId).back()};
+      copySpeciesProperties(species, speciesId, adjointId);
+      if (!species.getIsSpatial(speciesId)) {
+        // the adjoint is spatially averaged before each step instead
+        compartment.nonSpatialSpeciesIndices.push_back(is);
+        species.setIsSpatial(adjointId, true);
+      }
+      compartment.speciesIds.push_back(adjointId.toStdString());
+    }
+    for (std::size_t iParam = 0; iParam < optParams.size(); ++iParam) {
+      species.add(QString("gradient %1").arg(iParam), compartmentId);
+      const auto gradientId{species.getIds(compartmentId).back()};
+      species.setDiffusionConstant(gradientId, 0.0);
+      compartment.speciesIds.push_back(gradientId.toStdString());
+    }
+    compartments.push_back(std::move(compartment));
+  }
+  auto findCompartment =
+      [&compartments](
+          const std::string &compartmentId) -> const AdjointCompartment * {
+    for (const auto &compartment : compartments) {
+      if (compartment.id == compartmentId) {
+        return &compartment;
+      }
+    }
+    return nullptr;
+  };
+  for (const auto &location : model.getReactions().getReactionLocations()) {
+    std::vector<const AdjointCompartment *> locationCompartments;
+    if (location.type == model::ReactionLocation::Type::Compartment) {
+      locationCompartments.push_back(
+          findCompartment(location.id.toStdString()));
+    } else if (location.type == model::ReactionLocation::Type::Membrane) {
+      const auto *membrane{model.getMembranes().getMembrane(location.id)};
+      locationCompartments.push_back(
+          findCompartment(membrane->getCompartmentA()->getId()));
+      locationCompartments.push_back(
+          findCompartment(membrane->getCompartmentB()->getId()));
+    }
+    std::erase(locationCompartments, nullptr);
+    if (locationCompartments.empty()) {
+      continue;
+    }
+    addAdjointReactions(model, optParams, location, locationCompartments);
+  }
+  return compartments;
+}
+
+// the (state index, value) pairs to add to the adjoint after a cost is
+// evaluated
+using AdjointSeed = std::vector<std::pair<std::size_t, double>>;
+
+// The discrete adjoint of the forwards Euler pixel simulation
+//  - the forward simulation does one step at a time, and clamps negative
+//  concentrations like the pixel simulator
+//  - the adjoint simulation contains the species, their adjoints and the
+//  gradient species: one forwards Euler step from the state at step n and the
+//  adjoint at step n+1 gives the adjoint at step n, and the contribution of
+//  step n to the gradient
+class AdjointSimulation {
+private:
+  std::unique_ptr<model::Model> forwardModel;
+  std::unique_ptr<model::Model> adjointModel;
+  // the model with unit diffusion constants for diffusion constant parameters
+  std::unique_ptr<model::Model> diffusionModel;
+  std::vector<AdjointCompartment> compartments;
+  // the compartment and species index of each diffusion constant parameter
+  std::vector<std::optional<std::pair<std::size_t, std::size_t>>>
+      diffusionSpecies;
+  // true for diffusion constant parameters with a value for each voxel
+  std::vector<bool> diffusionFields;
+  bool hasDiffusionFields{false};
+  // the index in dv of the first value of each parameter
+  std::vector<std::size_t> paramOffsets;
+  std::unique_ptr<PixelSim> forwardSim;
+  std::unique_ptr<PixelSim> adjointSim;
+  std::unique_ptr<PixelSim> diffusionSim;
+  std::size_t nParams{0};
+  std::size_t stateSize{0};
+  double maxTimestep{std::numeric_limits<double>::max()};
+
+  // adds the contribution of a step to the gradient of the diffusion constant
+  // parameters, where L is the diffusion operator with unit diffusion
+  // constants:
+  //  - uniform D_j: dF_j/dD_j = L c_j / S_j
+  //  - field D_j: the flux 0.5 (D_k + D_l) (c_l - c_k) / S_j across each face
+  //  between voxels k and l gives lambda.dF_j/dD_k =
+  //  (lambda_k (L c_j)_k + c_k (L lambda)_k - (L lambda c_j)_k) / (2 S_j)
+  void addDiffusionGradient(const std::vector<double> &state,
+                            const std::vector<double> &adjointState,
+                            double dt, pagmo::vector_double &gradient) {
+    auto adjointIndex = [](const AdjointCompartment &compartment,
+                           std::size_t ix, std::size_t is) {
+      return compartment.adjointOffset + ix * compartment.adjointStride +
+             compartment.nSpecies + is;
+    };
+    std::vector<double> unitDiffusion(stateSize, 0.0);
+    diffusionSim->evaluateDiffusion(state, unitDiffusion);
+    std::vector<double> adjointDiffusion;
+    std::vector<double> productDiffusion;
+    if (hasDiffusionFields) {
+      std::vector<double> adjoint(stateSize, 0.0);
+      std::vector<double> product(stateSize, 0.0);
+      for (const auto &compartment : compartments) {
+        for (std::size_t ix = 0; ix < compartment.compartment->nVoxels();
+             ++ix) {
+          for (std::size_t is = 0; is < compartment.nSpecies; ++is) {
+            const auto i{compartment.offset + ix * compartment.stride + is};
+            adjoint[i] = adjointState[adjointIndex(compartment, ix, is)];
+            product[i] = adjoint[i] * state[i];
+          }
+        }
+      }
+      adjointDiffusion.assign(stateSize, 0.0);
+      productDiffusion.assign(stateSize, 0.0);
+      diffusionSim->evaluateDiffusion(adjoint, adjointDiffusion);
+      diffusionSim->evaluateDiffusion(product, productDiffusion);
+    }
+    for (std::size_t iParam = 0; iParam < nParams; ++iParam) {
+      if (!diffusionSpecies[iParam].has_value()) {
+        continue;
+      }
+      const auto [ic, is]{*diffusionSpecies[iParam]};
+      const auto &compartment{compartments[ic]};
+      const double factor{dt / compartment.storage[is]};
+      const auto offset{paramOffsets[iParam]};
+      for (std::size_t ix = 0; ix < compartment.compartment->nVoxels(); ++ix) {
+        const double adjoint{adjointState[adjointIndex(compartment, ix, is)]};
+        const auto i{compartment.offset + ix * compartment.stride + is};
+        if (diffusionFields[iParam]) {
+          gradient[offset + ix] +=
+              0.5 * factor *
+              (adjoint * unitDiffusion[i] + state[i] * adjointDiffusion[i] -
+               productDiffusion[i]);
+        } else {
+          gradient[offset] += factor * adjoint * unitDiffusion[i];
+        }
+      }
+    }
+  }
+
+public:
+  AdjointSimulation(const OptConstData &optConstData,
+                    const pagmo::vector_double &dv)
+      : nParams{optConstData.optimizeOptions.optParams.size()} {
+    const auto &options{optConstData.optimizeOptions};
+    std::size_t nValues{0};
+    for (auto size : optConstData.optParamSizes) {
+      paramOffsets.push_back(nValues);
+      nValues += size;
+    }
+    if (paramOffsets.size() != nParams || nValues != dv.size()) {
+      throw std::invalid_argument(
+          "Optimization: number of parameter values mismatch");
+    }
+    auto importModel = [&optConstData, &dv]() {
+      auto model{std::make_unique<sme::model::Model>()};
+      model->importSBMLString(optConstData.xmlModel);
+      applyParameters(dv, model.get());
+      model->getSimulationSettings().options.pixel.integrator =
+          PixelIntegratorType::RK101;
+      return model;
+    };
+    {
+      std::scoped_lock lock{modelConstructionMutex};
+      forwardModel = importModel();
+      if (auto error{checkCostGradientSupport(*forwardModel, options)};
+          !error.empty()) {
+        throw std::invalid_argument(error);
+      }
+      adjointModel = importModel();
+      compartments = addAdjoints(*adjointModel, options.optParams);
+      for (const auto &optParam : options.optParams) {
+        diffusionSpecies.emplace_back();
+        diffusionFields.push_back(false);
+        if (optParam.optParamType != OptParamType::DiffusionConstant) {
+          continue;
+        }
+        if (forwardModel->getSpecies().getDiffusionConstantType(
+                optParam.id.c_str()) == model::SpatialDataType::Image) {
+          diffusionFields.back() = true;
+          hasDiffusionFields = true;
+        }
+        if (diffusionModel == nullptr) {
+          diffusionModel = importModel();
+        }
+        diffusionModel->getSpecies().setDiffusionConstant(
+            optParam.id.c_str(), 1.0);
+        for (std::size_t ic = 0; ic < compartments.size(); ++ic) {
+          for (std::size_t is = 0; is < compartments[ic].nSpecies; ++is) {
+            if (compartments[ic].speciesIds[is] == optParam.id) {
+              diffusionSpecies.back() = {ic, is};
+            }
+          }
+        }
+      }
+    }
+    std::vector<std::string> compartmentIds;
+    std::vector<std::vector<std::string>> forwardSpeciesIds;
+    std::vector<std::vector<std::string>> adjointSpeciesIds;
+    std::set<std::string, std::less<>> forwardIds;
+    std::set<std::string, std::less<>> adjointIds;
+    for (const auto &compartment : compartments) {
+      compartmentIds.push_back(compartment.id);
+      auto endSpecies{compartment.speciesIds.cbegin() +
+                      static_cast<std::ptrdiff_t>(compartment.nSpecies)};
+      forwardSpeciesIds.emplace_back(compartment.speciesIds.cbegin(),
+                                     endSpecies);
+      adjointSpeciesIds.push_back(compartment.speciesIds);
+      forwardIds.insert(compartment.speciesIds.cbegin(), endSpecies);
+      adjointIds.insert(compartment.speciesIds.cbegin(),
+                        compartment.speciesIds.cend());
+    }
+    // negative values are clamped here instead, so that the clamped
+    // concentrations are known, and the adjoints can be negative
+    const std::map<std::string, double, std::less<>> substitutions;
+    forwardSim = std::make_unique<PixelSim>(*forwardModel, compartmentIds,
+                                            forwardSpeciesIds, substitutions,
+                                            forwardIds);
+    adjointSim = std::make_unique<PixelSim>(*adjointModel, compartmentIds,
+                                            adjointSpeciesIds, substitutions,
+                                            adjointIds);
+    if (diffusionModel != nullptr) {
+      diffusionSim = std::make_unique<PixelSim>(*diffusionModel, compartmentIds,
+                                                forwardSpeciesIds);
+    }
+    for (const auto *sim :
+         {forwardSim.get(), adjointSim.get(), diffusionSim.get()}) {
+      if (sim != nullptr && !sim->errorMessage().empty()) {
+        throw std::runtime_error(sim->errorMessage());
+      }
+    }
+    std::size_t adjointStateSize{0};
+    for (std::size_t ic = 0; ic < compartments.size(); ++ic) {
+      auto &compartment{compartments[ic]};
+      const auto nVoxels{compartment.compartment->nVoxels()};
+      compartment.offset = stateSize;
+      compartment.stride = forwardSim->getConcentrations(ic).size() / nVoxels;
+      stateSize += forwardSim->getConcentrations(ic).size();
+      compartment.adjointOffset = adjointStateSize;
+      compartment.adjointStride =
+          adjointSim->getConcentrations(ic).size() / nVoxels;
+      adjointStateSize += adjointSim->getConcentrations(ic).size();
+    }
+    maxTimestep = std::min(
+        {forwardModel->getSimulationSettings().options.pixel.maxTimestep,
+         forwardSim->getMaxStableTimestep(),
+         adjointSim->getMaxStableTimestep()});
+  }
+
+  [[nodiscard]] double getMaxTimestep() const { return maxTimestep; }
+
+  [[nodiscard]] std::vector<double> getState() const {
+    return forwardSim->getState();
+  }
+
+  void setState(const std::vector<double> &state) {
+    forwardSim->setState(state);
+  }
+
+  // does one forwards Euler step, and returns the state indices of the
+  // concentrations that were clamped to zero
+  std::vector<std::size_t> step(double dt,
+                                const std::function<bool()> &isStopping) {
+    forwardSim->run(dt, -1, isStopping);
+    auto state{forwardSim->getState()};
+    std::vector<std::size_t> clamped;
+    for (const auto &compartment : compartments) {
+      for (std::size_t ix = 0; ix < compartment.compartment->nVoxels();
+           ++ix) {
+        const auto i0{compartment.offset + ix * compartment.stride};
+        for (std::size_t i = i0; i < i0 + compartment.nSpecies; ++i) {
+          if (state[i] < 0.0) {
+            state[i] = 0.0;
+            clamped.push_back(i);
+          }
+        }
+      }
+    }
+    if (!clamped.empty()) {
+      forwardSim->setState(state);
+    }
+    return clamped;
+  }
+
+  // returns the cost of the current state, and sets the values of its targets
+  // and its derivative with respect to the state
+  double cost(const OptConstData &optConstData, const OptTimestep &optTimestep,
+              std::vector<std::vector<double>> &targets,
+              AdjointSeed &seed) const {
+    const auto &optCosts{optConstData.optimizeOptions.optCosts};
+    const auto &indices{optTimestep.optCostIndices};
+    // same weighting as calculateCosts(): each cost is multiplied by its own
+    // weight and the weights of all later costs
+    std::vector<double> factors(indices.size(), 1.0);
+    double factor{1.0};
+    for (std::size_t i = indices.size(); i-- > 0;) {
+      factor *= optCosts[indices[i]].weight;
+      factors[i] = factor;
+    }
+    double cost{0.0};
+    std::vector<double> dcost;
+    for (std::size_t i = 0; i < indices.size(); ++i) {
+      const auto &optCost{optCosts[indices[i]]};
+      const auto &compartment{compartments.at(optCost.compartmentIndex)};
+      cost += concentrationCostDerivative(
+          optCost, compartment.compartment,
+          forwardSim->getConcentrations(optCost.compartmentIndex),
+          compartment.stride, optConstData.imageSize, targets[indices[i]],
+          dcost);
+      cost *= optCost.weight;
+      for (std::size_t ix = 0; ix < dcost.size(); ++ix) {
+        seed.emplace_back(compartment.offset + ix * compartment.stride +
+                              optCost.speciesIndex,
+                          factors[i] * dcost[ix]);
+      }
+    }
+    return cost;
+  }
+
+  // replaces the adjoint at step n+1 with the adjoint at step n, and adds
+  // the contribution of step n to the gradient
+  void adjointStep(const std::vector<double> &state, double dt,
+                   std::vector<double> &lambda,
+                   pagmo::vector_double &gradient) {
+    std::vector<double> adjointState;
+    for (const auto &compartment : compartments) {
+      const auto n{compartment.nSpecies};
+      const auto nVoxels{compartment.compartment->nVoxels()};
+      // the adjoint of non-spatial species is spatially averaged
+      std::vector<double> average(n, 0.0);
+      for (auto is : compartment.nonSpatialSpeciesIndices) {
+        for (std::size_t ix = 0; ix < nVoxels; ++ix) {
+          average[is] +=
+              lambda[compartment.offset + ix * compartment.stride + is];
+        }
+        average[is] /= static_cast<double>(nVoxels);
+      }
+      for (std::size_t ix = 0; ix < nVoxels; ++ix) {
+        const auto i0{compartment.offset + ix * compartment.stride};
+        const auto iAdjoint{adjointState.size() + n};
+        adjointState.insert(adjointState.end(), state.cbegin() + i0,
+                            state.cbegin() + i0 + n);
+        adjointState.insert(adjointState.end(), lambda.cbegin() + i0,
+                            lambda.cbegin() + i0 + n);
+        for (auto is : compartment.nonSpatialSpeciesIndices) {
+          adjointState[iAdjoint + is] = average[is];
+        }
+        adjointState.insert(adjointState.end(), nParams, 0.0);
+        adjointState.insert(adjointState.end(), state.cbegin() + i0 + n,
+                            state.cbegin() + i0 + compartment.stride);
+      }
+    }
+    if (diffusionSim != nullptr) {
+      addDiffusionGradient(state, adjointState, dt, gradient);
+    }
+    adjointSim->setState(adjointState);
+    if (adjointSim->run(dt, -1, {}) != 1) {
+      throw std::runtime_error(
+          "Optimization: adjoint simulation timestep mismatch");
+    }
+    for (std::size_t ic = 0; ic < compartments.size(); ++ic) {
+      const auto &compartment{compartments[ic]};
+      const auto n{compartment.nSpecies};
+      const auto &conc{adjointSim->getConcentrations(ic)};
+      for (std::size_t ix = 0; ix < compartment.compartment->nVoxels();
+           ++ix) {
+        const auto i0{compartment.offset + ix * compartment.stride};
+        const auto iAdjoint{ix * compartment.adjointStride + n};
+        const auto *before{adjointState.data() + compartment.adjointOffset +
+                           iAdjoint};
+        const auto *after{conc.data() + iAdjoint};
+        // the step is linear in the adjoint, so the part removed by spatial
+        // averaging is unchanged
+        for (std::size_t is = 0; is < n; ++is) {
+          lambda[i0 + is] += after[is] - before[is];
+        }
+        for (std::size_t iParam = 0; iParam < nParams; ++iParam) {
+          gradient[paramOffsets[iParam]] += after[n + iParam];
+        }
+      }
+    }
+  }
+};
+
+std::optional<SimulatedCostGradient>
+simulateCostGradientAdjoint(const OptConstData &optConstData,
+                            const pagmo::vector_double &dv,
+                            const std::function<bool()> &isStopping) {
+  AdjointSimulation sim(optConstData, dv);
+  // the forwards Euler timesteps, same as PixelSim::run()
+  std::vector<double> timesteps;
+  // the number of timesteps before each cost is evaluated
+  std::vector<std::size_t> costSteps;
+  for (const auto &optTimestep : optConstData.optTimesteps) {
+    const double time{optTimestep.simulationTime};
+    double t{0.0};
+    constexpr double relativeTolerance{1e-12};
+    while (t + time * relativeTolerance < time) {
+      timesteps.push_back(std::min(sim.getMaxTimestep(), time - t));
+      t += timesteps.back();
+    }
+    costSteps.push_back(timesteps.size());
+  }
+  const auto nSteps{timesteps.size()};
+  // store the state every sqrt(nSteps) steps: the states in between are
+  // simulated again during the backwards pass, so at most 2 sqrt(nSteps)
+  // states are stored, at the cost of simulating the model twice
+  const auto interval{std::max<std::size_t>(
+      1, static_cast<std::size_t>(
+             std::ceil(std::sqrt(static_cast<double>(nSteps)))))};
+  std::vector<std::vector<double>> checkpoints;
+  std::vector<AdjointSeed> seeds(optConstData.optTimesteps.size());
+  SimulatedCostGradient result{
+      0.0, pagmo::vector_double(dv.size(), 0.0),
+      std::vector<std::vector<double>>(
+          optConstData.optimizeOptions.optCosts.size())};
+  std::size_t iStep{0};
+  for (std::size_t iCost = 0; iCost < costSteps.size(); ++iCost) {
+    for (; iStep < costSteps[iCost]; ++iStep) {
+      if (iStep % interval == 0) {
+        checkpoints.push_back(sim.getState());
+      }
+      sim.step(timesteps[iStep], isStopping);
+      if (isStopping()) {
+        return {};
+      }
+    }
+    result.cost += sim.cost(optConstData, optConstData.optTimesteps[iCost],
+                            result.targets, seeds[iCost]);
+  }
+  std::vector<double> lambda(sim.getState().size(), 0.0);
+  std::size_t iCost{costSteps.size()};
+  std::vector<std::vector<double>> states;
+  std::vector<std::vector<std::size_t>> clamped;
+  for (std::size_t iCheckpoint = checkpoints.size(); iCheckpoint-- > 0;) {
+    const auto begin{iCheckpoint * interval};
+    const auto end{std::min(nSteps, begin + interval)};
+    states.clear();
+    clamped.clear();
+    sim.setState(checkpoints[iCheckpoint]);
+    for (iStep = begin; iStep < end; ++iStep) {
+      states.push_back(sim.getState());
+      clamped.push_back(sim.step(timesteps[iStep], isStopping));
+      if (isStopping()) {
+        return {};
+      }
+    }
+    for (iStep = end; iStep-- > begin;) {
+      // costs evaluated after this step
+      while (iCost > 0 && costSteps[iCost - 1] == iStep + 1) {
+        --iCost;
+        for (const auto &[i, value] : seeds[iCost]) {
+          lambda[i] += value;
+        }
+      }
+      // clamped concentrations don't depend on the previous state
+      for (auto i : clamped[iStep - begin]) {
+        lambda[i] = 0.0;
+      }
+      sim.adjointStep(states[iStep - begin], timesteps[iStep], lambda,
+                      result.gradient);
+      if (isStopping()) {
+        return {};
+      }
+    }
+  }
+  SPDLOG_DEBUG("Cost {} with adjoint gradient {} ({} steps, {} checkpoints)",
+               result.cost, common::vectorToString(result.gradient), nSteps,
+               checkpoints.size());
+  return result;
+}
+
+} // namespace
+
+std::string checkCostGradientSupport(const sme::model::Model &model,
+                                     const OptimizeOptions &options) {
+  if (model.getSimulationSettings().simulatorType != SimulatorType::Pixel) {
+    return "Optimization: gradients require the Pixel simulator";
+  }
+  // the adjoint is that of a forwards Euler step
+  if (options.optAlgorithm.adjointGradient &&
+      model.getSimulationSettings().options.pixel.integrator !=
+          PixelIntegratorType::RK101) {
+    return "Optimization: the adjoint gradient requires the fixed timestep "
+           "forwards Euler (RK101) Pixel integrator";
+  }
+  // the gradient is always calculated at full resolution
+  if (options.optAlgorithm.coarseningFactor > 1) {
+    return "Optimization: gradients can't be calculated with a coarsening "
+           "factor";
+  }
+  for (const auto &optParam : options.optParams) {
+    if (optParam.optParamType == OptParamType::DiffusionConstant &&
+        !options.optAlgorithm.adjointGradient) {
+      return fmt::format("Optimization: gradients for the diffusion constant "
+                         "parameter '{}' require the adjoint gradient",
+                         optParam.name);
+    }
+  }
+  for (const auto &optCost : options.optCosts) {
+    if (optCost.optCostType != OptCostType::Concentration) {
+      return fmt::format("Optimization: gradients can only be calculated for "
+                         "concentration targets, not '{}'",
+                         optCost.name);
+    }
+  }
+  if (!model.getEvents().getIds().isEmpty()) {
+    return "Optimization: gradients can't be calculated for models with "
+           "events";
+  }
+  const auto &species{model.getSpecies()};
+  for (const auto &compartmentId : model.getCompartments().getIds()) {
+    for (const auto &speciesId : species.getIds(compartmentId)) {
+      if (!species.isSimulatedSpecies(speciesId)) {
+        continue;
+      }
+      const auto name{species.getName(speciesId).toStdString()};
+      if (species.getStorage(speciesId) == 0.0) {
+        return fmt::format("Optimization: gradients can't be calculated for "
+                           "zero storage species '{}'",
+                           name);
+      }
+      if (!species.getCrossDiffusionConstants(speciesId).empty()) {
+        return fmt::format("Optimization: gradients can't be calculated for "
+                           "cross-diffusion of species '{}'",
+                           name);
+      }
+      // the sensitivities have zero initial concentration and the same
+      // diffusion constant as the species
+      for (const auto &optParam : options.optParams) {
+        if (optParam.optParamType != OptParamType::ModelParameter) {
+          continue;
+        }
+        for (const auto &expr :
+             {species.getAnalyticConcentration(speciesId),
+              species.getAnalyticDiffusionConstant(speciesId)}) {
+          if (common::SimpleSymbolic::contains(expr.toStdString(),
+                                               optParam.id)) {
+            return fmt::format(
+                "Optimization: gradients can't be calculated: the initial "
+                "concentration or diffusion constant of species '{}' "
+                "depends on parameter '{}'",
+                name, optParam.name);
+          }
+        }
+      }
+    }
+  }
+  return {};
+}
+
+std::optional<SimulatedCostGradient>
+simulateCostGradient(const OptConstData &optConstData,
+                     const pagmo::vector_double &dv,
+                     const std::function<bool()> &isStopping) {
+  if (optConstData.optimizeOptions.optAlgorithm.adjointGradient) {
+    return simulateCostGradientAdjoint(optConstData, dv, isStopping);
+  }
+  return simulateCostGradientSensitivities(optConstData, dv, isStopping);
+}
+
+} // namespace sme::simulate
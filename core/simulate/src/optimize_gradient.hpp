@@ -0,0 +1,65 @@
+// Optimization gradient
+//  - forward sensitivity analysis of the optimization cost using the pixel
+//  simulator
+//  - discrete adjoint of the optimization cost using the forwards Euler pixel
+//  simulator
+
+#pragma once
+
+#include "sme/model.hpp"
+#include "sme/optimize.hpp"
+#include <functional>
+#include <optional>
+#include <pagmo/types.hpp>
+#include <string>
+#include <vector>
+
+namespace sme::simulate {
+
+struct SimulatedCostGradient {
+  double cost;
+  // the derivative of the cost with respect to each parameter
+  pagmo::vector_double gradient;
+  // the simulated values of each target, as set by calculateCosts()
+  std::vector<std::vector<double>> targets;
+};
+
+/**
+ * @brief Check that the cost gradient can be calculated for a model
+ *
+ * The model must use the Pixel simulator. The adjoint gradient also requires
+ * the fixed timestep RK101 integrator. The gradient is only calculated at
+ * full resolution, so the geometry coarsening factor must be 1.
+ *
+ * @returns an error message if the gradient can't be calculated
+ */
+std::string checkCostGradientSupport(const sme::model::Model &model,
+                                     const OptimizeOptions &options);
+
+/**
+ * @brief Simulate the model with parameters ``dv`` and return the cost and
+ * its gradient
+ *
+ * For each parameter, a sensitivity species is added for each reactive
+ * species, with the same storage and diffusion constant and zero initial
+ * concentration. The reactions for these species are the derivatives of the
+ * model reactions, so they are integrated along with the concentrations by
+ * the model's Pixel integrator. This gives the gradient of the pixel
+ * simulation, instead of a finite difference approximation. The cost is
+ * calculated by the same simulation, so it is consistent with the gradient.
+ *
+ * If the ``adjointGradient`` algorithm option is set, the model is instead
+ * simulated with forwards Euler, and the discrete adjoint of this simulation
+ * is integrated backwards in time. This costs about the same for any
+ * number of parameters, and supports diffusion constant parameters. The
+ * states needed by the backwards pass are recalculated from checkpoints, so
+ * only about twice the square root of the number of timesteps are stored.
+ *
+ * Returns ``{}`` if ``isStopping`` returns true.
+ */
+std::optional<SimulatedCostGradient>
+simulateCostGradient(const OptConstData &optConstData,
+                     const pagmo::vector_double &dv,
+                     const std::function<bool()> &isStopping);
+
+} // namespace sme::simulate
@@ -0,0 +1,536 @@
+#include "catch_wrapper.hpp"
+#include "model_test_utils.hpp"
+#include "optimize_gradient.hpp"
+#include "optimize_impl.hpp"
+#include "sme/model.hpp"
+#include "sme/optimize.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+using namespace sme;
+using namespace sme::test;
+
+// central finite difference approximation to the gradient of the cost
+static std::vector<double>
+finiteDifferenceGradient(const simulate::OptConstData &optConstData,
+                         const std::vector<double> &dv) {
+  std::vector<double> gradient;
+  for (std::size_t i = 0; i < dv.size(); ++i) {
+    const double h{1e-5 * dv[i]};
+    auto dvPlus{dv};
+    dvPlus[i] += h;
+    auto dvMinus{dv};
+    dvMinus[i] -= h;
+    auto plus{simulate::simulateCostGradient(optConstData, dvPlus,
+                                             []() { return false; })};
+    auto minus{simulate::simulateCostGradient(optConstData, dvMinus,
+                                              []() { return false; })};
+    gradient.push_back((plus->cost - minus->cost) / (2.0 * h));
+  }
+  return gradient;
+}
+
+static void setFixedTimestep(model::Model &model) {
+  // fixed timesteps: the cost is a smooth function of the parameters, so the
+  // finite difference approximation is accurate
+  auto &settings{model.getSimulationSettings()};
+  settings.simulatorType = simulate::SimulatorType::Pixel;
+  settings.options.pixel.integrator = simulate::PixelIntegratorType::RK101;
+  settings.options.pixel.maxTimestep = 0.002;
+}
+
+TEST_CASE("Optimization gradient",
+          "[core/simulate/optimize_gradient][core/simulate][core][optimize]") {
+  SECTION("ABtoC: reaction and model parameters") {
+    auto model{getExampleModel(Mod::ABtoC)};
+    setFixedTimestep(model);
+    model.getParameters().add("kg");
+    model.getParameters().setExpression("kg", "0.8");
+    model.getReactions().setRateExpression("r1", "k1 * kg * A * B");
+    auto &optimizeOptions{model.getOptimizeOptions()};
+    optimizeOptions.optParams.push_back(
+        {simulate::OptParamType::ReactionParameter, "k1", "k1", "r1", 0.02,
+         0.88});
+    optimizeOptions.optParams.push_back(
+        {simulate::OptParamType::ModelParameter, "kg", "kg", "", 0.1, 2.0});
+    // concentration of A: decreases with both parameters
+    optimizeOptions.optCosts.push_back(
+        {simulate::OptCostType::Concentration,
+         simulate::OptCostDiffType::Absolute, "A", "A", 0.05, 1.0, 0, 0, {}});
+    // relative difference of C from a target, at two times
+    std::vector<double> target(
+        static_cast<std::size_t>(
+            model.getGeometry().getImages().volume().nVoxels()),
+        0.01);
+    optimizeOptions.optCosts.push_back(
+        {simulate::OptCostType::Concentration,
+         simulate::OptCostDiffType::Relative, "C", "C", 0.05, 0.5, 0, 2,
+         target, 1e-6});
+    optimizeOptions.optCosts.push_back(
+        {simulate::OptCostType::Concentration,
+         simulate::OptCostDiffType::Absolute, "C2", "C", 0.1, 2.0, 0, 2,
+         target});
+    simulate::OptConstData optConstData;
+    REQUIRE(simulate::initOptConstData(optConstData, model).empty());
+    REQUIRE(
+        simulate::checkCostGradientSupport(model, optimizeOptions).empty());
+    std::vector<double> dv{0.3, 0.7};
+    auto result{simulate::simulateCostGradient(optConstData, dv,
+                                               []() { return false; })};
+    REQUIRE(result.has_value());
+    // same cost as the simulation without sensitivities
+    std::vector<std::vector<double>> targets(optimizeOptions.optCosts.size());
+    auto cost{simulate::simulateCost(optConstData, nullptr, dv, targets,
+                                     1e300, []() { return false; })};
+    REQUIRE(cost.has_value());
+    REQUIRE(result->cost == dbl_approx(cost->cost));
+    // A decreases as either parameter increases: the sensitivities are
+    // negative, so must not be clamped to zero
+    REQUIRE(result->gradient.size() == 2);
+    auto fd{finiteDifferenceGradient(optConstData, dv)};
+    for (std::size_t i = 0; i < dv.size(); ++i) {
+      CAPTURE(i);
+      REQUIRE(result->gradient[i] != 0.0);
+      REQUIRE(result->gradient[i] ==
+              Catch::Approx(fd[i]).epsilon(1e-4).margin(1e-12));
+    }
+    // stopping returns no result
+    REQUIRE(!simulate::simulateCostGradient(optConstData, dv, []() {
+               return true;
+             }).has_value());
+  }
+  SECTION("VerySimpleModel: membrane reactions with the same local ids") {
+    auto model{getExampleModel(Mod::VerySimpleModel)};
+    setFixedTimestep(model);
+    auto &optimizeOptions{model.getOptimizeOptions()};
+    optimizeOptions.optParams.push_back(
+        {simulate::OptParamType::ReactionParameter, "k1", "k1", "A_uptake",
+         0.01, 1.0});
+    optimizeOptions.optParams.push_back(
+        {simulate::OptParamType::ReactionParameter, "k1", "k1",
+         "A_B_conversion", 0.01, 1.0});
+    // concentration of A in the nucleus: increased by uptake into the cell,
+    // decreased by conversion to B in the nucleus
+    optimizeOptions.optCosts.push_back(
+        {simulate::OptCostType::Concentration,
+         simulate::OptCostDiffType::Absolute, "A", "A_c3", 0.2, 1.0, 2, 0, {}});
+    simulate::OptConstData optConstData;
+    REQUIRE(simulate::initOptConstData(optConstData, model).empty());
+    std::vector<double> dv{0.2, 0.5};
+    auto result{simulate::simulateCostGradient(optConstData, dv,
+                                               []() { return false; })};
+    REQUIRE(result.has_value());
+    auto fd{finiteDifferenceGradient(optConstData, dv)};
+    REQUIRE(result->gradient[0] > 0.0);
+    REQUIRE(result->gradient[1] < 0.0);
+    for (std::size_t i = 0; i < dv.size(); ++i) {
+      CAPTURE(i);
+      REQUIRE(result->gradient[i] ==
+              Catch::Approx(fd[i]).epsilon(1e-4).margin(1e-12));
+    }
+  }
+  SECTION("ABtoC: adjoint gradient") {
+    auto model{getExampleModel(Mod::ABtoC)};
+    setFixedTimestep(model);
+    model.getParameters().add("kg");
+    model.getParameters().setExpression("kg", "0.8");
+    model.getReactions().setRateExpression("r1", "k1 * kg * A * B");
+    auto &optimizeOptions{model.getOptimizeOptions()};
+    optimizeOptions.optParams.push_back(
+        {simulate::OptParamType::ReactionParameter, "k1", "k1", "r1", 0.02,
+         0.88});
+    optimizeOptions.optParams.push_back(
+        {simulate::OptParamType::ModelParameter, "kg", "kg", "", 0.1, 2.0});
+    optimizeOptions.optCosts.push_back(
+        {simulate::OptCostType::Concentration,
+         simulate::OptCostDiffType::Absolute, "A", "A", 0.05, 1.0, 0, 0, {}});
+    optimizeOptions.optCosts.push_back(
+        {simulate::OptCostType::Concentration,
+         simulate::OptCostDiffType::Absolute, "C", "C", 0.1, 2.0, 0, 2, {}});
+    std::vector<double> dv{0.3, 0.7};
+    simulate::OptConstData optConstData;
+    REQUIRE(simulate::initOptConstData(optConstData, model).empty());
+    auto sensitivities{simulate::simulateCostGradient(optConstData, dv, []() {
+      return false;
+    })};
+    REQUIRE(sensitivities.has_value());
+    optimizeOptions.optAlgorithm.adjointGradient = true;
+    REQUIRE(simulate::initOptConstData(optConstData, model).empty());
+    auto adjoint{simulate::simulateCostGradient(optConstData, dv,
+                                                []() { return false; })};
+    REQUIRE(adjoint.has_value());
+    // same cost and gradient as the forward sensitivities
+    REQUIRE(adjoint->cost == dbl_approx(sensitivities->cost));
+    REQUIRE(adjoint->gradient.size() == 2);
+    for (std::size_t i = 0; i < dv.size(); ++i) {
+      CAPTURE(i);
+      REQUIRE(adjoint->gradient[i] != 0.0);
+      REQUIRE(adjoint->gradient[i] ==
+              Catch::Approx(sensitivities->gradient[i]).epsilon(1e-6));
+    }
+    REQUIRE(!simulate::simulateCostGradient(optConstData, dv, []() {
+               return true;
+             }).has_value());
+  }
+  SECTION("ABtoC: adjoint gradient of a diffusion constant") {
+    auto model{getExampleModel(Mod::ABtoC)};
+    setFixedTimestep(model);
+    auto &optimizeOptions{model.getOptimizeOptions()};
+    optimizeOptions.optAlgorithm.adjointGradient = true;
+    optimizeOptions.optParams.push_back(
+        {simulate::OptParamType::DiffusionConstant, "D", "A", "", 0.1, 1.0});
+    optimizeOptions.optParams.push_back(
+        {simulate::OptParamType::ReactionParameter, "k1", "k1", "r1", 0.02,
+         0.88});
+    // difference of A from a non-uniform target
+    auto nVoxels{static_cast<std::size_t>(
+        model.getGeometry().getImages().volume().nVoxels())};
+    std::vector<double> target(nVoxels, 0.0);
+    for (std::size_t i = 0; i < nVoxels; i += 2) {
+      target[i] = 0.5;
+    }
+    optimizeOptions.optCosts.push_back(
+        {simulate::OptCostType::Concentration,
+         simulate::OptCostDiffType::Absolute, "A", "A", 0.05, 1.0, 0, 0,
+         target});
+    REQUIRE(
+        simulate::checkCostGradientSupport(model, optimizeOptions).empty());
+    simulate::OptConstData optConstData;
+    REQUIRE(simulate::initOptConstData(optConstData, model).empty());
+    std::vector<double> dv{0.4, 0.3};
+    auto result{simulate::simulateCostGradient(optConstData, dv,
+                                               []() { return false; })};
+    REQUIRE(result.has_value());
+    auto fd{finiteDifferenceGradient(optConstData, dv)};
+    for (std::size_t i = 0; i < dv.size(); ++i) {
+      CAPTURE(i);
+      REQUIRE(result->gradient[i] != 0.0);
+      REQUIRE(result->gradient[i] ==
+              Catch::Approx(fd[i]).epsilon(1e-4).margin(1e-12));
+    }
+  }
+  SECTION("ABtoC: adjoint gradient of a diffusion constant field") {
+    auto model{getExampleModel(Mod::ABtoC)};
+    setFixedTimestep(model);
+    auto nVoxels{static_cast<std::size_t>(
+        model.getGeometry().getImages().volume().nVoxels())};
+    std::vector<double> diffusion(nVoxels, 0.0);
+    for (std::size_t i = 0; i < nVoxels; ++i) {
+      diffusion[i] = 0.2 + 0.1 * static_cast<double>(i % 5);
+    }
+    model.getSpecies().setSampledFieldDiffusionConstant("A", diffusion);
+    auto &optimizeOptions{model.getOptimizeOptions()};
+    optimizeOptions.optAlgorithm.adjointGradient = true;
+    optimizeOptions.optParams.push_back(
+        {simulate::OptParamType::DiffusionConstant, "D", "A", "", 0.1, 1.0});
+    optimizeOptions.optParams.push_back(
+        {simulate::OptParamType::ReactionParameter, "k1", "k1", "r1", 0.02,
+         0.88});
+    std::vector<double> target(nVoxels, 0.0);
+    for (std::size_t i = 0; i < nVoxels; i += 2) {
+      target[i] = 0.5;
+    }
+    optimizeOptions.optCosts.push_back(
+        {simulate::OptCostType::Concentration,
+         simulate::OptCostDiffType::Absolute, "A", "A", 0.05, 1.0, 0, 0,
+         target});
+    // one value for each voxel of the compartment
+    const auto *compartment{model.getSpecies().getField("A")->getCompartment()};
+    const auto nField{compartment->nVoxels()};
+    REQUIRE(simulate::getOptParamSize(model, optimizeOptions.optParams[0]) ==
+            nField);
+    REQUIRE(simulate::getOptParamSize(model, optimizeOptions.optParams[1]) ==
+            1);
+    REQUIRE(
+        simulate::checkCostGradientSupport(model, optimizeOptions).empty());
+    simulate::OptConstData optConstData;
+    REQUIRE(simulate::initOptConstData(optConstData, model).empty());
+    REQUIRE(optConstData.optParamSizes ==
+            std::vector<std::size_t>{nField, 1});
+    std::vector<double> dv(nField + 1, 0.0);
+    for (std::size_t i = 0; i < nField; ++i) {
+      dv[i] = 0.2 + 0.3 * static_cast<double>(i % 3);
+    }
+    dv.back() = 0.3;
+    // the field values are set for each voxel
+    auto applied{getExampleModel(Mod::ABtoC)};
+    applied.getSpecies().setSampledFieldDiffusionConstant("A", diffusion);
+    applied.getOptimizeOptions() = optimizeOptions;
+    simulate::applyParameters(dv, &applied);
+    REQUIRE(applied.getSpecies().getDiffusionConstantType("A") ==
+            model::SpatialDataType::Image);
+    const auto &values{
+        applied.getSpecies().getField("A")->getDiffusionConstant()};
+    REQUIRE(values.size() == nField);
+    for (std::size_t i = 0; i < nField; ++i) {
+      REQUIRE(values[i] == dbl_approx(dv[i]));
+    }
+    REQUIRE(applied.getReactions().getParameterValue("r1", "k1") ==
+            dbl_approx(dv.back()));
+    auto result{simulate::simulateCostGradient(optConstData, dv,
+                                               []() { return false; })};
+    REQUIRE(result.has_value());
+    REQUIRE(result->gradient.size() == dv.size());
+    // finite differences for a few of the values
+    for (std::size_t i : {std::size_t{0}, nField / 3, nField / 2, nField - 1,
+                          nField}) {
+      CAPTURE(i);
+      const double h{1e-3 * dv[i]};
+      auto dvPlus{dv};
+      dvPlus[i] += h;
+      auto dvMinus{dv};
+      dvMinus[i] -= h;
+      auto plus{simulate::simulateCostGradient(optConstData, dvPlus,
+                                               []() { return false; })};
+      auto minus{simulate::simulateCostGradient(optConstData, dvMinus,
+                                                []() { return false; })};
+      const double fd{(plus->cost - minus->cost) / (2.0 * h)};
+      REQUIRE(result->gradient[i] ==
+              Catch::Approx(fd).epsilon(1e-3).margin(1e-9));
+    }
+    // a uniform field: the sum of the gradient is that of a uniform
+    // diffusion constant
+    std::ranges::fill(dv, 0.4);
+    auto fieldResult{simulate::simulateCostGradient(optConstData, dv,
+                                                    []() { return false; })};
+    REQUIRE(fieldResult.has_value());
+    model.getSpecies().setDiffusionConstant("A", 0.4);
+    simulate::OptConstData uniformOptConstData;
+    REQUIRE(simulate::initOptConstData(uniformOptConstData, model).empty());
+    REQUIRE(uniformOptConstData.optParamSizes ==
+            std::vector<std::size_t>{1, 1});
+    auto uniformResult{simulate::simulateCostGradient(
+        uniformOptConstData, {0.4, 0.4}, []() { return false; })};
+    REQUIRE(uniformResult.has_value());
+    REQUIRE(fieldResult->cost == dbl_approx(uniformResult->cost));
+    double sum{0.0};
+    for (std::size_t i = 0; i < nField; ++i) {
+      sum += fieldResult->gradient[i];
+    }
+    REQUIRE(sum == Catch::Approx(uniformResult->gradient[0]).epsilon(1e-8));
+    REQUIRE(fieldResult->gradient.back() ==
+            Catch::Approx(uniformResult->gradient[1]).epsilon(1e-8));
+  }
+  SECTION("VerySimpleModel: adjoint gradient with membrane reactions") {
+    auto model{getExampleModel(Mod::VerySimpleModel)};
+    setFixedTimestep(model);
+    auto &optimizeOptions{model.getOptimizeOptions()};
+    optimizeOptions.optParams.push_back(
+        {simulate::OptParamType::ReactionParameter, "k1", "k1", "A_uptake",
+         0.01, 1.0});
+    optimizeOptions.optParams.push_back(
+        {simulate::OptParamType::ReactionParameter, "k1", "k1",
+         "A_B_conversion", 0.01, 1.0});
+    optimizeOptions.optCosts.push_back(
+        {simulate::OptCostType::Concentration,
+         simulate::OptCostDiffType::Absolute, "A", "A_c3", 0.2, 1.0, 2, 0, {}});
+    std::vector<double> dv{0.2, 0.5};
+    simulate::OptConstData optConstData;
+    REQUIRE(simulate::initOptConstData(optConstData, model).empty());
+    auto sensitivities{simulate::simulateCostGradient(optConstData, dv, []() {
+      return false;
+    })};
+    REQUIRE(sensitivities.has_value());
+    optimizeOptions.optAlgorithm.adjointGradient = true;
+    REQUIRE(simulate::initOptConstData(optConstData, model).empty());
+    auto adjoint{simulate::simulateCostGradient(optConstData, dv,
+                                                []() { return false; })};
+    REQUIRE(adjoint.has_value());
+    REQUIRE(adjoint->cost == dbl_approx(sensitivities->cost));
+    for (std::size_t i = 0; i < dv.size(); ++i) {
+      CAPTURE(i);
+      REQUIRE(adjoint->gradient[i] ==
+              Catch::Approx(sensitivities->gradient[i]).epsilon(1e-6));
+    }
+  }
+  SECTION("unsupported models") {
+    auto model{getExampleModel(Mod::ABtoC)};
+    setFixedTimestep(model);
+    auto &optimizeOptions{model.getOptimizeOptions()};
+    optimizeOptions.optAlgorithm.optAlgorithmType =
+        simulate::OptAlgorithmType::LBFGS;
+    optimizeOptions.optAlgorithm.islands = 1;
+    optimizeOptions.optAlgorithm.population = 1;
+    optimizeOptions.optParams.push_back(
+        {simulate::OptParamType::ReactionParameter, "k1", "k1", "r1", 0.02,
+         0.88});
+    optimizeOptions.optCosts.push_back(
+        {simulate::OptCostType::Concentration,
+         simulate::OptCostDiffType::Absolute, "A", "A", 0.05, 1.0, 0, 0, {}});
+    REQUIRE(
+        simulate::checkCostGradientSupport(model, optimizeOptions).empty());
+    auto options{optimizeOptions};
+    options.optParams.push_back({simulate::OptParamType::DiffusionConstant,
+                                 "D", "A", "", 0.1, 1.0});
+    REQUIRE(!simulate::checkCostGradientSupport(model, options).empty());
+    // supported by the adjoint gradient
+    options.optAlgorithm.adjointGradient = true;
+    REQUIRE(simulate::checkCostGradientSupport(model, options).empty());
+    options = optimizeOptions;
+    options.optCosts.front().optCostType =
+        simulate::OptCostType::ConcentrationDcdt;
+    REQUIRE(!simulate::checkCostGradientSupport(model, options).empty());
+    model.getSpecies().setStorage("B", 0.0);
+    REQUIRE(
+        !simulate::checkCostGradientSupport(model, optimizeOptions).empty());
+    model.getSpecies().setStorage("B", 1.0);
+    // gradient is only calculated at full resolution
+    options = optimizeOptions;
+    options.optAlgorithm.coarseningFactor = 2;
+    REQUIRE(!simulate::checkCostGradientSupport(model, options).empty());
+    // default adaptive timestep integrator: supported by forward
+    // sensitivities, but not by the adjoint of forwards Euler
+    model.getSimulationSettings().options.pixel.integrator =
+        simulate::PixelIntegratorType::RK212;
+    REQUIRE(
+        simulate::checkCostGradientSupport(model, optimizeOptions).empty());
+    options.optAlgorithm.coarseningFactor = 1;
+    options.optAlgorithm.adjointGradient = true;
+    REQUIRE(!simulate::checkCostGradientSupport(model, options).empty());
+    model.getSimulationSettings().options.pixel.integrator =
+        simulate::PixelIntegratorType::RK101;
+    REQUIRE(simulate::checkCostGradientSupport(model, options).empty());
+    model.getSimulationSettings().simulatorType = simulate::SimulatorType::DUNE;
+    REQUIRE(
+        !simulate::checkCostGradientSupport(model, optimizeOptions).empty());
+    // optimization reports the error
+    simulate::Optimization optimization(model);
+    REQUIRE(!optimization.getErrorMessage().empty());
+    REQUIRE(optimization.evolve() == 0);
+  }
+  SECTION("LBFGS optimization") {
+    auto model{getExampleModel(Mod::ABtoC)};
+    model.getSimulationSettings().simulatorType =
+        simulate::SimulatorType::Pixel;
+    model.getSimulationSettings().options.pixel.integrator =
+        simulate::PixelIntegratorType::RK101;
+    auto &optimizeOptions{model.getOptimizeOptions()};
+    optimizeOptions.optAlgorithm.optAlgorithmType =
+        simulate::OptAlgorithmType::LBFGS;
+    optimizeOptions.optAlgorithm.islands = 1;
+    optimizeOptions.optAlgorithm.population = 1;
+    optimizeOptions.optParams.push_back(
+        {simulate::OptParamType::ReactionParameter, "k1", "k1", "r1", 0.02,
+         0.88});
+    optimizeOptions.optCosts.push_back(
+        {simulate::OptCostType::Concentration,
+         simulate::OptCostDiffType::Absolute, "A", "A", 0.2, 1.0, 0, 0, {}});
+    model.getReactions().setParameterValue("r1", "k1", 0.1);
+    simulate::Optimization optimization(model);
+    REQUIRE(optimization.getErrorMessage().empty());
+    optimization.evolve(2);
+    REQUIRE(optimization.getErrorMessage().empty());
+    // minimizing A: k1 increases towards its upper bound
+    const auto &fitness{optimization.getFitness()};
+    REQUIRE(fitness.size() == 3);
+    REQUIRE(fitness.back() <= fitness.front());
+    REQUIRE(optimization.getParams().back()[0] >=
+            optimization.getParams().front()[0]);
+  }
+  SECTION("fitness is the cost of the gradient simulation") {
+    // default maximum timestep, with the fixed timestep integrator
+    auto model{getExampleModel(Mod::ABtoC)};
+    auto &settings{model.getSimulationSettings()};
+    settings.simulatorType = simulate::SimulatorType::Pixel;
+    settings.options.pixel.integrator = simulate::PixelIntegratorType::RK101;
+    auto &optimizeOptions{model.getOptimizeOptions()};
+    optimizeOptions.optAlgorithm.optAlgorithmType =
+        simulate::OptAlgorithmType::LBFGS;
+    optimizeOptions.optAlgorithm.islands = 1;
+    optimizeOptions.optAlgorithm.population = 1;
+    optimizeOptions.optParams.push_back(
+        {simulate::OptParamType::ReactionParameter, "k1", "k1", "r1", 0.02,
+         0.88});
+    optimizeOptions.optCosts.push_back(
+        {simulate::OptCostType::Concentration,
+         simulate::OptCostDiffType::Absolute, "A", "A", 0.2, 1.0, 0, 0, {}});
+    for (bool adjointGradient : {false, true}) {
+      CAPTURE(adjointGradient);
+      optimizeOptions.optAlgorithm.adjointGradient = adjointGradient;
+      simulate::Optimization optimization(model);
+      REQUIRE(optimization.getErrorMessage().empty());
+      simulate::OptConstData optConstData;
+      REQUIRE(simulate::initOptConstData(optConstData, model).empty());
+      simulate::PagmoUDP udp(&optConstData, nullptr, &optimization);
+      REQUIRE(udp.has_gradient());
+      std::vector<std::vector<double>> targets(1);
+      auto cost{simulate::simulateCost(optConstData, nullptr, {0.3}, targets,
+                                       std::numeric_limits<double>::max(),
+                                       []() { return false; })};
+      REQUIRE(cost.has_value());
+      auto expected{simulate::simulateCostGradient(optConstData, {0.3},
+                                                   []() { return false; })};
+      REQUIRE(expected.has_value());
+      // same timesteps: the gradient simulation cost is the fitness
+      REQUIRE(expected->cost == Catch::Approx(cost->cost).epsilon(1e-10));
+      auto *cache{optimization.getFitnessCache()};
+      REQUIRE(udp.fitness({0.3})[0] == dbl_approx(expected->cost));
+      REQUIRE(cache->size() == 1);
+      // the gradient was calculated by the same simulation
+      auto gradient{udp.gradient({0.3})};
+      REQUIRE(gradient.size() == 1);
+      REQUIRE(gradient[0] == dbl_approx(expected->gradient[0]));
+      REQUIRE(cache->size() == 1);
+      // fitness cache hit
+      REQUIRE(udp.fitness({0.3})[0] == dbl_approx(expected->cost));
+      REQUIRE(cache->getHits() == 1);
+      // best results are from the gradient simulation
+      REQUIRE(optimization.getBestResultsFitness() ==
+              dbl_approx(expected->cost));
+      auto bestValues{optimization.getBestResultValues(0)};
+      REQUIRE(bestValues.size() == targets[0].size());
+      for (std::size_t i = 0; i < bestValues.size(); ++i) {
+        REQUIRE(bestValues[i] ==
+                Catch::Approx(targets[0][i]).epsilon(1e-10).margin(1e-12));
+      }
+    }
+  }
+  SECTION("higher order adaptive timestep integrator") {
+    auto model{getExampleModel(Mod::ABtoC)};
+    auto &settings{model.getSimulationSettings()};
+    settings.simulatorType = simulate::SimulatorType::Pixel;
+    settings.options.pixel.integrator = simulate::PixelIntegratorType::RK323;
+    settings.options.pixel.maxTimestep = 0.002;
+    auto &optimizeOptions{model.getOptimizeOptions()};
+    optimizeOptions.optAlgorithm.optAlgorithmType =
+        simulate::OptAlgorithmType::LBFGS;
+    optimizeOptions.optAlgorithm.islands = 1;
+    optimizeOptions.optAlgorithm.population = 1;
+    optimizeOptions.optParams.push_back(
+        {simulate::OptParamType::ReactionParameter, "k1", "k1", "r1", 0.02,
+         0.88});
+    optimizeOptions.optCosts.push_back(
+        {simulate::OptCostType::Concentration,
+         simulate::OptCostDiffType::Absolute, "A", "A", 0.2, 1.0, 0, 0, {}});
+    simulate::OptConstData optConstData;
+    REQUIRE(simulate::initOptConstData(optConstData, model).empty());
+    REQUIRE(
+        simulate::checkCostGradientSupport(model, optimizeOptions).empty());
+    std::vector<double> dv{0.3};
+    auto result{simulate::simulateCostGradient(optConstData, dv,
+                                               []() { return false; })};
+    REQUIRE(result.has_value());
+    REQUIRE(result->targets.size() == 1);
+    // the sensitivities are integrated with the same integrator as the
+    // model, so the cost agrees with the simulation without sensitivities up
+    // to the integrator tolerance
+    std::vector<std::vector<double>> targets(1);
+    auto cost{simulate::simulateCost(optConstData, nullptr, dv, targets,
+                                     1e300, []() { return false; })};
+    REQUIRE(cost.has_value());
+    REQUIRE(result->cost == Catch::Approx(cost->cost).epsilon(1e-3));
+    auto fd{finiteDifferenceGradient(optConstData, dv)};
+    REQUIRE(result->gradient[0] < 0.0);
+    REQUIRE(result->gradient[0] == Catch::Approx(fd[0]).epsilon(1e-3));
+    // the fitness is the cost of the gradient simulation
+    simulate::Optimization optimization(model);
+    REQUIRE(optimization.getErrorMessage().empty());
+    simulate::PagmoUDP udp(&optConstData, nullptr, &optimization);
+    REQUIRE(udp.fitness(dv)[0] == dbl_approx(result->cost));
+    REQUIRE(udp.gradient(dv)[0] == dbl_approx(result->gradient[0]));
+    REQUIRE(optimization.getBestResultsFitness() ==
+            dbl_approx(result->cost));
+  }
+}
@@ -1,10 +1,11 @@
 #include "optimize_impl.hpp"
+#include "optimize_cache.hpp"
+#include "optimize_gradient.hpp"
+#include "optimize_workers.hpp"
 #include "sme/logger.hpp"
 
 namespace sme::simulate {
 
-namespace {
-
 double calculateFieldCost(const OptCost &optCost,
                           const std::vector<double> &values) {
   double cost{0.0};
@@ -29,6 +30,8 @@ double calculateFieldCost(const OptCost &optCost,
   return cost;
 }
 
+namespace {
+
 double calculateFeatureCost(const OptCost &optCost,
                             const FeatureOptCost &featureOptCost,
                             const std::vector<double> &currentConcentrations) {
@@ -56,13 +59,65 @@ double calculateFeatureCost(const OptCost &optCost,
   return cost;
 }
 
+// a diffusion constant parameter of a species with a sampled field diffusion
+// constant has a value for each voxel of its compartment
+bool isDiffusionConstantField(const sme::model::Model &model,
+                              const OptParam &optParam) {
+  if (optParam.optParamType != OptParamType::DiffusionConstant) {
+    return false;
+  }
+  const QString id{optParam.id.c_str()};
+  const auto &species{model.getSpecies()};
+  const auto *field{species.getField(id)};
+  return species.getDiffusionConstantType(id) ==
+             model::SpatialDataType::Image &&
+         field != nullptr && field->getCompartment() != nullptr;
+}
+
+// sets the diffusion constant of each voxel of the species' compartment to
+// the values starting at index ``offset``
+void applyDiffusionConstantField(const pagmo::vector_double &values,
+                                 std::size_t offset, const QString &id,
+                                 sme::model::Model *model) {
+  auto &species{model->getSpecies()};
+  const auto *compartment{species.getField(id)->getCompartment()};
+  const auto nVoxels{compartment->nVoxels()};
+  if (offset + nVoxels > values.size()) {
+    throw std::invalid_argument(
+        "Optimization: too few values for diffusion constant field");
+  }
+  SPDLOG_INFO("Setting diffusion constant field of species '{}'",
+              id.toStdString());
+  const auto &imageSize{compartment->getImageSize()};
+  auto array{species.getSampledFieldDiffusionConstant(id)};
+  for (std::size_t ix = 0; ix < nVoxels; ++ix) {
+    array[common::voxelArrayIndex(imageSize, compartment->getVoxel(ix),
+                                  true)] = values[offset + ix];
+  }
+  species.setSampledFieldDiffusionConstant(id, array);
+}
+
 } // namespace
 
+std::size_t getOptParamSize(const sme::model::Model &model,
+                            const OptParam &optParam) {
+  if (!isDiffusionConstantField(model, optParam)) {
+    return 1;
+  }
+  return model.getSpecies()
+      .getField(optParam.id.c_str())
+      ->getCompartment()
+      ->nVoxels();
+}
+
 void applyParameters(const pagmo::vector_double &values,
                      sme::model::Model *model) {
   const auto &optParams{model->getOptimizeOptions().optParams};
-  for (std::size_t i = 0; i < values.size(); ++i) {
-    const auto &param{optParams[i]};
+  std::size_t i{0};
+  for (const auto &param : optParams) {
+    if (i >= values.size()) {
+      break;
+    }
     double value{values[i]};
     switch (param.optParamType) {
     case OptParamType::ModelParameter:
@@ -77,6 +132,11 @@ void applyParameters(const pagmo::vector_double &values,
                                               param.id.c_str(), value);
       break;
     case OptParamType::DiffusionConstant:
+      if (isDiffusionConstantField(*model, param)) {
+        applyDiffusionConstantField(values, i, param.id.c_str(), model);
+        i += getOptParamSize(*model, param);
+        continue;
+      }
       SPDLOG_INFO("Setting diffusion constant of species '{}' to {}", param.id,
                   value);
       model->getSpecies().setDiffusionConstant(param.id.c_str(), value);
@@ -84,6 +144,7 @@ void applyParameters(const pagmo::vector_double &values,
     default:
       throw std::invalid_argument("Optimization: Invalid OptParamType");
     }
+    ++i;
   }
 }
 
@@ -142,57 +203,241 @@ double calculateCosts(const std::vector<OptCost> &optCosts,
   return calculateCosts(optConstData, optCostIndices, sim, currentTargets);
 }
 
+std::optional<SimulatedCost>
+simulateCost(const OptConstData &optConstData, ThreadsafeModelQueue *modelQueue,
+             const pagmo::vector_double &dv,
+             std::vector<std::vector<double>> &currentTargets,
+             double earlyTerminationThreshold,
+             const std::function<bool()> &isStopping) {
+  std::shared_ptr<sme::model::Model> m;
+  if (modelQueue == nullptr || !modelQueue->try_pop(m)) {
+    SPDLOG_INFO("model queue missing or empty: constructing model");
+    m = std::make_shared<sme::model::Model>();
+    m->importSBMLString(optConstData.xmlModel);
+  }
+  m->getSimulationData().clear();
+  applyParameters(dv, m.get());
+  sme::simulate::Simulation sim(*m);
+  SimulatedCost result{0.0, true};
+  const auto &optTimesteps{optConstData.optTimesteps};
+  for (std::size_t i = 0; i < optTimesteps.size(); ++i) {
+    const auto &optTimestep{optTimesteps[i]};
+    sim.doMultipleTimesteps({{1, optTimestep.simulationTime}}, -1, isStopping);
+    if (isStopping()) {
+      return {};
+    }
+    result.cost += calculateCosts(optConstData, optTimestep.optCostIndices,
+                                  sim, currentTargets);
+    // costs are non-negative, so the partial cost is a lower bound on the
+    // final cost: stop if this is already too large
+    if (i + 1 < optTimesteps.size() &&
+        result.cost > earlyTerminationThreshold) {
+      // penalise by extrapolating the partial cost to all timesteps
+      result.cost *= static_cast<double>(optTimesteps.size()) /
+                     static_cast<double>(i + 1);
+      result.complete = false;
+      SPDLOG_DEBUG("Early termination after {}/{} timesteps: cost {}", i + 1,
+                   optTimesteps.size(), result.cost);
+      break;
+    }
+  }
+  if (modelQueue != nullptr) {
+    modelQueue->push(std::move(m));
+  }
+  return result;
+}
+
 PagmoUDP::PagmoUDP(const OptConstData *optConstData,
                    ThreadsafeModelQueue *modelQueue,
                    sme::simulate::Optimization *optimization)
     : m_optConstData{optConstData}, m_modelQueue{modelQueue},
       m_optimization{optimization} {}
 
+std::optional<SimulatedCost> PagmoUDP::evaluateCost(
+    const OptConstData &optConstData, ThreadsafeModelQueue *modelQueue,
+    std::size_t workerModelIndex, const pagmo::vector_double &dv,
+    std::vector<std::vector<double>> &currentTargets,
+    double earlyTerminationThreshold, double bestFitness) const {
+  if (auto *workerPool{m_optimization->getWorkerPool()};
+      workerPool != nullptr) {
+    return workerPool->evaluate(workerModelIndex, dv, currentTargets,
+                                earlyTerminationThreshold, bestFitness);
+  }
+  return simulateCost(optConstData, modelQueue, dv, currentTargets,
+                      earlyTerminationThreshold,
+                      [this]() { return m_optimization->getIsStopping(); });
+}
+
+std::optional<SimulatedCostGradient>
+PagmoUDP::evaluateCostGradient(const pagmo::vector_double &dv) const {
+  // enough for the most recent parameters of each island
+  constexpr std::size_t maxCostGradients{64};
+  {
+    std::scoped_lock lock{m_costGradients->mutex};
+    for (const auto &[x, costGradient] : m_costGradients->entries) {
+      if (x == dv) {
+        return costGradient;
+      }
+    }
+  }
+  std::optional<SimulatedCostGradient> result;
+  if (auto *workerPool{m_optimization->getWorkerPool()};
+      workerPool != nullptr) {
+    result = workerPool->evaluateGradient(
+        0, dv, m_optConstData->optimizeOptions.optCosts.size(),
+        m_optimization->getBestResultsFitness());
+  } else {
+    result = simulateCostGradient(
+        *m_optConstData, dv,
+        [this]() { return m_optimization->getIsStopping(); });
+  }
+  if (!result.has_value()) {
+    return {};
+  }
+  // the fitness of gradient-based algorithms is the cost of this simulation
+  m_optimization->getFitnessCache()->insert(1, dv, result->cost);
+  // the targets are only set by a worker if the cost is lower than the best
+  if (!result->targets.empty() &&
+      m_optimization->setBestResults(result->cost,
+                                     std::move(result->targets))) {
+    SPDLOG_INFO("Updated current best results with cost {}", result->cost);
+  }
+  result->targets.clear();
+  std::scoped_lock lock{m_costGradients->mutex};
+  m_costGradients->entries.emplace_front(dv, *result);
+  if (m_costGradients->entries.size() > maxCostGradients) {
+    m_costGradients->entries.pop_back();
+  }
+  return result;
+}
+
+void PagmoUDP::updateBestResults(const pagmo::vector_double &dv) const {
+  constexpr double maxCost{std::numeric_limits<double>::max()};
+  std::vector<std::vector<double>> currentTargets(
+      m_optConstData->optimizeOptions.optCosts.size(), std::vector<double>{});
+  auto cost{evaluateCost(*m_optConstData, m_modelQueue, 0, dv, currentTargets,
+                         maxCost, m_optimization->getBestResultsFitness())};
+  if (!cost.has_value() || !cost->complete) {
+    return;
+  }
+  m_optimization->getFitnessCache()->insert(1, dv, cost->cost);
+  if (m_optimization->setBestResults(cost->cost, std::move(currentTargets))) {
+    SPDLOG_INFO("Updated current best results with cost {}", cost->cost);
+  }
+}
+
 [[nodiscard]] pagmo::vector_double
 PagmoUDP::fitness(const pagmo::vector_double &dv) const {
-  std::shared_ptr<sme::model::Model> m;
+  constexpr double maxCost{std::numeric_limits<double>::max()};
   if (m_optimization->getIsStopping()) {
-    return {std::numeric_limits<double>::max()};
+    return {maxCost};
   }
-  if (m_modelQueue == nullptr || !m_modelQueue->try_pop(m)) {
-    SPDLOG_INFO("model queue missing or empty: constructing model");
-    m = std::make_shared<sme::model::Model>();
-    m->importSBMLString(m_optConstData->xmlModel);
+  const double earlyTerminationFactor{
+      m_optConstData->optimizeOptions.optAlgorithm.earlyTerminationFactor};
+  auto threshold = [earlyTerminationFactor](double bestFitness) {
+    return earlyTerminationFactor > 0.0
+               ? std::min(earlyTerminationFactor * bestFitness, maxCost)
+               : maxCost;
+  };
+  const auto *coarseLevel{m_optimization->getCoarseLevel()};
+  auto *cache{m_optimization->getFitnessCache()};
+  // promote competitive candidates to full resolution to update the best
+  // results, unless their full resolution cost is known not to be better
+  auto promote = [this, cache, &dv]() {
+    if (auto cost{cache->peek(1, dv)};
+        !cost.has_value() ||
+        *cost < m_optimization->getBestResultsFitness()) {
+      updateBestResults(dv);
+    }
+  };
+  if (auto cached{cache->find(coarseLevel == nullptr ? 1 : coarseLevel->factor,
+                              dv)};
+      cached.has_value()) {
+    // the best results may not include a cached cost, e.g. from the cache
+    // file of a previous optimization: simulate it once to get its targets
+    if (coarseLevel == nullptr) {
+      if (*cached < m_optimization->getBestResultsFitness()) {
+        updateBestResults(dv);
+      }
+    } else if (m_optimization->setBestCoarseFitness(*cached)) {
+      promote();
+    }
+    return {*cached};
+  }
+  if (has_gradient()) {
+    // the gradient is needed next, and is calculated with the cost
+    auto result{evaluateCostGradient(dv)};
+    if (!result.has_value()) {
+      return {maxCost};
+    }
+    return {result->cost};
   }
-  m->getSimulationData().clear();
-  applyParameters(dv, m.get());
-  sme::simulate::Simulation sim(*m);
-  double cost{0.0};
   std::vector<std::vector<double>> currentTargets(
       m_optConstData->optimizeOptions.optCosts.size(), std::vector<double>{});
-  for (const auto &optTimestep : m_optConstData->optTimesteps) {
-    sim.doMultipleTimesteps({{1, optTimestep.simulationTime}}, -1, [this]() {
-      return m_optimization->getIsStopping();
-    });
-    if (m_optimization->getIsStopping()) {
-      return {std::numeric_limits<double>::max()};
+  if (coarseLevel != nullptr) {
+    std::vector<std::vector<double>> coarseTargets(currentTargets.size());
+    // coarse targets are not needed: a best fitness of -max means the workers
+    // never send them
+    auto coarseCost{evaluateCost(
+        *coarseLevel->optConstData, coarseLevel->modelQueue.get(),
+        coarseLevel->workerModelIndex, dv, coarseTargets,
+        threshold(m_optimization->getBestCoarseFitness()), -maxCost)};
+    if (!coarseCost.has_value()) {
+      return {maxCost};
+    }
+    if (coarseCost->complete) {
+      cache->insert(coarseLevel->factor, dv, coarseCost->cost);
+    }
+    if (coarseCost->complete &&
+        m_optimization->setBestCoarseFitness(coarseCost->cost)) {
+      promote();
     }
-    cost += calculateCosts(*m_optConstData, optTimestep.optCostIndices, sim,
-                           currentTargets);
+    return {coarseCost->cost};
   }
-  if (m_optimization->setBestResults(cost, std::move(currentTargets))) {
-    SPDLOG_INFO("Updated current best results with cost {}", cost);
+  const double bestFitness{m_optimization->getBestResultsFitness()};
+  auto cost{evaluateCost(*m_optConstData, m_modelQueue, 0, dv, currentTargets,
+                         threshold(bestFitness), bestFitness)};
+  if (!cost.has_value()) {
+    return {maxCost};
   }
-  if (m_modelQueue != nullptr) {
-    m_modelQueue->push(std::move(m));
+  // early terminated costs depend on the best fitness, so are not cached
+  if (cost->complete) {
+    cache->insert(1, dv, cost->cost);
   }
-  return {cost};
+  if (cost->complete &&
+      m_optimization->setBestResults(cost->cost, std::move(currentTargets))) {
+    SPDLOG_INFO("Updated current best results with cost {}", cost->cost);
+  }
+  return {cost->cost};
+}
+
+[[nodiscard]] pagmo::vector_double
+PagmoUDP::gradient(const pagmo::vector_double &dv) const {
+  if (m_optimization->getIsStopping()) {
+    return pagmo::vector_double(dv.size(), 0.0);
+  }
+  auto result{evaluateCostGradient(dv)};
+  if (!result.has_value()) {
+    return pagmo::vector_double(dv.size(), 0.0);
+  }
+  return result->gradient;
+}
+
+[[nodiscard]] bool PagmoUDP::has_gradient() const {
+  return m_optConstData != nullptr &&
+         m_optConstData->optimizeOptions.optAlgorithm.optAlgorithmType ==
+             OptAlgorithmType::LBFGS;
 }
 
 [[nodiscard]] std::pair<pagmo::vector_double, pagmo::vector_double>
 PagmoUDP::get_bounds() const {
   std::pair<pagmo::vector_double, pagmo::vector_double> bounds;
   const auto &optParams{m_optConstData->optimizeOptions.optParams};
-  bounds.first.reserve(optParams.size());
-  bounds.second.reserve(optParams.size());
-  for (const auto &optParam : optParams) {
-    bounds.first.push_back(optParam.lowerBound);
-    bounds.second.push_back(optParam.upperBound);
+  const auto &sizes{m_optConstData->optParamSizes};
+  for (std::size_t i = 0; i < optParams.size(); ++i) {
+    bounds.first.insert(bounds.first.end(), sizes[i], optParams[i].lowerBound);
+    bounds.second.insert(bounds.second.end(), sizes[i],
+                         optParams[i].upperBound);
   }
   return bounds;
 }
@@ -1,16 +1,41 @@
+#pragma once
+
+#include "optimize_gradient.hpp"
 #include "sme/logger.hpp"
 #include "sme/model.hpp"
 #include "sme/optimize.hpp"
 #include "sme/simulate.hpp"
 #include "sme/utils.hpp"
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <pagmo/algorithms/pso.hpp>
+#include <utility>
 
 namespace sme::simulate {
 
+/**
+ * @brief The number of values of an optimization parameter
+ *
+ * A diffusion constant parameter of a species with a sampled field diffusion
+ * constant has one value for each voxel of the species' compartment. Other
+ * parameters have a single value.
+ */
+std::size_t getOptParamSize(const sme::model::Model &model,
+                            const OptParam &optParam);
+
 void applyParameters(const pagmo::vector_double &values,
                      sme::model::Model *model);
 
+/**
+ * @brief The sum of squared differences of ``values`` from the target values
+ */
+double calculateFieldCost(const OptCost &optCost,
+                          const std::vector<double> &values);
+
 double calculateCosts(const OptConstData &optConstData,
                       const std::vector<std::size_t> &optCostIndices,
                       const sme::simulate::Simulation &sim,
@@ -20,19 +45,67 @@ double calculateCosts(const std::vector<OptCost> &optCosts,
                       const sme::simulate::Simulation &sim,
                       std::vector<std::vector<double>> &currentTargets);
 
+std::string initOptConstData(OptConstData &optConstData,
+                             sme::model::Model &model);
+
+struct SimulatedCost {
+  double cost;
+  // false if the simulation was stopped early
+  bool complete;
+};
+
+/**
+ * @brief Simulate the model with parameters ``dv`` and return the cost
+ *
+ * The simulation is stopped early if the partial cost exceeds
+ * ``earlyTerminationThreshold``. Returns ``{}`` if ``isStopping`` returns
+ * true.
+ */
+std::optional<SimulatedCost>
+simulateCost(const OptConstData &optConstData, ThreadsafeModelQueue *modelQueue,
+             const pagmo::vector_double &dv,
+             std::vector<std::vector<double>> &currentTargets,
+             double earlyTerminationThreshold,
+             const std::function<bool()> &isStopping);
+
 /**
  * @brief Implements a Pagmo User Defined Problem to evolve
  *
  * @note Needs to be (cheaply) copy-constructible, implement `fitness()` and
  * `get_bounds()` functions, and be thread-safe, see
  * https://esa.github.io/pagmo2/docs/cpp/problem.html
+ *
+ * The `gradient()` of the fitness is only provided for gradient-based
+ * algorithms, since it requires a more expensive simulation. For these
+ * algorithms the fitness and the best results are calculated by the same
+ * simulation as the gradient, so each set of parameters is only simulated
+ * once.
  */
 
 class PagmoUDP {
 private:
+  // the most recent cost gradients, shared by all copies of the problem
+  struct CostGradients {
+    std::mutex mutex;
+    std::deque<std::pair<pagmo::vector_double, SimulatedCostGradient>>
+        entries;
+  };
   const OptConstData *m_optConstData{nullptr};
   ThreadsafeModelQueue *m_modelQueue{nullptr};
   sme::simulate::Optimization *m_optimization{nullptr};
+  std::shared_ptr<CostGradients> m_costGradients{
+      std::make_shared<CostGradients>()};
+  std::optional<SimulatedCostGradient>
+  evaluateCostGradient(const pagmo::vector_double &dv) const;
+  std::optional<SimulatedCost>
+  evaluateCost(const OptConstData &optConstData,
+               ThreadsafeModelQueue *modelQueue, std::size_t workerModelIndex,
+               const pagmo::vector_double &dv,
+               std::vector<std::vector<double>> &currentTargets,
+               double earlyTerminationThreshold, double bestFitness) const;
+  // simulate ``dv`` at full resolution, and use it as the best results if
+  // its cost is lower than the current best
+  void updateBestResults(const pagmo::vector_double &dv) const;
 
 public:
   PagmoUDP() = default;
@@ -41,6 +114,9 @@ public:
                     Optimization *optimization);
   [[nodiscard]] pagmo::vector_double
   fitness(const pagmo::vector_double &dv) const;
+  [[nodiscard]] pagmo::vector_double
+  gradient(const pagmo::vector_double &dv) const;
+  [[nodiscard]] bool has_gradient() const;
   [[nodiscard]] std::pair<pagmo::vector_double, pagmo::vector_double>
   get_bounds() const;
 };
@@ -1,10 +1,12 @@
 #include "catch_wrapper.hpp"
 #include "model_test_utils.hpp"
+#include "optimize_cache.hpp"
 #include "optimize_impl.hpp"
 #include "sme/model.hpp"
 #include "sme/optimize.hpp"
 #include "sme/utils.hpp"
 #include <algorithm>
+#include <limits>
 
 using namespace sme;
 using namespace sme::test;
@@ -452,3 +454,109 @@ TEST_CASE("Optimize calculateCosts: feature target values",
   REQUIRE_THROWS(
       simulate::calculateCosts(invalidOptConstData, {0}, sim, currentTargets));
 }
+
+TEST_CASE("Optimize PagmoUDP: early termination",
+          "[core/simulate/optimize][core/simulate][core][optimize]") {
+  auto model{getExampleModel(Mod::ABtoC)};
+  model.getSimulationSettings().simulatorType =
+      sme::simulate::SimulatorType::Pixel;
+  // costs: concentration of species A at times 1 and 2
+  simulate::OptCost optCost{};
+  optCost.optCostType = simulate::OptCostType::Concentration;
+  optCost.optCostDiffType = simulate::OptCostDiffType::Absolute;
+  optCost.name = "name";
+  optCost.id = "A";
+  optCost.simulationTime = 1.0;
+  optCost.weight = 1.0;
+  auto optCost2{optCost};
+  optCost2.simulationTime = 2.0;
+  auto &optimizeOptions{model.getOptimizeOptions()};
+  optimizeOptions.optParams.push_back(
+      {simulate::OptParamType::ReactionParameter, "name", "k1", "r1", 0.05,
+       0.21});
+  optimizeOptions.optCosts = {optCost, optCost2};
+  SECTION("invalid factor") {
+    optimizeOptions.optAlgorithm.earlyTerminationFactor = 0.5;
+    simulate::Optimization optimization(model);
+    REQUIRE(optimization.getErrorMessage() ==
+            "Invalid early termination factor, must be zero or at least 1");
+  }
+  SECTION("valid factor") {
+    simulate::Optimization optimization(model);
+    REQUIRE(optimization.getErrorMessage().empty());
+    auto optConstData{makeOptConstData(model, optimizeOptions.optCosts)};
+    optConstData.xmlModel = model.getXml().toStdString();
+    optConstData.optimizeOptions.optAlgorithm.earlyTerminationFactor = 2.0;
+    optConstData.optTimesteps = {{1.0, {0}}, {1.0, {1}}};
+    simulate::PagmoUDP udp(&optConstData, nullptr, &optimization);
+    // no best results yet: full evaluation
+    REQUIRE(optimization.getBestResultsFitness() ==
+            std::numeric_limits<double>::max());
+    double cost{udp.fitness({0.1})[0]};
+    REQUIRE(cost > 0.0);
+    REQUIRE(optimization.getBestResultsFitness() == dbl_approx(cost));
+    // identical parameters: cached cost
+    REQUIRE(udp.fitness({0.1})[0] == dbl_approx(cost));
+    REQUIRE(optimization.getFitnessCache()->getHits() == 1);
+    // partial cost cannot exceed twice the best cost: full evaluation
+    REQUIRE(udp.fitness({0.11})[0] > 0.0);
+    REQUIRE(optimization.getFitnessCache()->size() == 2);
+    // much better best cost: evaluation stopped after first timestep, and
+    // the partial cost is extrapolated to both timesteps
+    optimization.setBestResults(1e-3 * cost, {});
+    double penalisedCost{udp.fitness({0.12})[0]};
+    REQUIRE(penalisedCost > 2e-3 * cost);
+    // early terminated costs are not cached
+    REQUIRE(optimization.getFitnessCache()->size() == 2);
+    optConstData.optTimesteps = {{1.0, {0}}};
+    REQUIRE(penalisedCost == dbl_approx(2.0 * udp.fitness({0.12})[0]));
+    REQUIRE(optimization.getBestResultsFitness() == dbl_approx(1e-3 * cost));
+  }
+}
+
+TEST_CASE("Optimize PagmoUDP: cached fitness updates best results",
+          "[core/simulate/optimize][core/simulate][core][optimize]") {
+  auto model{getExampleModel(Mod::ABtoC)};
+  model.getSimulationSettings().simulatorType =
+      sme::simulate::SimulatorType::Pixel;
+  simulate::OptCost optCost{};
+  optCost.optCostType = simulate::OptCostType::Concentration;
+  optCost.optCostDiffType = simulate::OptCostDiffType::Absolute;
+  optCost.name = "name";
+  optCost.id = "A";
+  optCost.simulationTime = 1.0;
+  optCost.weight = 1.0;
+  auto &optimizeOptions{model.getOptimizeOptions()};
+  optimizeOptions.optParams.push_back(
+      {simulate::OptParamType::ReactionParameter, "name", "k1", "r1", 0.05,
+       0.21});
+  optimizeOptions.optCosts = {optCost};
+  simulate::Optimization optimization(model);
+  REQUIRE(optimization.getErrorMessage().empty());
+  auto optConstData{makeOptConstData(model, optimizeOptions.optCosts)};
+  optConstData.xmlModel = model.getXml().toStdString();
+  optConstData.optTimesteps = {{1.0, {0}}};
+  simulate::PagmoUDP udp(&optConstData, nullptr, &optimization);
+  std::vector<std::vector<double>> targets(1);
+  auto expected{simulate::simulateCost(optConstData, nullptr, {0.1}, targets,
+                                       std::numeric_limits<double>::max(),
+                                       []() { return false; })};
+  REQUIRE(expected.has_value());
+  // cost cached by a previous optimization, but not in the best results
+  auto *cache{optimization.getFitnessCache()};
+  cache->insert(1, {0.1}, expected->cost);
+  REQUIRE(optimization.getBestResultsFitness() ==
+          std::numeric_limits<double>::max());
+  // cache hit: re-simulated once to get the best results
+  REQUIRE(udp.fitness({0.1})[0] == dbl_approx(expected->cost));
+  REQUIRE(cache->getHits() == 1);
+  REQUIRE(optimization.getBestResultsFitness() == dbl_approx(expected->cost));
+  auto values{optimization.getBestResultValues(0)};
+  REQUIRE(values.size() == targets[0].size());
+  REQUIRE(values.front() == dbl_approx(targets[0].front()));
+  // already the best results: cached cost is returned
+  REQUIRE(udp.fitness({0.1})[0] == dbl_approx(expected->cost));
+  REQUIRE(cache->getHits() == 2);
+  REQUIRE(optimization.getBestResultsFitness() == dbl_approx(expected->cost));
+  REQUIRE(optimization.getBestResultValues(0) == values);
+}
@@ -33,6 +33,10 @@ std::string toString(OptAlgorithmType optAlgorithmType) {
     return "Augmented Lagrangian method";
   case PRAXIS:
     return "Brent's principle axis method";
+  case Surrogate:
+    return "Surrogate-assisted optimization (Gaussian process)";
+  case LBFGS:
+    return "Limited-memory BFGS (gradient-based)";
   default:
     return "";
   }
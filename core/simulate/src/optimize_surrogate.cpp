@@ -0,0 +1,315 @@
+#include "optimize_surrogate.hpp"
+#include "sme/logger.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numbers>
+#include <numeric>
+#include <utility>
+
+namespace sme::simulate {
+
+static double squaredDistance(const std::vector<double> &a,
+                              const std::vector<double> &b) {
+  double sum{0.0};
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    sum += (a[i] - b[i]) * (a[i] - b[i]);
+  }
+  return sum;
+}
+
+double GaussianProcess::kernel(const std::vector<double> &a,
+                               const std::vector<double> &b) const {
+  return std::exp(-0.5 * squaredDistance(a, b) / (lengthScale * lengthScale));
+}
+
+double GaussianProcess::factorize(double lengthScaleCandidate,
+                                  const std::vector<double> &yStandardised) {
+  // Cholesky factorization of the kernel matrix, returns log likelihood
+  constexpr double nugget{1e-6};
+  lengthScale = lengthScaleCandidate;
+  const std::size_t n{xTrain.size()};
+  cholesky.assign(n * n, 0.0);
+  auto l = [this, n](std::size_t i, std::size_t j) -> double & {
+    return cholesky[i * n + j];
+  };
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t j = 0; j <= i; ++j) {
+      double sum{kernel(xTrain[i], xTrain[j])};
+      if (i == j) {
+        sum += nugget;
+      }
+      for (std::size_t k = 0; k < j; ++k) {
+        sum -= l(i, k) * l(j, k);
+      }
+      if (i == j) {
+        if (sum <= 0.0) {
+          return -std::numeric_limits<double>::max();
+        }
+        l(i, i) = std::sqrt(sum);
+      } else {
+        l(i, j) = sum / l(j, j);
+      }
+    }
+  }
+  // alpha = K^-1 y
+  alpha = yStandardised;
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t k = 0; k < i; ++k) {
+      alpha[i] -= l(i, k) * alpha[k];
+    }
+    alpha[i] /= l(i, i);
+  }
+  double logLikelihood{-0.5 * std::inner_product(alpha.cbegin(), alpha.cend(),
+                                                  alpha.cbegin(), 0.0)};
+  for (std::size_t i = n; i-- > 0;) {
+    for (std::size_t k = i + 1; k < n; ++k) {
+      alpha[i] -= l(k, i) * alpha[k];
+    }
+    alpha[i] /= l(i, i);
+    logLikelihood -= std::log(l(i, i));
+  }
+  return logLikelihood;
+}
+
+bool GaussianProcess::fit(const std::vector<std::vector<double>> &x,
+                          const std::vector<double> &y) {
+  if (x.size() < 2 || x.size() != y.size()) {
+    return false;
+  }
+  xTrain = x;
+  yMean = std::accumulate(y.cbegin(), y.cend(), 0.0) /
+          static_cast<double>(y.size());
+  double variance{0.0};
+  for (double v : y) {
+    variance += (v - yMean) * (v - yMean);
+  }
+  variance /= static_cast<double>(y.size());
+  yScale = variance > 0.0 ? std::sqrt(variance) : 1.0;
+  std::vector<double> yStandardised(y.size());
+  std::ranges::transform(y, yStandardised.begin(),
+                         [this](double v) { return (v - yMean) / yScale; });
+  const auto dim{std::max(x.front().size(), std::size_t{1})};
+  const double dimensionScale{std::sqrt(static_cast<double>(dim))};
+  double bestLengthScale{dimensionScale};
+  double bestLogLikelihood{-std::numeric_limits<double>::max()};
+  for (double candidate : {0.05, 0.1, 0.2, 0.4, 0.8}) {
+    candidate *= dimensionScale;
+    if (double logLikelihood{factorize(candidate, yStandardised)};
+        logLikelihood > bestLogLikelihood) {
+      bestLogLikelihood = logLikelihood;
+      bestLengthScale = candidate;
+    }
+  }
+  factorize(bestLengthScale, yStandardised);
+  SPDLOG_DEBUG("{} points, length scale {}, log likelihood {}", x.size(),
+               lengthScale, bestLogLikelihood);
+  return true;
+}
+
+std::pair<double, double>
+GaussianProcess::predict(const std::vector<double> &x) const {
+  const std::size_t n{xTrain.size()};
+  if (n == 0) {
+    return {yMean, yScale};
+  }
+  std::vector<double> k(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    k[i] = kernel(x, xTrain[i]);
+  }
+  double mean{std::inner_product(k.cbegin(), k.cend(), alpha.cbegin(), 0.0)};
+  // variance = k(x,x) - |L^-1 k|^2
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t j = 0; j < i; ++j) {
+      k[i] -= cholesky[i * n + j] * k[j];
+    }
+    k[i] /= cholesky[i * n + i];
+  }
+  double variance{
+      1.0 - std::inner_product(k.cbegin(), k.cend(), k.cbegin(), 0.0)};
+  return {yMean + yScale * mean, yScale * std::sqrt(std::max(variance, 0.0))};
+}
+
+double GaussianProcess::expectedImprovement(const std::vector<double> &x,
+                                            double yMin) const {
+  auto [mean, sigma] = predict(x);
+  if (sigma <= 0.0) {
+    return std::max(yMin - mean, 0.0);
+  }
+  const double z{(yMin - mean) / sigma};
+  const double pdf{std::exp(-0.5 * z * z) / std::sqrt(2.0 * std::numbers::pi)};
+  const double cdf{0.5 * std::erfc(-z / std::numbers::sqrt2)};
+  return (yMin - mean) * cdf + sigma * pdf;
+}
+
+double GaussianProcess::getLengthScale() const { return lengthScale; }
+
+SurrogateAlgorithm::SurrogateAlgorithm(std::size_t evaluationsPerGeneration,
+                                       std::size_t maxTrainingPoints,
+                                       unsigned seed)
+    : evaluationsPerGeneration{std::max(evaluationsPerGeneration,
+                                        std::size_t{1})},
+      maxTrainingPoints{std::max(maxTrainingPoints, std::size_t{2})},
+      rng{seed} {}
+
+pagmo::population SurrogateAlgorithm::evolve(pagmo::population pop) const {
+  const auto &prob{pop.get_problem()};
+  const auto bounds{prob.get_bounds()};
+  const auto &lb{bounds.first};
+  const auto &ub{bounds.second};
+  const std::size_t dim{lb.size()};
+  if (pop.size() == 0 || dim == 0) {
+    return pop;
+  }
+  auto toUnit = [&lb, &ub](const pagmo::vector_double &x) {
+    std::vector<double> u(x.size());
+    for (std::size_t i = 0; i < x.size(); ++i) {
+      u[i] = ub[i] > lb[i] ? (x[i] - lb[i]) / (ub[i] - lb[i]) : 0.0;
+    }
+    return u;
+  };
+  auto fromUnit = [&lb, &ub](const std::vector<double> &u) {
+    pagmo::vector_double x(u.size());
+    for (std::size_t i = 0; i < u.size(); ++i) {
+      x[i] = lb[i] + std::clamp(u[i], 0.0, 1.0) * (ub[i] - lb[i]);
+    }
+    return x;
+  };
+  // islands share the archive, so also use the population seed to ensure
+  // each one proposes different candidates
+  std::mt19937 gen(rng() ^ pop.get_seed());
+  std::vector<std::vector<double>> xTrain;
+  std::vector<double> fTrain;
+  {
+    // add the current population to the archive and keep the best points
+    std::scoped_lock lock(archive->mutex);
+    for (std::size_t i = 0; i < pop.size(); ++i) {
+      const auto &x{pop.get_x()[i]};
+      if (std::ranges::find(archive->x, x) == archive->x.cend()) {
+        archive->x.push_back(x);
+        archive->f.push_back(pop.get_f()[i][0]);
+      }
+    }
+    std::vector<std::size_t> order(archive->x.size());
+    std::iota(order.begin(), order.end(), 0);
+    // sort by cost, with any NaN costs last
+    auto cost = [this](std::size_t i) {
+      double f{archive->f[i]};
+      return std::isnan(f) ? std::numeric_limits<double>::infinity() : f;
+    };
+    std::ranges::stable_sort(order, [&cost](std::size_t a, std::size_t b) {
+      return cost(a) < cost(b);
+    });
+    if (order.size() > maxTrainingPoints) {
+      order.resize(maxTrainingPoints);
+    }
+    std::vector<pagmo::vector_double> xArchive;
+    std::vector<double> fArchive;
+    for (std::size_t i : order) {
+      xArchive.push_back(std::move(archive->x[i]));
+      fArchive.push_back(archive->f[i]);
+      // exclude failed evaluations that return a huge or non-finite cost
+      if (double f{fArchive.back()};
+          std::isfinite(f) && f < 0.5 * std::numeric_limits<double>::max()) {
+        xTrain.push_back(toUnit(xArchive.back()));
+        fTrain.push_back(f);
+      }
+    }
+    archive->x = std::move(xArchive);
+    archive->f = std::move(fArchive);
+  }
+  // model strictly positive costs on a log scale
+  const bool logScale{!fTrain.empty() &&
+                      std::ranges::all_of(fTrain, [](double f) {
+                        return f > 0.0;
+                      })};
+  std::vector<double> yTrain(fTrain);
+  if (logScale) {
+    std::ranges::transform(yTrain, yTrain.begin(),
+                           [](double f) { return std::log(f); });
+  }
+  GaussianProcess gp;
+  const bool haveModel{gp.fit(xTrain, yTrain)};
+  // candidates: half uniform random, half perturbations of the best points
+  const std::size_t nCandidates{std::min(200 * dim, std::size_t{2000})};
+  const std::size_t nBest{std::min(xTrain.size(), std::size_t{5})};
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  std::normal_distribution<double> normal(0.0, 1.0);
+  std::vector<std::vector<double>> candidates;
+  candidates.reserve(nCandidates);
+  for (std::size_t i = 0; i < nCandidates; ++i) {
+    std::vector<double> u(dim);
+    if (nBest > 0 && i % 2 == 1) {
+      const auto &xBest{xTrain[i / 2 % nBest]};
+      const double sigma{std::pow(10.0, -3.0 * uniform(gen))};
+      for (std::size_t j = 0; j < dim; ++j) {
+        u[j] = std::clamp(xBest[j] + 0.1 * sigma * normal(gen), 0.0, 1.0);
+      }
+    } else {
+      for (auto &uj : u) {
+        uj = uniform(gen);
+      }
+    }
+    candidates.push_back(std::move(u));
+  }
+  // evaluate the candidates with the largest expected improvement
+  std::vector<double> score(nCandidates, 0.0);
+  if (haveModel) {
+    const double yMin{*std::ranges::min_element(yTrain)};
+    for (std::size_t i = 0; i < nCandidates; ++i) {
+      score[i] = gp.expectedImprovement(candidates[i], yMin);
+    }
+  }
+  std::vector<std::size_t> order(nCandidates);
+  std::iota(order.begin(), order.end(), 0);
+  std::ranges::stable_sort(order, [&score](std::size_t a, std::size_t b) {
+    return score[a] > score[b];
+  });
+  constexpr double minSquaredDistance{1e-12};
+  std::vector<std::vector<double>> selected;
+  for (std::size_t i : order) {
+    if (selected.size() >= evaluationsPerGeneration) {
+      break;
+    }
+    const auto &u{candidates[i]};
+    auto isNear = [&u](const std::vector<double> &v) {
+      return squaredDistance(u, v) < minSquaredDistance;
+    };
+    if (std::ranges::none_of(xTrain, isNear) &&
+        std::ranges::none_of(selected, isNear)) {
+      selected.push_back(u);
+    }
+  }
+  for (const auto &u : selected) {
+    auto x{fromUnit(u)};
+    auto f{prob.fitness(x)};
+    {
+      std::scoped_lock lock(archive->mutex);
+      archive->x.push_back(x);
+      archive->f.push_back(f[0]);
+      ++archive->nEvaluations;
+    }
+    const auto worst{pop.worst_idx()};
+    if (f[0] < pop.get_f()[worst][0]) {
+      pop.set_xf(worst, x, f);
+    }
+  }
+  return pop;
+}
+
+std::string SurrogateAlgorithm::get_name() const {
+  return "Surrogate-assisted optimization";
+}
+
+std::size_t SurrogateAlgorithm::getEvaluations() const {
+  std::scoped_lock lock(archive->mutex);
+  return archive->nEvaluations;
+}
+
+void SurrogateAlgorithm::clearArchive() {
+  std::scoped_lock lock(archive->mutex);
+  archive->x.clear();
+  archive->f.clear();
+}
+
+} // namespace sme::simulate
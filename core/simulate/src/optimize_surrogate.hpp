@@ -0,0 +1,126 @@
+// Surrogate-assisted optimization
+//  - GaussianProcess: Gaussian process regression surrogate model
+//  - SurrogateAlgorithm: pagmo user defined algorithm using the surrogate
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <pagmo/population.hpp>
+#include <pagmo/rng.hpp>
+#include <pagmo/types.hpp>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace sme::simulate {
+
+/**
+ * @brief Gaussian process regression with a squared exponential kernel.
+ *
+ * The inputs should be scaled to the unit hypercube. The outputs are
+ * standardised, and the kernel length scale is chosen from a set of
+ * candidates by maximizing the marginal likelihood.
+ */
+class GaussianProcess {
+public:
+  /**
+   * @brief Fit the model to the points ``x`` with values ``y``.
+   * @returns ``false`` if there are too few points to fit the model
+   */
+  bool fit(const std::vector<std::vector<double>> &x,
+           const std::vector<double> &y);
+  /**
+   * @brief Predicted mean and standard deviation at ``x``.
+   */
+  [[nodiscard]] std::pair<double, double>
+  predict(const std::vector<double> &x) const;
+  /**
+   * @brief Expected improvement at ``x`` over the minimum value ``yMin``.
+   */
+  [[nodiscard]] double expectedImprovement(const std::vector<double> &x,
+                                           double yMin) const;
+  /**
+   * @brief The kernel length scale of the fitted model.
+   */
+  [[nodiscard]] double getLengthScale() const;
+
+private:
+  std::vector<std::vector<double>> xTrain;
+  // lower triangular Cholesky factor of the kernel matrix, row-major
+  std::vector<double> cholesky;
+  std::vector<double> alpha;
+  double yMean{0.0};
+  double yScale{1.0};
+  double lengthScale{1.0};
+  [[nodiscard]] double kernel(const std::vector<double> &a,
+                              const std::vector<double> &b) const;
+  double factorize(double lengthScaleCandidate,
+                   const std::vector<double> &yStandardised);
+};
+
+/**
+ * @brief Surrogate-assisted optimization algorithm for pagmo.
+ *
+ * Each generation fits a Gaussian process to all the points evaluated so
+ * far. It then generates a large number of candidate points, both random and
+ * near the best points. Only the candidates with the largest expected
+ * improvement are evaluated, and each one replaces the worst individual in
+ * the population if it is better. Strictly positive costs are modelled on a
+ * log scale.
+ *
+ * The evaluated points are shared by all copies of the algorithm. This means
+ * all the islands of an archipelago contribute to and use the same
+ * surrogate.
+ */
+class SurrogateAlgorithm {
+public:
+  /**
+   * @brief Construct the algorithm.
+   * @param evaluationsPerGeneration Number of points to evaluate each
+   * generation
+   * @param maxTrainingPoints Maximum number of points (with the lowest
+   * costs) used to fit the surrogate
+   * @param seed Random number generator seed
+   */
+  explicit SurrogateAlgorithm(std::size_t evaluationsPerGeneration = 1,
+                              std::size_t maxTrainingPoints = 200,
+                              unsigned seed = pagmo::random_device::next());
+  /**
+   * @brief Evolve the population by one generation.
+   */
+  [[nodiscard]] pagmo::population evolve(pagmo::population pop) const;
+  /**
+   * @brief Name of the algorithm.
+   */
+  [[nodiscard]] std::string get_name() const;
+  /**
+   * @brief Total number of points evaluated by all copies of the algorithm.
+   */
+  [[nodiscard]] std::size_t getEvaluations() const;
+  /**
+   * @brief Discard the points evaluated so far by all copies of the
+   * algorithm.
+   *
+   * Should be called if the cost function changes, for example when the
+   * resolution of the simulation is increased, since the existing costs are
+   * then no longer comparable to new ones.
+   */
+  void clearArchive();
+
+private:
+  struct Archive {
+    std::mutex mutex;
+    std::vector<pagmo::vector_double> x;
+    std::vector<double> f;
+    std::size_t nEvaluations{0};
+  };
+  std::shared_ptr<Archive> archive{std::make_shared<Archive>()};
+  std::size_t evaluationsPerGeneration;
+  std::size_t maxTrainingPoints;
+  mutable std::mt19937 rng;
+};
+
+} // namespace sme::simulate
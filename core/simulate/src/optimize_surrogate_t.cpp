@@ -0,0 +1,88 @@
+#include "catch_wrapper.hpp"
+#include "optimize_surrogate.hpp"
+#include <algorithm>
+#include <cmath>
+#include <pagmo/problem.hpp>
+#include <utility>
+#include <vector>
+
+using namespace sme;
+
+namespace {
+
+// minimum value 1 at (1, -2)
+struct Quadratic {
+  [[nodiscard]] pagmo::vector_double
+  fitness(const pagmo::vector_double &x) const {
+    return {1.0 + std::pow(x[0] - 1.0, 2) + 10.0 * std::pow(x[1] + 2.0, 2)};
+  }
+  [[nodiscard]] std::pair<pagmo::vector_double, pagmo::vector_double>
+  get_bounds() const {
+    return {{-5.0, -5.0}, {5.0, 5.0}};
+  }
+};
+
+} // namespace
+
+TEST_CASE("Surrogate-assisted optimization",
+          "[core/simulate/optimize_surrogate][core/simulate][core][optimize]") {
+  std::vector<std::vector<double>> x;
+  std::vector<double> y;
+  for (std::size_t i = 0; i <= 10; ++i) {
+    double xi{0.1 * static_cast<double>(i)};
+    x.push_back({xi});
+    y.push_back(std::sin(6.0 * xi));
+  }
+  SECTION("Gaussian process") {
+    simulate::GaussianProcess gp;
+    REQUIRE(gp.fit({{0.5}}, {1.0}) == false);
+    REQUIRE(gp.fit(x, y) == true);
+    REQUIRE(gp.getLengthScale() > 0.0);
+    // interpolates training points
+    for (std::size_t i = 0; i < x.size(); ++i) {
+      auto [mean, sigma] = gp.predict(x[i]);
+      REQUIRE(mean == Catch::Approx(y[i]).margin(1e-3));
+      REQUIRE(sigma < 1e-2);
+    }
+    // smooth between training points
+    auto [mean, sigma] = gp.predict({0.35});
+    REQUIRE(mean == Catch::Approx(std::sin(2.1)).margin(1e-2));
+    REQUIRE(sigma < 1e-2);
+    // uncertain far from training points
+    auto [meanFar, sigmaFar] = gp.predict({3.0});
+    REQUIRE(sigmaFar > 0.5);
+  }
+  SECTION("Expected improvement") {
+    simulate::GaussianProcess gp;
+    REQUIRE(gp.fit(x, y) == true);
+    const double yMin{*std::ranges::min_element(y)};
+    for (const auto &xi : x) {
+      double ei{gp.expectedImprovement(xi, yMin)};
+      REQUIRE(ei >= 0.0);
+      REQUIRE(ei < 1e-3);
+    }
+    REQUIRE(gp.expectedImprovement({3.0}, yMin) > 1e-2);
+  }
+  SECTION("Optimize quadratic: copies share evaluated points") {
+    pagmo::problem prob{Quadratic{}};
+    pagmo::population pop1(prob, 4, 1);
+    pagmo::population pop2(prob, 4, 2);
+    simulate::SurrogateAlgorithm algo(1, 200, 1);
+    auto algoCopy{algo};
+    for (std::size_t i = 0; i < 15; ++i) {
+      double best1{pop1.champion_f()[0]};
+      double best2{pop2.champion_f()[0]};
+      pop1 = algo.evolve(pop1);
+      pop2 = algoCopy.evolve(pop2);
+      // best fitness never increases
+      REQUIRE(pop1.champion_f()[0] <= best1);
+      REQUIRE(pop2.champion_f()[0] <= best2);
+    }
+    // one evaluation per evolve call
+    REQUIRE(algo.getEvaluations() == 30);
+    REQUIRE(algoCopy.getEvaluations() == 30);
+    REQUIRE(pop1.get_problem().get_fevals() == 4 + 15);
+    double best{std::min(pop1.champion_f()[0], pop2.champion_f()[0])};
+    REQUIRE(best < 1.2);
+  }
+}
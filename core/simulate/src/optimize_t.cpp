@@ -3,7 +3,10 @@
 #include "sme/model.hpp"
 #include "sme/optimize.hpp"
 #include <QTest>
+#include <algorithm>
 #include <catch2/catch_test_macros.hpp>
+#include <functional>
+#include <limits>
 
 using namespace sme;
 using namespace sme::test;
@@ -679,3 +682,99 @@ TEST_CASE("optimizer_imageFunctions",
     REQUIRE(*std::ranges::min_element(values) == dbl_approx(0.0));
   }
 }
+
+TEST_CASE("Optimize ABtoC with coarse geometry for early iterations",
+          "[core/simulate/optimize][core/simulate][core][optimize]") {
+  auto model{getExampleModel(Mod::ABtoC)};
+  model.getSimulationSettings().simulatorType =
+      sme::simulate::SimulatorType::Pixel;
+  sme::simulate::OptimizeOptions optimizeOptions;
+  optimizeOptions.optAlgorithm.optAlgorithmType =
+      sme::simulate::OptAlgorithmType::PSO;
+  optimizeOptions.optAlgorithm.islands = 1;
+  optimizeOptions.optAlgorithm.population = 3;
+  optimizeOptions.optParams.push_back(
+      {sme::simulate::OptParamType::ReactionParameter, "name", "k1", "r1", 0.05,
+       0.21});
+  optimizeOptions.optCosts.push_back({sme::simulate::OptCostType::Concentration,
+                                      simulate::OptCostDiffType::Absolute,
+                                      "name",
+                                      "A",
+                                      1.0,
+                                      1.0,
+                                      0,
+                                      0,
+                                      {}});
+  SECTION("invalid coarsening factor") {
+    optimizeOptions.optAlgorithm.coarseningFactor = 0;
+    model.getOptimizeOptions() = optimizeOptions;
+    sme::simulate::Optimization optimization(model);
+    REQUIRE(optimization.getErrorMessage() ==
+            "Invalid coarsening factor, can't be less than 1");
+  }
+  SECTION("coarsening factor 4") {
+    optimizeOptions.optAlgorithm.coarseningFactor = 4;
+    model.getOptimizeOptions() = optimizeOptions;
+    sme::simulate::Optimization optimization(model);
+    REQUIRE(optimization.getErrorMessage().empty());
+    REQUIRE(optimization.getCoarseningFactor() == 4);
+    const auto *coarseLevel{optimization.getCoarseLevel()};
+    REQUIRE(coarseLevel != nullptr);
+    REQUIRE(coarseLevel->factor == 4);
+    REQUIRE(coarseLevel->optConstData->imageSize.width() == 25);
+    REQUIRE(coarseLevel->optConstData->imageSize.height() == 25);
+    std::size_t previousFactor{4};
+    for (std::size_t i = 1; i < 40 && previousFactor > 1; ++i) {
+      optimization.evolve();
+      REQUIRE(optimization.getErrorMessage().empty());
+      REQUIRE(optimization.getIterations() == i);
+      // resolution only ever increases
+      REQUIRE(optimization.getCoarseningFactor() <= previousFactor);
+      previousFactor = optimization.getCoarseningFactor();
+    }
+    REQUIRE(optimization.getCoarseningFactor() == 1);
+    optimization.evolve();
+    // each fitness is recorded with the factor it was evaluated at
+    auto factors{optimization.getCoarseningFactors()};
+    REQUIRE(factors.size() == optimization.getFitness().size());
+    REQUIRE(factors.front() == 4);
+    REQUIRE(std::ranges::find(factors, 2) != factors.cend());
+    REQUIRE(factors.back() == 1);
+    REQUIRE(std::ranges::is_sorted(factors, std::ranges::greater{}));
+    // best results are always at full resolution
+    REQUIRE(optimization.getBestResultValues(0).size() ==
+            optimization.getImageSize().nVoxels());
+    REQUIRE(optimization.getBestResultsFitness() <
+            std::numeric_limits<double>::max());
+  }
+  SECTION("surrogate algorithm with coarsening factor 2") {
+    // the surrogate discards the coarse costs when the resolution increases
+    optimizeOptions.optAlgorithm.optAlgorithmType =
+        sme::simulate::OptAlgorithmType::Surrogate;
+    optimizeOptions.optAlgorithm.population = 2;
+    optimizeOptions.optAlgorithm.coarseningFactor = 2;
+    model.getOptimizeOptions() = optimizeOptions;
+    sme::simulate::Optimization optimization(model);
+    REQUIRE(optimization.getErrorMessage().empty());
+    REQUIRE(optimization.getCoarseningFactor() == 2);
+    for (std::size_t i = 1; i < 20 && optimization.getCoarseningFactor() > 1;
+         ++i) {
+      optimization.evolve();
+      REQUIRE(optimization.getErrorMessage().empty());
+    }
+    REQUIRE(optimization.getCoarseningFactor() == 1);
+    // keep optimizing at full resolution: costs are only comparable after
+    // the first full resolution step
+    optimization.evolve();
+    REQUIRE(optimization.getErrorMessage().empty());
+    double fitness{optimization.getFitness().back()};
+    for (std::size_t i = 0; i < 3; ++i) {
+      optimization.evolve();
+      REQUIRE(optimization.getErrorMessage().empty());
+      REQUIRE(optimization.getFitness().back() <= fitness);
+      fitness = optimization.getFitness().back();
+    }
+    REQUIRE(optimization.getBestResultValues(0).size() ==
+            optimization.getImageSize().nVoxels());
+  }
+}
@@ -0,0 +1,421 @@
+#include "optimize_workers.hpp"
+#include "sme/logger.hpp"
+#include "sme/model.hpp"
+#include <QDeadlineTimer>
+#include <QProcess>
+#include <fmt/core.h>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <utility>
+
+namespace sme::simulate {
+
+// Protocol, one message per line:
+//  - on startup the worker is sent the number of models, followed by each
+//    SBML model encoded as base64, and replies "ready" or "error <message>"
+//  - request: "<modelIndex> <threshold> <bestFitness> <n> <p_1> ... <p_n>"
+//  - reply: "<cost> <complete> <nTargets>", followed by nTargets lines
+//    "<m> <v_1> ... <v_m>" with the values of each target. The targets are
+//    only sent if the cost is lower than bestFitness. If the cost can't be
+//    calculated the reply is instead "error <message>"
+//  - gradient request: "gradient <modelIndex> <bestFitness> <n> <p_1> ...
+//    <p_n>"
+//  - gradient reply: the same as a reply whose first target is the gradient:
+//    "<cost> 1 <1 + nTargets>" followed by "<n> <g_1> ... <g_n>", then the
+//    values of each target if the cost is lower than bestFitness
+//  - "quit" stops the worker
+
+static std::string formatDouble(double value) {
+  return fmt::format("{:.17g}", value);
+}
+
+// "<n> <v_1> ... <v_n>"
+static std::string formatValues(const std::vector<double> &values) {
+  std::string line{fmt::format("{}", values.size())};
+  for (double v : values) {
+    line.append(" ").append(formatDouble(v));
+  }
+  return line;
+}
+
+static double toDouble(const QByteArray &token) {
+  bool valid{false};
+  double value{token.toDouble(&valid)};
+  if (!valid) {
+    throw std::runtime_error(
+        fmt::format("Optimization worker: invalid number '{}'",
+                    token.toStdString()));
+  }
+  return value;
+}
+
+static std::size_t toSize(const QByteArray &token) {
+  bool valid{false};
+  auto value{token.toULongLong(&valid)};
+  if (!valid) {
+    throw std::runtime_error(
+        fmt::format("Optimization worker: invalid integer '{}'",
+                    token.toStdString()));
+  }
+  return static_cast<std::size_t>(value);
+}
+
+static std::optional<QByteArray> readLine(QProcess &process,
+                                         const QDeadlineTimer &deadline) {
+  while (!process.canReadLine()) {
+    if (deadline.hasExpired() ||
+        !process.waitForReadyRead(
+            static_cast<int>(deadline.remainingTime()))) {
+      return {};
+    }
+  }
+  return process.readLine().trimmed();
+}
+
+static bool isError(const QByteArray &line) {
+  return line.startsWith("error");
+}
+
+static void stopProcess(QProcess &process, int timeoutMs) {
+  if (process.state() != QProcess::NotRunning) {
+    process.kill();
+    process.waitForFinished(timeoutMs);
+  }
+}
+
+OptWorkerPool::OptWorkerPool(const OptWorkerOptions &options,
+                             const std::vector<std::string> &xmlModels)
+    : program{QString::fromStdString(options.program)},
+      header{QByteArray::number(xmlModels.size())},
+      timeoutMs{options.timeoutMs} {
+  header.append('\n');
+  for (const auto &xmlModel : xmlModels) {
+    header.append(QByteArray::fromStdString(xmlModel).toBase64());
+    header.append('\n');
+  }
+  for (const auto &argument : options.arguments) {
+    arguments.push_back(QString::fromStdString(argument));
+  }
+  std::latch started(static_cast<std::ptrdiff_t>(options.count));
+  threads.reserve(options.count);
+  for (std::size_t i = 0; i < options.count; ++i) {
+    threads.emplace_back(&OptWorkerPool::runWorker, this, i,
+                         std::ref(started));
+  }
+  started.wait();
+  SPDLOG_INFO("Started {} of {} optimization worker processes",
+              nRunning.load(), options.count);
+}
+
+OptWorkerPool::~OptWorkerPool() {
+  for (std::size_t i = 0; i < threads.size(); ++i) {
+    jobs.push(nullptr);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+std::string OptWorkerPool::startProcess(QProcess &process) const {
+  process.start(program, arguments);
+  if (!process.waitForStarted(timeoutMs)) {
+    auto error{process.errorString().toStdString()};
+    stopProcess(process, timeoutMs);
+    return error;
+  }
+  process.write(header);
+  auto reply{readLine(process, QDeadlineTimer(timeoutMs))};
+  if (reply.has_value() && *reply == "ready") {
+    return {};
+  }
+  stopProcess(process, timeoutMs);
+  if (!reply.has_value()) {
+    return "no reply during startup";
+  }
+  return reply->toStdString();
+}
+
+std::optional<std::vector<QByteArray>>
+OptWorkerPool::getReply(std::size_t index, QProcess &process,
+                        const std::string &request) const {
+  // the deadline is for the complete reply, including any targets
+  QDeadlineTimer deadline(timeoutMs);
+  process.write(QByteArray::fromStdString(request).append('\n'));
+  std::vector<QByteArray> lines;
+  try {
+    auto line{readLine(process, deadline)};
+    auto nTargets{!line.has_value() || isError(*line)
+                      ? std::size_t{0}
+                      : toSize(line->split(' ').back())};
+    for (std::size_t i = 0; i < nTargets && line.has_value(); ++i) {
+      lines.push_back(std::move(*line));
+      line = readLine(process, deadline);
+    }
+    if (line.has_value()) {
+      lines.push_back(std::move(*line));
+      return lines;
+    }
+  } catch (const std::runtime_error &e) {
+    SPDLOG_ERROR("Optimization worker {}: {}", index, e.what());
+    return {};
+  }
+  if (process.state() == QProcess::NotRunning) {
+    SPDLOG_ERROR("Optimization worker {} stopped unexpectedly", index);
+  } else {
+    SPDLOG_ERROR("Optimization worker {} did not reply within {} ms", index,
+                 timeoutMs);
+  }
+  return {};
+}
+
+void OptWorkerPool::runWorker(std::size_t index, std::latch &started) {
+  // the number of workers that can fail to evaluate the same parameters
+  constexpr std::size_t maxAttempts{2};
+  // the number of times a worker is restarted without a successful reply
+  constexpr std::size_t maxRestarts{3};
+  // the QProcess is created and used only in this thread
+  QProcess process;
+  process.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+  bool running{false};
+  if (auto workerError{startProcess(process)}; !workerError.empty()) {
+    std::scoped_lock lock{errorMutex};
+    errorMessage = fmt::format("Optimization worker {} failed to start: {}",
+                               index, workerError);
+  } else {
+    running = true;
+    ++nRunning;
+  }
+  started.count_down();
+  std::size_t nRestarts{0};
+  std::shared_ptr<Job> job;
+  while (true) {
+    jobs.pop(job);
+    if (job == nullptr) {
+      break;
+    }
+    if (!running) {
+      if (nRunning.load() > 0) {
+        // leave this and any later jobs to the workers that are running
+        jobs.push(std::move(job));
+        break;
+      }
+      job->reply.set_exception(std::make_exception_ptr(std::runtime_error(
+          fmt::format("Optimization worker {} is not running", index))));
+      continue;
+    }
+    if (auto lines{getReply(index, process, job->request)};
+        lines.has_value()) {
+      nRestarts = 0;
+      job->reply.set_value(std::move(*lines));
+      continue;
+    }
+    stopProcess(process, timeoutMs);
+    if (++job->attempts < maxAttempts) {
+      // retry with the next available worker
+      jobs.push(std::move(job));
+    } else {
+      job->reply.set_exception(std::make_exception_ptr(std::runtime_error(
+          fmt::format("Optimization worker {} failed to evaluate '{}'", index,
+                      job->request))));
+    }
+    if (++nRestarts <= maxRestarts) {
+      auto error{startProcess(process)};
+      if (error.empty()) {
+        SPDLOG_WARN("Optimization worker {} restarted", index);
+        continue;
+      }
+      SPDLOG_ERROR("Optimization worker {} failed to restart: {}", index,
+                   error);
+    }
+    SPDLOG_ERROR("Optimization worker {} retired", index);
+    running = false;
+    --nRunning;
+  }
+  if (process.state() != QProcess::NotRunning) {
+    process.write("quit\n");
+    if (!process.waitForFinished(timeoutMs)) {
+      process.kill();
+    }
+  }
+}
+
+std::vector<QByteArray> OptWorkerPool::submit(std::string &&request) {
+  auto job{std::make_shared<Job>()};
+  job->request = std::move(request);
+  auto reply{job->reply.get_future()};
+  jobs.push(std::move(job));
+  return reply.get();
+}
+
+static SimulatedCost
+parseCostReply(const std::vector<QByteArray> &lines,
+               std::vector<std::vector<double>> &currentTargets) {
+  if (isError(lines.front())) {
+    throw std::invalid_argument(lines.front().mid(6).toStdString());
+  }
+  auto tokens{lines.front().split(' ')};
+  if (tokens.size() != 3) {
+    throw std::runtime_error("Optimization worker: invalid reply");
+  }
+  SimulatedCost result{toDouble(tokens[0]), toSize(tokens[1]) != 0};
+  auto nTargets{toSize(tokens[2])};
+  if (nTargets > 0 && nTargets != currentTargets.size()) {
+    throw std::runtime_error("Optimization worker: invalid number of targets");
+  }
+  for (std::size_t i = 0; i < nTargets; ++i) {
+    auto values{lines[i + 1].split(' ')};
+    auto &target{currentTargets[i]};
+    target.resize(toSize(values.front()));
+    if (target.size() + 1 != static_cast<std::size_t>(values.size())) {
+      throw std::runtime_error("Optimization worker: invalid target values");
+    }
+    for (std::size_t j = 0; j < target.size(); ++j) {
+      target[j] = toDouble(values[static_cast<qsizetype>(j + 1)]);
+    }
+  }
+  return result;
+}
+
+SimulatedCost
+OptWorkerPool::evaluate(std::size_t modelIndex, const pagmo::vector_double &dv,
+                        std::vector<std::vector<double>> &currentTargets,
+                        double earlyTerminationThreshold, double bestFitness) {
+  return parseCostReply(
+      submit(fmt::format("{} {} {} {}", modelIndex,
+                         formatDouble(earlyTerminationThreshold),
+                         formatDouble(bestFitness), formatValues(dv))),
+      currentTargets);
+}
+
+SimulatedCostGradient
+OptWorkerPool::evaluateGradient(std::size_t modelIndex,
+                                const pagmo::vector_double &dv,
+                                std::size_t nTargets, double bestFitness) {
+  auto lines{submit(fmt::format("gradient {} {} {}", modelIndex,
+                                formatDouble(bestFitness), formatValues(dv)))};
+  // the gradient, followed by the targets if they were sent
+  std::vector<std::vector<double>> values(lines.size() > 2 ? 1 + nTargets
+                                                           : 1);
+  auto cost{parseCostReply(lines, values)};
+  if (values.front().size() != dv.size()) {
+    throw std::runtime_error("Optimization worker: invalid gradient");
+  }
+  SimulatedCostGradient result{cost.cost, std::move(values.front()), {}};
+  values.erase(values.begin());
+  result.targets = std::move(values);
+  return result;
+}
+
+std::size_t OptWorkerPool::size() const { return threads.size(); }
+
+const std::string &OptWorkerPool::getErrorMessage() const {
+  return errorMessage;
+}
+
+int runOptimizationWorker(std::istream &in, std::ostream &out) {
+  auto reply = [&out](const std::string &line) {
+    out << line << '\n';
+    out.flush();
+  };
+  std::string line;
+  std::size_t nModels{0};
+  try {
+    std::getline(in, line);
+    nModels = toSize(QByteArray::fromStdString(line).trimmed());
+  } catch (const std::runtime_error &e) {
+    reply(fmt::format("error {}", e.what()));
+    return 1;
+  }
+  std::vector<OptConstData> optConstData(nModels);
+  std::vector<std::unique_ptr<ThreadsafeModelQueue>> modelQueues;
+  for (auto &data : optConstData) {
+    std::getline(in, line);
+    auto model{std::make_shared<sme::model::Model>()};
+    model->importSBMLString(
+        QByteArray::fromBase64(QByteArray::fromStdString(line))
+            .toStdString());
+    if (!model->getIsValid()) {
+      reply("error invalid model");
+      return 1;
+    }
+    if (auto error{initOptConstData(data, *model)}; !error.empty()) {
+      reply(fmt::format("error {}", error));
+      return 1;
+    }
+    modelQueues.push_back(std::make_unique<ThreadsafeModelQueue>());
+    modelQueues.back()->push(std::move(model));
+  }
+  reply("ready");
+  while (std::getline(in, line) && line != "quit") {
+    try {
+      auto tokens{QByteArray::fromStdString(line).trimmed().split(' ')};
+      const bool gradient{!tokens.empty() && tokens.front() == "gradient"};
+      if (gradient) {
+        tokens.removeFirst();
+      }
+      // the parameters follow the model index, any cost thresholds, the best
+      // fitness, and the number of parameters
+      const qsizetype nHeader{gradient ? 3 : 4};
+      if (tokens.size() < nHeader) {
+        throw std::runtime_error("invalid request");
+      }
+      auto modelIndex{toSize(tokens[0])};
+      auto nParams{toSize(tokens[nHeader - 1])};
+      if (modelIndex >= nModels ||
+          static_cast<std::size_t>(tokens.size()) !=
+              nParams + static_cast<std::size_t>(nHeader)) {
+        throw std::runtime_error("invalid request");
+      }
+      pagmo::vector_double dv(nParams);
+      for (std::size_t i = 0; i < nParams; ++i) {
+        dv[i] = toDouble(tokens[static_cast<qsizetype>(i) + nHeader]);
+      }
+      const auto &data{optConstData[modelIndex]};
+      double bestFitness{toDouble(tokens[nHeader - 2])};
+      if (gradient) {
+        auto result{
+            simulateCostGradient(data, dv, []() { return false; })};
+        if (!result.has_value()) {
+          throw std::runtime_error("gradient simulation stopped");
+        }
+        const bool sendTargets{result->cost < bestFitness};
+        reply(fmt::format("{} 1 {}", formatDouble(result->cost),
+                          sendTargets ? 1 + result->targets.size() : 1));
+        reply(formatValues(result->gradient));
+        for (const auto &values : result->targets) {
+          if (!sendTargets) {
+            break;
+          }
+          reply(formatValues(values));
+        }
+        continue;
+      }
+      double threshold{toDouble(tokens[1])};
+      std::vector<std::vector<double>> currentTargets(
+          data.optimizeOptions.optCosts.size());
+      auto cost{simulateCost(data, modelQueues[modelIndex].get(), dv,
+                             currentTargets, threshold,
+                             []() { return false; })};
+      if (!cost.has_value()) {
+        throw std::runtime_error("simulation stopped");
+      }
+      const bool sendTargets{cost->complete && cost->cost < bestFitness};
+      reply(fmt::format("{} {} {}", formatDouble(cost->cost),
+                        cost->complete ? 1 : 0,
+                        sendTargets ? currentTargets.size() : 0));
+      for (const auto &values : currentTargets) {
+        if (!sendTargets) {
+          break;
+        }
+        reply(formatValues(values));
+      }
+    } catch (const std::exception &e) {
+      reply(fmt::format("error {}", e.what()));
+    }
+  }
+  return 0;
+}
+
+} // namespace sme::simulate
@@ -0,0 +1,112 @@
+// Optimization worker processes
+//  - OptWorkerPool: evaluates fitness in a pool of worker processes
+//  - runOptimizationWorker (sme/optimize.hpp): the worker side of the protocol
+
+#pragma once
+
+#include "optimize_gradient.hpp"
+#include "optimize_impl.hpp"
+#include "sme/optimize.hpp"
+#include <QByteArray>
+#include <QProcess>
+#include <QStringList>
+#include <atomic>
+#include <cstddef>
+#include <future>
+#include <latch>
+#include <memory>
+#include <mutex>
+#include <oneapi/tbb/concurrent_queue.h>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sme::simulate {
+
+/**
+ * @brief A pool of worker processes that evaluate the optimization cost
+ *
+ * Each worker process is started with the program and arguments from
+ * OptWorkerOptions, and should call runOptimizationWorker(). It is sent the
+ * SBML model for each resolution level once on startup, and then only the
+ * parameters for each evaluation. Each worker process is managed by its own
+ * thread, and evaluate() blocks until one of them returns the result.
+ *
+ * A worker that exits, sends an invalid reply or doesn't reply within the
+ * timeout is restarted, and its evaluation is retried by the next available
+ * worker. A worker that can't be restarted is retired, and its evaluations
+ * are done by the remaining workers.
+ */
+class OptWorkerPool {
+public:
+  /**
+   * @brief Start the worker processes
+   *
+   * @param[in] options the number of workers and how to start them
+   * @param[in] xmlModels the SBML model for each resolution level
+   */
+  OptWorkerPool(const OptWorkerOptions &options,
+                const std::vector<std::string> &xmlModels);
+  ~OptWorkerPool();
+  OptWorkerPool(const OptWorkerPool &) = delete;
+  OptWorkerPool &operator=(const OptWorkerPool &) = delete;
+  /**
+   * @brief Simulate model ``modelIndex`` with parameters ``dv`` in a worker
+   *
+   * ``currentTargets`` is only set if the cost is lower than ``bestFitness``.
+   *
+   * @throws std::invalid_argument if the cost can't be calculated
+   * @throws std::runtime_error if the worker process fails
+   */
+  SimulatedCost evaluate(std::size_t modelIndex,
+                         const pagmo::vector_double &dv,
+                         std::vector<std::vector<double>> &currentTargets,
+                         double earlyTerminationThreshold, double bestFitness);
+  /**
+   * @brief Simulate the cost gradient of model ``modelIndex`` with parameters
+   * ``dv`` in a worker
+   *
+   * The ``nTargets`` target values are only returned if the cost is lower
+   * than ``bestFitness``.
+   *
+   * @throws std::invalid_argument if the gradient can't be calculated
+   * @throws std::runtime_error if the worker process fails
+   */
+  SimulatedCostGradient evaluateGradient(std::size_t modelIndex,
+                                         const pagmo::vector_double &dv,
+                                         std::size_t nTargets,
+                                         double bestFitness);
+  /**
+   * @brief The number of worker processes
+   */
+  [[nodiscard]] std::size_t size() const;
+  /**
+   * @brief Returns a message if any worker failed to start
+   */
+  [[nodiscard]] const std::string &getErrorMessage() const;
+
+private:
+  struct Job {
+    std::string request;
+    std::promise<std::vector<QByteArray>> reply;
+    std::size_t attempts{0};
+  };
+  oneapi::tbb::concurrent_bounded_queue<std::shared_ptr<Job>> jobs;
+  std::vector<std::thread> threads;
+  QString program;
+  QStringList arguments;
+  QByteArray header;
+  int timeoutMs;
+  std::atomic<std::size_t> nRunning{0};
+  std::mutex errorMutex;
+  std::string errorMessage{};
+  [[nodiscard]] std::vector<QByteArray> submit(std::string &&request);
+  [[nodiscard]] std::string startProcess(QProcess &process) const;
+  [[nodiscard]] std::optional<std::vector<QByteArray>>
+  getReply(std::size_t index, QProcess &process,
+           const std::string &request) const;
+  void runWorker(std::size_t index, std::latch &started);
+};
+
+} // namespace sme::simulate
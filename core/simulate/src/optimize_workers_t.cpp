@@ -0,0 +1,169 @@
+#include "catch_wrapper.hpp"
+#include "model_test_utils.hpp"
+#include "optimize_gradient.hpp"
+#include "optimize_impl.hpp"
+#include "optimize_workers.hpp"
+#include "sme/model.hpp"
+#include "sme/optimize.hpp"
+#include <QByteArray>
+#include <QString>
+#include <QtGlobal>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace sme;
+using namespace sme::test;
+
+TEST_CASE("Optimization worker processes",
+          "[core/simulate/optimize_workers][core/simulate][core][optimize]") {
+  auto model{getExampleModel(Mod::ABtoC)};
+  model.getSimulationSettings().simulatorType =
+      sme::simulate::SimulatorType::Pixel;
+  sme::simulate::OptimizeOptions optimizeOptions;
+  optimizeOptions.optParams.push_back(
+      {sme::simulate::OptParamType::ReactionParameter, "name", "k1", "r1", 0.02,
+       0.88});
+  optimizeOptions.optCosts.push_back({sme::simulate::OptCostType::Concentration,
+                                      simulate::OptCostDiffType::Absolute,
+                                      "name",
+                                      "C",
+                                      1.0,
+                                      0.23,
+                                      0,
+                                      2,
+                                      {}});
+  model.getOptimizeOptions() = optimizeOptions;
+  simulate::OptConstData optConstData;
+  REQUIRE(simulate::initOptConstData(optConstData, model).empty());
+  const auto xml{QByteArray::fromStdString(optConstData.xmlModel)
+                     .toBase64()
+                     .toStdString()};
+  SECTION("worker protocol") {
+    std::vector<std::vector<double>> targets(1);
+    auto expected{simulate::simulateCost(optConstData, nullptr, {0.3}, targets,
+                                         1e300, []() { return false; })};
+    REQUIRE(expected.has_value());
+    std::stringstream in;
+    in << "1\n" << xml << "\n";
+    // cost lower than best fitness: targets are returned
+    in << "0 1e300 1e300 1 0.3\n";
+    // cost higher than best fitness: no targets
+    in << "0 1e300 0 1 0.3\n";
+    // invalid requests
+    in << "1 1e300 0 1 0.3\n";
+    in << "0 1e300 0 2 0.3\n";
+    in << "quit\n";
+    std::stringstream out;
+    REQUIRE(simulate::runOptimizationWorker(in, out) == 0);
+    std::vector<QByteArray> lines;
+    std::string line;
+    while (std::getline(out, line)) {
+      lines.push_back(QByteArray::fromStdString(line));
+    }
+    REQUIRE(lines.size() == 6);
+    REQUIRE(lines[0] == "ready");
+    auto reply{lines[1].split(' ')};
+    REQUIRE(reply.size() == 3);
+    REQUIRE(reply[0].toDouble() == dbl_approx(expected->cost));
+    REQUIRE(reply[1] == "1");
+    REQUIRE(reply[2] == "1");
+    auto values{lines[2].split(' ')};
+    REQUIRE(values.front().toULongLong() == targets[0].size());
+    REQUIRE(values.size() == static_cast<qsizetype>(targets[0].size() + 1));
+    REQUIRE(values[1].toDouble() == dbl_approx(targets[0][0]));
+    REQUIRE(lines[3] == lines[1].left(lines[1].size() - 1) + "0");
+    REQUIRE(lines[4].startsWith("error"));
+    REQUIRE(lines[5].startsWith("error"));
+  }
+  SECTION("worker gradient protocol") {
+    auto expected{simulate::simulateCostGradient(optConstData, {0.3},
+                                                 []() { return false; })};
+    REQUIRE(expected.has_value());
+    std::stringstream in;
+    in << "1\n" << xml << "\n";
+    // cost lower than best fitness: gradient and targets are returned
+    in << "gradient 0 1e300 1 0.3\n";
+    // cost higher than best fitness: only the gradient
+    in << "gradient 0 0 1 0.3\n";
+    // invalid requests
+    in << "gradient 0 1e300 2 0.3\n";
+    in << "gradient\n";
+    in << "quit\n";
+    std::stringstream out;
+    REQUIRE(simulate::runOptimizationWorker(in, out) == 0);
+    std::vector<QByteArray> lines;
+    std::string line;
+    while (std::getline(out, line)) {
+      lines.push_back(QByteArray::fromStdString(line));
+    }
+    REQUIRE(lines.size() == 8);
+    REQUIRE(lines[0] == "ready");
+    auto reply{lines[1].split(' ')};
+    REQUIRE(reply.size() == 3);
+    REQUIRE(reply[0].toDouble() == dbl_approx(expected->cost));
+    REQUIRE(reply[1] == "1");
+    REQUIRE(reply[2] == "2");
+    auto values{lines[2].split(' ')};
+    REQUIRE(values.size() == 2);
+    REQUIRE(values[0] == "1");
+    REQUIRE(values[1].toDouble() == dbl_approx(expected->gradient[0]));
+    const auto &target{expected->targets[0]};
+    values = lines[3].split(' ');
+    REQUIRE(values.front().toULongLong() == target.size());
+    REQUIRE(values.size() == static_cast<qsizetype>(target.size() + 1));
+    REQUIRE(values[1].toDouble() == dbl_approx(target[0]));
+    REQUIRE(lines[4] == lines[1].left(lines[1].size() - 1) + "1");
+    REQUIRE(lines[5] == lines[2]);
+    REQUIRE(lines[6].startsWith("error"));
+    REQUIRE(lines[7].startsWith("error"));
+  }
+  SECTION("invalid model") {
+    std::stringstream in;
+    in << "1\n" << "invalid\n";
+    std::stringstream out;
+    REQUIRE(simulate::runOptimizationWorker(in, out) == 1);
+    REQUIRE(out.str().starts_with("error"));
+  }
+  SECTION("worker program fails to start") {
+    simulate::OptWorkerOptions workerOptions{2, "/non/existent/program", {}};
+    simulate::OptWorkerPool pool(workerOptions, {optConstData.xmlModel});
+    REQUIRE(pool.size() == 2);
+    REQUIRE(!pool.getErrorMessage().empty());
+    std::vector<std::vector<double>> targets(1);
+    REQUIRE_THROWS_AS(pool.evaluate(0, {0.3}, targets, 1e300, 1e300),
+                      std::runtime_error);
+    // optimization reports the error
+    simulate::Optimization optimization(model, workerOptions);
+    REQUIRE(!optimization.getErrorMessage().empty());
+    REQUIRE(optimization.evolve() == 0);
+  }
+#ifndef Q_OS_WIN
+  // shell script workers that read the models and reply "ready"
+  const QString readModels{"read n; read m; echo ready; "};
+  SECTION("worker exits after each reply: restarted") {
+    simulate::OptWorkerOptions workerOptions{
+        1, "sh", {"-c", (readModels + "read r; echo 1.5 1 0").toStdString()}};
+    simulate::OptWorkerPool pool(workerOptions, {optConstData.xmlModel});
+    REQUIRE(pool.getErrorMessage().empty());
+    std::vector<std::vector<double>> targets(1);
+    for (int i = 0; i < 3; ++i) {
+      auto result{pool.evaluate(0, {0.3}, targets, 1e300, 1e300)};
+      REQUIRE(result.cost == dbl_approx(1.5));
+      REQUIRE(result.complete);
+    }
+  }
+  SECTION("worker doesn't reply: timeout") {
+    simulate::OptWorkerOptions workerOptions{
+        1,
+        "sh",
+        {"-c", (readModels + "read r; exec sleep 60").toStdString()},
+        200};
+    simulate::OptWorkerPool pool(workerOptions, {optConstData.xmlModel});
+    REQUIRE(pool.getErrorMessage().empty());
+    std::vector<std::vector<double>> targets(1);
+    REQUIRE_THROWS_AS(pool.evaluate(0, {0.3}, targets, 1e300, 1e300),
+                      std::runtime_error);
+  }
+#endif
+}
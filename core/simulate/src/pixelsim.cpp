@@ -89,8 +89,8 @@ void PixelSim::solveZeroStorageConstraints() {
               maxIterations);
 }
 
-void PixelSim::calculateDcdt() {
-  // calculate dcd/dt in all compartments
+void PixelSim::calculateRates() {
+  // calculate reaction and diffusion rates in all compartments
   maxStableTimestep = std::numeric_limits<double>::max();
   for (auto &sim : simCompartments) {
     if (useTBB) {
@@ -111,6 +111,13 @@ void PixelSim::calculateDcdt() {
   }
   for (auto &sim : simCompartments) {
     sim->spatiallyAverageDcdt();
+  }
+}
+
+void PixelSim::calculateDcdt() {
+  // calculate dcd/dt in all compartments
+  calculateRates();
+  for (auto &sim : simCompartments) {
     if (useTBB) {
       sim->applyStorage_tbb();
     } else {
@@ -272,7 +279,8 @@ double PixelSim::doRKAdaptive(double dtMax) {
 PixelSim::PixelSim(
     const model::Model &sbmlDoc, const std::vector<std::string> &compartmentIds,
     const std::vector<std::vector<std::string>> &compartmentSpeciesIds,
-    const std::map<std::string, double, std::less<>> &substitutions)
+    const std::map<std::string, double, std::less<>> &substitutions,
+    const std::set<std::string, std::less<>> &unclampedSpeciesIds)
     : PixelSimBase{sbmlDoc.getSimulationSettings().options.pixel.integrator,
                    sbmlDoc.getSimulationSettings().options.pixel.maxErr,
                    sbmlDoc.getSimulationSettings().options.pixel.maxTimestep},
@@ -349,7 +357,8 @@ PixelSim::PixelSim(
           doc, compartment, speciesIds,
           sbmlDoc.getSimulationSettings().options.pixel.doCSE,
           sbmlDoc.getSimulationSettings().options.pixel.optLevel, timeDependent,
-          spaceDependent, allUniformDiffusion, substitutions));
+          spaceDependent, allUniformDiffusion, substitutions,
+          unclampedSpeciesIds));
       maxStableTimestep = std::min(
           maxStableTimestep, simCompartments.back()->getMaxStableTimestep());
       if (simCompartments.back()->getHasZeroStorageSpecies()) {
@@ -477,11 +486,153 @@ PixelSim::getConcentrations(std::size_t compartmentIndex) const {
 
 std::size_t PixelSim::getConcentrationPadding() const { return nExtraVars; }
 
+std::optional<ConcentrationChange> PixelSim::updateConcentrationChange() {
+  oneapi::tbb::global_control control(
+      oneapi::tbb::global_control::max_allowed_parallelism, numMaxThreads);
+  ConcentrationChange change{};
+  for (auto &sim : simCompartments) {
+    auto compartmentChange{useTBB ? sim->updateConcentrationChange_tbb()
+                                  : sim->updateConcentrationChange()};
+    change.sumSquaredChange += compartmentChange.sumSquaredChange;
+    change.sumSquaredConcentration +=
+        compartmentChange.sumSquaredConcentration;
+  }
+  return change;
+}
+
+std::optional<SolverCheckpoint> PixelSim::getCheckpoint() const {
+  SolverCheckpoint checkpoint{};
+  checkpoint.simulatorType = SimulatorType::Pixel;
+  checkpoint.timestep = nextTimestep;
+  // the RK stage buffers are re-initialised at the start of every step, so
+  // the concentrations (including any time/space variables) and the next
+  // timestep are the complete integrator state between steps
+  checkpoint.state.reserve(simCompartments.size());
+  for (const auto &sim : simCompartments) {
+    checkpoint.state.push_back(sim->getConcentrations());
+  }
+  return checkpoint;
+}
+
+bool PixelSim::setCheckpoint(const SolverCheckpoint &checkpoint) {
+  if (checkpoint.simulatorType != SimulatorType::Pixel ||
+      checkpoint.state.size() != simCompartments.size()) {
+    SPDLOG_WARN("Solver checkpoint does not match this simulation");
+    return false;
+  }
+  for (std::size_t i = 0; i < simCompartments.size(); ++i) {
+    if (checkpoint.state[i].size() !=
+        simCompartments[i]->getConcentrations().size()) {
+      SPDLOG_WARN("Solver checkpoint does not match this simulation");
+      return false;
+    }
+  }
+  for (std::size_t i = 0; i < simCompartments.size(); ++i) {
+    simCompartments[i]->setConcentrations(checkpoint.state[i]);
+  }
+  if (checkpoint.timestep > 0.0) {
+    nextTimestep = std::min(checkpoint.timestep, maxTimestep);
+  }
+  SPDLOG_INFO("Restored solver checkpoint with next timestep {}",
+              nextTimestep);
+  return true;
+}
+
 const std::vector<double> &
 PixelSim::getDcdt(std::size_t compartmentIndex) const {
   return simCompartments[compartmentIndex]->getDcdt();
 }
 
+std::vector<double> PixelSim::getState() const {
+  std::vector<double> state;
+  for (const auto &sim : simCompartments) {
+    const auto &c{sim->getConcentrations()};
+    state.insert(state.end(), c.cbegin(), c.cend());
+  }
+  return state;
+}
+
+void PixelSim::setState(const std::vector<double> &state) {
+  auto iter{state.cbegin()};
+  for (auto &sim : simCompartments) {
+    auto n{static_cast<std::ptrdiff_t>(sim->getConcentrations().size())};
+    sim->setConcentrations({iter, iter + n});
+    iter += n;
+  }
+}
+
+void PixelSim::evaluateSteadyStateResidual(const std::vector<double> &state,
+                                           std::vector<double> &residual) {
+  setState(state);
+  // storage does not change the steady state, and without it zero-storage
+  // species constraints are also part of the residual
+  calculateRates();
+  auto iter{residual.begin()};
+  for (auto &sim : simCompartments) {
+    const auto &dcdt{sim->getDcdt()};
+    const std::size_t stride{dcdt.size() / sim->getVoxels().size()};
+    for (std::size_t i = 0; i < dcdt.size(); ++i) {
+      // time and space variables are not part of the steady state
+      *iter = i % stride < stride - nExtraVars ? dcdt[i] : 0.0;
+      ++iter;
+    }
+  }
+}
+
+void PixelSim::evaluateDiffusion(const std::vector<double> &state,
+                                 std::vector<double> &result) {
+  auto iterState{state.cbegin()};
+  auto iterResult{result.begin()};
+  std::vector<double> values;
+  std::vector<double> diffusion;
+  for (auto &sim : simCompartments) {
+    auto n{static_cast<std::ptrdiff_t>(sim->getConcentrations().size())};
+    values.assign(iterState, iterState + n);
+    diffusion.resize(values.size());
+    sim->applyDiffusionOperator(values, diffusion);
+    iterResult = std::copy(diffusion.cbegin(), diffusion.cend(), iterResult);
+    iterState += n;
+  }
+}
+
+std::vector<double> PixelSim::getDiffusionDiagonal() {
+  // neighbouring voxels have different parity, so the diagonal can be found
+  // by applying the diffusion operator to one vector for each parity
+  auto parity = [](const common::Voxel &v) {
+    return (static_cast<std::size_t>(v.p.x() + v.p.y()) + v.z) % 2;
+  };
+  std::size_t n{0};
+  for (const auto &sim : simCompartments) {
+    n += sim->getConcentrations().size();
+  }
+  std::vector<double> diagonal(n, 0.0);
+  std::vector<double> probe(n, 0.0);
+  std::vector<double> result(n, 0.0);
+  for (std::size_t p = 0; p < 2; ++p) {
+    std::size_t offset{0};
+    for (const auto &sim : simCompartments) {
+      const auto &voxels{sim->getVoxels()};
+      const std::size_t stride{sim->getConcentrations().size() /
+                               voxels.size()};
+      for (std::size_t ix = 0; ix < voxels.size(); ++ix) {
+        double value{parity(voxels[ix]) == p ? 1.0 : 0.0};
+        std::fill_n(probe.begin() + static_cast<std::ptrdiff_t>(offset),
+                    stride, value);
+        offset += stride;
+      }
+    }
+    evaluateDiffusion(probe, result);
+    for (std::size_t i = 0; i < n; ++i) {
+      if (probe[i] == 1.0) {
+        diagonal[i] = result[i];
+      }
+    }
+  }
+  return diagonal;
+}
+
+double PixelSim::getMaxStableTimestep() const { return maxStableTimestep; }
+
 double PixelSim::getLowerOrderConcentration(std::size_t compartmentIndex,
                                             std::size_t speciesIndex,
                                             std::size_t pixelIndex) const {
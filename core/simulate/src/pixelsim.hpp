@@ -8,6 +8,8 @@
 #include <limits>
 #include <map>
 #include <memory>
+#include <optional>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -30,6 +32,7 @@ private:
   std::vector<std::unique_ptr<SimCompartment>> simCompartments;
   std::vector<std::unique_ptr<SimMembrane>> simMembranes;
   const model::Model &doc;
+  void calculateRates();
   void calculateDcdt();
   void solveZeroStorageConstraints();
   double doRK101(double dt);
@@ -48,12 +51,17 @@ private:
 public:
   /**
    * @brief Construct pixel simulator for selected compartments/species.
+   *
+   * Negative concentrations are set to zero after each step, except for
+   * species in ``unclampedSpeciesIds``, which must be the last species of
+   * their compartment.
    */
   explicit PixelSim(
       const model::Model &sbmlDoc,
       const std::vector<std::string> &compartmentIds,
       const std::vector<std::vector<std::string>> &compartmentSpeciesIds,
-      const std::map<std::string, double, std::less<>> &substitutions = {});
+      const std::map<std::string, double, std::less<>> &substitutions = {},
+      const std::set<std::string, std::less<>> &unclampedSpeciesIds = {});
   /**
    * @brief Destructor.
    */
@@ -72,11 +80,54 @@ public:
    * @brief Concentration array padding.
    */
   [[nodiscard]] std::size_t getConcentrationPadding() const override;
+  /**
+   * @brief Change in concentrations since the previous call.
+   */
+  [[nodiscard]] std::optional<ConcentrationChange>
+  updateConcentrationChange() override;
+  /**
+   * @brief Current concentrations and adaptive timestep.
+   */
+  [[nodiscard]] std::optional<SolverCheckpoint> getCheckpoint() const override;
+  /**
+   * @brief Restore concentrations and adaptive timestep.
+   */
+  bool setCheckpoint(const SolverCheckpoint &checkpoint) override;
   /**
    * @brief Time derivative array for compartment.
    */
   [[nodiscard]] const std::vector<double> &
   getDcdt(std::size_t compartmentIndex) const;
+  /**
+   * @brief Concentrations of all compartments concatenated.
+   */
+  [[nodiscard]] std::vector<double> getState() const;
+  /**
+   * @brief Set concentrations of all compartments from concatenated values.
+   */
+  void setState(const std::vector<double> &state);
+  /**
+   * @brief Steady state residual for concatenated concentrations.
+   *
+   * The reaction and diffusion rates without storage, i.e. zero at a steady
+   * state. Entries for time and space variables are zero. This also sets the
+   * concentrations to ``state``.
+   */
+  void evaluateSteadyStateResidual(const std::vector<double> &state,
+                                   std::vector<double> &residual);
+  /**
+   * @brief Apply the diffusion operator to concatenated concentrations.
+   */
+  void evaluateDiffusion(const std::vector<double> &state,
+                         std::vector<double> &result);
+  /**
+   * @brief Diagonal of the diffusion operator.
+   */
+  [[nodiscard]] std::vector<double> getDiffusionDiagonal();
+  /**
+   * @brief Maximum stable timestep of the forwards Euler integrator.
+   */
+  [[nodiscard]] double getMaxStableTimestep() const;
   /**
    * @brief Lower-order concentration value for adaptive RK.
    */
@@ -14,6 +14,7 @@
 #include <memory>
 #include <oneapi/tbb/global_control.h>
 #include <oneapi/tbb/parallel_for.h>
+#include <oneapi/tbb/parallel_reduce.h>
 #include <oneapi/tbb/tick_count.h>
 #include <utility>
 
@@ -194,11 +195,23 @@ SimCompartment::SimCompartment(
     const model::Model &doc, const geometry::Compartment *compartment,
     std::vector<std::string> sIds, bool doCSE, unsigned optLevel,
     bool timeDependent, bool spaceDependent, bool useUniformDiffusionOp,
-    const std::map<std::string, double, std::less<>> &substitutions)
+    const std::map<std::string, double, std::less<>> &substitutions,
+    const std::set<std::string, std::less<>> &unclampedSpeciesIds)
     : comp{compartment}, nPixels{compartment->nVoxels()}, nSpecies{sIds.size()},
       compartmentId{compartment->getId()}, speciesIds{std::move(sIds)},
       useUniformDiffusionOperator{useUniformDiffusionOp} {
   nPrimarySpecies = nSpecies;
+  nClampedSpecies = nPrimarySpecies;
+  while (nClampedSpecies > 0 &&
+         unclampedSpeciesIds.contains(speciesIds[nClampedSpecies - 1])) {
+    --nClampedSpecies;
+  }
+  for (std::size_t is = 0; is < nClampedSpecies; ++is) {
+    if (unclampedSpeciesIds.contains(speciesIds[is])) {
+      throw PixelSimImplError("Unclamped species '" + speciesIds[is] +
+                              "' must be after all other species");
+    }
+  }
   // get species in compartment
   speciesNames.reserve(nSpecies);
   maxPrimaryDiagonalDiffusion.reserve(nSpecies);
@@ -485,6 +498,16 @@ void SimCompartment::evaluateDiffusionOperator(std::size_t begin,
   }
 }
 
+void SimCompartment::applyDiffusionOperator(std::vector<double> &values,
+                                            std::vector<double> &result) {
+  std::swap(conc, values);
+  std::swap(dcdt, result);
+  std::ranges::fill(dcdt, 0.0);
+  evaluateDiffusionOperator(0, nPixels);
+  std::swap(conc, values);
+  std::swap(dcdt, result);
+}
+
 void SimCompartment::evaluateReactions(std::size_t begin, std::size_t end) {
   for (std::size_t i = begin; i < end; ++i) {
     sym.eval(dcdt.data() + i * nSpecies, conc.data() + i * nSpecies);
@@ -644,7 +667,7 @@ void SimCompartment::clampNegativeConcentrations(std::size_t begin,
                                                  std::size_t end) {
   for (std::size_t ix = begin; ix < end; ++ix) {
     const std::size_t iOffset{ix * nSpecies};
-    for (std::size_t is = 0; is < nPrimarySpecies; ++is) {
+    for (std::size_t is = 0; is < nClampedSpecies; ++is) {
       auto &c{conc[iOffset + is]};
       if (c < 0.0) {
         c = 0.0;
@@ -664,6 +687,55 @@ void SimCompartment::clampNegativeConcentrations_tbb() {
                  });
 }
 
+ConcentrationChange
+SimCompartment::updateConcentrationChange(std::size_t begin, std::size_t end) {
+  ConcentrationChange change{};
+  for (std::size_t ix = begin; ix < end; ++ix) {
+    const std::size_t iOffset{ix * nSpecies};
+    for (std::size_t is = 0; is < nPrimarySpecies; ++is) {
+      const std::size_t i{iOffset + is};
+      const double dc{conc[i] - concReference[i]};
+      change.sumSquaredChange += dc * dc;
+      change.sumSquaredConcentration += conc[i] * conc[i];
+      concReference[i] = conc[i];
+    }
+  }
+  return change;
+}
+
+void SimCompartment::initConcentrationReference() {
+  // only allocated if convergence is monitored
+  if (concReference.size() != conc.size()) {
+    concReference = conc;
+  }
+}
+
+ConcentrationChange SimCompartment::updateConcentrationChange() {
+  initConcentrationReference();
+  return updateConcentrationChange(0, nPixels);
+}
+
+ConcentrationChange SimCompartment::updateConcentrationChange_tbb() {
+  initConcentrationReference();
+  // deterministic reduction: the result does not depend on the scheduling
+  constexpr std::size_t tbbGrainSize{64};
+  return oneapi::tbb::parallel_deterministic_reduce(
+      oneapi::tbb::blocked_range<std::size_t>(0, nPixels, tbbGrainSize),
+      ConcentrationChange{},
+      [this](const oneapi::tbb::blocked_range<std::size_t> &r,
+             ConcentrationChange change) {
+        auto rangeChange{updateConcentrationChange(r.begin(), r.end())};
+        change.sumSquaredChange += rangeChange.sumSquaredChange;
+        change.sumSquaredConcentration += rangeChange.sumSquaredConcentration;
+        return change;
+      },
+      [](ConcentrationChange a, const ConcentrationChange &b) {
+        a.sumSquaredChange += b.sumSquaredChange;
+        a.sumSquaredConcentration += b.sumSquaredConcentration;
+        return a;
+      });
+}
+
 void SimCompartment::doRKInit() {
   s2.assign(conc.size(), 0.0);
   s3 = conc;
@@ -785,6 +857,10 @@ PixelIntegratorError SimCompartment::calculateRKError(double epsilon) const {
       // average current and previous concentrations and add a (hopefully) small
       // constant term to avoid dividing by c=0 issues
       double localNorm = 0.5 * (conc[i] + s3[i] + epsilon);
+      if (is >= nClampedSpecies && is < nPrimarySpecies) {
+        // unclamped species can be negative
+        localNorm = 0.5 * (std::abs(conc[i]) + std::abs(s3[i]) + epsilon);
+      }
       err.rel = std::max(err.rel, localErr / localNorm);
     }
   }
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "basesim.hpp"
 #include "sme/image_stack.hpp"
 #include "sme/pde.hpp"
 #include "sme/simulate_options.hpp"
@@ -13,6 +14,7 @@
 #include <array>
 #include <cstddef>
 #include <limits>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -88,9 +90,13 @@ private:
   std::vector<std::size_t> nonSpatialSpeciesIndices;
   std::vector<std::size_t> zeroStorageSpeciesIndices;
   std::size_t nPrimarySpecies{0};
+  // the first nClampedSpecies species can't be negative
+  std::size_t nClampedSpecies{0};
   std::vector<double> maxPrimaryDiagonalDiffusion;
   std::vector<double> relaxOld;
   std::vector<double> relaxFirstOrder;
+  // concentrations at the previous convergence check, empty until first used
+  std::vector<double> concReference;
   double maxStableTimestep = std::numeric_limits<double>::max();
   double maxRelaxStableTimestep = std::numeric_limits<double>::max();
   double dx2{1.0};
@@ -100,17 +106,22 @@ private:
   bool hasNonUnitStorage{false};
   bool hasZeroStorageSpecies{false};
   bool hasCrossDiffusion{false};
+  void initConcentrationReference();
 
 public:
   /**
    * @brief Construct compartment simulation state.
+   *
+   * Species in ``unclampedSpeciesIds`` can become negative, and must be the
+   * last species in ``sIds``.
    */
   explicit SimCompartment(
       const model::Model &doc, const geometry::Compartment *compartment,
       std::vector<std::string> sIds, bool doCSE = true, unsigned optLevel = 3,
       bool timeDependent = false, bool spaceDependent = false,
       bool useUniformDiffusionOperator = false,
-      const std::map<std::string, double, std::less<>> &substitutions = {});
+      const std::map<std::string, double, std::less<>> &substitutions = {},
+      const std::set<std::string, std::less<>> &unclampedSpeciesIds = {});
 
   /**
    * @brief Evaluate diffusion contribution into ``dcdt`` for voxel range.
@@ -132,6 +143,12 @@ public:
    * @brief Apply cross-diffusion operator for voxel range.
    */
   void evaluateCrossDiffusionOperator(std::size_t begin, std::size_t end);
+  /**
+   * @brief Apply the diffusion operator to ``values`` instead of the
+   * concentrations.
+   */
+  void applyDiffusionOperator(std::vector<double> &values,
+                              std::vector<double> &result);
   /**
    * @brief Evaluate reactions and diffusion in single-thread mode.
    */
@@ -180,6 +197,23 @@ public:
    * @brief Clamp negative concentrations using multithreading.
    */
   void clampNegativeConcentrations_tbb();
+  /**
+   * @brief Change in species concentrations since the reference for voxel
+   * range, and update the reference to the current concentrations.
+   */
+  [[nodiscard]] ConcentrationChange
+  updateConcentrationChange(std::size_t begin, std::size_t end);
+  /**
+   * @brief Change in species concentrations for all voxels.
+   *
+   * The reference concentrations are allocated by the first call, which
+   * reports no change.
+   */
+  [[nodiscard]] ConcentrationChange updateConcentrationChange();
+  /**
+   * @brief Change in species concentrations using multithreading.
+   */
+  [[nodiscard]] ConcentrationChange updateConcentrationChange_tbb();
   /**
    * @brief Initialize Runge-Kutta work buffers.
    */
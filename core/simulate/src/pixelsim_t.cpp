@@ -2,6 +2,7 @@
 #include "model_test_utils.hpp"
 #include "pixelsim.hpp"
 #include "sme/model.hpp"
+#include <algorithm>
 #include <cmath>
 
 using namespace sme;
@@ -47,6 +48,76 @@ TEST_CASE("PixelSim", "[core/simulate/pixelsim][core/"
       REQUIRE(cUniform[i] == dbl_approx(cArray[i]));
     }
   }
+  SECTION("Steady state residual and diffusion operator") {
+    // model with diffusion and no reactions
+    auto m{getExampleModel(Mod::SingleCompartmentDiffusion)};
+    m.getSimulationSettings().options.pixel.enableMultiThreading = false;
+    std::vector<std::string> comps{"circle"};
+    std::vector<std::vector<std::string>> specs{{"slow", "fast"}};
+    simulate::PixelSim sim(m, comps, specs);
+    REQUIRE(sim.errorMessage().empty());
+    auto state{sim.getState()};
+    REQUIRE(state == sim.getConcentrations(0));
+    std::vector<double> residual(state.size(), 0.0);
+    std::vector<double> diffusion(state.size(), 0.0);
+    sim.evaluateSteadyStateResidual(state, residual);
+    sim.evaluateDiffusion(state, diffusion);
+    for (std::size_t i = 0; i < state.size(); ++i) {
+      REQUIRE(residual[i] == dbl_approx(diffusion[i]));
+    }
+    // diagonal matches diffusion operator applied to a unit vector
+    auto diagonal{sim.getDiffusionDiagonal()};
+    REQUIRE(diagonal.size() == state.size());
+    for (std::size_t i : {0u, 1u, 500u, 1001u}) {
+      std::vector<double> unit(state.size(), 0.0);
+      unit[i] = 1.0;
+      sim.evaluateDiffusion(unit, diffusion);
+      REQUIRE(diagonal[i] == dbl_approx(diffusion[i]));
+      REQUIRE(diagonal[i] < 0.0);
+    }
+    // evaluating the residual sets the concentrations
+    std::ranges::fill(state, 1.0);
+    sim.evaluateSteadyStateResidual(state, residual);
+    REQUIRE(sim.getConcentrations(0) == state);
+    for (auto r : residual) {
+      REQUIRE(r == Catch::Approx(0.0).margin(1e-12));
+    }
+  }
+  SECTION("Concentration change for convergence monitoring") {
+    auto m{getExampleModel(Mod::SingleCompartmentDiffusion)};
+    std::vector<std::string> comps{"circle"};
+    std::vector<std::vector<std::string>> specs{{"slow", "fast"}};
+    for (bool multithreaded : {false, true}) {
+      m.getSimulationSettings().options.pixel.enableMultiThreading =
+          multithreaded;
+      simulate::PixelSim sim(m, comps, specs);
+      REQUIRE(sim.errorMessage().empty());
+      double sumSquared{0.0};
+      for (double c : sim.getConcentrations(0)) {
+        sumSquared += c * c;
+      }
+      // first call sets the reference concentrations: no change
+      auto change{sim.updateConcentrationChange()};
+      REQUIRE(change.has_value());
+      REQUIRE(change->sumSquaredChange == dbl_approx(0.0));
+      REQUIRE(change->sumSquaredConcentration == dbl_approx(sumSquared));
+      auto c0{sim.getConcentrations(0)};
+      sim.run(0.1, -1.0, {});
+      double sumSquaredChange{0.0};
+      const auto &c1{sim.getConcentrations(0)};
+      for (std::size_t i = 0; i < c1.size(); ++i) {
+        sumSquaredChange += (c1[i] - c0[i]) * (c1[i] - c0[i]);
+      }
+      change = sim.updateConcentrationChange();
+      REQUIRE(change.has_value());
+      REQUIRE(change->sumSquaredChange > 0.0);
+      REQUIRE(change->sumSquaredChange == dbl_approx(sumSquaredChange));
+      // the current concentrations are the new reference
+      change = sim.updateConcentrationChange();
+      REQUIRE(change.has_value());
+      REQUIRE(change->sumSquaredChange == dbl_approx(0.0));
+    }
+  }
   SECTION("Zero-storage species: PixelSim accepts S=0") {
     auto m{getExampleModel(Mod::ABtoC)};
     m.getSpecies().setStorage("C", 0.0);
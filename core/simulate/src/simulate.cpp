@@ -1,5 +1,6 @@
 #include "sme/simulate.hpp"
 #include "basesim.hpp"
+#include "conc_image_pyramid.hpp"
 #include "dunesim.hpp"
 #ifdef SME_WITH_CUDA
 #include "cudapixelsim.hpp"
@@ -18,6 +19,7 @@
 #include "sme/utils.hpp"
 #include <QElapsedTimer>
 #include <algorithm>
+#include <cmath>
 #include <limits>
 #include <numeric>
 #include <shared_mutex>
@@ -320,6 +322,16 @@ void Simulation::updateConcentrations(double t) {
     }
   }
   model.getFeatures().evaluateAtTimepoint(data->timePoints.size() - 1);
+  if (concImagePyramid != nullptr) {
+    // downsample without blocking readers of the existing results
+    lock.unlock();
+    {
+      std::shared_lock sharedLock{dataMutex};
+      concImagePyramid->update(data->timePoints.size() - 1, *data);
+    }
+    lock.lock();
+  }
+  data->enforceMemoryBudget();
 }
 
 Simulation::Simulation(model::Model &smeModel)
@@ -333,6 +345,9 @@ Simulation::Simulation(model::Model &smeModel)
     SPDLOG_INFO("continuing existing simulation with {} timepoints",
                 data->timePoints.size());
   }
+  data->setMemoryBudgetBytes(settings->memoryBudgetBytes);
+  data->setReservedMemoryBytes(0);
+  data->enforceMemoryBudget();
   initModel();
   initEvents();
   // init simulator
@@ -346,7 +361,11 @@ Simulation::Simulation(model::Model &smeModel)
   }
 }
 
-Simulation::~Simulation() = default;
+Simulation::~Simulation() {
+  if (concImagePyramid != nullptr) {
+    data->setReservedMemoryBytes(0);
+  }
+}
 
 std::size_t Simulation::doTimesteps(double time, std::size_t nSteps,
                                     double timeout_ms) {
@@ -458,6 +477,9 @@ std::size_t Simulation::doMultipleTimesteps(
       }
       updateConcentrations(nextTime);
       ++nCompletedTimesteps;
+      if (timepointCallback) {
+        timepointCallback(nCompletedTimesteps.load() - 1);
+      }
     }
   }
   isRunning.store(false);
@@ -466,6 +488,70 @@ std::size_t Simulation::doMultipleTimesteps(
   return steps;
 }
 
+void Simulation::setTimepointCallback(
+    std::function<void(std::size_t)> callback) {
+  timepointCallback = std::move(callback);
+}
+
+void Simulation::setConcImagePyramidLevels(std::size_t nLevels) {
+  std::unique_lock lock{dataMutex};
+  concImagePyramid.reset();
+  data->setReservedMemoryBytes(0);
+  if (nLevels == 0 || compartments.empty()) {
+    data->enforceMemoryBudget();
+    return;
+  }
+  std::vector<std::size_t> compartmentNSpecies;
+  compartmentNSpecies.reserve(compartmentSpeciesIds.size());
+  for (const auto &speciesIds : compartmentSpeciesIds) {
+    compartmentNSpecies.push_back(speciesIds.size());
+  }
+  concImagePyramid = std::make_unique<ConcImagePyramid>(
+      imageSize, model.getGeometry().getVoxelSize(), compartments,
+      std::move(compartmentNSpecies), nLevels);
+  if (const auto budget{data->getMemoryBudgetBytes()}; budget != 0) {
+    // downsampled concentrations can be recomputed, so they get a fixed
+    // share of the memory budget, and the rest is left for the results
+    concImagePyramid->setMaxMemoryBytes(std::max(budget / 4, std::size_t{1}));
+    data->setReservedMemoryBytes(concImagePyramid->getReservedMemoryBytes());
+  }
+  data->enforceMemoryBudget();
+}
+
+void Simulation::setConcImageDisplaySize(const QSize &displaySize) {
+  setConcImagePyramidLevels(ConcImagePyramid::getLevel(
+      imageSize, displaySize, std::numeric_limits<std::size_t>::max()));
+}
+
+std::optional<SolverCheckpoint> Simulation::getSolverCheckpoint() const {
+  auto checkpoint{simulator->getCheckpoint()};
+  if (checkpoint.has_value()) {
+    std::shared_lock lock{dataMutex};
+    checkpoint->time = data->timePoints.back();
+  }
+  return checkpoint;
+}
+
+bool Simulation::applySolverCheckpoint(const SolverCheckpoint &checkpoint) {
+  double t{};
+  {
+    std::shared_lock lock{dataMutex};
+    if (data->timePoints.empty()) {
+      return false;
+    }
+    t = data->timePoints.back();
+  }
+  constexpr double relativeTolerance{1e-12};
+  if (std::abs(checkpoint.time - t) >
+      relativeTolerance * std::max(1.0, std::abs(t))) {
+    SPDLOG_WARN("Ignoring solver checkpoint from time {}: latest timepoint "
+                "is at time {}",
+                checkpoint.time, t);
+    return false;
+  }
+  return simulator->setCheckpoint(checkpoint);
+}
+
 const std::string &Simulation::errorMessage() const {
   return simulator->errorMessage();
 }
@@ -505,7 +591,8 @@ std::vector<double> Simulation::getConc(std::size_t timeIndex,
                                         std::size_t speciesIndex) const {
   std::vector<double> c;
   std::shared_lock lock{dataMutex};
-  const auto &compConc = data->concentration[timeIndex][compartmentIndex];
+  const auto conc{data->getConcentration(timeIndex)};
+  const auto &compConc{(*conc)[compartmentIndex]};
   std::size_t nPixels = compartments[compartmentIndex]->nVoxels();
   std::size_t nSpecies = compartmentSpeciesIds[compartmentIndex].size();
   std::size_t stride{nSpecies + data->concPadding[timeIndex]};
@@ -521,7 +608,8 @@ std::vector<double> Simulation::getConcArray(std::size_t timeIndex,
                                              std::size_t speciesIndex) const {
   std::vector<double> c(static_cast<std::size_t>(imageSize.nVoxels()), 0.0);
   std::shared_lock lock{dataMutex};
-  const auto &compConc = data->concentration[timeIndex][compartmentIndex];
+  const auto conc{data->getConcentration(timeIndex)};
+  const auto &compConc{(*conc)[compartmentIndex]};
   const auto &comp = compartments[compartmentIndex];
   std::size_t nPixels = comp->nVoxels();
   std::size_t nSpecies = compartmentSpeciesIds[compartmentIndex].size();
@@ -613,7 +701,8 @@ double Simulation::getLowerOrderConc(std::size_t compartmentIndex,
 common::ImageStack Simulation::getConcImage(
     std::size_t timeIndex,
     const std::vector<std::vector<std::size_t>> &speciesToDraw,
-    bool normaliseOverAllTimepoints, bool normaliseOverAllSpecies) const {
+    bool normaliseOverAllTimepoints, bool normaliseOverAllSpecies,
+    const QSize &displaySize) const {
   if (compartments.empty()) {
     return common::ImageStack{};
   }
@@ -656,13 +745,21 @@ common::ImageStack Simulation::getConcImage(
       }
     }
   }
+  if (concImagePyramid != nullptr) {
+    if (auto level{concImagePyramid->getLevel(displaySize)}; level > 0) {
+      return concImagePyramid->getImage(level, timeIndex, *data,
+                                        *speciesIndices, maxConcs,
+                                        compartmentSpeciesColors);
+    }
+  }
   common::ImageStack imgs(imageSize, QImage::Format_ARGB32_Premultiplied);
   imgs.setVoxelSize(model.getGeometry().getVoxelSize());
   imgs.fill(0);
+  const auto timeConc{data->getConcentration(timeIndex)};
   // iterate over compartments
   for (std::size_t ic = 0; ic < compartments.size(); ++ic) {
     const auto &voxels{compartments[ic]->getVoxels()};
-    const auto &conc{data->concentration[timeIndex][ic]};
+    const auto &conc{(*timeConc)[ic]};
     std::size_t nSpecies = compartmentSpeciesIds[ic].size();
     std::size_t stride{nSpecies + data->concPadding[timeIndex]};
     for (std::size_t ix = 0; ix < voxels.size(); ++ix) {
@@ -704,7 +801,8 @@ Simulation::getPyConcs(std::size_t timeIndex,
       std::vector<double>(imageSize.nVoxels(), 0.0));
   std::shared_lock lock{dataMutex};
   const auto &voxels{compartments[compartmentIndex]->getVoxels()};
-  const auto &conc{data->concentration[timeIndex][compartmentIndex]};
+  const auto timeConc{data->getConcentration(timeIndex)};
+  const auto &conc{(*timeConc)[compartmentIndex]};
   const std::size_t nSpecies{compartmentSpeciesIds[compartmentIndex].size()};
   const std::size_t stride{nSpecies + data->concPadding[timeIndex]};
   for (std::size_t ix = 0; ix < voxels.size(); ++ix) {
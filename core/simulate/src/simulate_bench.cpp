@@ -16,6 +16,34 @@ static void simulate_SimulationDUNE(benchmark::State &state) {
   }
 }
 
+// DUNE simulation setup with spatially varying initial concentrations and
+// diffusion constants
+template <typename T>
+static void simulate_SimulationDUNE_sampledFields(benchmark::State &state) {
+  T data;
+  auto &model{data.model};
+  model.getSimulationSettings().simulatorType = simulate::SimulatorType::DUNE;
+  const auto nVoxels{model.getGeometry().getImages().volume().nVoxels()};
+  for (const auto &compartmentId : model.getCompartments().getIds()) {
+    for (const auto &speciesId : model.getSpecies().getIds(compartmentId)) {
+      if (!model.getSpecies().getIsSpatial(speciesId)) {
+        continue;
+      }
+      std::vector<double> values(nVoxels, 0.0);
+      for (std::size_t i = 0; i < nVoxels; ++i) {
+        values[i] = 1.0 + static_cast<double>(i % 7);
+      }
+      model.getSpecies().setSampledFieldConcentration(speciesId, values);
+      model.getSpecies().setSampledFieldDiffusionConstant(speciesId, values);
+    }
+  }
+  std::unique_ptr<simulate::Simulation> simulation;
+  for (auto _ : state) {
+    simulation.reset();
+    simulation = std::make_unique<simulate::Simulation>(model);
+  }
+}
+
 template <typename T>
 static void simulate_SimulationPIXEL(benchmark::State &state) {
   T data;
@@ -38,5 +66,6 @@ static void simulate_Simulation_getConcImage(benchmark::State &state) {
 }
 
 SME_BENCHMARK(simulate_SimulationDUNE);
+SME_BENCHMARK(simulate_SimulationDUNE_sampledFields);
 SME_BENCHMARK(simulate_SimulationPIXEL);
 SME_BENCHMARK(simulate_Simulation_getConcImage);
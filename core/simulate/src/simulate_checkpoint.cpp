@@ -0,0 +1,61 @@
+#include "sme/simulate_checkpoint.hpp"
+#include "sme/logger.hpp"
+#include <QSaveFile>
+#include <cereal/archives/binary.hpp>
+#include <cereal/types/string.hpp>
+#include <fstream>
+#include <sstream>
+#include <string_view>
+
+namespace sme::simulate {
+
+namespace {
+
+constexpr std::string_view checkpointMagic{"sme-solver-checkpoint"};
+
+}
+
+bool exportSolverCheckpoint(const std::string &filename,
+                            const SolverCheckpoint &checkpoint) {
+  std::ostringstream ss;
+  {
+    cereal::BinaryOutputArchive ar(ss);
+    ar(std::string{checkpointMagic}, checkpoint);
+  }
+  const auto bytes{ss.str()};
+  QSaveFile file(filename.c_str());
+  if (!file.open(QIODevice::WriteOnly) ||
+      file.write(bytes.data(), static_cast<qint64>(bytes.size())) !=
+          static_cast<qint64>(bytes.size()) ||
+      !file.commit()) {
+    SPDLOG_WARN("Failed to write solver checkpoint '{}'", filename);
+    return false;
+  }
+  return true;
+}
+
+std::optional<SolverCheckpoint>
+importSolverCheckpoint(const std::string &filename) {
+  std::ifstream fs(filename, std::ios::binary);
+  if (!fs) {
+    return {};
+  }
+  SolverCheckpoint checkpoint{};
+  try {
+    cereal::BinaryInputArchive ar(fs);
+    std::string magic;
+    ar(magic);
+    if (magic != checkpointMagic) {
+      SPDLOG_WARN("Invalid solver checkpoint '{}'", filename);
+      return {};
+    }
+    ar(checkpoint);
+  } catch (const std::exception &e) {
+    SPDLOG_WARN("Failed to read solver checkpoint '{}'. {}", filename,
+                e.what());
+    return {};
+  }
+  return checkpoint;
+}
+
+} // namespace sme::simulate
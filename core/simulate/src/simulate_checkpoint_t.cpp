@@ -0,0 +1,43 @@
+#include "catch_wrapper.hpp"
+#include "sme/simulate_checkpoint.hpp"
+#include <QFile>
+
+using namespace sme;
+
+TEST_CASE("SolverCheckpoint",
+          "[core/simulate/simulate_checkpoint][core/simulate][core]["
+          "simulate_checkpoint]") {
+  const char *filename{"tmp_solver_checkpoint.bin"};
+  QFile::remove(filename);
+  SECTION("missing or invalid file") {
+    REQUIRE(!simulate::importSolverCheckpoint(filename).has_value());
+    QFile f(filename);
+    REQUIRE(f.open(QIODevice::WriteOnly));
+    f.write("not a checkpoint");
+    f.close();
+    REQUIRE(!simulate::importSolverCheckpoint(filename).has_value());
+  }
+  SECTION("export, import, overwrite") {
+    simulate::SolverCheckpoint checkpoint{};
+    checkpoint.simulatorType = simulate::SimulatorType::Pixel;
+    checkpoint.time = 1.5;
+    checkpoint.timestep = 0.01;
+    checkpoint.state = {{1.0, 2.0, 3.0}, {}, {0.5}};
+    REQUIRE(simulate::exportSolverCheckpoint(filename, checkpoint));
+    auto c{simulate::importSolverCheckpoint(filename)};
+    REQUIRE(c.has_value());
+    REQUIRE(c->simulatorType == checkpoint.simulatorType);
+    REQUIRE(c->time == dbl_approx(checkpoint.time));
+    REQUIRE(c->timestep == dbl_approx(checkpoint.timestep));
+    REQUIRE(c->state == checkpoint.state);
+    checkpoint.simulatorType = simulate::SimulatorType::DUNE;
+    checkpoint.time = 3.0;
+    checkpoint.state.clear();
+    REQUIRE(simulate::exportSolverCheckpoint(filename, checkpoint));
+    c = simulate::importSolverCheckpoint(filename);
+    REQUIRE(c.has_value());
+    REQUIRE(c->simulatorType == simulate::SimulatorType::DUNE);
+    REQUIRE(c->time == dbl_approx(3.0));
+    REQUIRE(c->state.empty());
+  }
+}
@@ -1,9 +1,191 @@
 #include "sme/simulate_data.hpp"
+#include "sme/logger.hpp"
 #include "sme/utils.hpp"
+#include <QByteArray>
+#include <QTemporaryFile>
+#include <QtEndian>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
 #include <limits>
+#include <map>
+#include <mutex>
+#include <oneapi/tbb/blocked_range.h>
+#include <oneapi/tbb/info.h>
+#include <oneapi/tbb/parallel_for.h>
+#include <stdexcept>
 
 namespace sme::simulate {
 
+/**
+ * @brief Append-only temporary file of spilled timepoint concentrations.
+ */
+class SimulationDataSpillFile {
+  struct Location {
+    qint64 offset{0};
+    std::vector<std::size_t> sizes;
+  };
+  struct PagedIn {
+    std::shared_ptr<const std::vector<std::vector<double>>> conc;
+    std::size_t bytes{0};
+    std::uint64_t lastUsed{0};
+  };
+  QTemporaryFile file;
+  std::map<std::size_t, Location> locations;
+  std::map<std::size_t, PagedIn> pagedIn;
+  std::size_t pagedInBytes{0};
+  std::uint64_t useCount{0};
+  std::mutex mutex;
+
+  // evict least recently used timepoints, apart from ``keep``, until the
+  // paged-in concentrations use at most ``maxBytes``
+  void evict(std::size_t maxBytes, std::size_t keep) {
+    while (pagedInBytes > maxBytes && pagedIn.size() > 1) {
+      auto lru{pagedIn.end()};
+      for (auto iter = pagedIn.begin(); iter != pagedIn.end(); ++iter) {
+        if (iter->first != keep &&
+            (lru == pagedIn.end() ||
+             iter->second.lastUsed < lru->second.lastUsed)) {
+          lru = iter;
+        }
+      }
+      pagedInBytes -= lru->second.bytes;
+      pagedIn.erase(lru);
+    }
+  }
+
+public:
+  SimulationDataSpillFile() {
+    if (!file.open()) {
+      SPDLOG_ERROR("Failed to create simulation data spill file");
+    }
+  }
+  [[nodiscard]] bool contains(std::size_t timeIndex) const {
+    return locations.contains(timeIndex);
+  }
+  [[nodiscard]] std::size_t size() const { return locations.size(); }
+  bool write(std::size_t timeIndex,
+             const std::vector<std::vector<double>> &conc) {
+    std::scoped_lock lock{mutex};
+    Location location{file.size(), {}};
+    if (!file.isOpen() || !file.seek(location.offset)) {
+      return false;
+    }
+    location.sizes.reserve(conc.size());
+    for (const auto &c : conc) {
+      const auto nBytes{static_cast<qint64>(c.size() * sizeof(double))};
+      if (file.write(reinterpret_cast<const char *>(c.data()), nBytes) !=
+          nBytes) {
+        SPDLOG_ERROR("Failed to write to simulation data spill file {}",
+                     file.fileName().toStdString());
+        return false;
+      }
+      location.sizes.push_back(c.size());
+    }
+    locations[timeIndex] = std::move(location);
+    return true;
+  }
+  [[nodiscard]] std::vector<std::vector<double>> read(std::size_t timeIndex) {
+    std::scoped_lock lock{mutex};
+    std::vector<std::vector<double>> conc;
+    const auto &location{locations.at(timeIndex)};
+    file.seek(location.offset);
+    conc.reserve(location.sizes.size());
+    for (auto n : location.sizes) {
+      auto &c{conc.emplace_back(n, 0.0)};
+      const auto nBytes{static_cast<qint64>(n * sizeof(double))};
+      if (file.read(reinterpret_cast<char *>(c.data()), nBytes) != nBytes) {
+        SPDLOG_ERROR("Failed to read from simulation data spill file {}",
+                     file.fileName().toStdString());
+      }
+    }
+    return conc;
+  }
+  [[nodiscard]] std::shared_ptr<const std::vector<std::vector<double>>>
+  pageIn(std::size_t timeIndex, std::size_t maxBytes) {
+    {
+      std::scoped_lock lock{mutex};
+      if (auto iter{pagedIn.find(timeIndex)}; iter != pagedIn.end()) {
+        iter->second.lastUsed = ++useCount;
+        return iter->second.conc;
+      }
+    }
+    auto conc{std::make_shared<const std::vector<std::vector<double>>>(
+        read(timeIndex))};
+    std::size_t bytes{0};
+    for (const auto &c : *conc) {
+      bytes += c.size() * sizeof(double);
+    }
+    std::scoped_lock lock{mutex};
+    // if another thread paged in the same timepoint first, keep its copy
+    auto [iter, inserted]{
+        pagedIn.try_emplace(timeIndex, PagedIn{std::move(conc), bytes, 0})};
+    iter->second.lastUsed = ++useCount;
+    if (inserted) {
+      pagedInBytes += bytes;
+      evict(maxBytes, timeIndex);
+    }
+    return iter->second.conc;
+  }
+  [[nodiscard]] std::size_t getPagedInBytes() {
+    std::scoped_lock lock{mutex};
+    return pagedInBytes;
+  }
+  std::vector<std::vector<double>> remove(std::size_t timeIndex) {
+    auto conc{read(timeIndex)};
+    std::scoped_lock lock{mutex};
+    locations.erase(timeIndex);
+    if (auto iter{pagedIn.find(timeIndex)}; iter != pagedIn.end()) {
+      pagedInBytes -= iter->second.bytes;
+      pagedIn.erase(iter);
+    }
+    return conc;
+  }
+  void releasePagedIn() {
+    std::scoped_lock lock{mutex};
+    pagedIn.clear();
+    pagedInBytes = 0;
+  }
+};
+
+/**
+ * @brief Temporary file of encoded concentration blocks and their offsets.
+ */
+class SimulationDataBlockFile {
+  QTemporaryFile file;
+  std::vector<std::uint64_t> offsets{0};
+
+public:
+  SimulationDataBlockFile() {
+    if (!file.open()) {
+      throw std::runtime_error(
+          "Failed to create temporary file for simulation data");
+    }
+  }
+  void append(const std::string &block) {
+    const auto nBytes{static_cast<qint64>(block.size())};
+    if (file.write(block.data(), nBytes) != nBytes) {
+      throw std::runtime_error(
+          "Failed to write temporary file for simulation data");
+    }
+    offsets.push_back(offsets.back() + block.size());
+  }
+  [[nodiscard]] const std::vector<std::uint64_t> &getOffsets() const {
+    return offsets;
+  }
+  [[nodiscard]] std::string read(std::size_t begin, std::size_t end) {
+    std::string bytes(offsets[end] - offsets[begin], '\0');
+    if (!file.flush() || !file.seek(static_cast<qint64>(offsets[begin])) ||
+        file.read(bytes.data(), static_cast<qint64>(bytes.size())) !=
+            static_cast<qint64>(bytes.size())) {
+      throw std::runtime_error(
+          "Failed to read temporary file for simulation data");
+    }
+    return bytes;
+  }
+};
+
 namespace {
 
 [[nodiscard]] std::size_t saturatingMul(std::size_t a, std::size_t b) {
@@ -27,6 +209,88 @@ get2dElementsBytes(const std::vector<std::vector<T>> &vec) {
   return bytes;
 }
 
+// zlib level: favour speed, most of the gain is from runs of zeros
+constexpr int concentrationBlockCompressionLevel{1};
+
+template <typename T>
+void appendLittleEndian(QByteArray &raw, const T *values, std::size_t n) {
+  static_assert(sizeof(T) == sizeof(std::uint64_t));
+  if constexpr (std::endian::native == std::endian::little) {
+    raw.append(reinterpret_cast<const char *>(values),
+               static_cast<qsizetype>(n * sizeof(T)));
+  } else {
+    for (std::size_t i = 0; i < n; ++i) {
+      const auto v{qToLittleEndian(std::bit_cast<std::uint64_t>(values[i]))};
+      raw.append(reinterpret_cast<const char *>(&v), sizeof(v));
+    }
+  }
+}
+
+template <typename T>
+void readLittleEndian(const char *raw, T *values, std::size_t n) {
+  static_assert(sizeof(T) == sizeof(std::uint64_t));
+  if constexpr (std::endian::native == std::endian::little) {
+    std::memcpy(values, raw, n * sizeof(T));
+  } else {
+    for (std::size_t i = 0; i < n; ++i) {
+      values[i] = std::bit_cast<T>(
+          qFromLittleEndian<std::uint64_t>(raw + i * sizeof(T)));
+    }
+  }
+}
+
+[[nodiscard]] std::string
+encodeConcentrationBlock(const std::vector<std::vector<double>> &conc) {
+  // layout: [nCompartments][n_0][n_0 doubles]...[n_N][n_N doubles],
+  // all little-endian
+  std::size_t nBytes{sizeof(std::uint64_t)};
+  for (const auto &c : conc) {
+    nBytes += sizeof(std::uint64_t) + c.size() * sizeof(double);
+  }
+  QByteArray raw;
+  raw.reserve(static_cast<qsizetype>(nBytes));
+  const std::uint64_t nCompartments{conc.size()};
+  appendLittleEndian(raw, &nCompartments, 1);
+  for (const auto &c : conc) {
+    const std::uint64_t n{c.size()};
+    appendLittleEndian(raw, &n, 1);
+    appendLittleEndian(raw, c.data(), c.size());
+  }
+  const auto compressed{qCompress(raw, concentrationBlockCompressionLevel)};
+  return {compressed.constData(), static_cast<std::size_t>(compressed.size())};
+}
+
+[[nodiscard]] std::vector<std::vector<double>>
+decodeConcentrationBlock(const char *block, std::size_t size) {
+  const auto raw{qUncompress(reinterpret_cast<const uchar *>(block),
+                             static_cast<qsizetype>(size))};
+  const auto rawSize{static_cast<std::size_t>(raw.size())};
+  std::size_t pos{0};
+  const auto read = [&raw, rawSize, &pos](auto *data, std::size_t n) {
+    if (n > (rawSize - pos) / sizeof(*data)) {
+      throw std::runtime_error("Invalid simulation data concentration block");
+    }
+    readLittleEndian(raw.constData() + pos, data, n);
+    pos += n * sizeof(*data);
+  };
+  std::uint64_t nCompartments{0};
+  read(&nCompartments, 1);
+  if (nCompartments > rawSize / sizeof(std::uint64_t)) {
+    throw std::runtime_error("Invalid simulation data concentration block");
+  }
+  std::vector<std::vector<double>> conc(nCompartments);
+  for (auto &c : conc) {
+    std::uint64_t n{0};
+    read(&n, 1);
+    if (n > (rawSize - pos) / sizeof(double)) {
+      throw std::runtime_error("Invalid simulation data concentration block");
+    }
+    c.resize(n);
+    read(c.data(), n);
+  }
+  return conc;
+}
+
 template <typename T>
 [[nodiscard]] std::size_t
 get3dElementsBytes(const std::vector<std::vector<std::vector<T>>> &vec) {
@@ -39,7 +303,90 @@ get3dElementsBytes(const std::vector<std::vector<std::vector<T>>> &vec) {
 
 } // namespace
 
+SimulationData::SimulationData() = default;
+
+SimulationData::~SimulationData() = default;
+
+SimulationData::SimulationData(SimulationData &&) noexcept = default;
+
+SimulationData &SimulationData::operator=(SimulationData &&) noexcept = default;
+
+std::vector<std::vector<double>>
+SimulationData::readSpilledConcentration(std::size_t timeIndex) const {
+  return spillFile->read(timeIndex);
+}
+
+std::size_t SimulationData::concentrationBlocksPerBatch() {
+  // enough blocks to keep all threads busy, while limiting the extra memory
+  // used for the encoded copies of the concentrations
+  return 4 * static_cast<std::size_t>(
+                 std::max(1, oneapi::tbb::info::default_concurrency()));
+}
+
+std::shared_ptr<SimulationDataBlockFile>
+SimulationData::encodeConcentrationBlocks() const {
+  auto blockFile{std::make_shared<SimulationDataBlockFile>()};
+  const std::size_t n{concentration.size()};
+  std::vector<std::string> blocks;
+  for (std::size_t begin = 0; begin < n;
+       begin += concentrationBlocksPerBatch()) {
+    const std::size_t end{std::min(n, begin + concentrationBlocksPerBatch())};
+    blocks.resize(end - begin);
+    oneapi::tbb::parallel_for(
+        oneapi::tbb::blocked_range<std::size_t>(begin, end),
+        [this, begin,
+         &blocks](const oneapi::tbb::blocked_range<std::size_t> &r) {
+          for (std::size_t i = r.begin(); i != r.end(); ++i) {
+            blocks[i - begin] =
+                isSpilled(i)
+                    ? encodeConcentrationBlock(readSpilledConcentration(i))
+                    : encodeConcentrationBlock(concentration[i]);
+          }
+        });
+    for (const auto &block : blocks) {
+      blockFile->append(block);
+    }
+  }
+  return blockFile;
+}
+
+const std::vector<std::uint64_t> &SimulationData::getConcentrationBlockOffsets(
+    const SimulationDataBlockFile &blockFile) {
+  return blockFile.getOffsets();
+}
+
+std::string
+SimulationData::readConcentrationBlocks(SimulationDataBlockFile &blockFile,
+                                        std::size_t begin, std::size_t end) {
+  return blockFile.read(begin, end);
+}
+
+void SimulationData::checkConcentrationBlockOffsets(
+    const std::vector<std::uint64_t> &offsets) {
+  if (offsets.empty() || offsets.front() != 0 ||
+      !std::is_sorted(offsets.cbegin(), offsets.cend())) {
+    throw std::runtime_error("Invalid simulation data concentration index");
+  }
+}
+
+void SimulationData::decodeConcentrationBlocks(
+    const std::string &bytes, const std::vector<std::uint64_t> &offsets,
+    std::size_t begin, std::size_t end) {
+  concentration.resize(end);
+  oneapi::tbb::parallel_for(
+      oneapi::tbb::blocked_range<std::size_t>(begin, end),
+      [this, begin, &bytes,
+       &offsets](const oneapi::tbb::blocked_range<std::size_t> &r) {
+        for (std::size_t i = r.begin(); i != r.end(); ++i) {
+          concentration[i] = decodeConcentrationBlock(
+              bytes.data() + (offsets[i] - offsets[begin]),
+              offsets[i + 1] - offsets[i]);
+        }
+      });
+}
+
 void SimulationData::clear() {
+  spillFile.reset();
   timePoints.clear();
   concentration.clear();
   avgMinMax.clear();
@@ -51,7 +398,7 @@ void SimulationData::clear() {
 
 std::size_t SimulationData::size() const { return timePoints.size(); }
 
-std::size_t SimulationData::getEstimatedMemoryBytes() const {
+std::size_t SimulationData::getResidentMemoryBytes() const {
   std::size_t bytes{0};
   bytes = common::saturatingAdd(
       bytes, saturatingMul(timePoints.size(), sizeof(double)));
@@ -65,6 +412,14 @@ std::size_t SimulationData::getEstimatedMemoryBytes() const {
   return bytes;
 }
 
+std::size_t SimulationData::getEstimatedMemoryBytes() const {
+  if (spillFile == nullptr) {
+    return getResidentMemoryBytes();
+  }
+  return common::saturatingAdd(getResidentMemoryBytes(),
+                               spillFile->getPagedInBytes());
+}
+
 std::size_t SimulationData::getEstimatedAdditionalMemoryBytes(
     std::size_t nAdditionalTimepoints) const {
   if (nAdditionalTimepoints == 0 || concentration.empty()) {
@@ -98,6 +453,10 @@ void SimulationData::reserve(std::size_t n) {
 void SimulationData::pop_back() {
   timePoints.pop_back();
   concentration.pop_back();
+  // the last timepoint is always kept in memory
+  if (!concentration.empty() && isSpilled(concentration.size() - 1)) {
+    concentration.back() = spillFile->remove(concentration.size() - 1);
+  }
   avgMinMax.pop_back();
   concentrationMax.pop_back();
   concPadding.pop_back();
@@ -108,4 +467,91 @@ void SimulationData::pop_back() {
   }
 }
 
+std::shared_ptr<const std::vector<std::vector<double>>>
+SimulationData::getConcentration(std::size_t timeIndex) const {
+  if (!isSpilled(timeIndex)) {
+    // non-owning pointer to the resident concentrations
+    return {std::shared_ptr<void>{}, &concentration[timeIndex]};
+  }
+  // paged-in timepoints can use whatever is left of the memory budget,
+  // but at least the one being read is always kept
+  std::size_t maxBytes{std::numeric_limits<std::size_t>::max()};
+  if (memoryBudgetBytes != 0) {
+    const auto bytes{getResidentMemoryBytes()};
+    const auto budget{getAvailableMemoryBudgetBytes()};
+    maxBytes = bytes < budget ? budget - bytes : 0;
+  }
+  return spillFile->pageIn(timeIndex, maxBytes);
+}
+
+bool SimulationData::isSpilled(std::size_t timeIndex) const {
+  return spillFile != nullptr && spillFile->contains(timeIndex);
+}
+
+std::size_t SimulationData::nSpilled() const {
+  return spillFile == nullptr ? 0 : spillFile->size();
+}
+
+std::size_t SimulationData::getMemoryBudgetBytes() const {
+  return memoryBudgetBytes;
+}
+
+void SimulationData::setMemoryBudgetBytes(std::size_t bytes) {
+  memoryBudgetBytes = bytes;
+}
+
+void SimulationData::setReservedMemoryBytes(std::size_t bytes) {
+  reservedMemoryBytes = bytes;
+}
+
+std::size_t SimulationData::getAvailableMemoryBudgetBytes() const {
+  return memoryBudgetBytes > reservedMemoryBytes
+             ? memoryBudgetBytes - reservedMemoryBytes
+             : 0;
+}
+
+bool SimulationData::enforceMemoryBudget() {
+  if (spillFile != nullptr) {
+    spillFile->releasePagedIn();
+  }
+  if (memoryBudgetBytes == 0 || concentration.size() < 2) {
+    return true;
+  }
+  std::size_t bytes{getResidentMemoryBytes()};
+  const std::size_t budget{getAvailableMemoryBudgetBytes()};
+  if (bytes <= budget && nSpilled() == 0) {
+    return true;
+  }
+  // leave room for one paged-in timepoint, so that reading spilled
+  // timepoints doesn't exceed the budget
+  const std::size_t pageBytes{get2dElementsBytes(concentration.back())};
+  const std::size_t maxBytes{budget > pageBytes ? budget - pageBytes : 0};
+  // spill oldest resident timepoints first, never the last one
+  for (std::size_t i = 0; i + 1 < concentration.size(); ++i) {
+    if (bytes <= maxBytes) {
+      break;
+    }
+    if (isSpilled(i)) {
+      continue;
+    }
+    if (spillFile == nullptr) {
+      spillFile = std::make_unique<SimulationDataSpillFile>();
+    }
+    if (!spillFile->write(i, concentration[i])) {
+      return false;
+    }
+    for (auto &c : concentration[i]) {
+      bytes -= c.size() * sizeof(double);
+      c.clear();
+      c.shrink_to_fit();
+    }
+  }
+  if (bytes > budget) {
+    SPDLOG_WARN("Simulation data memory budget of {} bytes exceeded: {} bytes "
+                "in memory",
+                budget, bytes);
+  }
+  return true;
+}
+
 } // namespace sme::simulate
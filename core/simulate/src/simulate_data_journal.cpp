@@ -0,0 +1,253 @@
+#include "sme/simulate_data_journal.hpp"
+#include "sme/logger.hpp"
+#include <cereal/archives/binary.hpp>
+#include <cereal/types/utility.hpp>
+#include <cereal/types/vector.hpp>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <sstream>
+#include <string_view>
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace sme::simulate {
+
+namespace {
+
+constexpr std::string_view journalMagic{"sme-simulation-journal"};
+constexpr std::uint32_t journalVersion{0};
+
+// record layout: [payload size][payload checksum][payload]
+using RecordHeader = std::array<std::uint64_t, 2>;
+
+[[nodiscard]] std::uint64_t checksum(const std::string &payload) {
+  // 64-bit FNV-1a
+  std::uint64_t hash{14695981039346656037ULL};
+  for (auto c : payload) {
+    hash ^= static_cast<std::uint8_t>(c);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+[[nodiscard]] std::optional<std::string> readRecord(QFile &file) {
+  RecordHeader header{};
+  constexpr auto headerBytes{static_cast<qint64>(sizeof(RecordHeader))};
+  if (file.read(reinterpret_cast<char *>(header.data()), headerBytes) !=
+      headerBytes) {
+    return {};
+  }
+  const auto [size, sum] = header;
+  if (size > static_cast<std::uint64_t>(file.size() - file.pos())) {
+    return {};
+  }
+  std::string payload(size, '\0');
+  if (file.read(payload.data(), static_cast<qint64>(size)) !=
+      static_cast<qint64>(size)) {
+    return {};
+  }
+  if (checksum(payload) != sum) {
+    return {};
+  }
+  return payload;
+}
+
+void readTimepoint(const std::string &payload, SimulationData &data) {
+  std::istringstream ss(payload);
+  cereal::BinaryInputArchive ar(ss);
+  double t{};
+  std::size_t padding{};
+  std::vector<std::vector<double>> conc;
+  std::vector<std::vector<AvgMinMax>> avgMinMax;
+  std::vector<std::vector<double>> concMax;
+  std::vector<std::vector<double>> featureValues;
+  ar(t, padding, conc, avgMinMax, concMax, featureValues);
+  data.timePoints.push_back(t);
+  data.concPadding.push_back(padding);
+  data.concentration.push_back(std::move(conc));
+  data.avgMinMax.push_back(std::move(avgMinMax));
+  data.concentrationMax.push_back(std::move(concMax));
+  if (data.featureResults.size() < featureValues.size()) {
+    data.featureResults.resize(featureValues.size());
+  }
+  for (std::size_t i = 0; i < featureValues.size(); ++i) {
+    data.featureResults[i].values.push_back(std::move(featureValues[i]));
+  }
+}
+
+} // namespace
+
+std::size_t SimulationDataJournalContents::nCompletedTimesteps() const {
+  if (data.size() < nInitialTimepoints) {
+    return 0;
+  }
+  return data.size() - nInitialTimepoints;
+}
+
+std::optional<SimulationDataJournalContents>
+readSimulationDataJournal(const std::string &filename) {
+  QFile file(filename.c_str());
+  if (!file.open(QIODevice::ReadOnly)) {
+    return {};
+  }
+  SimulationDataJournalContents contents;
+  try {
+    auto header{readRecord(file)};
+    if (!header.has_value()) {
+      SPDLOG_WARN("Invalid simulation journal '{}'", filename);
+      return {};
+    }
+    std::istringstream ss(header.value());
+    cereal::BinaryInputArchive ar(ss);
+    std::string magic;
+    std::uint32_t version{};
+    ar(magic, version);
+    if (magic != journalMagic || version != journalVersion) {
+      SPDLOG_WARN("Invalid simulation journal '{}'", filename);
+      return {};
+    }
+    ar(contents.previousTimes, contents.requestedTimes,
+       contents.nInitialTimepoints);
+    contents.validBytes = file.pos();
+    while (auto payload{readRecord(file)}) {
+      readTimepoint(payload.value(), contents.data);
+      contents.validBytes = file.pos();
+    }
+  } catch (const std::exception &e) {
+    // keep any timepoints read before the corrupted record
+    SPDLOG_WARN("Failed to read simulation journal '{}'. {}", filename,
+                e.what());
+  }
+  if (contents.validBytes < file.size()) {
+    SPDLOG_WARN("Ignoring incomplete record at end of simulation journal '{}'",
+                filename);
+  }
+  return contents;
+}
+
+std::pair<std::vector<std::pair<std::size_t, double>>,
+          std::vector<std::pair<std::size_t, double>>>
+splitSimulationTimes(const std::vector<std::pair<std::size_t, double>> &times,
+                     std::size_t nCompleted) {
+  std::vector<std::pair<std::size_t, double>> completed;
+  std::vector<std::pair<std::size_t, double>> remaining;
+  for (const auto &[nSteps, dt] : times) {
+    const std::size_t nDone{std::min(nSteps, nCompleted)};
+    nCompleted -= nDone;
+    if (nDone > 0) {
+      completed.emplace_back(nDone, dt);
+    }
+    if (nSteps > nDone) {
+      remaining.emplace_back(nSteps - nDone, dt);
+    }
+  }
+  return {std::move(completed), std::move(remaining)};
+}
+
+SimulationDataJournal::SimulationDataJournal(
+    const std::string &filename, const SimulationData &data,
+    const std::vector<std::pair<std::size_t, double>> &previousTimes,
+    const std::vector<std::pair<std::size_t, double>> &requestedTimes,
+    std::size_t syncInterval)
+    : file(filename.c_str()), syncInterval{syncInterval} {
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    SPDLOG_WARN("Failed to create simulation journal '{}'", filename);
+    return;
+  }
+  std::ostringstream ss;
+  {
+    cereal::BinaryOutputArchive ar(ss);
+    ar(std::string{journalMagic}, journalVersion, previousTimes,
+       requestedTimes, data.size());
+  }
+  valid = writeRecord(ss.str());
+  for (std::size_t i = 0; valid && i < data.size(); ++i) {
+    valid = append(data, i);
+  }
+  valid = valid && sync();
+}
+
+SimulationDataJournal::SimulationDataJournal(
+    const std::string &filename, const SimulationDataJournalContents &contents,
+    std::size_t syncInterval)
+    : file(filename.c_str()), syncInterval{syncInterval} {
+  if (!file.open(QIODevice::ReadWrite)) {
+    SPDLOG_WARN("Failed to open simulation journal '{}'", filename);
+    return;
+  }
+  // discard any incomplete record at the end of the journal
+  valid = file.resize(contents.validBytes) && file.seek(contents.validBytes);
+}
+
+SimulationDataJournal::~SimulationDataJournal() {
+  if (valid) {
+    sync();
+  }
+}
+
+bool SimulationDataJournal::isValid() const { return valid; }
+
+bool SimulationDataJournal::writeRecord(const std::string &payload) {
+  const RecordHeader header{payload.size(), checksum(payload)};
+  constexpr auto headerBytes{static_cast<qint64>(sizeof(RecordHeader))};
+  const auto payloadBytes{static_cast<qint64>(payload.size())};
+  if (file.write(reinterpret_cast<const char *>(header.data()),
+                 headerBytes) != headerBytes ||
+      file.write(payload.data(), payloadBytes) != payloadBytes ||
+      !file.flush()) {
+    SPDLOG_WARN("Failed to write to simulation journal '{}'",
+                file.fileName().toStdString());
+    return false;
+  }
+  return true;
+}
+
+bool SimulationDataJournal::append(const SimulationData &data,
+                                   std::size_t timeIndex) {
+  if (!file.isOpen()) {
+    return false;
+  }
+  std::vector<std::vector<double>> featureValues;
+  featureValues.reserve(data.featureResults.size());
+  for (const auto &featureResult : data.featureResults) {
+    if (timeIndex < featureResult.values.size()) {
+      featureValues.push_back(featureResult.values[timeIndex]);
+    } else {
+      featureValues.emplace_back();
+    }
+  }
+  std::ostringstream ss;
+  {
+    cereal::BinaryOutputArchive ar(ss);
+    ar(data.timePoints[timeIndex], data.concPadding[timeIndex]);
+    ar(*data.getConcentration(timeIndex));
+    ar(data.avgMinMax[timeIndex], data.concentrationMax[timeIndex],
+       featureValues);
+  }
+  if (!writeRecord(ss.str())) {
+    return false;
+  }
+  ++nUnsynced;
+  if (syncInterval > 0 && nUnsynced >= syncInterval) {
+    return sync();
+  }
+  return true;
+}
+
+bool SimulationDataJournal::sync() {
+  if (!file.isOpen() || !file.flush()) {
+    return false;
+  }
+  nUnsynced = 0;
+#ifdef Q_OS_WIN
+  return _commit(file.handle()) == 0;
+#else
+  return ::fsync(file.handle()) == 0;
+#endif
+}
+
+} // namespace sme::simulate
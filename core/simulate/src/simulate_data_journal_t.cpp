@@ -0,0 +1,118 @@
+#include "catch_wrapper.hpp"
+#include "sme/simulate_data_journal.hpp"
+#include <QFile>
+
+using namespace sme;
+
+static simulate::SimulationData makeSimulationData(std::size_t nTimepoints) {
+  simulate::SimulationData data;
+  data.featureResults.resize(1);
+  for (std::size_t i = 0; i < nTimepoints; ++i) {
+    const auto x{static_cast<double>(i)};
+    data.timePoints.push_back(x);
+    data.concentration.push_back({{x, -x, 2.0 * x}, {x + 0.5}});
+    data.avgMinMax.push_back({{{x, 0.0, 2.0 * x}}, {{x + 0.5, x, x + 1.0}}});
+    data.concentrationMax.push_back({{2.0 * x}, {x + 0.5}});
+    data.concPadding.push_back(0);
+    data.featureResults[0].values.push_back({x, 3.0 * x});
+  }
+  return data;
+}
+
+TEST_CASE("SimulationDataJournal",
+          "[core/simulate/simulate_data_journal][core/simulate][core]["
+          "simulate_data_journal]") {
+  const char *filename{"tmp_simulation_data_journal.bin"};
+  QFile::remove(filename);
+  SECTION("missing or invalid file") {
+    REQUIRE(!simulate::readSimulationDataJournal(filename).has_value());
+    QFile f(filename);
+    REQUIRE(f.open(QIODevice::WriteOnly));
+    f.write("not a journal");
+    f.close();
+    REQUIRE(!simulate::readSimulationDataJournal(filename).has_value());
+  }
+  SECTION("write, read, resume") {
+    auto data{makeSimulationData(4)};
+    auto initialData{makeSimulationData(2)};
+    const std::vector<std::pair<std::size_t, double>> previousTimes{{1, 1.0}};
+    const std::vector<std::pair<std::size_t, double>> requestedTimes{
+        {1, 1.0}, {2, 1.0}};
+    {
+      simulate::SimulationDataJournal journal(filename, initialData,
+                                              previousTimes, requestedTimes);
+      REQUIRE(journal.isValid());
+      REQUIRE(journal.append(data, 2));
+    }
+    auto contents{simulate::readSimulationDataJournal(filename)};
+    REQUIRE(contents.has_value());
+    REQUIRE(contents->previousTimes == previousTimes);
+    REQUIRE(contents->requestedTimes == requestedTimes);
+    REQUIRE(contents->nInitialTimepoints == 2);
+    REQUIRE(contents->nCompletedTimesteps() == 1);
+    REQUIRE(contents->validBytes == QFile(filename).size());
+    const auto &d{contents->data};
+    REQUIRE(d.size() == 3);
+    REQUIRE(d.timePoints == std::vector<double>{0.0, 1.0, 2.0});
+    REQUIRE(d.concentration == std::vector(data.concentration.begin(),
+                                           data.concentration.begin() + 3));
+    REQUIRE(d.avgMinMax[2] == data.avgMinMax[2]);
+    REQUIRE(d.concentrationMax[2] == data.concentrationMax[2]);
+    REQUIRE(d.concPadding == std::vector<std::size_t>{0, 0, 0});
+    REQUIRE(d.featureResults.size() == 1);
+    REQUIRE(d.featureResults[0].values[2] == data.featureResults[0].values[2]);
+    // simulate a crash during a write: incomplete record is ignored
+    {
+      QFile f(filename);
+      REQUIRE(f.open(QIODevice::Append));
+      f.write("incomplete record");
+    }
+    contents = simulate::readSimulationDataJournal(filename);
+    REQUIRE(contents.has_value());
+    REQUIRE(contents->data.size() == 3);
+    REQUIRE(contents->validBytes < QFile(filename).size());
+    // resume: incomplete record is discarded, new timepoints appended
+    {
+      simulate::SimulationDataJournal journal(filename, contents.value(), 0);
+      REQUIRE(journal.isValid());
+      REQUIRE(journal.append(data, 3));
+    }
+    contents = simulate::readSimulationDataJournal(filename);
+    REQUIRE(contents.has_value());
+    REQUIRE(contents->validBytes == QFile(filename).size());
+    REQUIRE(contents->nCompletedTimesteps() == 2);
+    REQUIRE(contents->data.timePoints.back() == dbl_approx(3.0));
+    REQUIRE(contents->data.concentration == data.concentration);
+  }
+  SECTION("spilled timepoints") {
+    auto data{makeSimulationData(3)};
+    data.setMemoryBudgetBytes(1);
+    REQUIRE(data.enforceMemoryBudget());
+    REQUIRE(data.isSpilled(0));
+    {
+      simulate::SimulationDataJournal journal(filename, data, {}, {});
+      REQUIRE(journal.isValid());
+    }
+    auto contents{simulate::readSimulationDataJournal(filename)};
+    REQUIRE(contents.has_value());
+    REQUIRE(contents->data.concentration ==
+            makeSimulationData(3).concentration);
+  }
+  SECTION("split simulation times") {
+    const std::vector<std::pair<std::size_t, double>> times{{3, 0.1},
+                                                            {2, 0.5}};
+    using Times = std::vector<std::pair<std::size_t, double>>;
+    auto [c0, r0] = simulate::splitSimulationTimes(times, 0);
+    REQUIRE(c0.empty());
+    REQUIRE(r0 == times);
+    auto [c2, r2] = simulate::splitSimulationTimes(times, 2);
+    REQUIRE(c2 == Times{{2, 0.1}});
+    REQUIRE(r2 == Times{{1, 0.1}, {2, 0.5}});
+    auto [c4, r4] = simulate::splitSimulationTimes(times, 4);
+    REQUIRE(c4 == Times{{3, 0.1}, {1, 0.5}});
+    REQUIRE(r4 == Times{{1, 0.5}});
+    auto [c9, r9] = simulate::splitSimulationTimes(times, 9);
+    REQUIRE(c9 == times);
+    REQUIRE(r9.empty());
+  }
+}
@@ -1,5 +1,11 @@
 #include "catch_wrapper.hpp"
 #include "sme/simulate_data.hpp"
+#include <QByteArray>
+#include <QtEndian>
+#include <algorithm>
+#include <cereal/archives/binary.hpp>
+#include <cstring>
+#include <sstream>
 
 using namespace sme;
 
@@ -87,4 +93,198 @@ TEST_CASE("SimulateData",
     REQUIRE(data.concPadding.back() == 0);
     REQUIRE(data.xmlModel == "sim model");
   }
+  SECTION("indexed little-endian concentration blocks") {
+    std::stringstream ss;
+    {
+      cereal::BinaryOutputArchive ar(ss);
+      ar(data);
+    }
+    const auto bytes{ss.str()};
+    std::size_t pos{0};
+    const auto read = [&bytes, &pos](auto &value) {
+      REQUIRE(pos + sizeof(value) <= bytes.size());
+      std::memcpy(&value, bytes.data() + pos, sizeof(value));
+      pos += sizeof(value);
+    };
+    std::uint32_t version{0};
+    read(version);
+    REQUIRE(version == 2);
+    std::uint64_t nTimePoints{0};
+    read(nTimePoints);
+    REQUIRE(nTimePoints == 2);
+    pos += nTimePoints * sizeof(double);
+    const std::size_t markerPos{pos};
+    std::uint32_t marker{0};
+    read(marker);
+    REQUIRE(marker == 0x01020304);
+    std::uint64_t nOffsets{0};
+    read(nOffsets);
+    REQUIRE(nOffsets == 3);
+    std::vector<std::uint64_t> offsets(nOffsets);
+    for (auto &offset : offsets) {
+      read(offset);
+    }
+    REQUIRE(offsets[0] == 0);
+    // decode the second timepoint directly from its offset
+    const auto raw{qUncompress(
+        reinterpret_cast<const uchar *>(bytes.data() + pos + offsets[1]),
+        static_cast<qsizetype>(offsets[2] - offsets[1]))};
+    REQUIRE(static_cast<std::size_t>(raw.size()) ==
+            3 * sizeof(std::uint64_t) + 4 * sizeof(double));
+    const auto *r{raw.constData()};
+    REQUIRE(qFromLittleEndian<std::uint64_t>(r) == 2);
+    REQUIRE(qFromLittleEndian<std::uint64_t>(r + 8) == 2);
+    std::uint64_t bits{qFromLittleEndian<std::uint64_t>(r + 16)};
+    double c{0};
+    std::memcpy(&c, &bits, sizeof(c));
+    REQUIRE(c == dbl_approx(2.2));
+    bits = qFromLittleEndian<std::uint64_t>(r + 48);
+    std::memcpy(&c, &bits, sizeof(c));
+    REQUIRE(c == dbl_approx(-3.1));
+    // the index allows skipping over all blocks
+    std::stringstream rest(bytes.substr(pos + offsets.back()));
+    {
+      cereal::BinaryInputArchive ar(rest);
+      decltype(data.avgMinMax) avgMinMax;
+      ar(avgMinMax);
+      REQUIRE(avgMinMax == data.avgMinMax);
+    }
+    // data saved with a different byte order is rejected
+    auto swapped{bytes};
+    std::reverse(swapped.begin() + static_cast<std::ptrdiff_t>(markerPos),
+                 swapped.begin() + static_cast<std::ptrdiff_t>(markerPos + 4));
+    std::stringstream ssSwapped(swapped);
+    simulate::SimulationData loaded;
+    cereal::BinaryInputArchive ar(ssSwapped);
+    REQUIRE_THROWS(ar(loaded));
+  }
+  SECTION("serialization of many timepoints") {
+    // more timepoints than are encoded in a single parallel batch
+    constexpr std::size_t nTimepoints{1000};
+    data.clear();
+    for (std::size_t i = 0; i < nTimepoints; ++i) {
+      const auto x{static_cast<double>(i)};
+      data.timePoints.push_back(x);
+      data.concentration.push_back(
+          {std::vector<double>(i % 7, x), {}, {x, -x, 0.5 * x}});
+      data.avgMinMax.push_back({{{x, 0.0, x}}, {}, {{x, -x, 0.5 * x}}});
+      data.concentrationMax.push_back({{x}, {}, {x}});
+      data.concPadding.push_back(i % 2);
+    }
+    data.setMemoryBudgetBytes(1024);
+    REQUIRE(data.enforceMemoryBudget());
+    REQUIRE(data.nSpilled() > 0);
+    std::stringstream ss;
+    {
+      cereal::BinaryOutputArchive ar(ss);
+      ar(data);
+    }
+    simulate::SimulationData loaded;
+    {
+      cereal::BinaryInputArchive ar(ss);
+      ar(loaded);
+    }
+    REQUIRE(loaded.size() == nTimepoints);
+    REQUIRE(loaded.timePoints == data.timePoints);
+    REQUIRE(loaded.concPadding == data.concPadding);
+    REQUIRE(loaded.avgMinMax == data.avgMinMax);
+    REQUIRE(loaded.concentrationMax == data.concentrationMax);
+    for (std::size_t i = 0; i < nTimepoints; ++i) {
+      REQUIRE(loaded.concentration[i].size() == 3);
+      for (std::size_t ic = 0; ic < 3; ++ic) {
+        REQUIRE(loaded.concentration[i][ic] ==
+                (*data.getConcentration(i))[ic]);
+      }
+    }
+  }
+  SECTION("memory budget") {
+    REQUIRE(data.getMemoryBudgetBytes() == 0);
+    REQUIRE(data.enforceMemoryBudget());
+    REQUIRE(data.nSpilled() == 0);
+    // serialize without any spilled timepoints for comparison
+    std::stringstream ssResident;
+    {
+      cereal::BinaryOutputArchive ar(ssResident);
+      ar(data);
+    }
+    // tiny budget: all but the last timepoint are spilled to disk
+    data.setMemoryBudgetBytes(1);
+    REQUIRE(data.getMemoryBudgetBytes() == 1);
+    REQUIRE(data.enforceMemoryBudget());
+    REQUIRE(data.nSpilled() == 1);
+    REQUIRE(data.isSpilled(0));
+    REQUIRE(!data.isSpilled(1));
+    REQUIRE(data.concentration.size() == 2);
+    REQUIRE(data.concentration[0].size() == 2);
+    REQUIRE(data.concentration[0][0].empty());
+    REQUIRE(data.concentration[1][0].size() == 2);
+    // spilled timepoints are paged back in on demand
+    const auto c0{data.getConcentration(0)};
+    REQUIRE(c0->size() == 2);
+    REQUIRE((*c0)[0].size() == 2);
+    REQUIRE((*c0)[0][0] == dbl_approx(1.2));
+    REQUIRE((*c0)[0][1] == dbl_approx(-0.881));
+    REQUIRE((*c0)[1][1] == dbl_approx(-0.1));
+    REQUIRE((*data.getConcentration(1))[1][0] == dbl_approx(3.0));
+    REQUIRE(data.enforceMemoryBudget());
+    REQUIRE(data.nSpilled() == 1);
+    // serialized data is identical to the resident version
+    std::stringstream ssSpilled;
+    {
+      cereal::BinaryOutputArchive ar(ssSpilled);
+      ar(data);
+    }
+    REQUIRE(ssSpilled.str() == ssResident.str());
+    simulate::SimulationData loaded;
+    {
+      cereal::BinaryInputArchive ar(ssSpilled);
+      ar(loaded);
+    }
+    REQUIRE(loaded.nSpilled() == 0);
+    REQUIRE(loaded.concentration[0][0].size() == 2);
+    REQUIRE(loaded.concentration[0][0][1] == dbl_approx(-0.881));
+    // removing the last timepoint pages the new last timepoint back in
+    data.pop_back();
+    REQUIRE(data.nSpilled() == 0);
+    REQUIRE(!data.isSpilled(0));
+    REQUIRE(data.concentration.back()[0].size() == 2);
+    REQUIRE(data.concentration.back()[0][0] == dbl_approx(1.2));
+    data.clear();
+    REQUIRE(data.nSpilled() == 0);
+    REQUIRE(data.getMemoryBudgetBytes() == 1);
+  }
+  SECTION("paged-in timepoints stay within the memory budget") {
+    constexpr std::size_t nTimepoints{20};
+    constexpr std::size_t nConc{1000};
+    data.clear();
+    for (std::size_t i = 0; i < nTimepoints; ++i) {
+      const auto x{static_cast<double>(i)};
+      data.timePoints.push_back(x);
+      data.concentration.push_back({std::vector<double>(nConc, x)});
+      data.avgMinMax.push_back({{{x, x, x}}});
+      data.concentrationMax.push_back({{x}});
+      data.concPadding.push_back(0);
+    }
+    // room for a few timepoints in memory
+    constexpr std::size_t budget{5 * nConc * sizeof(double)};
+    data.setMemoryBudgetBytes(budget);
+    REQUIRE(data.enforceMemoryBudget());
+    REQUIRE(data.nSpilled() > 0);
+    REQUIRE(data.getEstimatedMemoryBytes() <= budget);
+    // the pointer keeps its concentrations alive after they are released
+    const auto c0{data.getConcentration(0)};
+    for (int repeat = 0; repeat < 2; ++repeat) {
+      for (std::size_t i = 0; i < nTimepoints; ++i) {
+        const auto c{data.getConcentration(i)};
+        REQUIRE(c->size() == 1);
+        REQUIRE((*c)[0].size() == nConc);
+        REQUIRE((*c)[0].back() == dbl_approx(static_cast<double>(i)));
+        REQUIRE(data.getEstimatedMemoryBytes() <= budget);
+      }
+    }
+    REQUIRE((*c0)[0].size() == nConc);
+    REQUIRE((*c0)[0][0] == dbl_approx(0.0));
+    REQUIRE(data.enforceMemoryBudget());
+    REQUIRE(data.getEstimatedMemoryBytes() <= budget);
+  }
 }
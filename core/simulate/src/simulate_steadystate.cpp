@@ -1,10 +1,12 @@
 #include "sme/simulate_steadystate.hpp"
 #include "basesim.hpp"
 #include "dunesim.hpp"
+#include "newton_krylov.hpp"
 #include "pixelsim.hpp"
 #include "sme/duneconverter.hpp"
 #include "sme/image_stack.hpp"
 #include "sme/simulate_options.hpp"
+#include "sme/voxel.hpp"
 #include <QElapsedTimer>
 #include <QFile>
 #include <QImage>
@@ -12,10 +14,13 @@
 #include <algorithm>
 #include <cmath>
 #include <dune/common/exceptions.hh>
+#include <fmt/core.h>
 #include <limits>
+#include <memory>
 #include <oneapi/tbb/global_control.h>
 #include <oneapi/tbb/info.h>
 #include <spdlog/spdlog.h>
+#include <stdexcept>
 #include <vector>
 
 namespace sme::simulate {
@@ -25,10 +30,11 @@ namespace sme::simulate {
 SteadyStateSimulation::SteadyStateSimulation(
     sme::model::Model &model, double tolerance,
     std::size_t steps_to_convergence,
-    SteadyStateConvergenceMode convergence_mode, double timeout_ms, double dt)
+    SteadyStateConvergenceMode convergence_mode, double timeout_ms, double dt,
+    SteadyStateSolverType solver_type)
     : m_model(model), m_convergence_tolerance(tolerance),
       m_steps_to_convergence(steps_to_convergence), m_timeout_ms(timeout_ms),
-      m_stop_mode(convergence_mode), m_dt(dt) {
+      m_stop_mode(convergence_mode), m_dt(dt), m_solver_type(solver_type) {
   initModel();
   initSimulator();
 }
@@ -77,45 +83,70 @@ void SteadyStateSimulation::initSimulator() {
   if (m_model.getSimulationSettings().simulatorType == SimulatorType::DUNE &&
       m_model.getGeometry().getIsMeshValid()) {
     SPDLOG_DEBUG(" DUNE Simulator selected");
-    m_simulator = std::make_unique<DuneSim>(m_model, m_compartmentIds);
+    m_simulator =
+        std::make_unique<DuneSim>(m_model, m_compartmentIds, m_substitutions);
   } else {
     SPDLOG_DEBUG(" Pixel Simulator selected");
-    m_simulator = std::make_unique<PixelSim>(m_model, m_compartmentIds,
-                                             m_compartmentSpeciesIds);
+    m_simulator = std::make_unique<PixelSim>(
+        m_model, m_compartmentIds, m_compartmentSpeciesIds, m_substitutions);
   }
 }
 
-double SteadyStateSimulation::computeStoppingCriterion(
-    const std::vector<double> &c_old, const std::vector<double> &c_new) const {
+void SteadyStateSimulation::restartSimulator(
+    const std::optional<SolverCheckpoint> &initialState) {
+  m_simulator = nullptr;
+  m_steps_below_tolerance = 0;
+  m_has_converged.store(false);
+  initSimulator();
+  if (initialState.has_value() && !initialState->state.empty() &&
+      !m_simulator->setCheckpoint(initialState.value())) {
+    SPDLOG_WARN("Could not set the simulator state: starting from the "
+                "initial concentrations");
+    // the state may have been partially applied
+    m_simulator = nullptr;
+    initSimulator();
+  }
+  m_error.store(std::numeric_limits<double>::max());
+  m_step.store(0);
+}
 
-  double sum_squared_dcdt = 0.0;
-  double dcdt_norm = 0.0;
+double SteadyStateSimulation::computeStoppingCriterion(
+    const ConcentrationChange &change) const {
+  // L2 norm of the average rate of change over the last interval
+  double dcdt_norm =
+      std::sqrt(change.sumSquaredChange) / std::max(m_dt, 1e-12);
   if (m_stop_mode == SteadyStateConvergenceMode::relative) {
     SPDLOG_DEBUG("  - relative convergence mode");
-    double sum_squared_c = 0.0;
-
-    for (size_t i = 0; i < c_new.size(); ++i) {
-      double dcdt = (c_new[i] - c_old[i]) / std::max(m_dt, 1e-12);
-      // Sum of squares for L2 norm calculations
-      sum_squared_dcdt += dcdt * dcdt;
-      sum_squared_c += c_new[i] * c_new[i];
-    }
-
-    dcdt_norm = std::sqrt(sum_squared_dcdt);
-    double c_norm = std::sqrt(sum_squared_c);
+    double c_norm = std::sqrt(change.sumSquaredConcentration);
     dcdt_norm = dcdt_norm / std::max(c_norm, 1e-12);
-
   } else {
     SPDLOG_DEBUG("  - absolute convergence mode");
-    for (size_t i = 0; i < c_new.size(); ++i) {
-      double dcdt = (c_new[i] - c_old[i]) / std::max(m_dt, 1e-12);
-      // Sum of squares for L2 norm calculations
-      sum_squared_dcdt += dcdt * dcdt;
-    }
+  }
+  return dcdt_norm;
+}
 
-    dcdt_norm = std::sqrt(sum_squared_dcdt);
+double SteadyStateSimulation::updateStoppingCriterion() {
+  // the simulator reduces over its own concentrations without copying them
+  std::scoped_lock lock{m_concentration_mutex};
+  auto change = m_simulator->updateConcentrationChange();
+  if (!change.has_value()) {
+    return std::numeric_limits<double>::quiet_NaN();
   }
+  return computeStoppingCriterion(change.value());
+}
 
+double SteadyStateSimulation::computeResidualCriterion(
+    const std::vector<double> &residual, const std::vector<double> &c) const {
+  double sum_squared_dcdt = 0.0;
+  double sum_squared_c = 0.0;
+  for (size_t i = 0; i < residual.size(); ++i) {
+    sum_squared_dcdt += residual[i] * residual[i];
+    sum_squared_c += c[i] * c[i];
+  }
+  double dcdt_norm = std::sqrt(sum_squared_dcdt);
+  if (m_stop_mode == SteadyStateConvergenceMode::relative) {
+    dcdt_norm = dcdt_norm / std::max(std::sqrt(sum_squared_c), 1e-12);
+  }
   return dcdt_norm;
 }
 
@@ -133,7 +164,7 @@ SteadyStateSimulation::computeConcentrationNormalisation(
     std::scoped_lock lock{m_concentration_mutex};
     for (std::size_t i = 0; i < m_compartments.size(); ++i) {
       maxConcs.emplace_back(speciesToDraw[i].size(), absoluteMin);
-      const auto c = m_simulator->getConcentrations(i);
+      const auto &c = m_simulator->getConcentrations(i);
       absoluteMax = std::max(absoluteMax, *std::ranges::max_element(c));
     }
 
@@ -146,7 +177,7 @@ SteadyStateSimulation::computeConcentrationNormalisation(
     std::scoped_lock lock{m_concentration_mutex};
     for (std::size_t i = 0; i < m_compartments.size(); ++i) {
       double speciesMax = 0;
-      const auto c = m_simulator->getConcentrations(i);
+      const auto &c = m_simulator->getConcentrations(i);
       for (std::size_t is : speciesToDraw[i]) {
         speciesMax = std::max(speciesMax, c[is]);
       }
@@ -171,9 +202,8 @@ void SteadyStateSimulation::runPixel(double time) {
 
   QElapsedTimer timer;
 
-  std::vector<double> c_old = getConcentrations();
-  std::vector<double> c_new;
-  c_new.reserve(c_old.capacity());
+  // set the reference concentrations for the first convergence check
+  updateStoppingCriterion();
 
   // do timesteps until we reach t
   double tNow = 0;
@@ -186,11 +216,7 @@ void SteadyStateSimulation::runPixel(double time) {
       m_simulator->run(m_dt, m_timeout_ms,
                        [this]() { return m_simulator->getStopRequested(); });
     }
-    c_new = getConcentrations();
-
-    auto current_error = computeStoppingCriterion(c_old, c_new);
-
-    c_old.swap(c_new);
+    auto current_error = updateStoppingCriterion();
 
     if (std::isnan(current_error) || std::isinf(current_error)) {
       m_simulator->setCurrentErrormessage(
@@ -242,11 +268,9 @@ void SteadyStateSimulation::runDune(double time) {
 
   double relativeTolerance = 1e-12;
 
-  std::vector<double> c_old = getConcentrations();
+  // set the reference concentrations for the first convergence check
+  updateStoppingCriterion();
 
-  std::vector<double> c_new;
-  c_new.reserve(c_old.capacity());
-  c_new.resize(c_old.size());
   // use dt here to avoid too long intervals for checking the stopping criterion
   while (tNow + time * relativeTolerance < time) {
     try {
@@ -262,9 +286,7 @@ void SteadyStateSimulation::runDune(double time) {
       break;
     }
 
-    c_new = getConcentrations();
-
-    double current_error = computeStoppingCriterion(c_old, c_new);
+    double current_error = updateStoppingCriterion();
 
     if (std::isnan(current_error) || std::isinf(current_error)) {
       m_simulator->setCurrentErrormessage(
@@ -274,8 +296,6 @@ void SteadyStateSimulation::runDune(double time) {
       break;
     }
 
-    c_old.swap(c_new);
-
     if (current_error < m_convergence_tolerance) {
       ++m_steps_below_tolerance;
     } else {
@@ -309,12 +329,101 @@ void SteadyStateSimulation::runDune(double time) {
   }
 }
 
+void SteadyStateSimulation::runNewtonKrylov() {
+  m_simulator->setCurrentErrormessage("");
+  // the residual is evaluated using the Pixel discretization, so it would
+  // not find the steady state of a DUNE simulation
+  auto *pixelSim = dynamic_cast<PixelSim *>(m_simulator.get());
+  if (pixelSim == nullptr) {
+    m_simulator->setCurrentErrormessage(
+        "Newton-Krylov steady state solver requires the Pixel simulator: use "
+        "the Pixel simulator or the time stepping solver");
+    SPDLOG_ERROR("{}", m_simulator->errorMessage());
+    return;
+  }
+
+  QElapsedTimer timer;
+  timer.start();
+
+  NewtonKrylovOptions options;
+  options.initialPseudoTimestep = m_dt;
+  options.nonNegative = true;
+  std::unique_ptr<NewtonKrylovSolver> solver;
+  {
+    std::scoped_lock lock{m_concentration_mutex};
+    solver = std::make_unique<NewtonKrylovSolver>(
+        [pixelSim](const std::vector<double> &c, std::vector<double> &f) {
+          pixelSim->evaluateSteadyStateResidual(c, f);
+        },
+        pixelSim->getState(), options);
+    // the diffusion operator is linear: use it to precondition the solver
+    solver->setPreconditioner(
+        [pixelSim](const std::vector<double> &c, std::vector<double> &f) {
+          pixelSim->evaluateDiffusion(c, f);
+        },
+        pixelSim->getDiffusionDiagonal());
+    pixelSim->setState(solver->getState());
+  }
+
+  std::size_t iteration = 0;
+  while (true) {
+    {
+      std::scoped_lock lock{m_concentration_mutex};
+      solver->step();
+      pixelSim->setState(solver->getState());
+    }
+    ++iteration;
+
+    double current_error =
+        computeResidualCriterion(solver->getResidual(), solver->getState());
+
+    if (std::isnan(current_error) || std::isinf(current_error)) {
+      m_simulator->setCurrentErrormessage(
+          "Simulation failed: NaN  of Inf detected in norm");
+      SPDLOG_DEBUG(m_simulator->errorMessage());
+      m_simulator->setStopRequested(true);
+      break;
+    }
+
+    recordData(static_cast<double>(iteration), current_error);
+
+    // a Newton iterate with a small residual does not need to be confirmed
+    // by subsequent steps
+    if (current_error < m_convergence_tolerance) {
+      m_steps_below_tolerance = m_steps_to_convergence;
+      m_has_converged.store(true);
+      m_simulator->setStopRequested(true);
+      SPDLOG_DEBUG("Simulation has converged after {} residual evaluations",
+                   solver->getResidualEvaluations());
+      break;
+    }
+
+    if (m_timeout_ms >= 0.0 &&
+        static_cast<double>(timer.elapsed()) >= m_timeout_ms) {
+      SPDLOG_DEBUG("Simulation timeout: requesting stop");
+      m_simulator->setStopRequested(true);
+      m_simulator->setCurrentErrormessage("Simulation timed out");
+      break;
+    }
+
+    if (m_simulator->getStopRequested() || m_stop_requested.load()) {
+      m_simulator->setCurrentErrormessage("Simulation stopped early");
+      SPDLOG_DEBUG("Simulation timeout or stopped early");
+      break;
+    }
+  }
+}
+
 void SteadyStateSimulation::run() {
   // since we expect the simulation to either converge or run into timeout,
   // we can set the time to run to infinity for all intents and purposes
   m_simulator->setStopRequested(false);
   m_stop_requested.store(false);
-  if (m_model.getSimulationSettings().simulatorType == SimulatorType::DUNE) {
+  if (m_solver_type == SteadyStateSolverType::newton_krylov) {
+    SPDLOG_DEBUG("  - runNewtonKrylov");
+    runNewtonKrylov();
+  } else if (m_model.getSimulationSettings().simulatorType ==
+             SimulatorType::DUNE) {
     SPDLOG_DEBUG("  - runDune");
     runDune(std::numeric_limits<double>::max());
   } else if (m_model.getSimulationSettings().simulatorType ==
@@ -326,6 +435,90 @@ void SteadyStateSimulation::run() {
   }
 }
 
+std::vector<SteadyStateContinuationPoint>
+SteadyStateSimulation::runContinuation(
+    const SteadyStateContinuationOptions &options,
+    const std::function<void(const SteadyStateContinuationPoint &)>
+        &onSteadyState) {
+  const auto constants = m_model.getParameters().getGlobalConstants();
+  if (std::ranges::none_of(constants, [&options](const auto &c) {
+        return c.id == options.parameterId;
+      })) {
+    throw std::invalid_argument(
+        fmt::format("Continuation parameter '{}' is not a constant parameter",
+                    options.parameterId));
+  }
+  if (!(options.initialStep > 0.0 && options.minStep > 0.0 &&
+        options.maxStep > 0.0)) {
+    throw std::invalid_argument("Continuation steps must be positive");
+  }
+  constexpr double stepIncrease = 1.5;
+  constexpr double stepDecrease = 0.5;
+  const double direction = options.end >= options.start ? 1.0 : -1.0;
+  const double length = std::abs(options.end - options.start);
+  double step = std::min(options.initialStep, options.maxStep);
+  // distance from the start of the last steady state that was found
+  double progress = 0.0;
+  // the parameter value is compiled into the simulator as a constant, so a
+  // new simulator is needed for each value, starting from the state of the
+  // previous steady state
+  std::optional<SolverCheckpoint> initialState;
+  std::vector<SteadyStateContinuationPoint> points;
+  m_stop_requested.store(false);
+  // restore the substitutions on exit, including if an exception is thrown
+  struct SubstitutionsGuard {
+    std::map<std::string, double, std::less<>> &substitutions;
+    std::map<std::string, double, std::less<>> saved;
+    ~SubstitutionsGuard() { substitutions = std::move(saved); }
+  } substitutionsGuard{m_substitutions, m_substitutions};
+  while (true) {
+    double target = points.empty() ? 0.0 : std::min(progress + step, length);
+    double value = options.start + direction * target;
+    SPDLOG_DEBUG("Continuation: {} = {}", options.parameterId, value);
+    m_substitutions[options.parameterId] = value;
+    restartSimulator(initialState);
+    run();
+    if (m_stop_requested.load()) {
+      break;
+    }
+    if (!hasConverged()) {
+      if (points.empty()) {
+        SPDLOG_WARN("Continuation: no steady state at {} = {}",
+                    options.parameterId, value);
+        break;
+      }
+      step *= stepDecrease;
+      if (step < options.minStep) {
+        SPDLOG_WARN("Continuation: step below minimum at {} = {}",
+                    options.parameterId, value);
+        break;
+      }
+      continue;
+    }
+    points.push_back({value, getLatestError(), getLatestStep()});
+    const auto &point = points.back();
+    if (onSteadyState) {
+      onSteadyState(point);
+    }
+    initialState = m_simulator->getCheckpoint();
+    if ((!initialState.has_value() || initialState->state.empty()) &&
+        points.size() == 1) {
+      SPDLOG_WARN("Continuation: simulator state is not available, each "
+                  "steady state is found from the initial concentrations");
+    }
+    progress = target;
+    if (progress >= length) {
+      break;
+    }
+    // grow the step unless this steady state was much harder to find
+    if (points.size() < 2 ||
+        point.steps <= 2.0 * points[points.size() - 2].steps) {
+      step = std::min(step * stepIncrease, options.maxStep);
+    }
+  }
+  return points;
+}
+
 void SteadyStateSimulation::requestStop() {
   m_simulator->setStopRequested(true);
   m_stop_requested.store(true);
@@ -340,6 +533,7 @@ void SteadyStateSimulation::reset() {
   // reset model
   m_model.getSimulationData().clear();
   m_model.getSimulationSettings().times.clear();
+  m_substitutions.clear();
   initModel();
 
   // reset simulator
@@ -368,6 +562,10 @@ SteadyStateConvergenceMode SteadyStateSimulation::getConvergenceMode() const {
   return m_stop_mode;
 }
 
+SteadyStateSolverType SteadyStateSimulation::getSolverType() const {
+  return m_solver_type;
+}
+
 std::size_t SteadyStateSimulation::getStepsBelowTolerance() const {
   return m_steps_below_tolerance;
 }
@@ -435,7 +633,7 @@ sme::common::ImageStack SteadyStateSimulation::getConcentrationImage(
     std::size_t nSpecies = m_compartmentSpeciesIds[i].size();
 
     std::scoped_lock lock{m_concentration_mutex};
-    const auto concentrations = m_simulator->getConcentrations(i);
+    const auto &concentrations = m_simulator->getConcentrations(i);
     const auto concentrationPadding = m_simulator->getConcentrationPadding();
 
     for (std::size_t vi = 0; vi < voxels.size(); ++vi) {
@@ -464,6 +662,28 @@ sme::common::ImageStack SteadyStateSimulation::getConcentrationImage(
   return concentrationImageStack;
 }
 
+std::vector<std::vector<double>>
+SteadyStateSimulation::getPyConcs(std::size_t compartmentIndex) {
+  auto imageSize = m_model.getGeometry().getImages().volume();
+  std::vector<std::vector<double>> pyConcs(
+      m_compartmentSpeciesIds[compartmentIndex].size(),
+      std::vector<double>(imageSize.nVoxels(), 0.0));
+  const auto &voxels = m_compartments[compartmentIndex]->getVoxels();
+  const std::size_t nSpecies = m_compartmentSpeciesIds[compartmentIndex].size();
+
+  std::scoped_lock lock{m_concentration_mutex};
+  const auto &concentrations =
+      m_simulator->getConcentrations(compartmentIndex);
+  const auto stride = nSpecies + m_simulator->getConcentrationPadding();
+  for (std::size_t vi = 0; vi < voxels.size(); ++vi) {
+    const auto pyIndex = common::voxelArrayIndex(imageSize, voxels[vi], false);
+    for (std::size_t s : m_compartmentSpeciesIdxs[compartmentIndex]) {
+      pyConcs[s][pyIndex] = concentrations[vi * stride + s];
+    }
+  }
+  return pyConcs;
+}
+
 [[nodiscard]] const std::vector<std::vector<std::size_t>> &
 SteadyStateSimulation::getCompartmentSpeciesIdxs() const {
   return m_compartmentSpeciesIdxs;
@@ -482,6 +702,15 @@ void SteadyStateSimulation::setConvergenceMode(
   m_stop_mode = mode;
 }
 
+void SteadyStateSimulation::setSolverType(SteadyStateSolverType solver_type) {
+  if (solver_type == m_solver_type) {
+    return;
+  }
+  m_solver_type = solver_type;
+  // restart from the initial concentrations
+  reset();
+}
+
 void SteadyStateSimulation::setStopTolerance(double stop_tolerance) {
   m_convergence_tolerance = stop_tolerance;
 }
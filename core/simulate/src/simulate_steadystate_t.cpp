@@ -2,6 +2,7 @@
 #include "model_test_utils.hpp"
 #include "sme/simulate_options.hpp"
 #include "sme/simulate_steadystate.hpp"
+#include <algorithm>
 #include <catch2/catch_test_macros.hpp>
 #include <fmt/core.h>
 #include <fmt/ranges.h>
@@ -34,6 +35,8 @@ TEST_CASE("SimulateSteadyState", "[core][core/simulate][steadystate][core/"
             simulate::SteadyStateConvergenceMode::relative);
     REQUIRE(sim.getStepsToConvergence() == 10);
     REQUIRE(sim.getTimeout() == 1000);
+    REQUIRE(sim.getSolverType() ==
+            simulate::SteadyStateSolverType::timestepping);
     REQUIRE(sim.hasConverged() == false);
     REQUIRE(sim.getConcentrations().size() ==
             6298); // number of values for each species in each compartment
@@ -66,6 +69,11 @@ TEST_CASE("SimulateSteadyState", "[core][core/simulate][steadystate][core/"
 
     sim.setTimeout(2000);
     REQUIRE(sim.getTimeout() == 2000);
+
+    sim.setSolverType(simulate::SteadyStateSolverType::newton_krylov);
+    REQUIRE(sim.getSolverType() ==
+            simulate::SteadyStateSolverType::newton_krylov);
+    REQUIRE(sim.getConcentrations().size() == 6298);
   }
 
   SECTION("Run_into_timeout_and_query_for_errormessage") {
@@ -150,6 +158,115 @@ TEST_CASE("SimulateSteadyState", "[core][core/simulate][steadystate][core/"
     REQUIRE(sim.getStepsBelowTolerance() == sim.getStepsToConvergence());
     REQUIRE(sim.getSolverErrormessage() == "");
   }
+  SECTION("Run_until_convergence_newton_krylov") {
+    m.getSimulationSettings().simulatorType = simulate::SimulatorType::Pixel;
+    // reference steady state from time stepping
+    simulate::SteadyStateSimulation reference(
+        m, 1e-5, 10, simulate::SteadyStateConvergenceMode::relative,
+        100000000, 5.0);
+    reference.run();
+    REQUIRE(reference.hasConverged());
+    simulate::SteadyStateSimulation sim(
+        m, rel_stop_tolerance, 10,
+        simulate::SteadyStateConvergenceMode::relative, 600000, 1.0,
+        simulate::SteadyStateSolverType::newton_krylov);
+    REQUIRE(sim.getSolverType() ==
+            simulate::SteadyStateSolverType::newton_krylov);
+    REQUIRE(sim.hasConverged() == false);
+    sim.run(); // run until convergence
+    REQUIRE(sim.hasConverged());
+    REQUIRE(sim.getSolverStopRequested());
+    // number of Newton iterations
+    REQUIRE(sim.getLatestStep() > 0.0);
+    REQUIRE(sim.getLatestStep() < 1000.0);
+    REQUIRE(sim.getLatestError() < rel_stop_tolerance);
+    REQUIRE(sim.getSolverErrormessage() == "");
+    auto pyConcs = sim.getPyConcs(0);
+    auto referenceConcs = reference.getPyConcs(0);
+    REQUIRE(pyConcs.size() == sim.getCompartmentSpeciesIds()[0].size());
+    REQUIRE(pyConcs.size() == referenceConcs.size());
+    for (std::size_t is = 0; is < pyConcs.size(); ++is) {
+      CAPTURE(is);
+      const auto &c{pyConcs[is]};
+      const auto &cRef{referenceConcs[is]};
+      REQUIRE(c.size() == m.getGeometry().getImages().volume().nVoxels());
+      REQUIRE(c.size() == cRef.size());
+      // same steady state as time stepping, with non-negative concentrations
+      double cMax{*std::ranges::max_element(cRef)};
+      for (std::size_t ix = 0; ix < c.size(); ++ix) {
+        REQUIRE(c[ix] >= 0.0);
+        REQUIRE(c[ix] == Catch::Approx(cRef[ix]).margin(0.01 * cMax));
+      }
+    }
+  }
+
+  SECTION("Newton_krylov_rejects_dune") {
+    m.getSimulationSettings().simulatorType = simulate::SimulatorType::DUNE;
+    simulate::SteadyStateSimulation sim(
+        m, rel_stop_tolerance, 10,
+        simulate::SteadyStateConvergenceMode::relative, 600000, 1.0,
+        simulate::SteadyStateSolverType::newton_krylov);
+    REQUIRE(sim.getSimulatorType() == simulate::SimulatorType::DUNE);
+    sim.run();
+    REQUIRE(sim.hasConverged() == false);
+    REQUIRE(sim.getLatestStep() == 0.0);
+    REQUIRE(sim.getSolverErrormessage().find("Pixel simulator") !=
+            std::string::npos);
+  }
+
+  SECTION("Continuation_newton_krylov") {
+    m.getSimulationSettings().simulatorType = simulate::SimulatorType::Pixel;
+    simulate::SteadyStateSimulation sim(
+        m, rel_stop_tolerance, 10,
+        simulate::SteadyStateConvergenceMode::relative, 600000, 1.0,
+        simulate::SteadyStateSolverType::newton_krylov);
+    simulate::SteadyStateContinuationOptions options;
+    options.parameterId = "k";
+    options.start = 0.06;
+    options.end = 0.062;
+    options.initialStep = 0.001;
+    std::vector<double> callbackValues;
+    auto points = sim.runContinuation(
+        options, [&](const simulate::SteadyStateContinuationPoint &point) {
+          REQUIRE(sim.hasConverged());
+          REQUIRE(sim.getPyConcs(0).size() == 2);
+          callbackValues.push_back(point.parameterValue);
+        });
+    REQUIRE(points.size() >= 2);
+    REQUIRE(callbackValues.size() == points.size());
+    REQUIRE(points.front().parameterValue == dbl_approx(0.06));
+    REQUIRE(points.back().parameterValue == dbl_approx(0.062));
+    for (const auto &point : points) {
+      REQUIRE(point.error < rel_stop_tolerance);
+    }
+    // later steady states start from the previous one
+    REQUIRE(points.back().steps <= points.front().steps);
+    // model is not modified
+    REQUIRE(m.getParameters().getExpression("k") == "0.06");
+    // invalid parameter
+    options.parameterId = "not_a_parameter";
+    REQUIRE_THROWS(sim.runContinuation(options));
+  }
+
+  SECTION("Continuation_dune") {
+    // each steady state starts from the DUNE solution of the previous one
+    m.getSimulationSettings().simulatorType = simulate::SimulatorType::DUNE;
+    simulate::SteadyStateSimulation sim(
+        m, abs_stop_tolerance, 10,
+        simulate::SteadyStateConvergenceMode::absolute, 100000000, 5.0);
+    simulate::SteadyStateContinuationOptions options;
+    options.parameterId = "k";
+    options.start = 0.06;
+    options.end = 0.061;
+    options.initialStep = 0.001;
+    auto points = sim.runContinuation(options);
+    REQUIRE(points.size() == 2);
+    REQUIRE(points.back().parameterValue == dbl_approx(0.061));
+    REQUIRE(points.back().steps <= points.front().steps);
+    REQUIRE(sim.getSolverErrormessage() == "");
+    REQUIRE(m.getParameters().getExpression("k") == "0.06");
+  }
+
   SECTION("Reset_restores_state") {
     m.getSimulationSettings().simulatorType = simulate::SimulatorType::Pixel;
     simulate::SteadyStateSimulation sim(
@@ -10,6 +10,7 @@
 #include <algorithm>
 #include <cmath>
 #include <future>
+#include <optional>
 
 using namespace sme;
 using namespace sme::test;
@@ -364,6 +365,122 @@ TEST_CASE("Simulate: very_simple_model, 2d geometry",
   }
 }
 
+TEST_CASE("Simulate: very_simple_model, downsampled concentration images",
+          "[core/simulate/simulate][core/simulate][core][simulate][pixel]") {
+  auto s{getExampleModel(Mod::VerySimpleModel)};
+  s.getSimulationSettings().simulatorType = simulate::SimulatorType::Pixel;
+  simulate::Simulation sim(s);
+  // timepoint 0 is stored before the levels are enabled
+  sim.setConcImagePyramidLevels(3);
+  sim.doTimesteps(0.2, 2);
+  REQUIRE(sim.errorMessage().empty());
+  const auto voxelSize{s.getGeometry().getVoxelSize()};
+  auto sumRgb = [](const common::ImageStack &imgs) {
+    double sum{0};
+    for (std::size_t z = 0; z < imgs.volume().depth(); ++z) {
+      for (int y = 0; y < imgs[z].height(); ++y) {
+        for (int x = 0; x < imgs[z].width(); ++x) {
+          auto c{imgs[z].pixel(x, y)};
+          sum += qRed(c) + qGreen(c) + qBlue(c);
+        }
+      }
+    }
+    return sum;
+  };
+  for (std::size_t timeIndex : {0U, 2U}) {
+    CAPTURE(timeIndex);
+    auto full{sim.getConcImage(timeIndex)};
+    REQUIRE(full.volume() == common::Volume(100, 100, 1));
+    // display at least as large as the image: full resolution
+    auto img{sim.getConcImage(timeIndex, {}, false, false, QSize(200, 100))};
+    REQUIRE(img.volume() == full.volume());
+    REQUIRE(img[0] == full[0]);
+    // 2x downsampled
+    img = sim.getConcImage(timeIndex, {}, false, false, QSize(60, 50));
+    REQUIRE(img.volume() == common::Volume(50, 50, 1));
+    REQUIRE(img.voxelSize().width() == dbl_approx(2.0 * voxelSize.width()));
+    REQUIRE(img.voxelSize().height() == dbl_approx(2.0 * voxelSize.height()));
+    REQUIRE(img.voxelSize().depth() == dbl_approx(voxelSize.depth()));
+    // average color is approximately preserved
+    REQUIRE(4.0 * sumRgb(img) == Catch::Approx(sumRgb(full)).epsilon(0.02));
+    // coarsest available level for a very small display
+    img = sim.getConcImage(timeIndex, {}, false, false, QSize(5, 40));
+    REQUIRE(img.volume() == common::Volume(13, 13, 1));
+    REQUIRE(img.voxelSize().width() == dbl_approx(8.0 * voxelSize.width()));
+  }
+  // disabled: always full resolution
+  sim.setConcImagePyramidLevels(0);
+  auto img{sim.getConcImage(2, {}, false, false, QSize(10, 10))};
+  REQUIRE(img.volume() == common::Volume(100, 100, 1));
+}
+
+TEST_CASE("Simulate: very_simple_model_3d, downsampled concentration images",
+          "[core/simulate/simulate][core/simulate][core][simulate][pixel]") {
+  auto s{getExampleModel(Mod::VerySimpleModel3D)};
+  s.getSimulationSettings().simulatorType = simulate::SimulatorType::Pixel;
+  simulate::Simulation sim(s);
+  sim.doTimesteps(0.1, 1);
+  REQUIRE(sim.errorMessage().empty());
+  const auto voxelSize{s.getGeometry().getVoxelSize()};
+  const auto full{sim.getConcImage(1)};
+  const auto vol{full.volume()};
+  REQUIRE(vol.depth() > 1);
+  const QSize halfSize(vol.width() / 2, vol.height() / 2);
+  // only the levels needed for this display size
+  sim.setConcImageDisplaySize(halfSize);
+  // 2x downsampled in x, y and z
+  auto img{sim.getConcImage(1, {}, false, false, halfSize)};
+  REQUIRE(img.volume() == common::Volume((vol.width() + 1) / 2,
+                                         (vol.height() + 1) / 2,
+                                         (vol.depth() + 1) / 2));
+  REQUIRE(img.voxelSize().width() == dbl_approx(2.0 * voxelSize.width()));
+  REQUIRE(img.voxelSize().depth() == dbl_approx(2.0 * voxelSize.depth()));
+  // no coarser levels were enabled
+  img = sim.getConcImage(1, {}, false, false, QSize(1, 1));
+  REQUIRE(img.volume() == common::Volume((vol.width() + 1) / 2,
+                                         (vol.height() + 1) / 2,
+                                         (vol.depth() + 1) / 2));
+}
+
+TEST_CASE("Simulate: very_simple_model, reading results within memory budget",
+          "[core/simulate/simulate][core/simulate][core][simulate][pixel]") {
+  auto s{getExampleModel(Mod::VerySimpleModel)};
+  s.getSimulationSettings().simulatorType = simulate::SimulatorType::Pixel;
+  std::size_t timepointBytes{0};
+  {
+    simulate::Simulation sim(s);
+    timepointBytes = s.getSimulationData().getEstimatedAdditionalMemoryBytes(1);
+  }
+  REQUIRE(timepointBytes > 0);
+  // room for a few of the timepoints in memory
+  const std::size_t budget{8 * timepointBytes};
+  s.getSimulationSettings().memoryBudgetBytes = budget;
+  simulate::Simulation sim(s);
+  sim.doTimesteps(0.05, 12);
+  REQUIRE(sim.errorMessage().empty());
+  const auto &data{s.getSimulationData()};
+  REQUIRE(data.nSpilled() > 0);
+  REQUIRE(data.getEstimatedMemoryBytes() <= budget);
+  // browsing every timepoint after the run pages them in and out again
+  const auto nTimepoints{sim.getTimePoints().size()};
+  REQUIRE(nTimepoints == 13);
+  for (std::size_t timeIndex = 0; timeIndex < nTimepoints; ++timeIndex) {
+    CAPTURE(timeIndex);
+    REQUIRE(sim.getConcImage(timeIndex).volume().nVoxels() > 0);
+    REQUIRE(!sim.getPyConcs(timeIndex, 0).empty());
+    REQUIRE(!sim.getConc(timeIndex, 1, 0).empty());
+    REQUIRE(data.getEstimatedMemoryBytes() <= budget);
+  }
+  // downsampled display images count against the same budget
+  sim.setConcImagePyramidLevels(3);
+  for (std::size_t timeIndex = 0; timeIndex < nTimepoints; ++timeIndex) {
+    CAPTURE(timeIndex);
+    REQUIRE(sim.getConcImage(timeIndex, {}, false, false, QSize(10, 10))
+                .volume() == common::Volume(13, 13, 1));
+    REQUIRE(data.getEstimatedMemoryBytes() <= budget - budget / 4);
+  }
+}
+
 TEST_CASE("Simulate: very_simple_model, failing Pixel sim",
           "[core/simulate/simulate][core/simulate][core][simulate][pixel]") {
   auto s{getExampleModel(Mod::VerySimpleModel)};
@@ -1593,6 +1710,95 @@ TEST_CASE("Pixel simulator: timeout",
   REQUIRE(sim2.getNCompletedTimesteps() > 1);
 }
 
+TEST_CASE("Pixel simulator: restart from solver checkpoint",
+          "[core/simulate/simulate][core/simulate][core][simulate][pixel]") {
+  auto s{getExampleModel(Mod::Brusselator)};
+  auto &options{s.getSimulationSettings().options};
+  options.pixel.integrator = simulate::PixelIntegratorType::RK323;
+  options.pixel.enableMultiThreading = false;
+  s.getSimulationSettings().simulatorType = simulate::SimulatorType::Pixel;
+  std::optional<simulate::SolverCheckpoint> checkpoint;
+  std::vector<double> cRef;
+  {
+    simulate::Simulation sim(s);
+    sim.doTimesteps(0.5);
+    checkpoint = sim.getSolverCheckpoint();
+    REQUIRE(checkpoint.has_value());
+    REQUIRE(checkpoint->simulatorType == simulate::SimulatorType::Pixel);
+    REQUIRE(checkpoint->time == dbl_approx(0.5));
+    // adaptive timestep has grown from its initial value
+    REQUIRE(checkpoint->timestep > 1e-5);
+    REQUIRE(checkpoint->state.size() == 1);
+    sim.doTimesteps(0.5);
+    cRef = sim.getConc(2, 0, 0);
+  }
+  // remove last timepoint & continue from the checkpoint at t=0.5
+  s.getSimulationData().pop_back();
+  REQUIRE(s.getSimulationData().timePoints.back() == dbl_approx(0.5));
+  simulate::Simulation sim(s);
+  auto wrongTime{checkpoint.value()};
+  wrongTime.time = 0.25;
+  REQUIRE(sim.applySolverCheckpoint(wrongTime) == false);
+  auto wrongSimulator{checkpoint.value()};
+  wrongSimulator.simulatorType = simulate::SimulatorType::DUNE;
+  REQUIRE(sim.applySolverCheckpoint(wrongSimulator) == false);
+  auto wrongSize{checkpoint.value()};
+  wrongSize.state[0].pop_back();
+  REQUIRE(sim.applySolverCheckpoint(wrongSize) == false);
+  REQUIRE(sim.applySolverCheckpoint(checkpoint.value()) == true);
+  REQUIRE(sim.getSolverCheckpoint()->timestep ==
+          dbl_approx(checkpoint->timestep));
+  sim.doTimesteps(0.5);
+  REQUIRE(sim.errorMessage().empty());
+  // restarted simulation is identical to the uninterrupted one
+  auto c{sim.getConc(2, 0, 0)};
+  REQUIRE(c.size() == cRef.size());
+  for (std::size_t i = 0; i < c.size(); ++i) {
+    REQUIRE(c[i] == dbl_approx(cRef[i]));
+  }
+}
+
+TEST_CASE("DUNE simulator: restart from solver checkpoint",
+          "[core/simulate/simulate][core/simulate][core][simulate][dune]") {
+  for (auto discretization : {simulate::DuneDiscretizationType::FEM1,
+                              simulate::DuneDiscretizationType::FEM2}) {
+    CAPTURE(static_cast<int>(discretization));
+    auto s{getExampleModel(Mod::ABtoC)};
+    s.getSimulationSettings().simulatorType = simulate::SimulatorType::DUNE;
+    s.getSimulationSettings().options.dune.discretization = discretization;
+    std::optional<simulate::SolverCheckpoint> checkpoint;
+    std::vector<double> cRef;
+    {
+      simulate::Simulation sim(s);
+      sim.doTimesteps(0.2);
+      checkpoint = sim.getSolverCheckpoint();
+      REQUIRE(checkpoint.has_value());
+      REQUIRE(checkpoint->simulatorType == simulate::SimulatorType::DUNE);
+      // finite element solution at the nodes of the mesh
+      REQUIRE(checkpoint->state.size() == 1);
+      REQUIRE(!checkpoint->state[0].empty());
+      sim.doTimesteps(0.2);
+      cRef = sim.getConc(2, 0, 0);
+    }
+    // remove last timepoint & continue from the checkpoint at t=0.2
+    s.getSimulationData().pop_back();
+    simulate::Simulation sim(s);
+    auto wrongSize{checkpoint.value()};
+    wrongSize.state[0].pop_back();
+    REQUIRE(sim.applySolverCheckpoint(wrongSize) == false);
+    REQUIRE(sim.applySolverCheckpoint(checkpoint.value()) == true);
+    sim.doTimesteps(0.2);
+    REQUIRE(sim.errorMessage().empty());
+    // restarted simulation matches the uninterrupted one, instead of
+    // restarting from the concentrations sampled at the voxels
+    auto c{sim.getConc(2, 0, 0)};
+    REQUIRE(c.size() == cRef.size());
+    for (std::size_t i = 0; i < c.size(); ++i) {
+      REQUIRE(c[i] == Catch::Approx(cRef[i]).epsilon(1e-8).margin(1e-12));
+    }
+  }
+}
+
 TEST_CASE("Pixel simulator: brusselator model, RK2, RK3, RK4",
           "[core/simulate/simulate][core/simulate][core][simulate][pixel]") {
   double eps{1e-20};
@@ -1677,6 +1883,34 @@ TEST_CASE("DUNE: simulation",
     REQUIRE(imgConc.volume().depth() == 1);
     REQUIRE(imgConc[0].size() == QSize(100, 100));
   }
+  SECTION("ABtoC model: restart from solver checkpoint") {
+    auto s{getExampleModel(Mod::ABtoC)};
+    auto &options{s.getSimulationSettings().options};
+    options.dune.dt = 0.001;
+    options.dune.maxDt = 0.01;
+    options.dune.minDt = 0.0001;
+    s.getSimulationSettings().simulatorType = simulate::SimulatorType::DUNE;
+    std::optional<simulate::SolverCheckpoint> checkpoint;
+    {
+      simulate::Simulation duneSim(s);
+      duneSim.doTimesteps(0.05);
+      checkpoint = duneSim.getSolverCheckpoint();
+    }
+    REQUIRE(checkpoint.has_value());
+    REQUIRE(checkpoint->simulatorType == simulate::SimulatorType::DUNE);
+    REQUIRE(checkpoint->time == dbl_approx(0.05));
+    // stepper timestep has grown from its initial value
+    REQUIRE(checkpoint->timestep > options.dune.dt);
+    simulate::Simulation duneSim(s);
+    REQUIRE(duneSim.getSolverCheckpoint()->timestep ==
+            dbl_approx(options.dune.dt));
+    REQUIRE(duneSim.applySolverCheckpoint(checkpoint.value()) == true);
+    REQUIRE(duneSim.getSolverCheckpoint()->timestep ==
+            dbl_approx(checkpoint->timestep));
+    duneSim.doTimesteps(0.05);
+    REQUIRE(duneSim.errorMessage().empty());
+    REQUIRE(duneSim.getTimePoints().size() == 3);
+  }
   SECTION("very-simple-model: different linearSolvers") {
     auto m{getExampleModel(Mod::VerySimpleModel)};
     m.getSimulationSettings().simulatorType = simulate::SimulatorType::DUNE;
@@ -0,0 +1,15 @@
+#include "sme/simulator_cache.hpp"
+#include "dunesim_impl.hpp"
+
+namespace sme::simulate {
+
+SimulatorCache::SimulatorCache()
+    : duneSimCache{std::make_unique<DuneSimCache>()} {}
+
+SimulatorCache::~SimulatorCache() = default;
+
+DuneSimCache &SimulatorCache::getDuneSimCache() { return *duneSimCache; }
+
+void SimulatorCache::clear() { duneSimCache->clear(); }
+
+} // namespace sme::simulate
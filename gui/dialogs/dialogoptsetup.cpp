@@ -111,6 +111,21 @@ getDefaultOptParams(const sme::model::Model &model) {
         optParams.push_back({sme::simulate::OptParamType::DiffusionConstant,
                              name.toStdString(), speciesId.toStdString(), "",
                              value, value});
+      } else if (model.getSpecies().getDiffusionConstantType(speciesId) ==
+                 sme::model::SpatialDataType::Image) {
+        // optimized with a value for each voxel
+        auto speciesName{model.getSpecies().getName(speciesId)};
+        const auto &values{
+            model.getSpecies().getField(speciesId)->getDiffusionConstant()};
+        if (values.empty()) {
+          continue;
+        }
+        auto name{
+            QString("Diffusion constant field of '%1'").arg(speciesName)};
+        optParams.push_back({sme::simulate::OptParamType::DiffusionConstant,
+                             name.toStdString(), speciesId.toStdString(), "",
+                             sme::common::min(values),
+                             sme::common::max(values)});
       }
     }
   }
@@ -166,7 +181,8 @@ setValidMinPopulation(sme::simulate::OptAlgorithmType optAlgorithmType,
   static std::unordered_map<sme::simulate::OptAlgorithmType, int> minPopulation{
       {PSO, 2}, {GPSO, 2},  {DE, 5},   {iDE, 7},    {jDE, 7},
       {pDE, 7}, {ABC, 2},   {gaco, 7}, {COBYLA, 1}, {BOBYQA, 1},
-      {NMS, 1}, {sbplx, 1}, {AL, 1},   {PRAXIS, 1}};
+      {NMS, 1}, {sbplx, 1}, {AL, 1},   {PRAXIS, 1}, {Surrogate, 2},
+      {LBFGS, 1}};
   if (auto iter{minPopulation.find(optAlgorithmType)};
       iter != minPopulation.end()) {
     spinPopulation->setMinimum(iter->second);
@@ -137,6 +137,9 @@ void DialogSimulationOptions::setupConnections() {
   connect(ui->buttonBox, &QDialogButtonBox::rejected, this,
           &DialogSimulationOptions::reject);
   // Dune tab
+  connect(ui->cmbDuneDiscretization,
+          qOverload<int>(&QComboBox::currentIndexChanged), this,
+          &DialogSimulationOptions::cmbDuneDiscretization_currentIndexChanged);
   connect(ui->cmbDuneIntegrator,
           qOverload<int>(&QComboBox::currentIndexChanged), this,
           &DialogSimulationOptions::cmbDuneIntegrator_currentIndexChanged);
@@ -191,6 +194,8 @@ void DialogSimulationOptions::setupConnections() {
 }
 
 void DialogSimulationOptions::loadDuneOpts() {
+  ui->cmbDuneDiscretization->setCurrentIndex(
+      static_cast<int>(opt.dune.discretization));
   selectMatchingOrFirstItem(ui->cmbDuneIntegrator, opt.dune.integrator.c_str());
   opt.dune.integrator = ui->cmbDuneIntegrator->currentText().toStdString();
   ui->txtDuneDt->setText(dblToQString(opt.dune.dt));
@@ -211,6 +216,12 @@ void DialogSimulationOptions::loadDuneOpts() {
   ui->spnDuneThreads->setValue(opt.dune.maxThreads);
 }
 
+void DialogSimulationOptions::cmbDuneDiscretization_currentIndexChanged(
+    int index) {
+  opt.dune.discretization =
+      static_cast<sme::simulate::DuneDiscretizationType>(index);
+}
+
 void DialogSimulationOptions::cmbDuneIntegrator_currentIndexChanged(
     [[maybe_unused]] int index) {
   opt.dune.integrator = ui->cmbDuneIntegrator->currentText().toStdString();
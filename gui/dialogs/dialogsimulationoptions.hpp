@@ -19,6 +19,7 @@ public:
 private:
   void setupConnections();
   void loadDuneOpts();
+  void cmbDuneDiscretization_currentIndexChanged(int index);
   void cmbDuneIntegrator_currentIndexChanged(int index);
   void txtDuneDt_editingFinished();
   void txtDuneMinDt_editingFinished();
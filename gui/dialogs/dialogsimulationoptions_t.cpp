@@ -139,6 +139,7 @@ TEST_CASE("DialogSimulationOptions", "[gui/dialogs/simulationoptions][gui/"
   }
   SECTION("user changes Dune values, then resets to defaults") {
     widgets.tabSimulator->setCurrentIndex(0);
+    widgets.cmbDuneDiscretization->setCurrentIndex(1);
     widgets.cmbDuneIntegrator->setCurrentIndex(2);
     widgets.txtDuneDt->clear();
     sendKeyEvents(widgets.txtDuneDt, {"0", ".", "4", "Enter"});
@@ -158,6 +159,8 @@ TEST_CASE("DialogSimulationOptions", "[gui/dialogs/simulationoptions][gui/"
     widgets.cmbDuneLinearSolver->setCurrentIndex(2);
     widgets.spnDuneThreads->setValue(1);
     auto opt = dia.getOptions();
+    REQUIRE(opt.dune.discretization ==
+            sme::simulate::DuneDiscretizationType::FEM2);
     REQUIRE(opt.dune.integrator == "Heun");
     REQUIRE(opt.dune.dt == dbl_approx(0.4));
     REQUIRE(opt.dune.minDt == dbl_approx(1e-12));
@@ -172,6 +175,7 @@ TEST_CASE("DialogSimulationOptions", "[gui/dialogs/simulationoptions][gui/"
     sendMouseClick(widgets.btnDuneReset);
     sme::simulate::DuneOptions defaultOpts{};
     opt = dia.getOptions();
+    REQUIRE(opt.dune.discretization == defaultOpts.discretization);
     REQUIRE(opt.dune.integrator == defaultOpts.integrator);
     REQUIRE(opt.dune.dt == dbl_approx(defaultOpts.dt));
     REQUIRE(opt.dune.minDt == dbl_approx(defaultOpts.minDt));
@@ -29,6 +29,13 @@ void DialogSteadystate::initUi() {
   ui->cmbConvergence->addItems({"Absolute", "Relative"});
   ui->cmbConvergence->setCurrentIndex(1);
 
+  ui->cmbSolver->addItems({"Time stepping", "Newton-Krylov"});
+  ui->cmbSolver->setCurrentIndex(
+      m_sim.getSolverType() ==
+              sme::simulate::SteadyStateSolverType::newton_krylov
+          ? 1
+          : 0);
+
   ui->cmbPlotting->addItems({"2D", "3D"});
   ui->cmbPlotting->setCurrentIndex(0);
 
@@ -59,6 +66,9 @@ void DialogSteadystate::connectSlots() {
   connect(ui->cmbConvergence, &QComboBox::currentIndexChanged, this,
           &DialogSteadystate::convergenceCurrentIndexChanged);
 
+  connect(ui->cmbSolver, &QComboBox::currentIndexChanged, this,
+          &DialogSteadystate::solverCurrentIndexChanged);
+
   connect(ui->cmbPlotting, &QComboBox::currentIndexChanged, this,
           &DialogSteadystate::plottingCurrentIndexChanged);
 
@@ -253,6 +263,7 @@ void DialogSteadystate::updateSpeciesToPlot() {
 void DialogSteadystate::finalise() {
   m_plotRefreshTimer.stop();
   ui->btnReset->setEnabled(true);
+  ui->cmbSolver->setEnabled(true);
 }
 
 const sme::simulate::SteadyStateSimulation &
@@ -378,6 +389,17 @@ void DialogSteadystate::convergenceCurrentIndexChanged(int index) {
   }
 }
 
+void DialogSteadystate::solverCurrentIndexChanged(int index) {
+  // changing the solver resets the simulation
+  if (index == 0) {
+    m_sim.setSolverType(sme::simulate::SteadyStateSolverType::timestepping);
+  } else {
+    m_sim.setSolverType(sme::simulate::SteadyStateSolverType::newton_krylov);
+  }
+  ui->btnStartStop->setText("Start");
+  resetPlots();
+}
+
 void DialogSteadystate::plottingCurrentIndexChanged(
     [[maybe_unused]] int index) {
 
@@ -437,6 +459,7 @@ void DialogSteadystate::btnStartStopClicked() {
     // start timer to periodically update simulation results
     ui->btnStartStop->setText("Stop");
     ui->btnReset->setEnabled(false);
+    ui->cmbSolver->setEnabled(false);
     runSim();
   } else {
     SPDLOG_DEBUG(" stop simulation");
@@ -61,6 +61,7 @@ private:
 
   // slots
   void convergenceCurrentIndexChanged(int index);
+  void solverCurrentIndexChanged(int index);
   void plottingCurrentIndexChanged(int index);
   void stepsWithinToleranceInputChanged();
   void timeoutInputChanged();
@@ -37,6 +37,8 @@ struct DialogSteadystateWidgets {
     GET_DIALOG_WIDGET(QComboBox, cmbPlotting);
     GET_DIALOG_WIDGET(QLineEdit, toleranceInput);
     GET_DIALOG_WIDGET(QComboBox, cmbConvergence);
+    GET_DIALOG_WIDGET(QLabel, solverLabel);
+    GET_DIALOG_WIDGET(QComboBox, cmbSolver);
     GET_DIALOG_WIDGET(QLabel, valuesLabel);
     GET_DIALOG_WIDGET(QLabelMouseTracker, valuesPlot);
     GET_DIALOG_WIDGET(QLabel, toleranceLabel);
@@ -63,6 +65,8 @@ struct DialogSteadystateWidgets {
   QComboBox *cmbPlotting;
   QLineEdit *toleranceInput;
   QComboBox *cmbConvergence;
+  QLabel *solverLabel;
+  QComboBox *cmbSolver;
   QLabel *valuesLabel;
   QLabelMouseTracker *valuesPlot;
   QLabel *toleranceLabel;
@@ -95,6 +99,8 @@ TEST_CASE("DialogSteadyState", "[gui/dialogs/steadystate][gui/"
     REQUIRE(widgets.tolStepInput->text() == "10");
     REQUIRE(widgets.cmbPlotting->currentText() == "2D");
     REQUIRE(widgets.cmbConvergence->currentText() == "Relative");
+    REQUIRE(widgets.cmbSolver->currentText() == "Time stepping");
+    REQUIRE(widgets.solverLabel->text() == "Solver:");
 
     REQUIRE(widgets.valuesLabel->text() == "current values:");
     REQUIRE(widgets.toleranceLabel->text() == "Stop tolerance: ");
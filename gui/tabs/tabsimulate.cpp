@@ -23,6 +23,9 @@
 #include <cmath>
 #include <limits>
 
+// number of downsampled image levels used to display a running simulation
+static constexpr std::size_t nConcImagePyramidLevels{3};
+
 TabSimulate::TabSimulate(sme::model::Model &m, QLabelMouseTracker *mouseTracker,
                          QVoxelRenderer *voxelRenderer, QWidget *parent)
     : QWidget(parent), ui{std::make_unique<Ui::TabSimulate>()}, model{m},
@@ -245,6 +248,7 @@ void TabSimulate::loadModelData() {
   // and once they are deleted it dereferences a nullptr and segfaults...
   sim.reset();
   sim = std::make_unique<sme::simulate::Simulation>(model);
+  sim->setConcImagePyramidLevels(nConcImagePyramidLevels);
   if (!sim->errorMessage().empty()) {
     ui->btnSimulate->setEnabled(false);
     const auto simulatorType{model.getSimulationSettings().simulatorType};
@@ -458,10 +462,15 @@ void TabSimulate::btnSliceImage_clicked() {
   plotData.lengthUnit = model.getUnits().getLength().name;
   plotData.concentrationUnit = model.getUnits().getConcentration();
   plotData.timepointIndex = ui->hslideTime->value();
-  if (const auto *zSlider{lblGeometry->getZSlider()}; zSlider != nullptr) {
-    plotData.zIndex = zSlider->value();
-  }
-  DialogImageSlice dialog(model.getGeometry().getImages(), images, time,
+  const auto fullImages{getFullResolutionImages()};
+  if (const auto *zSlider{lblGeometry->getZSlider()};
+      zSlider != nullptr && !images.isEmpty() && !fullImages.isEmpty()) {
+    // displayed images may be downsampled in z
+    plotData.zIndex = static_cast<int>(
+        static_cast<std::size_t>(zSlider->value()) *
+        fullImages.front().volume().depth() / images.front().volume().depth());
+  }
+  DialogImageSlice dialog(model.getGeometry().getImages(), fullImages, time,
                           flipYAxis, plotData);
   if (dialog.exec() == QDialog::Accepted) {
     SPDLOG_DEBUG("todo: save current slice settings");
@@ -469,7 +478,8 @@ void TabSimulate::btnSliceImage_clicked() {
 }
 
 void TabSimulate::btnExport_clicked() {
-  DialogExport dialog(images, plt.get(), model, *sim.get(),
+  const auto fullImages{getFullResolutionImages()};
+  DialogExport dialog(fullImages, plt.get(), model, *sim.get(),
                       ui->hslideTime->value());
   if (dialog.exec() == QDialog::Accepted) {
     SPDLOG_DEBUG("todo: save current export settings");
@@ -503,8 +513,10 @@ void TabSimulate::updatePlotAndImages() {
   }
   for (std::size_t i = n0; i < n; ++i) {
     SPDLOG_DEBUG("adding timepoint {}", i);
-    // process new results
-    images.push_back(sim->getConcImage(i, compartmentSpeciesToDraw));
+    // process new results: display images are rendered from the
+    // downsampled level that fits the display
+    images.push_back(sim->getConcImage(i, compartmentSpeciesToDraw, false,
+                                       false, lblGeometry->size()));
     time.push_back(timePoints[i]);
     int speciesIndex = 0;
     for (std::size_t ic = 0; ic < sim->getCompartmentIds().size(); ++ic) {
@@ -564,12 +576,14 @@ void TabSimulate::finalizePlotAndImages() {
   plt->update(displayOptions.showSpecies, displayOptions.showMinMax,
               displayOptions.showFeatures);
   updateSpeciesToDraw();
-  // update all images
+  // update all images at display resolution, full resolution images are
+  // only rendered on demand for the image slice and export dialogs
   for (int iTime = 0; iTime < time.size(); ++iTime) {
     images[iTime] = sim->getConcImage(static_cast<std::size_t>(iTime),
                                       compartmentSpeciesToDraw,
                                       displayOptions.normaliseOverAllTimepoints,
-                                      displayOptions.normaliseOverAllSpecies);
+                                      displayOptions.normaliseOverAllSpecies,
+                                      lblGeometry->size());
   }
   plt->setVerticalLine(time.back());
   // enable slider to choose time to display
@@ -583,7 +597,23 @@ void TabSimulate::finalizePlotAndImages() {
     SPDLOG_INFO("resetting simulation after early stop");
     sim.reset();
     sim = std::make_unique<sme::simulate::Simulation>(model);
+    sim->setConcImagePyramidLevels(nConcImagePyramidLevels);
+  }
+}
+
+QVector<sme::common::ImageStack> TabSimulate::getFullResolutionImages() const {
+  QVector<sme::common::ImageStack> fullImages;
+  if (sim == nullptr) {
+    return fullImages;
+  }
+  fullImages.reserve(time.size());
+  for (int iTime = 0; iTime < time.size(); ++iTime) {
+    fullImages.push_back(sim->getConcImage(
+        static_cast<std::size_t>(iTime), compartmentSpeciesToDraw,
+        displayOptions.normaliseOverAllTimepoints,
+        displayOptions.normaliseOverAllSpecies));
   }
+  return fullImages;
 }
 
 void TabSimulate::btnDisplayOptions_clicked() {
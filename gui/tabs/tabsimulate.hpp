@@ -73,6 +73,8 @@ private:
   void updateSpeciesToDraw();
   void updatePlotAndImages();
   void finalizePlotAndImages();
+  [[nodiscard]] QVector<sme::common::ImageStack>
+  getFullResolutionImages() const;
   void btnDisplayOptions_clicked();
   void graphClicked(const QMouseEvent *event);
   void hslideTime_valueChanged(int value);
@@ -19,7 +19,18 @@ namespace pysme {
 void bindModel(nanobind::module_ &m) {
   nanobind::enum_<::sme::simulate::DuneDiscretizationType>(
       m, "DuneDiscretizationType")
-      .value("FEM1", ::sme::simulate::DuneDiscretizationType::FEM1);
+      .value("FEM1", ::sme::simulate::DuneDiscretizationType::FEM1)
+      .value("FEM2", ::sme::simulate::DuneDiscretizationType::FEM2);
+  nanobind::enum_<::sme::simulate::SteadyStateConvergenceMode>(
+      m, "SteadyStateConvergenceMode")
+      .value("absolute", ::sme::simulate::SteadyStateConvergenceMode::absolute)
+      .value("relative", ::sme::simulate::SteadyStateConvergenceMode::relative);
+  nanobind::enum_<::sme::simulate::SteadyStateSolverType>(
+      m, "SteadyStateSolverType")
+      .value("timestepping",
+             ::sme::simulate::SteadyStateSolverType::timestepping)
+      .value("newton_krylov",
+             ::sme::simulate::SteadyStateSolverType::newton_krylov);
   nanobind::class_<Model> model(m, "Model",
                                 R"(
                                      the spatial model
@@ -54,7 +65,17 @@ void bindModel(nanobind::module_ &m) {
       .def_rw("newton_rel_err", &::sme::simulate::DuneOptions::newtonRelErr)
       .def_rw("newton_abs_err", &::sme::simulate::DuneOptions::newtonAbsErr)
       .def_rw("linear_solver", &::sme::simulate::DuneOptions::linearSolver)
-      .def_rw("max_threads", &::sme::simulate::DuneOptions::maxThreads);
+      .def_rw("preconditioner", &::sme::simulate::DuneOptions::preconditioner)
+      .def_rw("max_threads", &::sme::simulate::DuneOptions::maxThreads)
+      .def_rw("adaptive_mesh", &::sme::simulate::DuneOptions::adaptiveMesh)
+      .def_rw("adaptive_max_level",
+              &::sme::simulate::DuneOptions::adaptiveMaxLevel)
+      .def_rw("adaptive_refine_tol",
+              &::sme::simulate::DuneOptions::adaptiveRefineTol)
+      .def_rw("adaptive_coarsen_tol",
+              &::sme::simulate::DuneOptions::adaptiveCoarsenTol)
+      .def_rw("adaptive_interval",
+              &::sme::simulate::DuneOptions::adaptiveInterval);
   nanobind::class_<::sme::simulate::PixelOptions>(m, "PixelOptions")
       .def(nanobind::init<>())
       .def_rw("backend", &::sme::simulate::PixelOptions::backend)
@@ -267,11 +288,12 @@ void bindModel(nanobind::module_ &m) {
              std::optional<::sme::simulate::SimulatorType> simulatorType,
              bool continueExistingSimulation, bool returnResults,
              std::optional<int> nThreads,
-             std::optional<SimulationSettings> settings) {
-            return self.simulateFloat(simulationTime, imageInterval,
-                                      timeoutSeconds, throwOnTimeout,
-                                      simulatorType, continueExistingSimulation,
-                                      returnResults, nThreads, settings);
+             std::optional<SimulationSettings> settings,
+             std::optional<std::pair<int, int>> imageSize) {
+            return self.simulateFloat(
+                simulationTime, imageInterval, timeoutSeconds, throwOnTimeout,
+                simulatorType, continueExistingSimulation, returnResults,
+                nThreads, settings, imageSize);
           },
           nanobind::arg("simulation_time") = nanobind::none(),
           nanobind::arg("image_interval") = nanobind::none(),
@@ -282,6 +304,7 @@ void bindModel(nanobind::module_ &m) {
           nanobind::arg("return_results") = true,
           nanobind::arg("n_threads") = nanobind::none(), nanobind::kw_only(),
           nanobind::arg("settings") = nanobind::none(),
+          nanobind::arg("image_size") = nanobind::none(),
           R"(
           Run a simulation and optionally return the results.
 
@@ -323,6 +346,12 @@ void bindModel(nanobind::module_ &m) {
               Per-call simulation settings override. If omitted, use
               `model.simulation_settings`.
           :type settings: sme.SimulationSettings, optional
+          :param image_size:
+              Maximum `(width, height)` the concentration images will be
+              displayed at. If given, each `concentration_image` is rendered
+              from downsampled concentrations with at least one voxel per
+              pixel. If omitted, images are full resolution.
+          :type image_size: tuple[int, int], optional
           :returns: simulation results.
           :rtype: SimulationResultList
           :raises RuntimeError: if the simulation times out or fails.
@@ -335,11 +364,12 @@ void bindModel(nanobind::module_ &m) {
              std::optional<::sme::simulate::SimulatorType> simulatorType,
              bool continueExistingSimulation, bool returnResults,
              std::optional<int> nThreads,
-             std::optional<SimulationSettings> settings) {
+             std::optional<SimulationSettings> settings,
+             std::optional<std::pair<int, int>> imageSize) {
             return self.simulateString(
                 simulationTimes, imageIntervals, timeoutSeconds, throwOnTimeout,
                 simulatorType, continueExistingSimulation, returnResults,
-                nThreads, settings);
+                nThreads, settings, imageSize);
           },
           nanobind::arg("simulation_times"), nanobind::arg("image_intervals"),
           nanobind::arg("timeout_seconds") = 86400,
@@ -349,6 +379,7 @@ void bindModel(nanobind::module_ &m) {
           nanobind::arg("return_results") = true,
           nanobind::arg("n_threads") = nanobind::none(), nanobind::kw_only(),
           nanobind::arg("settings") = nanobind::none(),
+          nanobind::arg("image_size") = nanobind::none(),
           R"(
           Run a simulation and optionally return the results.
 
@@ -386,14 +417,150 @@ void bindModel(nanobind::module_ &m) {
               Per-call simulation settings override. If omitted, use
               `model.simulation_settings`.
           :type settings: sme.SimulationSettings, optional
+          :param image_size:
+              Maximum `(width, height)` the concentration images will be
+              displayed at. If given, each `concentration_image` is rendered
+              from downsampled concentrations with at least one voxel per
+              pixel. If omitted, images are full resolution.
+          :type image_size: tuple[int, int], optional
           :returns: simulation results.
           :rtype: SimulationResultList
           :raises RuntimeError: if the simulation times out or fails.
           )")
+      .def("export_solver_checkpoint", &Model::exportSolverCheckpoint,
+           nanobind::arg("filename"),
+           R"(
+           exports the solver state at the last timepoint of the simulation
+
+           A simulation continued with ``continue_existing_simulation=True``
+           resumes the solver from this state, with the same timestep,
+           instead of restarting it with a small timestep. This happens
+           automatically within a Python session, the checkpoint file allows
+           it to also be done after e.g. saving and re-opening the model.
+
+           Args:
+               filename (str): the name of the file to create
+           )")
+      .def("import_solver_checkpoint", &Model::importSolverCheckpoint,
+           nanobind::arg("filename"),
+           R"(
+           imports a solver state to use when continuing the simulation
+
+           The solver state is used by the next call to :func:`Model.simulate`
+           with ``continue_existing_simulation=True``, if it was exported at
+           the same time as the last timepoint of the existing simulation.
+
+           Args:
+               filename (str): the name of the solver checkpoint file
+           )")
+      .def("steady_state", &Model::steadyState,
+           nanobind::arg("tolerance") = 1e-6,
+           nanobind::arg("steps_to_convergence") = 10,
+           nanobind::arg("convergence_mode") =
+               ::sme::simulate::SteadyStateConvergenceMode::relative,
+           nanobind::arg("timeout_seconds") = 3600, nanobind::arg("dt") = 1.0,
+           nanobind::arg("solver") =
+               ::sme::simulate::SteadyStateSolverType::timestepping,
+           R"(
+          Find the steady state of the model for the current parameters.
+
+          :param tolerance:
+              Stop tolerance for the (possibly normalised) rate of change of
+              the concentrations. Default: `1e-6`.
+          :type tolerance: float
+          :param steps_to_convergence:
+              Number of consecutive convergence checks that have to be below
+              the tolerance. Only used by the time stepping solver.
+              Default: `10`.
+          :type steps_to_convergence: int
+          :param convergence_mode:
+              Normalise the rate of change by the concentrations (`relative`)
+              or not (`absolute`). Default: `relative`.
+          :type convergence_mode: sme.SteadyStateConvergenceMode
+          :param timeout_seconds:
+              Maximum wall-clock runtime in seconds. Default: `3600`.
+          :type timeout_seconds: int
+          :param dt:
+              Simulation time between convergence checks for the time stepping
+              solver, or the initial pseudo-timestep for the Newton-Krylov
+              solver. Default: `1.0`.
+          :type dt: float
+          :param solver:
+              The steady state solver. The `newton_krylov` solver requires
+              the Pixel simulator. Default: `timestepping`.
+          :type solver: sme.SteadyStateSolverType
+          :returns: the steady state concentrations.
+          :rtype: SimulationResult
+          :raises RuntimeError: if the solver fails or does not converge.
+          )")
+      .def("steady_state_continuation", &Model::steadyStateContinuation,
+           nanobind::arg("parameter"), nanobind::arg("start"),
+           nanobind::arg("end"), nanobind::arg("initial_step"),
+           nanobind::arg("min_step") = 1e-6,
+           nanobind::arg("max_step") = nanobind::none(),
+           nanobind::arg("tolerance") = 1e-6,
+           nanobind::arg("steps_to_convergence") = 10,
+           nanobind::arg("convergence_mode") =
+               ::sme::simulate::SteadyStateConvergenceMode::relative,
+           nanobind::arg("timeout_seconds") = 3600, nanobind::arg("dt") = 1.0,
+           nanobind::arg("solver") =
+               ::sme::simulate::SteadyStateSolverType::newton_krylov,
+           R"(
+          Find the steady states for a range of values of a model parameter.
+
+          Each steady state is used as the initial state for the next
+          parameter value, and the step in the parameter value is adapted:
+          it grows while steady states are found easily, and is halved if the
+          solver does not converge. The model itself is not modified.
+
+          :param parameter: The name of the constant model parameter to vary.
+          :type parameter: str
+          :param start: The first parameter value.
+          :type start: float
+          :param end: The last parameter value.
+          :type end: float
+          :param initial_step: The initial step in the parameter value.
+          :type initial_step: float
+          :param min_step:
+              The continuation stops if the step is reduced below this value.
+              Default: `1e-6`.
+          :type min_step: float
+          :param max_step: The maximum step in the parameter value.
+          :type max_step: float, optional
+          :param tolerance: See :func:`Model.steady_state`.
+          :type tolerance: float
+          :param steps_to_convergence: See :func:`Model.steady_state`.
+          :type steps_to_convergence: int
+          :param convergence_mode: See :func:`Model.steady_state`.
+          :type convergence_mode: sme.SteadyStateConvergenceMode
+          :param timeout_seconds:
+              Maximum wall-clock runtime in seconds for each steady state.
+              Default: `3600`.
+          :type timeout_seconds: int
+          :param dt: See :func:`Model.steady_state`.
+          :type dt: float
+          :param solver:
+              The steady state solver, `newton_krylov` requires the Pixel
+              simulator. Only the Pixel simulator state can be used as the
+              initial state for the next parameter value.
+              Default: `newton_krylov`.
+          :type solver: sme.SteadyStateSolverType
+          :returns: the parameter values and steady state concentrations.
+          :rtype: list[tuple[float, SimulationResult]]
+          :raises ValueError: if the parameter is not found.
+          )")
       .def("simulation_results", &Model::getSimulationResults,
+           nanobind::kw_only(), nanobind::arg("image_size") = nanobind::none(),
            R"(
           returns the simulation results.
 
+          Args:
+              image_size (tuple[int, int], optional): maximum
+                  ``(width, height)`` the concentration images will be
+                  displayed at. If given, each ``concentration_image`` is
+                  rendered from downsampled concentrations with at least one
+                  voxel per pixel. If omitted, images are full resolution.
+
           Returns:
               SimulationResultList: the simulation results
           )")
@@ -404,20 +571,32 @@ void bindModel(nanobind::module_ &m) {
       .def("__str__", &Model::getStr);
 }
 
+static QSize toQSize(const std::optional<std::pair<int, int>> &size) {
+  if (!size.has_value()) {
+    return {};
+  }
+  if (size->first <= 0 || size->second <= 0) {
+    throw std::invalid_argument("image_size must be positive");
+  }
+  return {size->first, size->second};
+}
+
 static std::vector<SimulationResult>
 constructSimulationResults(const ::sme::simulate::Simulation *sim,
-                           const ::sme::model::Model &model, bool getDcdt) {
+                           const ::sme::model::Model &model, bool getDcdt,
+                           const QSize &imageSize) {
   std::vector<SimulationResult> results;
   const auto timePoints{sim->getTimePoints()};
   const auto &features{model.getFeatures().getFeatures()};
   const auto &featureResults{sim->getSimulationData().featureResults};
+  // species concentrations are always full resolution
+  const auto shape{model.getGeometry().getImages().volume()};
   results.reserve(timePoints.size());
   for (std::size_t i = 0; i < timePoints.size(); ++i) {
     auto &result = results.emplace_back();
     result.timePoint = timePoints[i];
-    auto img = sim->getConcImage(i, {}, true);
-    auto shape = img.volume();
-    result.concentration_image = toPyImageRgb(img);
+    result.concentration_image =
+        toPyImageRgb(sim->getConcImage(i, {}, true, false, imageSize));
     for (std::size_t ci = 0; ci < sim->getCompartmentIds().size(); ++ci) {
       const auto &names{sim->getPyNames(ci)};
       auto concs{sim->getPyConcs(i, ci)};
@@ -452,6 +631,29 @@ constructSimulationResults(const ::sme::simulate::Simulation *sim,
   return results;
 }
 
+static SimulationResult constructSteadyStateResult(
+    ::sme::simulate::SteadyStateSimulation &steadyStateSim,
+    const ::sme::model::Model &model, double timePoint) {
+  SimulationResult result;
+  const auto &speciesIdxs{steadyStateSim.getCompartmentSpeciesIdxs()};
+  auto img{steadyStateSim.getConcentrationImage(speciesIdxs, false)};
+  auto shape{img.volume()};
+  result.timePoint = timePoint;
+  result.concentration_image = toPyImageRgb(img);
+  const auto &speciesIds{steadyStateSim.getCompartmentSpeciesIds()};
+  for (std::size_t ci = 0; ci < speciesIds.size(); ++ci) {
+    auto concs{steadyStateSim.getPyConcs(ci)};
+    for (std::size_t si = 0; si < speciesIds[ci].size(); ++si) {
+      auto name{model.getSpecies()
+                    .getName(speciesIds[ci][si].c_str())
+                    .toStdString()};
+      result.species_concentration[nanobind::str(name.data(), name.size())] =
+          as_ndarray(std::move(concs[si]), shape);
+    }
+  }
+  return result;
+}
+
 void Model::init() {
   if (!s->getIsValid()) {
     throw std::invalid_argument("Failed to open model: " +
@@ -488,12 +690,18 @@ Model::Model(const std::string &filename) {
 }
 
 void Model::importFile(const std::string &filename) {
+  // any existing simulation or solver state refers to the previous model
+  sim.reset();
+  solverCheckpoint.reset();
   s = std::make_unique<::sme::model::Model>();
   s->importFile(filename);
   init();
 }
 
 void Model::importSbmlString(const std::string &xml) {
+  // any existing simulation or solver state refers to the previous model
+  sim.reset();
+  solverCheckpoint.reset();
   s = std::make_unique<::sme::model::Model>();
   s->importSBMLString(xml);
   init();
@@ -544,7 +752,8 @@ std::vector<SimulationResult> Model::simulateString(
     std::optional<::sme::simulate::SimulatorType> simulatorType,
     bool continueExistingSimulation, bool returnResults,
     std::optional<int> nThreads,
-    const std::optional<SimulationSettings> &simulationSettingsOverride) {
+    const std::optional<SimulationSettings> &simulationSettingsOverride,
+    const std::optional<std::pair<int, int>> &imageSize) {
   QElapsedTimer simulationRuntimeTimer;
   simulationRuntimeTimer.start();
   double timeoutMillisecs{static_cast<double>(timeoutSeconds) * 1000.0};
@@ -595,12 +804,19 @@ std::vector<SimulationResult> Model::simulateString(
         "No simulation times specified: set simulation_time/image_interval, "
         "or set simulation_settings.times");
   }
-  // ensure any existing DUNE objects are destroyed to avoid later segfaults
-  sim.reset();
-  sim = std::make_unique<::sme::simulate::Simulation>(*(s.get()));
+  resetSimulation(continueExistingSimulation);
   if (const auto &e = sim->errorMessage(); !e.empty()) {
     throw std::runtime_error(fmt::format("Error in simulation setup: {}", e));
   }
+  if (solverCheckpoint.has_value()) {
+    // resume the solver from the state at the end of the previous simulation
+    sim->applySolverCheckpoint(solverCheckpoint.value());
+    solverCheckpoint.reset();
+  }
+  const auto displaySize{toQSize(imageSize)};
+  if (returnResults && !displaySize.isEmpty()) {
+    sim->setConcImageDisplaySize(displaySize);
+  }
   sim->doMultipleTimesteps(times, timeoutMillisecs, []() {
     if (PyErr_CheckSignals() != 0) {
       throw nanobind::python_error();
@@ -611,7 +827,7 @@ std::vector<SimulationResult> Model::simulateString(
     throw std::runtime_error(fmt::format("Error during simulation: {}", e));
   }
   if (returnResults) {
-    return constructSimulationResults(sim.get(), *s, true);
+    return constructSimulationResults(sim.get(), *s, true, displaySize);
   }
   return {};
 }
@@ -622,7 +838,8 @@ std::vector<SimulationResult> Model::simulateFloat(
     std::optional<::sme::simulate::SimulatorType> simulatorType,
     bool continueExistingSimulation, bool returnResults,
     std::optional<int> nThreads,
-    const std::optional<SimulationSettings> &simulationSettingsOverride) {
+    const std::optional<SimulationSettings> &simulationSettingsOverride,
+    const std::optional<std::pair<int, int>> &imageSize) {
   if (simulationTime.has_value() != imageInterval.has_value()) {
     throw std::invalid_argument("simulation_time and image_interval must both "
                                 "be set or both be omitted");
@@ -633,21 +850,133 @@ std::vector<SimulationResult> Model::simulateFloat(
         QString::number(imageInterval.value(), 'g', 17).toStdString(),
         timeoutSeconds, throwOnTimeout, simulatorType,
         continueExistingSimulation, returnResults, nThreads,
-        simulationSettingsOverride);
+        simulationSettingsOverride, imageSize);
   }
   return simulateString(std::nullopt, std::nullopt, timeoutSeconds,
                         throwOnTimeout, simulatorType,
                         continueExistingSimulation, returnResults, nThreads,
-                        simulationSettingsOverride);
+                        simulationSettingsOverride, imageSize);
 }
 
-std::vector<SimulationResult> Model::getSimulationResults() {
-  sim.reset();
-  sim = std::make_unique<::sme::simulate::Simulation>(*s);
+std::vector<SimulationResult> Model::getSimulationResults(
+    const std::optional<std::pair<int, int>> &imageSize) {
+  resetSimulation(true);
   if (const auto &e{sim->errorMessage()}; !e.empty()) {
     throw std::runtime_error(fmt::format("Error in simulation setup: {}", e));
   }
-  return constructSimulationResults(sim.get(), *s, false);
+  const auto displaySize{toQSize(imageSize)};
+  if (!displaySize.isEmpty()) {
+    sim->setConcImageDisplaySize(displaySize);
+  }
+  return constructSimulationResults(sim.get(), *s, false, displaySize);
+}
+
+SimulationResult Model::steadyState(
+    double tolerance, std::size_t stepsToConvergence,
+    ::sme::simulate::SteadyStateConvergenceMode convergenceMode,
+    int timeoutSeconds, double dt,
+    ::sme::simulate::SteadyStateSolverType solverType) {
+  double timeoutMillisecs{static_cast<double>(timeoutSeconds) * 1000.0};
+  // the steady state simulation clears any existing simulation results
+  sim.reset();
+  solverCheckpoint.reset();
+  ::sme::simulate::SteadyStateSimulation steadyStateSim(
+      *s, tolerance, stepsToConvergence, convergenceMode, timeoutMillisecs, dt,
+      solverType);
+  steadyStateSim.run();
+  if (const auto &e{steadyStateSim.getSolverErrormessage()}; !e.empty()) {
+    throw std::runtime_error(fmt::format("Error during steady state: {}", e));
+  }
+  if (!steadyStateSim.hasConverged()) {
+    throw std::runtime_error(fmt::format(
+        "Steady state did not converge: latest error {} above tolerance {}",
+        steadyStateSim.getLatestError(), tolerance));
+  }
+  return constructSteadyStateResult(steadyStateSim, *s,
+                                    steadyStateSim.getLatestStep());
+}
+
+std::vector<std::pair<double, SimulationResult>>
+Model::steadyStateContinuation(
+    const std::string &parameterName, double start, double end,
+    double initialStep, double minStep, std::optional<double> maxStep,
+    double tolerance, std::size_t stepsToConvergence,
+    ::sme::simulate::SteadyStateConvergenceMode convergenceMode,
+    int timeoutSeconds, double dt,
+    ::sme::simulate::SteadyStateSolverType solverType) {
+  ::sme::simulate::SteadyStateContinuationOptions options;
+  const auto &parameters{s->getParameters()};
+  for (const auto &id : parameters.getIds()) {
+    if (parameters.getName(id).toStdString() == parameterName) {
+      options.parameterId = id.toStdString();
+    }
+  }
+  if (options.parameterId.empty()) {
+    throw std::invalid_argument(
+        fmt::format("Parameter '{}' not found", parameterName));
+  }
+  options.start = start;
+  options.end = end;
+  options.initialStep = initialStep;
+  options.minStep = minStep;
+  if (maxStep.has_value()) {
+    options.maxStep = maxStep.value();
+  }
+  double timeoutMillisecs{static_cast<double>(timeoutSeconds) * 1000.0};
+  sim.reset();
+  solverCheckpoint.reset();
+  ::sme::simulate::SteadyStateSimulation steadyStateSim(
+      *s, tolerance, stepsToConvergence, convergenceMode, timeoutMillisecs, dt,
+      solverType);
+  std::vector<std::pair<double, SimulationResult>> results;
+  steadyStateSim.runContinuation(
+      options,
+      [&](const ::sme::simulate::SteadyStateContinuationPoint &point) {
+        if (PyErr_CheckSignals() != 0) {
+          throw nanobind::python_error();
+        }
+        results.emplace_back(point.parameterValue,
+                             constructSteadyStateResult(steadyStateSim, *s,
+                                                        point.steps));
+      });
+  return results;
+}
+
+void Model::resetSimulation(bool keepSolverState) {
+  if (!keepSolverState) {
+    solverCheckpoint.reset();
+  } else if (sim != nullptr && !solverCheckpoint.has_value()) {
+    // keep the solver state to be able to continue this simulation later
+    solverCheckpoint = sim->getSolverCheckpoint();
+  }
+  // ensure any existing DUNE objects are destroyed to avoid later segfaults
+  sim.reset();
+  sim = std::make_unique<::sme::simulate::Simulation>(*s);
+}
+
+void Model::exportSolverCheckpoint(const std::string &filename) {
+  std::optional<::sme::simulate::SolverCheckpoint> checkpoint{
+      solverCheckpoint};
+  if (!checkpoint.has_value() && sim != nullptr) {
+    checkpoint = sim->getSolverCheckpoint();
+  }
+  if (!checkpoint.has_value()) {
+    throw std::runtime_error("No solver state available: run a simulation "
+                             "before exporting a solver checkpoint");
+  }
+  if (!::sme::simulate::exportSolverCheckpoint(filename, checkpoint.value())) {
+    throw std::runtime_error(
+        fmt::format("Failed to write solver checkpoint '{}'", filename));
+  }
+}
+
+void Model::importSolverCheckpoint(const std::string &filename) {
+  auto checkpoint{::sme::simulate::importSolverCheckpoint(filename)};
+  if (!checkpoint.has_value()) {
+    throw std::invalid_argument(
+        fmt::format("Failed to read solver checkpoint '{}'", filename));
+  }
+  solverCheckpoint = std::move(checkpoint);
 }
 
 std::string Model::getStr() const {
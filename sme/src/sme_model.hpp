@@ -2,6 +2,7 @@
 
 #include "sme/model.hpp"
 #include "sme/simulate.hpp"
+#include "sme/simulate_steadystate.hpp"
 #include "sme_common.hpp"
 #include "sme_compartment.hpp"
 #include "sme_membrane.hpp"
@@ -11,6 +12,7 @@
 #include <nanobind/nanobind.h>
 #include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace pysme {
@@ -23,7 +25,9 @@ class Model {
 private:
   std::unique_ptr<::sme::model::Model> s;
   std::unique_ptr<::sme::simulate::Simulation> sim;
+  std::optional<::sme::simulate::SolverCheckpoint> solverCheckpoint;
   void init();
+  void resetSimulation(bool keepSolverState);
 
 public:
   explicit Model(const std::string &filename = {});
@@ -47,15 +51,32 @@ public:
       std::optional<::sme::simulate::SimulatorType> simulatorType,
       bool continueExistingSimulation, bool returnResults,
       std::optional<int> nThreads,
-      const std::optional<SimulationSettings> &simulationSettingsOverride);
+      const std::optional<SimulationSettings> &simulationSettingsOverride,
+      const std::optional<std::pair<int, int>> &imageSize);
   std::vector<SimulationResult> simulateFloat(
       std::optional<double> simulationTime, std::optional<double> imageInterval,
       int timeoutSeconds, bool throwOnTimeout,
       std::optional<::sme::simulate::SimulatorType> simulatorType,
       bool continueExistingSimulation, bool returnResults,
       std::optional<int> nThreads,
-      const std::optional<SimulationSettings> &simulationSettingsOverride);
-  std::vector<SimulationResult> getSimulationResults();
+      const std::optional<SimulationSettings> &simulationSettingsOverride,
+      const std::optional<std::pair<int, int>> &imageSize);
+  std::vector<SimulationResult>
+  getSimulationResults(const std::optional<std::pair<int, int>> &imageSize);
+  SimulationResult
+  steadyState(double tolerance, std::size_t stepsToConvergence,
+              ::sme::simulate::SteadyStateConvergenceMode convergenceMode,
+              int timeoutSeconds, double dt,
+              ::sme::simulate::SteadyStateSolverType solverType);
+  std::vector<std::pair<double, SimulationResult>> steadyStateContinuation(
+      const std::string &parameterName, double start, double end,
+      double initialStep, double minStep, std::optional<double> maxStep,
+      double tolerance, std::size_t stepsToConvergence,
+      ::sme::simulate::SteadyStateConvergenceMode convergenceMode,
+      int timeoutSeconds, double dt,
+      ::sme::simulate::SteadyStateSolverType solverType);
+  void exportSolverCheckpoint(const std::string &filename);
+  void importSolverCheckpoint(const std::string &filename);
   [[nodiscard]] std::string getStr() const;
 };
 
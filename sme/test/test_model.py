@@ -261,7 +261,17 @@ def test_simulate():
     settings.options.dune.integrator = "Alexander2"
     settings.options.dune.write_vtk_files = False
     settings.options.dune.max_threads = 1
+    assert settings.options.dune.preconditioner == ""
+    settings.options.dune.preconditioner = "ILU"
     m.simulation_settings = settings
+    assert m.simulation_settings.options.dune.preconditioner == "ILU"
+    assert m.simulation_settings.options.dune.adaptive_mesh is False
+    assert m.simulation_settings.options.dune.adaptive_max_level == 2
+    assert m.simulation_settings.options.dune.adaptive_interval == 10
+    assert (
+        m.simulation_settings.options.dune.discretization
+        == sme.DuneDiscretizationType.FEM1
+    )
     sim_results = m.simulate(0.002, 0.001, return_results=False)
     assert len(sim_results) == 0
     assert len(m.simulation_results()) == 3
@@ -300,6 +310,103 @@ def test_simulation_result_feature_values():
     )
 
 
+def test_simulate_image_size():
+    m = sme.open_example_model()
+    full_shape = m.compartment_image.shape
+    assert full_shape == (1, 100, 100, 3)
+    # concentration images rendered from downsampled concentrations
+    sim_results = m.simulate(
+        0.002, 0.001, simulator_type=sme.SimulatorType.Pixel, image_size=(25, 25)
+    )
+    assert len(sim_results) == 3
+    for res in sim_results:
+        assert res.concentration_image.shape == (1, 25, 25, 3)
+        assert res.species_concentration["A_cell"].shape == full_shape[:-1]
+    assert m.simulation_results(image_size=(50, 60))[
+        -1
+    ].concentration_image.shape == (1, 50, 50, 3)
+    # full resolution by default
+    assert m.simulation_results()[-1].concentration_image.shape == full_shape
+    with pytest.raises(ValueError):
+        m.simulation_results(image_size=(0, 10))
+
+
+def test_steady_state():
+    m = sme.open_example_model("gray-scott")
+    # Newton-Krylov requires the Pixel simulator
+    m.simulation_settings.simulator_type = sme.SimulatorType.DUNE
+    with pytest.raises(RuntimeError):
+        m.steady_state(solver=sme.SteadyStateSolverType.newton_krylov)
+    m.simulation_settings.simulator_type = sme.SimulatorType.Pixel
+    result = m.steady_state(
+        tolerance=1e-3,
+        convergence_mode=sme.SteadyStateConvergenceMode.relative,
+        solver=sme.SteadyStateSolverType.newton_krylov,
+    )
+    assert set(result.species_concentration.keys()) == {"U", "V"}
+    assert result.species_concentration["U"].shape == m.compartment_image.shape[:-1]
+    assert result.concentration_image.shape == m.compartment_image.shape
+    assert np.all(np.isfinite(result.species_concentration["U"]))
+    # unreachable tolerance: no convergence before the timeout
+    with pytest.raises(RuntimeError):
+        m.steady_state(tolerance=1e-30, timeout_seconds=1)
+
+
+def test_steady_state_continuation():
+    m = sme.open_example_model("gray-scott")
+    m.simulation_settings.simulator_type = sme.SimulatorType.Pixel
+    results = m.steady_state_continuation(
+        "k", start=0.06, end=0.062, initial_step=0.001, tolerance=1e-3
+    )
+    assert len(results) >= 2
+    assert results[0][0] == pytest.approx(0.06)
+    assert results[-1][0] == pytest.approx(0.062)
+    for value, result in results:
+        assert set(result.species_concentration.keys()) == {"U", "V"}
+        assert np.all(np.isfinite(result.species_concentration["V"]))
+    # model parameter is not modified
+    assert m.parameters["k"].value == "0.06"
+    with pytest.raises(ValueError):
+        m.steady_state_continuation("not_a_parameter", 0.0, 1.0, 0.1)
+
+
+def test_solver_checkpoint(tmp_path):
+    m = sme.open_example_model("ABtoC")
+    with pytest.raises(RuntimeError):
+        m.export_solver_checkpoint(str(tmp_path / "none.bin"))
+    with pytest.raises(ValueError):
+        m.import_solver_checkpoint(str(tmp_path / "missing.bin"))
+    sim_results = m.simulate(0.002, 0.001, simulator_type=sme.SimulatorType.Pixel)
+    assert len(sim_results) == 3
+    tmp_model = str(tmp_path / "tmp.sme")
+    tmp_checkpoint = str(tmp_path / "tmp.checkpoint")
+    m.export_sme_file(tmp_model)
+    m.export_solver_checkpoint(tmp_checkpoint)
+    # re-open the model and continue the simulation from the checkpoint
+    m2 = sme.open_file(tmp_model)
+    m2.import_solver_checkpoint(tmp_checkpoint)
+    sim_results2 = m2.simulate(
+        0.002,
+        0.001,
+        simulator_type=sme.SimulatorType.Pixel,
+        continue_existing_simulation=True,
+    )
+    assert len(sim_results2) == 5
+    # continue the original simulation within this session
+    sim_results = m.simulate(
+        0.002,
+        0.001,
+        simulator_type=sme.SimulatorType.Pixel,
+        continue_existing_simulation=True,
+    )
+    assert len(sim_results) == 5
+    for species in ["A", "B", "C"]:
+        assert np.allclose(
+            sim_results[4].species_concentration[species],
+            sim_results2[4].species_concentration[species],
+        )
+
+
 def test_simulate_3d():
     for sim_type in [sme.SimulatorType.DUNE, sme.SimulatorType.Pixel]:
         m = sme.open_example_model("very-simple-model-3d")